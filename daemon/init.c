@@ -45,6 +45,10 @@
 #include <wait.h>
 #endif
 #include <string.h>
+#include <unistd.h>
+
+/** nr. of one second alarms between sample files sync and stats report */
+#define OPD_SYNC_TICKS (60 * 10)
 
 size_t kernel_pointer_size;
 
@@ -147,7 +151,12 @@ static void opd_do_samples(char const * opd_buf, ssize_t count)
  
 	opd_process_samples(opd_buf, num);
 
-	complete_dump();
+	/* opcontrol --dump removes the status file then waits for it, pending
+	 * sample counts must reach the sample files before it is re-created */
+	if (access(op_dump_status, F_OK)) {
+		sfile_flush_files();
+		complete_dump();
+	}
 }
  
 static void opd_do_jitdumps(void)
@@ -255,12 +264,18 @@ static void opd_do_read(char * buf, size_t size)
 }
 
 
-/** opd_alarm - sync files and report stats */
+/** opd_alarm - update live stats, periodically sync files and report stats */
 static void opd_alarm(void)
 {
-	sfile_sync_files();
-	opd_print_stats();
-	alarm(60 * 10);
+	static unsigned int ticks;
+
+	opd_write_live_stats();
+	if (++ticks == OPD_SYNC_TICKS) {
+		ticks = 0;
+		sfile_sync_files();
+		opd_print_stats();
+	}
+	alarm(1);
 }
  
 
@@ -285,6 +300,7 @@ static void clean_exit(void)
 
 static void opd_sigterm(void)
 {
+	sfile_flush_files();
 	opd_do_jitdumps();
 	opd_print_stats();
 	printf("oprofiled stopped %s", op_get_time());
@@ -310,7 +326,6 @@ static void opd_sigchild(void)
  
 static void opd_26_init(void)
 {
-	size_t i;
 	size_t opd_buf_size;
 	unsigned long long start_time = 0ULL;
 	struct timeval tv;
@@ -327,8 +342,7 @@ static void opd_26_init(void)
 
 	opd_reread_module_info();
 
-	for (i = 0; i < OPD_MAX_STATS; i++)
-		opd_stats[i] = 0;
+	opd_stats_init();
 
 	perfmon_init();
 
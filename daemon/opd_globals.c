@@ -0,0 +1,149 @@
+/**
+ * @file daemon/opd_globals.c
+ * Daemon state and helpers shared by oprofiled and its tests
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "config.h"
+
+#include "oprofiled.h"
+#include "opd_printf.h"
+
+#include "op_config.h"
+#include "op_libiberty.h"
+#include "op_string.h"
+#include "op_cpu_type.h"
+#include "op_list.h"
+#include "op_fileio.h"
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+sig_atomic_t signal_alarm;
+sig_atomic_t signal_hup;
+sig_atomic_t signal_term;
+sig_atomic_t signal_child;
+sig_atomic_t signal_usr1;
+sig_atomic_t signal_usr2;
+
+uint op_nr_counters;
+op_cpu cpu_type;
+int no_event_ok;
+int vsfile;
+int vsamples;
+int varcs;
+int vmodule;
+int vmisc;
+int vext;
+int separate_lib;
+int separate_kernel;
+int separate_thread;
+int separate_cpu;
+int no_vmlinux;
+char * vmlinux;
+char * kernel_range;
+char * session_dir;
+int no_xen;
+char * xenimage;
+char * xen_range;
+
+#define OPD_IMAGE_FILTER_HASH_SIZE 32
+static struct list_head images_filter[OPD_IMAGE_FILTER_HASH_SIZE];
+static int filter_images;
+
+
+void opd_open_logfile(void)
+{
+	if (open(op_log_file, O_WRONLY|O_CREAT|O_NOCTTY|O_APPEND, 0644) == -1) {
+		perror("oprofiled: couldn't re-open stdout: ");
+		exit(EXIT_FAILURE);
+	}
+
+	if (dup2(1, 2) == -1) {
+		perror("oprofiled: couldn't dup stdout to stderr: ");
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+struct opd_hashed_name {
+	char * name;
+	struct list_head next;
+};
+
+
+static void add_image_filter(char const * name)
+{
+	size_t hash;
+	struct opd_hashed_name * elt = xmalloc(sizeof(struct opd_hashed_name));
+	elt->name = xmalloc(PATH_MAX);
+	if (!realpath(name, elt->name)) {
+		free(elt->name);
+		free(elt);
+		return;
+	}
+	hash = op_hash_string(elt->name);
+	verbprintf(vmisc, "Adding to image filter: \"%s\"\n", elt->name);
+	list_add(&elt->next, &images_filter[hash % OPD_IMAGE_FILTER_HASH_SIZE]);
+}
+
+
+void opd_parse_image_filter(char const * filter)
+{
+	size_t i;
+	char const * last = filter;
+	char const * cur = filter;
+
+	if (!filter)
+		return;
+
+	filter_images = 1;
+
+	for (i = 0; i < OPD_IMAGE_FILTER_HASH_SIZE; ++i)
+		list_init(&images_filter[i]);
+
+	while ((cur = strchr(last, ',')) != NULL) {
+		char * tmp = op_xstrndup(last, cur - last);
+		add_image_filter(tmp);
+		free(tmp);
+		last = cur + 1;
+	}
+	add_image_filter(last);
+}
+
+
+int is_image_ignored(char const * name)
+{
+	size_t hash;
+	struct list_head * pos;
+
+	if (!filter_images)
+		return 0;
+
+	hash = op_hash_string(name);
+
+	list_for_each(pos, &images_filter[hash % OPD_IMAGE_FILTER_HASH_SIZE]) {
+		struct opd_hashed_name * hashed_name =
+			list_entry(pos, struct opd_hashed_name, next);
+		if (!strcmp(hashed_name->name, name))
+			return 0;
+	}
+
+	return 1;
+}
+
+
+/** return the int in the given oprofilefs file */
+int opd_read_fs_int(char const * path, char const * name, int fatal)
+{
+	char filename[PATH_MAX + 1];
+	snprintf(filename, PATH_MAX, "%s/%s", path, name);
+	return op_read_int_from_file(filename, fatal);
+}
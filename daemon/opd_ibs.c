@@ -37,8 +37,6 @@
 
 extern op_cpu cpu_type;
 extern int no_event_ok;
-extern int sfile_equal(struct sfile const * sf, struct sfile const * sf2);
-extern void sfile_dup(struct sfile * to, struct sfile * from);
 extern char * session_dir;
 
 /* IBS Select Counters */
@@ -743,8 +741,6 @@ static odb_t * ibs_sfile_get(struct transient const * trans, int is_cg)
 	struct sfile * sf = trans->current;
 	struct sfile * last = trans->last;
 	struct cg_entry * cg;
-	struct list_head * pos;
-	unsigned long hash;
 	odb_t * file;
 	unsigned long counter, ibs_vci, key;
 
@@ -768,22 +764,7 @@ static odb_t * ibs_sfile_get(struct transient const * trans, int is_cg)
 	if (!is_cg)
 		goto open;
 
-	hash = last->hashval & (CG_HASH_SIZE - 1);
-
-	/* Need to look for the right 'to'. Since we're looking for
-	 * 'last', we use its hash.
-	 */
-	list_for_each(pos, &sf->cg_hash[hash]) {
-		cg = list_entry(pos, struct cg_entry, hash);
-		if (sfile_equal(last, &cg->to)) {
-			file = &(cg->to.ext_files[ibs_vci]);
-			goto open;
-		}
-	}
-
-	cg = xmalloc(sizeof(struct cg_entry));
-	sfile_dup(&cg->to, last);
-	list_add(&cg->hash, &sf->cg_hash[hash]);
+	cg = sfile_find_cg(sf, last);
 	file = &(cg->to.ext_files[ibs_vci]);
 
 open:
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/time.h>
 
 
 static char const * get_dep_name(struct sfile const * sf)
@@ -148,6 +149,7 @@ int opd_open_sample_file(odb_t *file, struct sfile *last,
 	char const * binary;
 	int spu_profile = 0;
 	vma_t last_start = 0;
+	struct timeval start, end;
 	int err;
 
 	mangled = mangle_filename(last, sf, counter, cg);
@@ -169,8 +171,14 @@ int opd_open_sample_file(odb_t *file, struct sfile *last,
 	if (sf != last)
 		sfile_get(last);
 
+	/* make room before running out of fds or address space */
+	if (sfile_lru_full())
+		sfile_lru_clear();
+
 retry:
+	gettimeofday(&start, NULL);
 	err = odb_open(file, mangled, ODB_RDWR, sizeof(struct opd_header));
+	gettimeofday(&end, NULL);
 
 	/* This can naturally happen when racing against opcontrol --reset. */
 	if (err) {
@@ -187,6 +195,9 @@ retry:
 		goto out;
 	}
 
+	sfile_lru_opened(file, (end.tv_sec - start.tv_sec) * 1000000ULL +
+	                 end.tv_usec - start.tv_usec);
+
 	if (!sf->kernel)
 		binary = find_cookie(sf->cookie);
 	else
@@ -22,6 +22,7 @@
 
 #include "op_libiberty.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -79,8 +80,14 @@ struct kern_cmdline {
 	unsigned int has_cmdline;
 };
 
-/** All sfiles are on this list. */
-static LIST_HEAD(lru_list);
+/** All cg_entry are hashed on their caller and callee id */
+static struct op_arc_hash arcs = OP_ARC_HASH_INIT;
+
+/** source of sfile ids */
+static unsigned long last_sfile_id;
+
+/** All sfiles are on this list, bounded by opened fds and mapped bytes. */
+static odb_lru_t lru = { LIST_HEAD_INIT(lru.list), 0, 0, { 0, 0, 0, 0 } };
 
 
 /* FIXME: can undoubtedly improve this hashing */
@@ -216,6 +223,7 @@ create_sfile(unsigned long hash, struct transient const * trans,
 	sf = xmalloc(sizeof(struct sfile));
 
 	sf->hashval = hash;
+	sf->id = ++last_sfile_id;
 
 	/* The logic here: if we're in the kernel, the cached cookie is
 	 * meaningless (though not the app_cookie if separate_kernel)
@@ -239,6 +247,10 @@ create_sfile(unsigned long hash, struct transient const * trans,
 	for (i = 0; i < CG_HASH_SIZE; ++i)
 		list_init(&sf->cg_hash[i]);
 
+	sf->aggr = NULL;
+
+	odb_lru_entry_init(&sf->lru);
+
 	if (separate_thread)
 		sf->tid = trans->tid;
 	if (separate_thread || trans->cookie == NO_COOKIE)
@@ -265,6 +277,13 @@ create_sfile(unsigned long hash, struct transient const * trans,
 
 
 struct sfile * sfile_find(struct transient const * trans)
+{
+	return sfile_find_count(trans, 1);
+}
+
+
+struct sfile * sfile_find_count(struct transient const * trans,
+                                unsigned long int count)
 {
 	struct sfile * sf;
 	struct list_head * pos;
@@ -277,7 +296,7 @@ struct sfile * sfile_find(struct transient const * trans)
 	if (trans->in_kernel == -1) {
 		verbprintf(vsamples, "Losing sample at 0x%llx of unknown provenance.\n",
 		           trans->pc);
-		opd_stats[OPD_NO_CTX]++;
+		opd_stats[OPD_NO_CTX] += count;
 		return NULL;
 	}
 
@@ -286,7 +305,7 @@ struct sfile * sfile_find(struct transient const * trans)
 		ki = find_kernel_image(trans);
 		if (!ki) {
 			verbprintf(vsamples, "Lost kernel sample %llx\n", trans->pc);
-			opd_stats[OPD_LOST_KERNEL]++;
+			opd_stats[OPD_LOST_KERNEL] += count;
 			return NULL;
 		}
 		// We *know* that PID 0, 1, and 2 are pure kernel context tasks, so
@@ -310,7 +329,7 @@ struct sfile * sfile_find(struct transient const * trans)
 						           "Dropping user context kernel sample 0x%llx "
 						           "for process %u due to no app cookie available.\n",
 						           (unsigned long long)trans->pc, trans->tgid);
-						opd_stats[OPD_NO_APP_KERNEL_SAMPLE]++;
+						opd_stats[OPD_NO_APP_KERNEL_SAMPLE] += count;
 						return NULL;
 					}
 					break;
@@ -330,7 +349,7 @@ struct sfile * sfile_find(struct transient const * trans)
 					           "Open of /proc/%u/cmdline failed, so dropping "
 					           "kernel sameple 0x%llx\n",
 					           trans->tgid, (unsigned long long)trans->pc);
-					opd_stats[OPD_NO_APP_KERNEL_SAMPLE]++;
+					opd_stats[OPD_NO_APP_KERNEL_SAMPLE] += count;
 					dropped = 1;
 				} else {
 					if((read(fd, dst, 8) < 1)) {
@@ -342,7 +361,7 @@ struct sfile * sfile_find(struct transient const * trans)
 						dst[7] = '\0';
 						verbprintf(vsamples, "Start of cmdline for PID %u is %s\n", trans->tgid, dst);
 						kcmd->has_cmdline = 1;
-						opd_stats[OPD_NO_APP_KERNEL_SAMPLE]++;
+						opd_stats[OPD_NO_APP_KERNEL_SAMPLE] += count;
 						dropped = 1;
 					}
 					close(fd);
@@ -358,15 +377,17 @@ struct sfile * sfile_find(struct transient const * trans)
 			printf("No anon map for pc %llx, app %s.\n",
 			       trans->pc, app);
 		}
-		opd_stats[OPD_LOST_NO_MAPPING]++;
+		opd_stats[OPD_LOST_NO_MAPPING] += count;
 		return NULL;
 	}
 
 find_sfile:
+	opd_stats[OPD_SFILE_LOOKUPS] += count;
 	hash = sfile_hash(trans, ki);
 	list_for_each(pos, &hashes[hash]) {
 		sf = list_entry(pos, struct sfile, hash);
 		if (trans_match(trans, sf, ki)) {
+			opd_stats[OPD_SFILE_HITS] += count;
 			sfile_get(sf);
 			goto lru;
 		}
@@ -395,8 +416,48 @@ void sfile_dup(struct sfile * to, struct sfile * from)
 	for (i = 0; i < CG_HASH_SIZE; ++i)
 		list_init(&to->cg_hash[i]);
 
+	to->aggr = NULL;
+
 	list_init(&to->hash);
-	list_init(&to->lru);
+	odb_lru_entry_init(&to->lru);
+}
+
+
+struct cg_entry * sfile_find_cg(struct sfile * sf, struct sfile * last)
+{
+	struct cg_entry * cg;
+	struct op_arc * arc;
+	struct list_head * pos;
+	unsigned long hash;
+
+	/* fast path, integer compare on the (caller, callee id) hash */
+	arc = op_arc_hash_find(&arcs, sf->id, last->id);
+	if (arc)
+		return list_entry(arc, struct cg_entry, arc);
+
+	hash = last->hashval & (CG_HASH_SIZE - 1);
+
+	/* 'last' can be a new instance of an evicted sfile, still pointed
+	 * to by an entry under its old id. Since we're looking for 'last',
+	 * we use its hash.
+	 */
+	list_for_each(pos, &sf->cg_hash[hash]) {
+		cg = list_entry(pos, struct cg_entry, hash);
+		if (sfile_equal(last, &cg->to)) {
+			op_arc_hash_del(&arcs, &cg->arc);
+			cg->to.id = last->id;
+			op_arc_hash_add(&arcs, &cg->arc, sf->id, last->id);
+			return cg;
+		}
+	}
+
+	cg = xmalloc(sizeof(struct cg_entry));
+	sfile_dup(&cg->to, last);
+	cg->from = sf;
+	list_add(&cg->hash, &sf->cg_hash[hash]);
+	op_arc_hash_add(&arcs, &cg->arc, sf->id, last->id);
+
+	return cg;
 }
 
 
@@ -405,8 +466,6 @@ static odb_t * get_file(struct transient const * trans, int is_cg)
 	struct sfile * sf = trans->current;
 	struct sfile * last = trans->last;
 	struct cg_entry * cg;
-	struct list_head * pos;
-	unsigned long hash;
 	odb_t * file;
 
 	if ((trans->ext) != NULL)
@@ -423,22 +482,7 @@ static odb_t * get_file(struct transient const * trans, int is_cg)
 	if (!is_cg)
 		goto open;
 
-	hash = last->hashval & (CG_HASH_SIZE - 1);
-
-	/* Need to look for the right 'to'. Since we're looking for
-	 * 'last', we use its hash.
-	 */
-	list_for_each(pos, &sf->cg_hash[hash]) {
-		cg = list_entry(pos, struct cg_entry, hash);
-		if (sfile_equal(last, &cg->to)) {
-			file = &cg->to.files[trans->event];
-			goto open;
-		}
-	}
-
-	cg = xmalloc(sizeof(struct cg_entry));
-	sfile_dup(&cg->to, last);
-	list_add(&cg->hash, &sf->cg_hash[hash]);
+	cg = sfile_find_cg(sf, last);
 	file = &cg->to.files[trans->event];
 
 open:
@@ -529,6 +573,64 @@ static void sfile_log_arc(struct transient const * trans)
 		fprintf(stderr, "%s: %s\n", __FUNCTION__, strerror(err));
 		abort();
 	}
+
+	odb_lru_hit(&trans->current->lru, 1);
+}
+
+
+static void aggr_write(struct sfile * sf, struct sfile_aggr_entry * entry)
+{
+	int err = odb_update_node_with_offset(&sf->files[entry->counter],
+	                                      (odb_key_t)entry->pc,
+	                                      entry->count);
+	if (err) {
+		fprintf(stderr, "%s: %s\n", __FUNCTION__, strerror(err));
+		abort();
+	}
+
+	entry->count = 0;
+}
+
+
+/*
+ * Samples are counted in a small direct mapped table in front of the
+ * sample files, hot pcs are then updated in cache resident memory rather
+ * than in the shared mapping. An entry is written back when evicted by
+ * another pc and the whole table on sfile close, sync or dump.
+ */
+static void aggr_add(struct sfile * sf, unsigned long counter, vma_t pc,
+                     unsigned long count)
+{
+	struct sfile_aggr_entry * entry;
+
+	if (!sf->aggr)
+		sf->aggr = xcalloc(SFILE_AGGR_SIZE, sizeof(struct sfile_aggr_entry));
+
+	entry = &sf->aggr[((pc >> 2) ^ (pc >> 11) ^ counter) & (SFILE_AGGR_SIZE - 1)];
+
+	if (entry->count && (entry->pc != pc || entry->counter != counter ||
+	                     count > UINT_MAX - entry->count))
+		aggr_write(sf, entry);
+
+	if (!entry->count) {
+		entry->pc = pc;
+		entry->counter = counter;
+	}
+	entry->count += count;
+}
+
+
+static void aggr_flush(struct sfile * sf)
+{
+	size_t i;
+
+	if (!sf->aggr)
+		return;
+
+	for (i = 0; i < SFILE_AGGR_SIZE; ++i) {
+		if (sf->aggr[i].count)
+			aggr_write(sf, &sf->aggr[i]);
+	}
 }
 
 
@@ -566,7 +668,14 @@ void sfile_log_sample_count(struct transient const * trans,
 		verbose_sample(trans, pc);
 
 	if (!file) {
-		opd_stats[OPD_LOST_SAMPLEFILE]++;
+		opd_stats[OPD_LOST_SAMPLEFILE] += count;
+		return;
+	}
+
+	odb_lru_hit(&trans->current->lru, count);
+
+	if (!trans->ext) {
+		aggr_add(trans->current, trans->event, pc, count);
 		return;
 	}
 
@@ -584,6 +693,10 @@ static int close_sfile(struct sfile * sf, void * data __attribute__((unused)))
 {
 	size_t i;
 
+	aggr_flush(sf);
+	free(sf->aggr);
+	sf->aggr = NULL;
+
 	/* it's OK to close a non-open odb file */
 	for (i = 0; i < op_nr_counters; ++i)
 		odb_close(&sf->files[i]);
@@ -598,7 +711,14 @@ static void kill_sfile(struct sfile * sf)
 {
 	close_sfile(sf, NULL);
 	list_del(&sf->hash);
-	list_del(&sf->lru);
+	list_del(&sf->lru.list);
+}
+
+
+static int flush_sfile(struct sfile * sf, void * data __attribute__((unused)))
+{
+	aggr_flush(sf);
+	return 0;
 }
 
 
@@ -606,6 +726,8 @@ static int sync_sfile(struct sfile * sf, void * data __attribute__((unused)))
 {
 	size_t i;
 
+	aggr_flush(sf);
+
 	for (i = 0; i < op_nr_counters; ++i)
 		odb_sync(&sf->files[i]);
 
@@ -644,6 +766,7 @@ for_one_sfile(struct sfile * sf, sfile_func func, void * data)
 			if (free_sf || func(&cg->to, data)) {
 				kill_sfile(&cg->to);
 				list_del(&cg->hash);
+				op_arc_hash_del(&arcs, &cg->arc);
 				free(cg);
 			}
 		}
@@ -661,8 +784,8 @@ static void for_each_sfile(sfile_func func, void * data)
 	struct list_head * pos;
 	struct list_head * pos2;
 
-	list_for_each_safe(pos, pos2, &lru_list) {
-		struct sfile * sf = list_entry(pos, struct sfile, lru);
+	list_for_each_safe(pos, pos2, &lru.list) {
+		struct sfile * sf = list_entry(pos, struct sfile, lru.list);
 		for_one_sfile(sf, func, data);
 	}
 }
@@ -680,6 +803,12 @@ void sfile_clear_anon(struct anon_mapping * anon)
 }
 
 
+void sfile_flush_files(void)
+{
+	for_each_sfile(flush_sfile, NULL);
+}
+
+
 void sfile_sync_files(void)
 {
 	for_each_sfile(sync_sfile, NULL);
@@ -698,45 +827,54 @@ static int always_true(void)
 }
 
 
-#define LRU_AMOUNT 256
+static void evict_sfile(odb_lru_entry_t * entry,
+                        void * data __attribute__((unused)))
+{
+	struct sfile * sf = list_entry(entry, struct sfile, lru);
+	for_one_sfile(sf, (sfile_func)always_true, NULL);
+}
+
 
 /*
- * Clear out older sfiles. Note the current sfiles we're using
+ * Clear out older and colder sfiles. Note the current sfiles we're using
  * will not be present in this list, due to sfile_get/put() pairs
  * around the caller of this.
  */
 int sfile_lru_clear(void)
 {
-	struct list_head * pos;
-	struct list_head * pos2;
-	int amount = LRU_AMOUNT;
+	return odb_lru_evict(&lru, evict_sfile, NULL);
+}
 
-	if (list_empty(&lru_list))
-		return 1;
 
-	list_for_each_safe(pos, pos2, &lru_list) {
-		struct sfile * sf;
-		if (!--amount)
-			break;
-		sf = list_entry(pos, struct sfile, lru);
-		for_one_sfile(sf, (sfile_func)always_true, NULL);
-	}
+int sfile_lru_full(void)
+{
+	return odb_lru_full(&lru);
+}
 
-	return 0;
+
+void sfile_lru_opened(odb_t const * file, unsigned long long usecs)
+{
+	odb_lru_opened(&lru, file, usecs);
+}
+
+
+odb_lru_stats_t const * sfile_lru_stats(void)
+{
+	return &lru.stats;
 }
 
 
 void sfile_get(struct sfile * sf)
 {
 	if (sf)
-		list_del(&sf->lru);
+		odb_lru_get(&sf->lru);
 }
 
 
 void sfile_put(struct sfile * sf)
 {
 	if (sf)
-		list_add_tail(&sf->lru, &lru_list);
+		odb_lru_put(&lru, &sf->lru);
 }
 
 
@@ -744,6 +882,8 @@ void sfile_init(void)
 {
 	size_t i = 0;
 
+	odb_lru_init(&lru);
+
 	for (; i < HASH_SIZE; ++i) {
 		list_init(&hashes[i]);
 		list_init(&kernel_cmdlines[i]);
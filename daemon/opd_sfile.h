@@ -18,6 +18,7 @@
 #include "op_hw_config.h"
 #include "op_types.h"
 #include "op_list.h"
+#include "op_arc_hash.h"
 
 #include <sys/types.h>
 
@@ -26,6 +27,18 @@ struct transient;
 
 #define CG_HASH_SIZE 16
 #define UNUSED_EMBEDDED_OFFSET ~0LLU
+/** nr. of pending sample counts per sfile, must be a power of two */
+#define SFILE_AGGR_SIZE 64
+
+/** a sample count not yet written to its sample file */
+struct sfile_aggr_entry {
+	/** sample offset in the image */
+	vma_t pc;
+	/** counter nr., index in sfile::files */
+	unsigned int counter;
+	/** pending count, zero if this entry is unused */
+	unsigned int count;
+};
 
 /**
  * Each set of sample files (where a set is over the physical counter
@@ -37,6 +50,8 @@ struct transient;
 struct sfile {
 	/** hash value for this sfile */
 	unsigned long hashval;
+	/** unique id, never reused, identifies callees in arcs lookup */
+	unsigned long id;
 	/** cookie value for the binary profiled */
 	cookie_t cookie;
 	/** cookie value for the application owner, INVALID_COOKIE if not set */
@@ -56,8 +71,8 @@ struct sfile {
 
 	/** hash table link */
 	struct list_head hash;
-	/** lru list */
-	struct list_head lru;
+	/** lru list and sample rate */
+	odb_lru_entry_t lru;
 	/** true if this file should be ignored in profiles */
 	int ignored;
 	/** opened sample files */
@@ -66,14 +81,20 @@ struct sfile {
 	odb_t * ext_files;
 	/** hash table of opened cg sample files */
 	struct list_head cg_hash[CG_HASH_SIZE];
+	/** pending sample counts, NULL until the first sample is logged */
+	struct sfile_aggr_entry * aggr;
 };
 
 /** a call-graph entry */
 struct cg_entry {
 	/** where arc is to */
 	struct sfile to;
+	/** where arc is from, owner of this entry */
+	struct sfile * from;
 	/** next in the hash slot */
 	struct list_head hash;
+	/** link in the (from, to.id) arcs hash */
+	struct op_arc arc;
 };
 
 /** clear any sfiles that are for the kernel */
@@ -84,16 +105,28 @@ struct anon_mapping;
 /** clear any sfiles for the given anon mapping */
 void sfile_clear_anon(struct anon_mapping *);
 
-/** sync sample files */
+/** write pending sample counts to the sample files */
+void sfile_flush_files(void);
+
+/** flush and sync sample files */
 void sfile_sync_files(void);
 
 /** close sample files */
 void sfile_close_files(void);
 
-/** clear out a certain amount of LRU entries
+/** clear out cold LRU entries until the sfile cache is below its bounds
  * return non-zero if the lru is already empty */
 int sfile_lru_clear(void);
 
+/** return non-zero if the opened sample files exceed the sfile cache bounds */
+int sfile_lru_full(void);
+
+/** account the time spent opening a sample file */
+void sfile_lru_opened(odb_t const * file, unsigned long long usecs);
+
+/** return sfile cache eviction statistics */
+odb_lru_stats_t const * sfile_lru_stats(void);
+
 /** remove a sfile from the lru list, protecting it from sfile_lru_clear() */
 void sfile_get(struct sfile * sf);
 
@@ -106,6 +139,22 @@ void sfile_put(struct sfile * sf);
  */
 struct sfile * sfile_find(struct transient const * trans);
 
+/**
+ * Same as sfile_find() for count identical samples, the statistics
+ * are updated for each of them.
+ */
+struct sfile * sfile_find_count(struct transient const * trans,
+                                unsigned long int count);
+
+/**
+ * Find or create the call-graph entry for arcs from sf to last.
+ * This is the sfile for the cg sample files of this arc.
+ */
+struct cg_entry * sfile_find_cg(struct sfile * sf, struct sfile * last);
+
+/** return non-zero if sf and sf2 are for the same sample files */
+int sfile_equal(struct sfile const * sf, struct sfile const * sf2);
+
 /** Log the sample in a previously located sfile. */
 void sfile_log_sample(struct transient const * trans);
 
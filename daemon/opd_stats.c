@@ -11,15 +11,41 @@
 
 #include "opd_stats.h"
 #include "opd_extended.h"
+#include "opd_sfile.h"
 #include "oprofiled.h"
 
 #include "op_get_time.h"
+#include "op_config.h"
+#include "op_libiberty.h"
 
 #include <dirent.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+OP_STATS_PER_THREAD unsigned long opd_stats[OPD_MAX_STATS];
+
+static op_stats_t opd_stats_threads;
+
+void opd_stats_init(void)
+{
+	memset(opd_stats, 0, sizeof(opd_stats));
+	op_stats_register(&opd_stats_threads, opd_stats);
+}
+
+
+void opd_stats_exit(void)
+{
+	op_stats_unregister(&opd_stats_threads, opd_stats, OPD_MAX_STATS);
+}
+
+
+unsigned long opd_read_stat(int stat)
+{
+	return op_stats_read(&opd_stats_threads, stat);
+}
 
-unsigned long opd_stats[OPD_MAX_STATS];
 
 /**
  * print_if - print an integer value read from file filename,
@@ -39,21 +65,26 @@ void opd_print_stats(void)
 {
 	DIR * dir;
 	struct dirent * dirent;
+	odb_lru_stats_t const * lru_stats = sfile_lru_stats();
 
 	printf("\n%s\n", op_get_time());
 	printf("\n-- OProfile Statistics --\n");
-	printf("Nr. sample dumps: %lu\n", opd_stats[OPD_DUMP_COUNT]);
-	printf("Nr. non-backtrace samples: %lu\n", opd_stats[OPD_SAMPLES]);
-	printf("Nr. kernel samples: %lu\n", opd_stats[OPD_KERNEL]);
-	printf("Nr. lost samples (no kernel/user): %lu\n", opd_stats[OPD_NO_CTX]);
-	printf("Nr. lost kernel samples: %lu\n", opd_stats[OPD_LOST_KERNEL]);
-	printf("Nr. incomplete code structs: %lu\n", opd_stats[OPD_DANGLING_CODE]);
+	printf("Nr. sample dumps: %lu\n", opd_read_stat(OPD_DUMP_COUNT));
+	printf("Nr. non-backtrace samples: %lu\n", opd_read_stat(OPD_SAMPLES));
+	printf("Nr. kernel samples: %lu\n", opd_read_stat(OPD_KERNEL));
+	printf("Nr. lost samples (no kernel/user): %lu\n", opd_read_stat(OPD_NO_CTX));
+	printf("Nr. lost kernel samples: %lu\n", opd_read_stat(OPD_LOST_KERNEL));
+	printf("Nr. incomplete code structs: %lu\n", opd_read_stat(OPD_DANGLING_CODE));
 	printf("Nr. samples lost due to sample file open failure: %lu\n",
-		opd_stats[OPD_LOST_SAMPLEFILE]);
+		opd_read_stat(OPD_LOST_SAMPLEFILE));
 	printf("Nr. samples lost due to no permanent mapping: %lu\n",
-		opd_stats[OPD_LOST_NO_MAPPING]);
+		opd_read_stat(OPD_LOST_NO_MAPPING));
 	printf("Nr. user context kernel samples lost due to no app info available: %lu\n",
-	       opd_stats[OPD_NO_APP_KERNEL_SAMPLE]);
+	       opd_read_stat(OPD_NO_APP_KERNEL_SAMPLE));
+	printf("Nr. sample file cache evictions: %lu (%lu passes)\n",
+	       lru_stats->evictions, lru_stats->passes);
+	printf("Nr. non-empty sample files re-opened: %lu (%llu usecs)\n",
+	       lru_stats->reopens, lru_stats->reopen_usecs);
 	print_if("Nr. samples lost due to buffer overflow: %u\n",
 	       "/dev/oprofile/stats", "event_lost_overflow", 1);
 	print_if("Nr. samples lost due to no mapping: %u\n",
@@ -90,3 +121,64 @@ void opd_print_stats(void)
 out:
 	fflush(stdout);
 }
+
+
+/** sum of the samples lost in the daemon */
+static unsigned long opd_lost_samples(void)
+{
+	return opd_read_stat(OPD_NO_CTX) + opd_read_stat(OPD_LOST_KERNEL) +
+		opd_read_stat(OPD_LOST_SAMPLEFILE) +
+		opd_read_stat(OPD_LOST_NO_MAPPING) +
+		opd_read_stat(OPD_NO_APP_KERNEL_SAMPLE);
+}
+
+
+void opd_write_live_stats(void)
+{
+	static unsigned long last_samples;
+	static struct timeval last_time;
+	static char * filename;
+	struct op_stats_entry entries[7];
+	odb_lru_stats_t const * lru_stats = sfile_lru_stats();
+	unsigned long samples = opd_read_stat(OPD_SAMPLES);
+	unsigned long lookups = opd_read_stat(OPD_SFILE_LOOKUPS);
+	unsigned long rate = 0;
+	unsigned long usecs;
+	struct timeval now;
+
+	if (!filename) {
+		filename = xmalloc(strlen(op_samples_dir) + strlen("live_stats") + 1);
+		strcpy(filename, op_samples_dir);
+		strcat(filename, "live_stats");
+	}
+
+	gettimeofday(&now, NULL);
+	if (last_time.tv_sec) {
+		usecs = (now.tv_sec - last_time.tv_sec) * 1000000 +
+			now.tv_usec - last_time.tv_usec;
+		if (usecs)
+			rate = (unsigned long)((samples - last_samples) *
+				1000000ULL / usecs);
+	}
+	last_samples = samples;
+	last_time = now;
+
+	entries[0].name = "samples";
+	entries[0].value = samples;
+	entries[1].name = "samples_per_sec";
+	entries[1].value = rate;
+	entries[2].name = "lost_samples";
+	entries[2].value = opd_lost_samples();
+	entries[3].name = "sfile_lookups";
+	entries[3].value = lookups;
+	entries[4].name = "sfile_hit_percent";
+	entries[4].value = lookups ?
+		opd_read_stat(OPD_SFILE_HITS) * 100ULL / lookups : 0;
+	entries[5].name = "sfile_evictions";
+	entries[5].value = lru_stats->evictions;
+	entries[6].name = "sfile_reopens";
+	entries[6].value = lru_stats->reopens;
+
+	/* best effort, the samples dir may have been removed by --reset */
+	op_stats_write(filename, entries, sizeof(entries) / sizeof(entries[0]));
+}
@@ -12,7 +12,10 @@
 #ifndef OPD_STATS_H
 #define OPD_STATS_H
 
-extern unsigned long opd_stats[];
+#include "op_stats.h"
+
+/** counters of the calling thread, use opd_read_stat() to get the totals */
+extern OP_STATS_PER_THREAD unsigned long opd_stats[];
 
 enum {	OPD_SAMPLES, /**< nr. samples */
 	OPD_KERNEL, /**< nr. kernel samples */
@@ -24,9 +27,28 @@ enum {	OPD_SAMPLES, /**< nr. samples */
 	OPD_DUMP_COUNT, /**< nr. of times buffer is read */
 	OPD_DANGLING_CODE, /**< nr. partial code notifications (buffer overflow */
 	OPD_NO_APP_KERNEL_SAMPLE, /**<nr. user ctx kernel samples dropped due to no app cookie available */
+	OPD_SFILE_LOOKUPS, /**< nr. sample file hash lookups */
+	OPD_SFILE_HITS, /**< nr. lookups finding an existing sample file */
 	OPD_MAX_STATS /**< end of stats */
 };
 
+/** clear the statistics, the calling thread counters are registered */
+void opd_stats_init(void);
+
+/** add the calling thread counters to the totals, call it before exiting */
+void opd_stats_exit(void);
+
+/** return the sum over all threads of the given statistic */
+unsigned long opd_read_stat(int stat);
+
 void opd_print_stats(void);
 
+/**
+ * opd_write_live_stats - update the live statistics file
+ *
+ * Called every second, rewrite op_samples_dir/live_stats with the
+ * sample rate and the lost samples and sample file cache counts.
+ */
+void opd_write_live_stats(void);
+
 #endif /* OPD_STATS_H */
@@ -31,6 +31,10 @@
 #include <stdio.h>
 #include <errno.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 extern size_t kernel_pointer_size;
 
 
@@ -82,17 +86,18 @@ int enough_remaining(struct transient * trans, size_t size)
 }
 
 
-static void opd_put_sample(struct transient * trans, unsigned long long pc)
+/**
+ * opd_log_sample - log count identical samples
+ * @param trans  current transient state
+ * @param pc  sample address
+ * @param event  counter the sample belongs to
+ * @param count  number of identical consecutive samples
+ *
+ * count must be one when tracing, arcs are relative to the previous sample.
+ */
+static void opd_log_sample(struct transient * trans, unsigned long long pc,
+                           unsigned long long event, unsigned long count)
 {
-	unsigned long long event;
-
-	if (!enough_remaining(trans, 1)) {
-		trans->remaining = 0;
-		return;
-	}
-
-	event = pop_buffer_value(trans);
-
 	if (trans->tracing != TRACING_ON)
 		trans->event = event;
 
@@ -107,7 +112,7 @@ static void opd_put_sample(struct transient * trans, unsigned long long pc)
 
 	/* get the current sfile if needed */
 	if (!trans->current)
-		trans->current = sfile_find(trans);
+		trans->current = sfile_find_count(trans, count);
 
 	/*
 	 * can happen if kernel sample falls through the cracks, or if
@@ -117,8 +122,8 @@ static void opd_put_sample(struct transient * trans, unsigned long long pc)
 		goto out;
 
 	if (trans->tracing != TRACING_ON) {
-		opd_stats[OPD_SAMPLES]++;
-		opd_stats[trans->in_kernel == 1 ? OPD_KERNEL : OPD_PROCESS]++;
+		opd_stats[OPD_SAMPLES] += count;
+		opd_stats[trans->in_kernel == 1 ? OPD_KERNEL : OPD_PROCESS] += count;
 	}
 
 
@@ -127,7 +132,7 @@ static void opd_put_sample(struct transient * trans, unsigned long long pc)
 		goto out;
 
 	/* log the sample or arc */
-	sfile_log_sample(trans);
+	sfile_log_sample_count(trans, count);
 
 out:
 	/* switch to trace mode */
@@ -138,6 +143,21 @@ out:
 }
 
 
+static void opd_put_sample(struct transient * trans, unsigned long long pc)
+{
+	unsigned long long event;
+
+	if (!enough_remaining(trans, 1)) {
+		trans->remaining = 0;
+		return;
+	}
+
+	event = pop_buffer_value(trans);
+
+	opd_log_sample(trans, pc, event, 1);
+}
+
+
 static void code_unknown(struct transient * trans __attribute__((unused)))
 {
 	fprintf(stderr, "Unknown code !\n");
@@ -293,6 +313,173 @@ handler_t handlers[LAST_CODE + 1] = {
 
 extern void (*special_processor)(struct transient *);
 
+/** return the nr of 32 bits values in buffer before the first ESCAPE_CODE */
+static size_t find_escape_code32(uint32_t const * buffer, size_t nr)
+{
+	size_t i = 0;
+
+#ifdef __SSE2__
+	__m128i const escape = _mm_set1_epi32(-1);
+
+	for (; i + 4 <= nr; i += 4) {
+		__m128i val = _mm_loadu_si128((__m128i const *)(buffer + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(val, escape)))
+			break;
+	}
+#endif
+
+	for (; i < nr; ++i) {
+		if (buffer[i] == ~0U)
+			break;
+	}
+
+	return i;
+}
+
+
+/** return the nr of 64 bits values in buffer before the first ESCAPE_CODE */
+static size_t find_escape_code64(uint64_t const * buffer, size_t nr)
+{
+	size_t i = 0;
+
+#ifdef __SSE2__
+	__m128i const escape = _mm_set1_epi32(-1);
+
+	for (; i + 2 <= nr; i += 2) {
+		__m128i val = _mm_loadu_si128((__m128i const *)(buffer + i));
+		__m128i eq = _mm_cmpeq_epi32(val, escape);
+		/* kernel addresses have an all ones upper half on most
+		 * 64 bits arch, both halves must match */
+		eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+		if (_mm_movemask_epi8(eq))
+			break;
+	}
+#endif
+
+	for (; i < nr; ++i) {
+		if (buffer[i] == ~0LLU)
+			break;
+	}
+
+	return i;
+}
+
+
+static __inline__ uint64_t
+buffer_value(char const * buffer, size_t pos, size_t const pointer_size)
+{
+	if (pointer_size == 4)
+		return ((uint32_t const *)buffer)[pos];
+	return ((uint64_t const *)buffer)[pos];
+}
+
+
+/**
+ * process_sample_run - log nr {pc, event} pairs not containing ESCAPE_CODE
+ *
+ * Identical consecutive samples are given to the sfile layer at once,
+ * except when tracing where each sample is an arc from the previous one.
+ */
+static __inline__ __attribute__((always_inline)) void
+process_sample_run(struct transient * trans, size_t nr,
+                   size_t const pointer_size)
+{
+	char const * buffer = trans->buffer;
+	size_t i = 0;
+
+	trans->buffer += 2 * nr * pointer_size;
+	trans->remaining -= 2 * nr;
+
+	while (i < nr) {
+		unsigned long long pc = buffer_value(buffer, 2 * i, pointer_size);
+		unsigned long long event =
+			buffer_value(buffer, 2 * i + 1, pointer_size);
+		unsigned long count = 1;
+
+		if (trans->tracing == TRACING_OFF) {
+			while (i + count < nr &&
+			       buffer_value(buffer, 2 * (i + count), pointer_size) == pc &&
+			       buffer_value(buffer, 2 * (i + count) + 1, pointer_size) == event)
+				++count;
+		}
+
+		opd_log_sample(trans, pc, event, count);
+		i += count;
+	}
+}
+
+
+/**
+ * process_samples - process a buffer of pointer_size values
+ *
+ * Runs of plain samples between two ESCAPE_CODE are located with a
+ * vectorized scan and processed in a tight loop, anything else goes
+ * through pop_buffer_value() one value at a time.
+ */
+static __inline__ __attribute__((always_inline)) void
+process_samples(struct transient * trans, size_t const pointer_size)
+{
+	/* FIXME: was uint64_t but it can't compile on alpha where uint64_t
+	 * is an unsigned long and below the printf("..." %llu\n", code)
+	 * generate a warning, this look like a stopper to use c98 types :/
+	 */
+	unsigned long long code;
+	unsigned long long const escape_code =
+		pointer_size == 4 ? (uint32_t)~0U : ~0LLU;
+	size_t run;
+
+	while (trans->remaining) {
+		if (pointer_size == 4)
+			run = find_escape_code32((uint32_t const *)trans->buffer,
+			                         trans->remaining);
+		else
+			run = find_escape_code64((uint64_t const *)trans->buffer,
+			                         trans->remaining);
+
+		/* only whole {pc, event} pairs */
+		if (run >= 2) {
+			process_sample_run(trans, run / 2, pointer_size);
+			continue;
+		}
+
+		code = pop_buffer_value(trans);
+
+		if (code != escape_code) {
+			opd_put_sample(trans, code);
+			continue;
+		}
+
+		if (!trans->remaining) {
+			verbprintf(vmisc, "Dangling ESCAPE_CODE.\n");
+			opd_stats[OPD_DANGLING_CODE]++;
+			break;
+		}
+
+		// started with ESCAPE_CODE, next is type
+		code = pop_buffer_value(trans);
+	
+		if (code >= LAST_CODE) {
+			fprintf(stderr, "Unknown code %llu\n", code);
+			abort();
+		}
+
+		handlers[code](trans);
+	}
+}
+
+
+static void process_samples32(struct transient * trans)
+{
+	process_samples(trans, 4);
+}
+
+
+static void process_samples64(struct transient * trans)
+{
+	process_samples(trans, 8);
+}
+
+
 void opd_process_samples(char const * buffer, size_t count)
 {
 	struct transient trans = {
@@ -316,39 +503,13 @@ void opd_process_samples(char const * buffer, size_t count)
 		.ext = NULL
 	};
 
-	/* FIXME: was uint64_t but it can't compile on alpha where uint64_t
-	 * is an unsigned long and below the printf("..." %llu\n", code)
-	 * generate a warning, this look like a stopper to use c98 types :/
-	 */
-	unsigned long long code;
-
 	if (special_processor) {
 		special_processor(&trans);
 		return;
 	}
 
-	while (trans.remaining) {
-		code = pop_buffer_value(&trans);
-
-		if (!is_escape_code(code)) {
-			opd_put_sample(&trans, code);
-			continue;
-		}
-
-		if (!trans.remaining) {
-			verbprintf(vmisc, "Dangling ESCAPE_CODE.\n");
-			opd_stats[OPD_DANGLING_CODE]++;
-			break;
-		}
-
-		// started with ESCAPE_CODE, next is type
-		code = pop_buffer_value(&trans);
-	
-		if (code >= LAST_CODE) {
-			fprintf(stderr, "Unknown code %llu\n", code);
-			abort();
-		}
-
-		handlers[code](&trans);
-	}
+	if (kernel_pointer_size == 4)
+		process_samples32(&trans);
+	else
+		process_samples64(&trans);
 }
@@ -29,13 +29,10 @@
 #include "op_cpu_type.h"
 #include "op_popt.h"
 #include "op_lockfile.h"
-#include "op_list.h"
-#include "op_fileio.h"
 
 #include <sys/types.h>
 #include <sys/resource.h>
 #include <stdlib.h>
-#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -44,33 +41,6 @@
 #include <dirent.h>
 #include <limits.h>
 
-sig_atomic_t signal_alarm;
-sig_atomic_t signal_hup;
-sig_atomic_t signal_term;
-sig_atomic_t signal_child;
-sig_atomic_t signal_usr1;
-sig_atomic_t signal_usr2;
-
-uint op_nr_counters;
-op_cpu cpu_type;
-int no_event_ok;
-int vsfile;
-int vsamples;
-int varcs;
-int vmodule;
-int vmisc;
-int vext;
-int separate_lib;
-int separate_kernel;
-int separate_thread;
-int separate_cpu;
-int no_vmlinux;
-char * vmlinux;
-char * kernel_range;
-char * session_dir;
-int no_xen;
-char * xenimage;
-char * xen_range;
 static char * verbose;
 static char * binary_name_filter;
 static char * events;
@@ -79,9 +49,6 @@ static int showvers;
 static struct oprofiled_ops * opd_ops;
 extern struct oprofiled_ops opd_26_ops;
 
-#define OPD_IMAGE_FILTER_HASH_SIZE 32
-static struct list_head images_filter[OPD_IMAGE_FILTER_HASH_SIZE];
-
 static struct poptOption options[] = {
 	{ "session-dir", 0, POPT_ARG_STRING, &session_dir, 0, "place sample database in dir instead of default location", "/var/lib/oprofile", },
 	{ "kernel-range", 'r', POPT_ARG_STRING, &kernel_range, 0, "Kernel VMA range", "start-end", },
@@ -103,20 +70,6 @@ static struct poptOption options[] = {
 };
  
 
-void opd_open_logfile(void)
-{
-	if (open(op_log_file, O_WRONLY|O_CREAT|O_NOCTTY|O_APPEND, 0644) == -1) {
-		perror("oprofiled: couldn't re-open stdout: ");
-		exit(EXIT_FAILURE);
-	}
-
-	if (dup2(1, 2) == -1) {
-		perror("oprofiled: couldn't dup stdout to stderr: ");
-		exit(EXIT_FAILURE);
-	}
-}
- 
-
 /**
  * opd_fork - fork and return as child
  *
@@ -172,7 +125,7 @@ static void opd_write_abi(void)
 
 
 /**
- * opd_alarm - sync files and report stats
+ * opd_alarm - update live stats, periodically sync files and report stats
  */
 static void opd_alarm(int val __attribute__((unused)))
 {
@@ -275,80 +228,6 @@ static void opd_setup_signals(void)
 }
 
 
-struct opd_hashed_name {
-	char * name;
-	struct list_head next;
-};
-
-
-static void add_image_filter(char const * name)
-{
-	size_t hash;
-	struct opd_hashed_name * elt = xmalloc(sizeof(struct opd_hashed_name));
-	elt->name = xmalloc(PATH_MAX);
-	if (!realpath(name, elt->name)) {
-		free(elt->name);
-		free(elt);
-		return;
-	}
-	hash = op_hash_string(elt->name);
-	verbprintf(vmisc, "Adding to image filter: \"%s\"\n", elt->name);
-	list_add(&elt->next, &images_filter[hash % OPD_IMAGE_FILTER_HASH_SIZE]);
-}
-
-
-static void opd_parse_image_filter(void)
-{
-	size_t i;
-	char const * last = binary_name_filter;
-	char const * cur = binary_name_filter;
-
-	if (!binary_name_filter)
-		return;
-
-	for (i = 0; i < OPD_IMAGE_FILTER_HASH_SIZE; ++i)
-		list_init(&images_filter[i]);
-
-	while ((cur = strchr(last, ',')) != NULL) {
-		char * tmp = op_xstrndup(last, cur - last);
-		add_image_filter(tmp);
-		free(tmp);
-		last = cur + 1;
-	}
-	add_image_filter(last);
-}
-
-
-int is_image_ignored(char const * name)
-{
-	size_t hash;
-	struct list_head * pos;
-
-	if (!binary_name_filter)
-		return 0;
-	
-	hash = op_hash_string(name);
-
-	list_for_each(pos, &images_filter[hash % OPD_IMAGE_FILTER_HASH_SIZE]) {
-		struct opd_hashed_name * hashed_name =
-			list_entry(pos, struct opd_hashed_name, next);
-		if (!strcmp(hashed_name->name, name))
-			return 0;
-	}
-
-	return 1;
-}
-
-
-/** return the int in the given oprofilefs file */
-int opd_read_fs_int(char const * path, char const * name, int fatal)
-{
-	char filename[PATH_MAX + 1];
-	snprintf(filename, PATH_MAX, "%s/%s", path, name);
-	return op_read_int_from_file(filename, fatal);
-}
-
-
 static void opd_handle_verbose_option(char const * name)
 {
 	if (!strcmp(name, "all")) {
@@ -464,7 +343,7 @@ static void opd_options(int argc, char const * argv[])
 	if (events != NULL)
 		opd_parse_events(events);
 
-	opd_parse_image_filter();
+	opd_parse_image_filter(binary_name_filter);
 
 	poptFreeContext(optcon);
 }
@@ -515,8 +394,9 @@ int main(int argc, char const * argv[])
 
 	opd_go_daemon();
 
-	/* clean up every 10 minutes */
-	alarm(60 * 10);
+	/* update the live stats every second, the alarm handler syncs
+	 * the sample files and prints stats every 10 minutes */
+	alarm(1);
 
 	if (op_write_lock_file(op_lock_file)) {
 		fprintf(stderr, "oprofiled: could not create lock file %s\n",
@@ -14,6 +14,8 @@
 
 #ifndef OPROFILED_H
 
+#include "op_cpu_type.h"
+
 #include <signal.h>
 
 struct oprofiled_ops {
@@ -34,6 +36,13 @@ struct oprofiled_ops {
 void opd_open_logfile(void);
 
  
+/**
+ * opd_parse_image_filter - set the images to profile
+ * @param filter comma separated image names, NULL to profile all images
+ */
+void opd_parse_image_filter(char const * filter);
+
+
 /**
  * is_image_ignored - check if we must ignore this image
  * @param name the name to check
@@ -55,6 +64,8 @@ extern sig_atomic_t signal_usr1;
 extern sig_atomic_t signal_usr2;
 
 extern unsigned int op_nr_counters;
+extern op_cpu cpu_type;
+extern int no_event_ok;
 extern int separate_lib;
 extern int separate_kernel;
 extern int separate_thread;
@@ -62,6 +73,7 @@ extern int separate_cpu;
 extern int no_vmlinux;
 extern char * vmlinux;
 extern char * kernel_range;
+extern char * session_dir;
 extern int no_xen;
 extern char * xenimage;
 extern char * xen_range;
@@ -0,0 +1,158 @@
+/**
+ * @file opd_cg_bench.c
+ * time the lookup of call-graph arcs at several call chain depths
+ *
+ * usage: opd_cg_bench [nr_images] [nr_chains]
+ *
+ * nr_chains (default 10000) random call chains over nr_images (default
+ * 1000) user space images are walked at depth 16 and 64, each frame
+ * logging an arc from its caller. The arcs are looked up through
+ * sfile_find_cg(), hashed on the caller and callee ids, and through a
+ * scan of the caller cg_hash slot comparing sfiles with sfile_equal().
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "opd_sfile.h"
+#include "oprofiled.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define NR_ROUNDS 10
+
+static size_t const depths[] = { 16, 64 };
+
+static struct sfile * images;
+static size_t nr_images;
+
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+static void create_images(void)
+{
+	size_t i, j;
+
+	images = calloc(nr_images, sizeof(struct sfile));
+	if (!images) {
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < nr_images; ++i) {
+		struct sfile * sf = &images[i];
+		sf->hashval = (i + 1) * 0x9e3779b1UL >> 8;
+		sf->id = i + 1;
+		sf->cookie = i + 1;
+		sf->app_cookie = INVALID_COOKIE;
+		sf->tid = (pid_t)-1;
+		sf->tgid = (pid_t)-1;
+		sf->embedded_offset = UNUSED_EMBEDDED_OFFSET;
+		for (j = 0; j < CG_HASH_SIZE; ++j)
+			list_init(&sf->cg_hash[j]);
+	}
+}
+
+
+/* the lookup done before arcs were hashed on their ids */
+static struct cg_entry * scan_cg(struct sfile * sf, struct sfile * last)
+{
+	struct list_head * pos;
+	unsigned long hash = last->hashval & (CG_HASH_SIZE - 1);
+
+	list_for_each(pos, &sf->cg_hash[hash]) {
+		struct cg_entry * cg = list_entry(pos, struct cg_entry, hash);
+		if (sfile_equal(last, &cg->to))
+			return cg;
+	}
+
+	return NULL;
+}
+
+
+static void run(size_t depth, size_t nr_chains)
+{
+	size_t const nr_frames = nr_chains * (depth + 1);
+	struct sfile ** frames = malloc(nr_frames * sizeof(struct sfile *));
+	unsigned long seed = depth;
+	size_t nr_arcs = 0;
+	double hashed_time, scan_time, start;
+	size_t round, i;
+
+	if (!frames) {
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < nr_frames; ++i) {
+		seed = seed * 1103515245UL + 12345;
+		frames[i] = &images[(seed >> 8) % nr_images];
+	}
+
+	/* create the arcs, the two lookups then find the same entries */
+	for (i = 0; i < nr_frames; ++i) {
+		if (i % (depth + 1) == 0)
+			continue;
+		sfile_find_cg(frames[i], frames[i - 1]);
+		++nr_arcs;
+	}
+
+	start = now();
+	for (round = 0; round < NR_ROUNDS; ++round) {
+		for (i = 0; i < nr_frames; ++i) {
+			if (i % (depth + 1) != 0)
+				sfile_find_cg(frames[i], frames[i - 1]);
+		}
+	}
+	hashed_time = now() - start;
+
+	start = now();
+	for (round = 0; round < NR_ROUNDS; ++round) {
+		for (i = 0; i < nr_frames; ++i) {
+			if (i % (depth + 1) != 0 &&
+			    !scan_cg(frames[i], frames[i - 1])) {
+				fprintf(stderr, "arc not found\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	scan_time = now() - start;
+
+	printf("depth %lu: %lu arcs, sfile_find_cg() %.1f ns/arc, "
+	       "cg_hash scan %.1f ns/arc\n", (unsigned long)depth,
+	       (unsigned long)nr_arcs,
+	       hashed_time * 1e9 / (nr_arcs * NR_ROUNDS),
+	       scan_time * 1e9 / (nr_arcs * NR_ROUNDS));
+
+	free(frames);
+}
+
+
+int main(int argc, char const * argv[])
+{
+	size_t nr_chains;
+	size_t i;
+
+	nr_images = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000;
+	nr_chains = argc > 2 ? strtoul(argv[2], NULL, 0) : 10000;
+	if (!nr_images || !nr_chains) {
+		fprintf(stderr, "usage: opd_cg_bench [nr_images] [nr_chains]\n");
+		return EXIT_FAILURE;
+	}
+
+	op_nr_counters = 1;
+	create_images();
+
+	for (i = 0; i < sizeof(depths) / sizeof(depths[0]); ++i)
+		run(depths[i], nr_chains);
+
+	return EXIT_SUCCESS;
+}
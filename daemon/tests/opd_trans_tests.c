@@ -0,0 +1,104 @@
+/**
+ * @file opd_trans_tests.c
+ * tests the statistics of batched samples in opd_process_samples()
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "opd_anon.h"
+#include "opd_cookie.h"
+#include "opd_interface.h"
+#include "opd_sfile.h"
+#include "opd_stats.h"
+#include "opd_trans.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ESCAPE ~0LLU
+#define NR_SAMPLES 100
+
+/* no process has this tgid, so no anon mapping can be found */
+#define NO_TGID 0x7ffffffe
+
+static uint64_t buffer[16 + 2 * NR_SAMPLES];
+
+
+static void check_stat(int stat, char const * name, unsigned long expected)
+{
+	unsigned long const value = opd_read_stat(stat);
+
+	if (value != expected) {
+		fprintf(stderr, "%s is %lu instead of %lu\n",
+		        name, value, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+/* append the identical samples, return the size of the buffer */
+static size_t add_samples(size_t pos)
+{
+	size_t i;
+
+	for (i = 0; i < NR_SAMPLES; ++i) {
+		buffer[pos++] = 0x1000;
+		buffer[pos++] = 0;
+	}
+
+	return pos;
+}
+
+
+/* samples before any context switch have no context */
+static void check_no_ctx(void)
+{
+	size_t const size = add_samples(0);
+
+	opd_process_samples((char const *)buffer, size);
+
+	check_stat(OPD_NO_CTX, "OPD_NO_CTX", NR_SAMPLES);
+}
+
+
+/* user space samples without cookie nor anon mapping are lost */
+static void check_lost_no_mapping(void)
+{
+	size_t size = 0;
+
+	buffer[size++] = ESCAPE;
+	buffer[size++] = CTX_SWITCH_CODE;
+	buffer[size++] = NO_TGID;
+	buffer[size++] = NO_COOKIE;
+	buffer[size++] = ESCAPE;
+	buffer[size++] = CTX_TGID_CODE;
+	buffer[size++] = NO_TGID;
+	buffer[size++] = ESCAPE;
+	buffer[size++] = USER_ENTER_SWITCH_CODE;
+	buffer[size++] = ESCAPE;
+	buffer[size++] = COOKIE_SWITCH_CODE;
+	buffer[size++] = NO_COOKIE;
+	size = add_samples(size);
+
+	opd_process_samples((char const *)buffer, size);
+
+	check_stat(OPD_LOST_NO_MAPPING, "OPD_LOST_NO_MAPPING", NR_SAMPLES);
+}
+
+
+int main(void)
+{
+	kernel_pointer_size = sizeof(uint64_t);
+	opd_stats_init();
+	anon_init();
+	sfile_init();
+
+	check_no_ctx();
+	check_lost_no_mapping();
+
+	check_stat(OPD_SAMPLES, "OPD_SAMPLES", 0);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file db_lru.c
+ * Bounded cache of DB files owners
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "odb.h"
+
+/** fds left for the caller own use: log file, pipes, perf events... */
+#define LRU_RESERVED_FILES	64
+/** never learn a bound smaller than this one */
+#define LRU_MIN_FILES		16
+/** default bound on mapped bytes */
+#define LRU_MAX_MAPPED		(sizeof(void *) > 4 ? 1024UL << 20 : 256UL << 20)
+/** eviction stops at (bound - bound / LRU_SLACK) */
+#define LRU_SLACK		8
+
+
+void odb_lru_init(odb_lru_t * lru)
+{
+	struct rlimit rlim;
+
+	list_init(&lru->list);
+
+	lru->max_files = 1024 - LRU_RESERVED_FILES;
+	if (!getrlimit(RLIMIT_NOFILE, &rlim) && rlim.rlim_cur != RLIM_INFINITY &&
+	    rlim.rlim_cur > LRU_RESERVED_FILES + LRU_MIN_FILES)
+		lru->max_files = rlim.rlim_cur - LRU_RESERVED_FILES;
+
+	lru->max_mapped = LRU_MAX_MAPPED;
+
+	lru->stats.passes = 0;
+	lru->stats.evictions = 0;
+	lru->stats.reopens = 0;
+	lru->stats.reopen_usecs = 0;
+}
+
+
+void odb_lru_entry_init(odb_lru_entry_t * entry)
+{
+	list_init(&entry->list);
+	entry->samples = 0;
+}
+
+
+int odb_lru_full(odb_lru_t const * lru)
+{
+	return odb_nr_open_files() >= lru->max_files ||
+	       odb_mapped_bytes() >= lru->max_mapped;
+}
+
+
+static int below_watermark(odb_lru_t const * lru)
+{
+	return odb_nr_open_files() < lru->max_files - lru->max_files / LRU_SLACK &&
+	       odb_mapped_bytes() < lru->max_mapped - lru->max_mapped / LRU_SLACK;
+}
+
+
+int odb_lru_evict(odb_lru_t * lru, odb_lru_evict_func evict, void * data)
+{
+	struct list_head * pos;
+	struct list_head * pos2;
+	int second_chance;
+
+	if (list_empty(&lru->list))
+		return 1;
+
+	if (!odb_lru_full(lru) && odb_nr_open_files() >= LRU_MIN_FILES)
+		lru->max_files = odb_nr_open_files();
+
+	lru->stats.passes++;
+
+	/* first walk skips and ages entries which logged samples since the
+	 * previous pass, second walk is a plain LRU eviction */
+	for (second_chance = 1; second_chance >= 0; --second_chance) {
+		list_for_each_safe(pos, pos2, &lru->list) {
+			odb_lru_entry_t * entry =
+				list_entry(pos, odb_lru_entry_t, list);
+
+			if (second_chance && entry->samples) {
+				entry->samples /= 2;
+				continue;
+			}
+
+			evict(entry, data);
+			lru->stats.evictions++;
+
+			if (below_watermark(lru))
+				return 0;
+		}
+	}
+
+	return 0;
+}
+
+
+void odb_lru_opened(odb_lru_t * lru, odb_t const * odb,
+                    unsigned long long usecs)
+{
+	/* node zero is never used */
+	if (odb->data && odb->data->descr->current_size > 1) {
+		lru->stats.reopens++;
+		lru->stats.reopen_usecs += usecs;
+	}
+}
@@ -64,6 +64,12 @@ static unsigned int tables_size(odb_data_t const * data, odb_node_nr_t node_nr)
 }
 
 
+/** nr of odb_data_t currently opened, each one holding a fd and a mapping */
+static size_t nr_open_files;
+/** sum of the mapped size of all opened odb_data_t */
+static size_t nr_mapped_bytes;
+
+
 int odb_grow_hashtable(odb_data_t * data)
 {
 	unsigned int old_file_size;
@@ -83,6 +89,8 @@ int odb_grow_hashtable(odb_data_t * data)
 	if (new_map == MAP_FAILED)
 		return 1;
 
+	nr_mapped_bytes += new_file_size - old_file_size;
+
 	data->base_memory = new_map;
 	data->descr = odb_to_descr(data);
 	data->descr->size *= 2;
@@ -251,6 +259,8 @@ int odb_open(odb_t * odb, char const * filename, enum odb_rw rw,
 
 	list_add(&data->list, &files_hash[hash]);
 	odb->data = data;
+	nr_open_files++;
+	nr_mapped_bytes += tables_size(data, data->descr->size);
 out:
 	return err;
 fail_unmap:
@@ -274,6 +284,8 @@ void odb_close(odb_t * odb)
 			size_t size = tables_size(data, data->descr->size);
 			list_del(&data->list);
 			munmap(data->base_memory, size);
+			nr_open_files--;
+			nr_mapped_bytes -= size;
 			if (data->fd >= 0)
 				close(data->fd);
 			free(data->filename);
@@ -292,6 +304,18 @@ int odb_open_count(odb_t const * odb)
 }
 
 
+size_t odb_nr_open_files(void)
+{
+	return nr_open_files;
+}
+
+
+size_t odb_mapped_bytes(void)
+{
+	return nr_mapped_bytes;
+}
+
+
 void * odb_get_data(odb_t * odb)
 {
 	return odb->data->base_memory;
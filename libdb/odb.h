@@ -129,6 +129,12 @@ void odb_close(odb_t * odb);
 /** return the number of times this sample file is open */
 int odb_open_count(odb_t const * odb);
 
+/** return the number of DB files currently opened (i.e. fds in use) */
+size_t odb_nr_open_files(void);
+
+/** return the number of bytes currently mapped by all opened DB files */
+size_t odb_mapped_bytes(void);
+
 /** return the start of the mapped data */
 void * odb_get_data(odb_t * odb);
 
@@ -161,6 +167,104 @@ static __inline void odb_commit_reservation(odb_data_t * data)
 /** "immpossible" node number to indicate an error from odb_hash_add_node() */
 #define ODB_NODE_NR_INVALID ((odb_node_nr_t)-1)
 
+/* db_lru.c */
+
+/**
+ * An object owning one or more DB files, e.g. a daemon sample file set.
+ * Entries are kept in recency order by an odb_lru_t, the samples field
+ * is a decaying count of samples logged through the entry and is used
+ * to give hot entries a second chance at eviction time.
+ */
+typedef struct odb_lru_entry {
+	struct list_head list;		/**< link in odb_lru_t::list */
+	unsigned long samples;		/**< decayed nr. of samples logged */
+} odb_lru_entry_t;
+
+/** statistics about the eviction of DB files owners */
+typedef struct {
+	unsigned long passes;		/**< nr. of eviction passes */
+	unsigned long evictions;	/**< nr. of entries evicted */
+	unsigned long reopens;		/**< nr. of non-empty DB files opened */
+	unsigned long long reopen_usecs;/**< time spent opening them */
+} odb_lru_stats_t;
+
+/**
+ * A cache of DB files owners bounded by the number of opened DB files
+ * and by the number of bytes they map.
+ */
+typedef struct {
+	struct list_head list;		/**< entries, least recently used first */
+	size_t max_files;		/**< bound on odb_nr_open_files() */
+	size_t max_mapped;		/**< bound on odb_mapped_bytes() */
+	odb_lru_stats_t stats;		/**< eviction statistics */
+} odb_lru_t;
+
+/** called to close all the DB files owned by an evicted entry */
+typedef void (*odb_lru_evict_func)(odb_lru_entry_t * entry, void * data);
+
+/**
+ * odb_lru_init - initialize a DB files cache
+ * @param lru the cache to initialize
+ *
+ * The opened files bound is derived from RLIMIT_NOFILE, the mapped bytes
+ * bound is fixed, both can be overwritten by the caller after this call.
+ */
+void odb_lru_init(odb_lru_t * lru);
+
+/** initialize an entry, it is not part of any cache after this call */
+void odb_lru_entry_init(odb_lru_entry_t * entry);
+
+/** return non-zero if the opened DB files exceed the cache bounds */
+int odb_lru_full(odb_lru_t const * lru);
+
+/**
+ * odb_lru_evict - close DB files owned by cold entries
+ * @param lru the cache to shrink
+ * @param evict the function closing the files of an entry and freeing it
+ * @param data passed through to evict
+ *
+ * Entries are evicted in recency order until the cache is back below a
+ * low watermark of its bounds; entries which logged samples since the
+ * previous eviction pass get a second chance with their count halved.
+ * At least one entry is evicted. If this is called while the cache is
+ * not full (the caller hit EMFILE first) the current number of opened
+ * files is recorded as the new bound.
+ *
+ * Entries currently removed from the list (see odb_lru_get()) are never
+ * evicted. Return non-zero if the cache was already empty.
+ */
+int odb_lru_evict(odb_lru_t * lru, odb_lru_evict_func evict, void * data);
+
+/**
+ * odb_lru_opened - account the cost of opening a DB file
+ * @param lru the cache owning the file
+ * @param odb the DB file successfully opened
+ * @param usecs time spent in odb_open()
+ *
+ * Opening a file which already contains samples is accounted as a
+ * re-open, typically the cost of a previous eviction.
+ */
+void odb_lru_opened(odb_lru_t * lru, odb_t const * odb,
+                    unsigned long long usecs);
+
+/** remove an entry from the cache list, protecting it from eviction */
+static __inline void odb_lru_get(odb_lru_entry_t * entry)
+{
+	list_del(&entry->list);
+}
+
+/** add an entry as the most recently used one */
+static __inline void odb_lru_put(odb_lru_t * lru, odb_lru_entry_t * entry)
+{
+	list_add_tail(&entry->list, &lru->list);
+}
+
+/** account count samples logged through this entry */
+static __inline void odb_lru_hit(odb_lru_entry_t * entry, unsigned long count)
+{
+	entry->samples += count;
+}
+
 /* db_debug.c */
 /** check that the hash is well built */
 int odb_check_hash(odb_t const * odb);
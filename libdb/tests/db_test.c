@@ -136,6 +136,85 @@ static void do_test(void)
 }
 
 
+#define LRU_NR_ENTRIES 8
+
+struct lru_owner {
+	odb_lru_entry_t lru;
+	odb_t file;
+	int evicted;
+};
+
+
+static void lru_evict(odb_lru_entry_t * entry, void * data)
+{
+	struct lru_owner * owner = list_entry(entry, struct lru_owner, lru);
+	(void)data;
+	list_del(&entry->list);
+	odb_close(&owner->file);
+	owner->evicted = 1;
+}
+
+
+static void do_lru_test(void)
+{
+	struct lru_owner owners[LRU_NR_ENTRIES];
+	char filename[64];
+	odb_lru_t lru;
+	size_t open_files = odb_nr_open_files();
+	int i, rc;
+
+	odb_lru_init(&lru);
+	lru.max_files = open_files + LRU_NR_ENTRIES / 2;
+
+	for (i = 0; i < LRU_NR_ENTRIES; ++i) {
+		odb_lru_entry_init(&owners[i].lru);
+		owners[i].evicted = 0;
+		snprintf(filename, sizeof(filename), "%s.%d", TEST_FILENAME, i);
+		rc = odb_open(&owners[i].file, filename, ODB_RDWR,
+			      sizeof(struct opd_header));
+		if (rc) {
+			fprintf(stderr, "%s", strerror(rc));
+			exit(EXIT_FAILURE);
+		}
+		odb_lru_put(&lru, &owners[i].lru);
+	}
+
+	if (odb_nr_open_files() != open_files + LRU_NR_ENTRIES ||
+	    !odb_lru_full(&lru)) {
+		fprintf(stderr, "%s:%d bad open files accounting\n",
+			__FILE__, __LINE__);
+		nr_error++;
+	}
+
+	/* the least recently used entry is hot and must survive */
+	odb_lru_hit(&owners[0].lru, 10);
+
+	odb_lru_evict(&lru, lru_evict, NULL);
+
+	if (owners[0].evicted || !owners[1].evicted || odb_lru_full(&lru)) {
+		fprintf(stderr, "%s:%d bad lru eviction\n", __FILE__, __LINE__);
+		nr_error++;
+	}
+	if (lru.stats.evictions == 0 || owners[0].lru.samples != 5) {
+		fprintf(stderr, "%s:%d bad lru stats\n", __FILE__, __LINE__);
+		nr_error++;
+	}
+
+	for (i = 0; i < LRU_NR_ENTRIES; ++i) {
+		if (!owners[i].evicted)
+			odb_close(&owners[i].file);
+		snprintf(filename, sizeof(filename), "%s.%d", TEST_FILENAME, i);
+		remove(filename);
+	}
+
+	if (odb_nr_open_files() != open_files || odb_mapped_bytes() != 0) {
+		fprintf(stderr, "%s:%d bad close accounting\n",
+			__FILE__, __LINE__);
+		nr_error++;
+	}
+}
+
+
 static void sanity_check(char const * filename)
 {
 	odb_t hash;
@@ -178,6 +257,8 @@ speed_test:
 
 	do_test();
 
+	do_lru_test();
+
 	do_speed_test();
 
 	if (nr_error)
@@ -35,6 +35,8 @@ char * stats_filenames[OPERF_MAX_STATS] = {
                                            "total_samples",
                                            "",
                                            "",
+                                           "",
+                                           "",
                                            "lost_invalid_domain",
                                            "lost_kernel",
                                            "lost_samplefile",
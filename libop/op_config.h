@@ -23,6 +23,8 @@ extern "C" {
 enum {	OPERF_SAMPLES, /**< nr. samples */
 	OPERF_KERNEL, /**< nr. kernel samples */
 	OPERF_PROCESS, /**< nr. userspace samples */
+	OPERF_SFILE_LOOKUPS, /**< nr. sample file hash lookups */
+	OPERF_SFILE_HITS, /**< nr. lookups finding an existing sample file */
 	OPERF_INVALID_CTX, /**< nr. samples lost due to sample address not in expected range for domain */
 	OPERF_LOST_KERNEL,  /**< nr. kernel samples lost */
 	OPERF_LOST_SAMPLEFILE, /**< nr samples for which sample file can't be opened */
@@ -34,7 +36,7 @@ enum {	OPERF_SAMPLES, /**< nr. samples */
 	OPERF_RECORD_LOST_SAMPLE, /**<nr. samples lost reported by perf_events kernel */
 	OPERF_MAX_STATS /**< end of stats */
 };
-#define OPERF_INDEX_OF_FIRST_LOST_STAT 3
+#define OPERF_INDEX_OF_FIRST_LOST_STAT 5
 
 /* Warn on lost samples if number of lost samples is greater the this fraction
  * of the total samples
@@ -998,8 +998,7 @@ unsigned int operf_read::convertPerfData(void)
 		memset(event, '\0', 65536);
 	}
 
-	for (int i = 0; i < OPERF_MAX_STATS; i++)
-		operf_stats[i] = 0;
+	operf_stats_init();
 
 	ostringstream message;
 	message << "Converting operf data to oprofile sample data format" << endl;
@@ -1033,6 +1032,8 @@ unsigned int operf_read::convertPerfData(void)
 		num_recs++;
 		if ((num_recs % 1000000 == 0) && print_progress)
 			cerr << ".";
+		if (num_recs % 4096 == 0)
+			operf_write_live_stats(operf_options::session_dir);
 	}
 
 	if (unlikely(error)) {
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/time.h>
 
 extern operf_read operfRead;
 extern op_cpu cpu_type;
@@ -136,6 +137,7 @@ int operf_open_sample_file(odb_t *file, struct operf_sfile *last,
 	char * mangled;
 	char const * binary;
 	vma_t last_start = 0;
+	struct timeval start, end;
 	int err;
 
 	mangled = mangle_filename(last, sf, counter, cg);
@@ -156,8 +158,14 @@ int operf_open_sample_file(odb_t *file, struct operf_sfile *last,
 	if (sf != last)
 		operf_sfile_get(last);
 
+	/* make room before running out of fds or address space */
+	if (operf_sfile_lru_full())
+		operf_sfile_lru_clear();
+
 retry:
+	gettimeofday(&start, NULL);
 	err = odb_open(file, mangled, ODB_RDWR, sizeof(struct opd_header));
+	gettimeofday(&end, NULL);
 
 	/* This should never happen unless someone is clearing out sample data dir. */
 	if (err) {
@@ -177,6 +185,9 @@ retry:
 		goto out;
 	}
 
+	operf_sfile_lru_opened(file, (end.tv_sec - start.tv_sec) * 1000000ULL +
+	                       end.tv_usec - start.tv_usec);
+
 	if (!sf->kernel)
 		binary = sf->image_name;
 	else
@@ -32,8 +32,14 @@
 /** All sfiles are hashed into these lists */
 static struct list_head hashes[HASH_SIZE];
 
-/** All sfiles are on this list. */
-static LIST_HEAD(lru_list);
+/** All operf_cg_entry are hashed on their caller and callee id */
+static struct op_arc_hash arcs = OP_ARC_HASH_INIT;
+
+/** source of sfile ids */
+static unsigned long last_sfile_id;
+
+/** All sfiles are on this list, bounded by opened fds and mapped bytes. */
+static odb_lru_t lru = { LIST_HEAD_INIT(lru.list), 0, 0, { 0, 0, 0, 0 } };
 
 
 static unsigned long
@@ -141,6 +147,7 @@ create_sfile(unsigned long hash, struct operf_transient const * trans,
 	sf = (operf_sfile *)xmalloc(sizeof(struct operf_sfile));
 
 	sf->hashval = hash;
+	sf->id = ++last_sfile_id;
 	sf->tid = trans->tid;
 	sf->tgid = trans->tgid;
 	sf->cpu = 0;
@@ -167,6 +174,8 @@ create_sfile(unsigned long hash, struct operf_transient const * trans,
 	for (i = 0; i < CG_HASH_SIZE; ++i)
 		list_init(&sf->cg_hash[i]);
 
+	odb_lru_entry_init(&sf->lru);
+
 	if (operf_options::separate_cpu)
 		sf->cpu = trans->cpu;
 
@@ -198,6 +207,7 @@ struct operf_sfile * operf_sfile_find(struct operf_transient const * trans)
 		}
 	}
 
+	operf_stats[OPERF_SFILE_LOOKUPS]++;
 	hash = sfile_hash(trans, ki);
 	list_for_each(pos, &hashes[hash]) {
 		sf = list_entry(pos, struct operf_sfile, hash);
@@ -206,6 +216,7 @@ struct operf_sfile * operf_sfile_find(struct operf_transient const * trans)
 		             trans->image_name, trans->image_len,
 		             trans->app_filename, trans->app_len,
 		             trans->tgid, trans->tid, trans->cpu)) {
+			operf_stats[OPERF_SFILE_HITS]++;
 			operf_sfile_get(sf);
 			goto lru;
 		}
@@ -236,16 +247,53 @@ void operf_sfile_dup(struct operf_sfile * to, struct operf_sfile * from)
 		list_init(&to->cg_hash[i]);
 
 	list_init(&to->hash);
-	list_init(&to->lru);
+	odb_lru_entry_init(&to->lru);
 }
 
+static struct operf_cg_entry *
+find_cg(struct operf_sfile * sf, struct operf_sfile * last)
+{
+	struct operf_cg_entry * cg;
+	struct op_arc * arc;
+	struct list_head * pos;
+	unsigned long hash;
+
+	/* fast path, integer compare on the (caller, callee id) hash */
+	arc = op_arc_hash_find(&arcs, sf->id, last->id);
+	if (arc)
+		return list_entry(arc, struct operf_cg_entry, arc);
+
+	hash = last->hashval & (CG_HASH_SIZE - 1);
+
+	/* 'last' can be a new instance of an evicted sfile, still pointed
+	 * to by an entry under its old id. Since we're looking for 'last',
+	 * we use its hash.
+	 */
+	list_for_each(pos, &sf->cg_hash[hash]) {
+		cg = list_entry(pos, struct operf_cg_entry, hash);
+		if (operf_sfile_equal(last, &cg->to)) {
+			op_arc_hash_del(&arcs, &cg->arc);
+			cg->to.id = last->id;
+			op_arc_hash_add(&arcs, &cg->arc, sf->id, last->id);
+			return cg;
+		}
+	}
+
+	cg = (operf_cg_entry *)xmalloc(sizeof(struct operf_cg_entry));
+	operf_sfile_dup(&cg->to, last);
+	cg->from = sf;
+	list_add(&cg->hash, &sf->cg_hash[hash]);
+	op_arc_hash_add(&arcs, &cg->arc, sf->id, last->id);
+
+	return cg;
+}
+
+
 static odb_t * get_file(struct operf_transient const * trans, int is_cg)
 {
 	struct operf_sfile * sf = trans->current;
 	struct operf_sfile * last = trans->last;
 	struct operf_cg_entry * cg;
-	struct list_head * pos;
-	unsigned long hash;
 	odb_t * file;
 
 	// TODO: handle extended
@@ -265,22 +313,7 @@ static odb_t * get_file(struct operf_transient const * trans, int is_cg)
 	if (!is_cg)
 		goto open;
 
-	hash = last->hashval & (CG_HASH_SIZE - 1);
-
-	/* Need to look for the right 'to'. Since we're looking for
-	 * 'last', we use its hash.
-	 */
-	list_for_each(pos, &sf->cg_hash[hash]) {
-		cg = list_entry(pos, struct operf_cg_entry, hash);
-		if (operf_sfile_equal(last, &cg->to)) {
-			file = &cg->to.files[trans->event];
-			goto open;
-		}
-	}
-
-	cg = (operf_cg_entry *)xmalloc(sizeof(struct operf_cg_entry));
-	operf_sfile_dup(&cg->to, last);
-	list_add(&cg->hash, &sf->cg_hash[hash]);
+	cg = find_cg(sf, last);
 	file = &cg->to.files[trans->event];
 
 open:
@@ -369,6 +402,7 @@ void  operf_sfile_log_arc(struct operf_transient const * trans)
 		abort();
 	}
 
+	odb_lru_hit(&trans->current->lru, 1);
 }
 
 void operf_sfile_log_sample(struct operf_transient const * trans)
@@ -405,6 +439,7 @@ void operf_sfile_log_sample_count(struct operf_transient const * trans,
 		fprintf(stderr, "%s: %s\n", __FUNCTION__, strerror(err));
 		abort();
 	}
+	odb_lru_hit(&trans->current->lru, count);
 	operf_stats[OPERF_SAMPLES]++;
 	if (trans->in_kernel)
 		operf_stats[OPERF_KERNEL]++;
@@ -432,7 +467,7 @@ static void kill_sfile(struct operf_sfile * sf)
 {
 	close_sfile(sf, NULL);
 	list_del(&sf->hash);
-	list_del(&sf->lru);
+	list_del(&sf->lru.list);
 }
 
 
@@ -473,6 +508,7 @@ for_one_sfile(struct operf_sfile * sf, operf_sfile_func func, void * data)
 			if (free_sf || func(&cg->to, data)) {
 				kill_sfile(&cg->to);
 				list_del(&cg->hash);
+				op_arc_hash_del(&arcs, &cg->arc);
 				free(cg);
 			}
 		}
@@ -490,8 +526,8 @@ static void for_each_sfile(operf_sfile_func func, void * data)
 	struct list_head * pos;
 	struct list_head * pos2;
 
-	list_for_each_safe(pos, pos2, &lru_list) {
-		struct operf_sfile * sf = list_entry(pos, struct operf_sfile, lru);
+	list_for_each_safe(pos, pos2, &lru.list) {
+		struct operf_sfile * sf = list_entry(pos, struct operf_sfile, lru.list);
 		for_one_sfile(sf, func, data);
 	}
 }
@@ -525,45 +561,54 @@ static int always_true(void)
 }
 
 
-#define LRU_AMOUNT 256
+static void evict_sfile(odb_lru_entry_t * entry,
+                        void * data __attribute__((unused)))
+{
+	struct operf_sfile * sf = list_entry(entry, struct operf_sfile, lru);
+	for_one_sfile(sf, (operf_sfile_func)always_true, NULL);
+}
+
 
 /*
- * Clear out older sfiles. Note the current sfiles we're using
+ * Clear out older and colder sfiles. Note the current sfiles we're using
  * will not be present in this list, due to operf_sfile_get/put() pairs
  * around the caller of this.
  */
 int operf_sfile_lru_clear(void)
 {
-	struct list_head * pos;
-	struct list_head * pos2;
-	int amount = LRU_AMOUNT;
+	return odb_lru_evict(&lru, evict_sfile, NULL);
+}
 
-	if (list_empty(&lru_list))
-		return 1;
 
-	list_for_each_safe(pos, pos2, &lru_list) {
-		struct operf_sfile * sf;
-		if (!--amount)
-			break;
-		sf = list_entry(pos, struct operf_sfile, lru);
-		for_one_sfile(sf, (operf_sfile_func)always_true, NULL);
-	}
+int operf_sfile_lru_full(void)
+{
+	return odb_lru_full(&lru);
+}
 
-	return 0;
+
+void operf_sfile_lru_opened(odb_t const * file, unsigned long long usecs)
+{
+	odb_lru_opened(&lru, file, usecs);
+}
+
+
+odb_lru_stats_t const * operf_sfile_lru_stats(void)
+{
+	return &lru.stats;
 }
 
 
 void operf_sfile_get(struct operf_sfile * sf)
 {
 	if (sf)
-		list_del(&sf->lru);
+		odb_lru_get(&sf->lru);
 }
 
 
 void operf_sfile_put(struct operf_sfile * sf)
 {
 	if (sf)
-		list_add_tail(&sf->lru, &lru_list);
+		odb_lru_put(&lru, &sf->lru);
 }
 
 
@@ -571,6 +616,8 @@ void operf_sfile_init(void)
 {
 	size_t i = 0;
 
+	odb_lru_init(&lru);
+
 	for (; i < HASH_SIZE; ++i)
 		list_init(&hashes[i]);
 }
@@ -18,6 +18,7 @@
 #include "op_hw_config.h"
 #include "op_types.h"
 #include "op_list.h"
+#include "op_arc_hash.h"
 #include "operf_process_info.h"
 
 #include <sys/types.h>
@@ -40,6 +41,8 @@ struct operf_kernel_image;
 struct operf_sfile {
 	/** hash value for this sfile */
 	unsigned long hashval;
+	/** unique id, never reused, identifies callees in arcs lookup */
+	unsigned long id;
 	const char * image_name;
 	const char * app_filename;
 	size_t image_len, app_len;
@@ -57,8 +60,8 @@ struct operf_sfile {
 
 	/** hash table link */
 	struct list_head hash;
-	/** lru list */
-	struct list_head lru;
+	/** lru list and sample rate */
+	odb_lru_entry_t lru;
 	/** true if this file should be ignored in profiles */
 	int ignored;
 	/** opened sample files */
@@ -73,8 +76,12 @@ struct operf_sfile {
 struct operf_cg_entry {
 	/** where arc is to */
 	struct operf_sfile to;
+	/** where arc is from, owner of this entry */
+	struct operf_sfile * from;
 	/** next in the hash slot */
 	struct list_head hash;
+	/** link in the (from, to.id) arcs hash */
+	struct op_arc arc;
 };
 
 /**
@@ -116,10 +123,19 @@ void operf_sfile_sync_files(void);
 /** close sample files */
 void operf_sfile_close_files(void);
 
-/** clear out a certain amount of LRU entries
+/** clear out cold LRU entries until the sfile cache is below its bounds
  * return non-zero if the lru is already empty */
 int operf_sfile_lru_clear(void);
 
+/** return non-zero if the opened sample files exceed the sfile cache bounds */
+int operf_sfile_lru_full(void);
+
+/** account the time spent opening a sample file */
+void operf_sfile_lru_opened(odb_t const * file, unsigned long long usecs);
+
+/** return sfile cache eviction statistics */
+odb_lru_stats_t const * operf_sfile_lru_stats(void);
+
 /** remove a sfile from the lru list, protecting it from operf_sfile_lru_clear() */
 void operf_sfile_get(struct operf_sfile * sf);
 
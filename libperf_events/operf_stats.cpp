@@ -17,11 +17,80 @@
 #include <fcntl.h>
 #include <iostream>
 #include <errno.h>
+#include <sys/time.h>
 
 #include "operf_stats.h"
+#include "operf_sfile.h"
 #include "op_get_time.h"
 
-unsigned long operf_stats[OPERF_MAX_STATS];
+OP_STATS_PER_THREAD unsigned long operf_stats[OPERF_MAX_STATS];
+
+static op_stats_t operf_stats_threads;
+
+void operf_stats_init(void)
+{
+	memset(operf_stats, 0, sizeof(operf_stats));
+	op_stats_register(&operf_stats_threads, operf_stats);
+}
+
+
+void operf_stats_exit(void)
+{
+	op_stats_unregister(&operf_stats_threads, operf_stats, OPERF_MAX_STATS);
+}
+
+
+unsigned long operf_read_stat(int stat)
+{
+	return op_stats_read(&operf_stats_threads, stat);
+}
+
+
+void operf_write_live_stats(std::string const & sessiondir)
+{
+	static unsigned long last_samples;
+	static struct timeval last_time;
+	struct op_stats_entry entries[7];
+	odb_lru_stats_t const * lru_stats = operf_sfile_lru_stats();
+	unsigned long samples = operf_read_stat(OPERF_SAMPLES);
+	unsigned long lookups = operf_read_stat(OPERF_SFILE_LOOKUPS);
+	unsigned long lost = 0;
+	unsigned long rate = 0;
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	if (last_time.tv_sec) {
+		unsigned long usecs = (now.tv_sec - last_time.tv_sec) * 1000000 +
+			now.tv_usec - last_time.tv_usec;
+		if (usecs < 1000000)
+			return;
+		rate = (unsigned long)((samples - last_samples) * 1000000ULL / usecs);
+	}
+	last_samples = samples;
+	last_time = now;
+
+	for (int i = OPERF_INDEX_OF_FIRST_LOST_STAT; i < OPERF_MAX_STATS; i++)
+		lost += operf_read_stat(i);
+
+	entries[0].name = "samples";
+	entries[0].value = samples;
+	entries[1].name = "samples_per_sec";
+	entries[1].value = rate;
+	entries[2].name = "lost_samples";
+	entries[2].value = lost;
+	entries[3].name = "sfile_lookups";
+	entries[3].value = lookups;
+	entries[4].name = "sfile_hit_percent";
+	entries[4].value = lookups ?
+		operf_read_stat(OPERF_SFILE_HITS) * 100ULL / lookups : 0;
+	entries[5].name = "sfile_evictions";
+	entries[5].value = lru_stats->evictions;
+	entries[6].name = "sfile_reopens";
+	entries[6].value = lru_stats->reopens;
+
+	std::string filename = sessiondir + "/samples/live_stats";
+	op_stats_write(filename.c_str(), entries, sizeof(entries) / sizeof(entries[0]));
+}
 
 /**
  * operf_print_stats - print out latest statistics to operf.log
@@ -49,6 +118,7 @@ void operf_print_stats(string sessiondir, char * starttime, bool throttled,
 	string operf_log (sessiondir);
 	unsigned long total_lost_samples = 0;
 	bool stats_dir_valid = true;
+	odb_lru_stats_t const * lru_stats = operf_sfile_lru_stats();
 
 	string stats_dir = create_stats_dir(sessiondir + "/" + "samples/current/");
 	if (strcmp(stats_dir.c_str(), "") != 0) {
@@ -68,30 +138,34 @@ void operf_print_stats(string sessiondir, char * starttime, bool throttled,
 	fprintf(fp, "\nProfiling started at %s", starttime);
 	fprintf(fp, "Profiling stopped at %s", op_get_time());
 	fprintf(fp, "\n-- OProfile/operf Statistics --\n");
-	fprintf(fp, "Nr. non-backtrace samples: %lu\n", operf_stats[OPERF_SAMPLES]);
-	fprintf(fp, "Nr. kernel samples: %lu\n", operf_stats[OPERF_KERNEL]);
-	fprintf(fp, "Nr. user space samples: %lu\n", operf_stats[OPERF_PROCESS]);
+	fprintf(fp, "Nr. non-backtrace samples: %lu\n", operf_read_stat(OPERF_SAMPLES));
+	fprintf(fp, "Nr. kernel samples: %lu\n", operf_read_stat(OPERF_KERNEL));
+	fprintf(fp, "Nr. user space samples: %lu\n", operf_read_stat(OPERF_PROCESS));
 	fprintf(fp, "Nr. samples lost due to sample address not in expected range for domain: %lu\n",
-	       operf_stats[OPERF_INVALID_CTX]);
-	fprintf(fp, "Nr. lost kernel samples: %lu\n", operf_stats[OPERF_LOST_KERNEL]);
+	       operf_read_stat(OPERF_INVALID_CTX));
+	fprintf(fp, "Nr. lost kernel samples: %lu\n", operf_read_stat(OPERF_LOST_KERNEL));
 	fprintf(fp, "Nr. samples lost due to sample file open failure: %lu\n",
-		operf_stats[OPERF_LOST_SAMPLEFILE]);
+		operf_read_stat(OPERF_LOST_SAMPLEFILE));
 	fprintf(fp, "Nr. samples lost due to no permanent mapping: %lu\n",
-		operf_stats[OPERF_LOST_NO_MAPPING]);
+		operf_read_stat(OPERF_LOST_NO_MAPPING));
 	fprintf(fp, "Nr. user context kernel samples lost due to no app info available: %lu\n",
-	       operf_stats[OPERF_NO_APP_KERNEL_SAMPLE]);
+	       operf_read_stat(OPERF_NO_APP_KERNEL_SAMPLE));
 	fprintf(fp, "Nr. user samples lost due to no app info available: %lu\n",
-	       operf_stats[OPERF_NO_APP_USER_SAMPLE]);
+	       operf_read_stat(OPERF_NO_APP_USER_SAMPLE));
 	fprintf(fp, "Nr. backtraces skipped due to no file mapping: %lu\n",
-	       operf_stats[OPERF_BT_LOST_NO_MAPPING]);
+	       operf_read_stat(OPERF_BT_LOST_NO_MAPPING));
 	fprintf(fp, "Nr. hypervisor samples dropped due to address out-of-range: %lu\n",
-	       operf_stats[OPERF_LOST_INVALID_HYPERV_ADDR]);
+	       operf_read_stat(OPERF_LOST_INVALID_HYPERV_ADDR));
 	fprintf(fp, "Nr. samples lost reported by perf_events kernel: %lu\n",
-	       operf_stats[OPERF_RECORD_LOST_SAMPLE]);
+	       operf_read_stat(OPERF_RECORD_LOST_SAMPLE));
+	fprintf(fp, "Nr. sample file cache evictions: %lu (%lu passes)\n",
+	       lru_stats->evictions, lru_stats->passes);
+	fprintf(fp, "Nr. non-empty sample files re-opened: %lu (%llu usecs)\n",
+	       lru_stats->reopens, lru_stats->reopen_usecs);
 
-	if (operf_stats[OPERF_RECORD_LOST_SAMPLE]) {
+	if (operf_read_stat(OPERF_RECORD_LOST_SAMPLE)) {
 		fprintf(stderr, "\n\n * * * ATTENTION: The kernel lost %lu samples. * * *\n",
-		        operf_stats[OPERF_RECORD_LOST_SAMPLE]);
+		        operf_read_stat(OPERF_RECORD_LOST_SAMPLE));
 		fprintf(stderr, "Decrease the sampling rate to eliminate (or reduce) lost samples.\n");
 	} else if (throttled) {
 		fprintf(stderr, "* * * * WARNING: Profiling rate was throttled back by the kernel * * * *\n");
@@ -101,16 +175,16 @@ void operf_print_stats(string sessiondir, char * starttime, bool throttled,
 	}
 
 	for (int i = OPERF_INDEX_OF_FIRST_LOST_STAT; i < OPERF_MAX_STATS; i++) {
-		if (stats_dir_valid && operf_stats[i])
-			_write_stats_file(stats_dir + "/" + stats_filenames[i], operf_stats[i]);
-		total_lost_samples += operf_stats[i];
+		if (stats_dir_valid && operf_read_stat(i))
+			_write_stats_file(stats_dir + "/" + stats_filenames[i], operf_read_stat(i));
+		total_lost_samples += operf_read_stat(i);
 	}
 	// Write total_samples into stats file if we see any indication of lost samples
 	if (total_lost_samples)
-		_write_stats_file(stats_dir + "/" + stats_filenames[OPERF_SAMPLES], operf_stats[OPERF_SAMPLES]);
+		_write_stats_file(stats_dir + "/" + stats_filenames[OPERF_SAMPLES], operf_read_stat(OPERF_SAMPLES));
 
 	if (total_lost_samples > (int)(OPERF_WARN_LOST_SAMPLES_THRESHOLD
-				       * operf_stats[OPERF_SAMPLES]))
+				       * operf_read_stat(OPERF_SAMPLES)))
 		fprintf(stderr, "\nWARNING: Lost samples detected! See %s for details.\n", operf_log.c_str());
 
 	fflush(fp);
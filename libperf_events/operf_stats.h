@@ -13,11 +13,32 @@
 #include <string>
 #include <vector>
 #include "operf_counter.h"
+#include "op_stats.h"
 
 #ifndef OPERF_STATS_H
 #define OPERF_STATS_H
 
-extern unsigned long operf_stats[];
+/** counters of the calling thread, use operf_read_stat() to get the totals */
+extern OP_STATS_PER_THREAD unsigned long operf_stats[];
+
+/** clear the statistics, the calling thread counters are registered */
+void operf_stats_init(void);
+
+/** add the calling thread counters to the totals, call it before exiting */
+void operf_stats_exit(void);
+
+/** return the sum over all threads of the given statistic */
+unsigned long operf_read_stat(int stat);
+
+/**
+ * operf_write_live_stats - update the live statistics file
+ * @param sessiondir the session directory
+ *
+ * Can be called often, sessiondir/samples/live_stats is rewritten at
+ * most once per second with the sample rate and the lost samples and
+ * sample file cache counts.
+ */
+void operf_write_live_stats(std::string const & sessiondir);
 
 void operf_print_stats(std::string sampledir, char * starttime, bool throttled,
                        std::vector< operf_event_t> const & events);
@@ -483,6 +483,66 @@ template_from_profile(parsed_filename const & parsed,
 }
 
 
+/// the key of a profile specification
+string spec_key(string const & event, string const & count,
+                string const & unitmask, string const & tgid,
+                string const & tid, string const & cpu)
+{
+	// '/' can't appear in any part of a sample filename event spec
+	string key;
+	key.reserve(event.size() + count.size() + unitmask.size() +
+	            tgid.size() + tid.size() + cpu.size() + 5);
+	key += event;
+	key += '/';
+	key += count;
+	key += '/';
+	key += unitmask;
+	key += '/';
+	key += tgid;
+	key += '/';
+	key += tid;
+	key += '/';
+	key += cpu;
+	return key;
+}
+
+
+/// the key of the sample files a sample filename can go with
+string sample_files_key(parsed_filename const & parsed)
+{
+	return parsed.image + '\0' + parsed.lib_image + '\0' +
+		spec_key(parsed.event, parsed.count, parsed.unitmask,
+		         parsed.tgid, parsed.tid, parsed.cpu);
+}
+
+
+/**
+ * The classes being built by arrange_profiles() and indexes to find
+ * where a sample file goes without linear searches through the lists or
+ * parsing again the sample filenames already added. std::list elements
+ * don't move so the indexes point in the lists.
+ */
+struct class_builder {
+	/// the classes in creation order
+	list<profile_class> classes;
+
+	/// class by profile template key
+	map<string, profile_class *> class_index;
+
+	/// profile set of a class by image
+	typedef pair<profile_class const *, string> set_key;
+	map<set_key, profile_set *> set_index;
+
+	/// first dependent set of a profile set for a lib image
+	typedef pair<profile_set const *, string> dep_key;
+	map<dep_key, profile_dep_set *> dep_index;
+
+	/// profile_sample_files of a list by sample_files_key()
+	typedef pair<list<profile_sample_files> const *, string> files_key;
+	map<files_key, profile_sample_files *> files_index;
+};
+
+
 /**
  * Find a matching class the sample file could go in, or generate
  * a new class if needed.
@@ -490,16 +550,26 @@ template_from_profile(parsed_filename const & parsed,
  * The returned value is non-const reference but the ptemplate member
  * must be considered as const
  */
-profile_class & find_class(set<profile_class> & classes,
+profile_class & find_class(class_builder & builder,
                            parsed_filename const & parsed,
                            merge_option const & merge_by)
 {
-	profile_class cls;
-	cls.ptemplate = template_from_profile(parsed, merge_by);
-
-	pair<set<profile_class>::iterator, bool> ret = classes.insert(cls);
-
-	return const_cast<profile_class &>(*ret.first);
+	profile_template const ptemplate =
+		template_from_profile(parsed, merge_by);
+	string const key = spec_key(ptemplate.event, ptemplate.count,
+	                            ptemplate.unitmask, ptemplate.tgid,
+	                            ptemplate.tid, ptemplate.cpu);
+
+	map<string, profile_class *>::iterator it =
+		builder.class_index.lower_bound(key);
+	if (it != builder.class_index.end() && it->first == key)
+		return *it->second;
+
+	builder.classes.push_back(profile_class());
+	profile_class & pclass = builder.classes.back();
+	pclass.ptemplate = ptemplate;
+	builder.class_index.insert(it, make_pair(key, &pclass));
+	return pclass;
 }
 
 /**
@@ -544,40 +614,31 @@ add_to_profile_sample_files(profile_sample_files & sample_files,
 
 /**
  * we need to fix cg filename: a callgraph filename can occur before the binary
- * non callgraph samples filename occur so we must search.
+ * non callgraph samples filename occur so we must search. parsed is the
+ * sample filename as arranged, raw_key the sample_files_key() of the sample
+ * filename as parsed: the files are found by the names in their filenames.
  */
-profile_sample_files &
-find_profile_sample_files(list<profile_sample_files> & files,
-			  parsed_filename const & parsed,
-			  extra_images const & extra)
-{
-	list<profile_sample_files>::iterator it;
-	list<profile_sample_files>::iterator const end = files.end();
-	for (it = files.begin(); it != end; ++it) {
-		if (!it->sample_filename.empty()) {
-			parsed_filename psample_filename =
-			  parse_filename(it->sample_filename, extra);
-			if (psample_filename.lib_image == parsed.lib_image &&
-			    psample_filename.image == parsed.image &&
-			    psample_filename.profile_spec_equal(parsed))
-				return *it;
-		}
+void add_to_sample_files(class_builder & builder,
+                         list<profile_sample_files> & files,
+                         parsed_filename const & parsed,
+                         string const & raw_key)
+{
+	typedef map<class_builder::files_key, profile_sample_files *> index_t;
 
-		list<string>::const_iterator cit;
-		list<string>::const_iterator const cend = it->cg_files.end();
-		for (cit = it->cg_files.begin(); cit != cend; ++cit) {
-			parsed_filename pcg_filename =
-				parse_filename(*cit, extra);
-			if (pcg_filename.lib_image == parsed.lib_image &&
-			    pcg_filename.image == parsed.image &&
-			    pcg_filename.profile_spec_equal(parsed))
-				return *it;
-		}
+	index_t::iterator it = builder.files_index.find(
+		class_builder::files_key(&files, sample_files_key(parsed)));
+	if (it != builder.files_index.end()) {
+		add_to_profile_sample_files(*it->second, parsed);
+	} else {
+		// not found, create a new one
+		files.push_back(profile_sample_files());
+		add_to_profile_sample_files(files.back(), parsed);
 	}
 
-	// not found, create a new one
-	files.push_back(profile_sample_files());
-	return files.back();
+	// the first profile_sample_files holding a filename is the one a
+	// search for this filename would find
+	builder.files_index.insert(make_pair(
+		class_builder::files_key(&files, raw_key), &files.back()));
 }
 
 
@@ -587,61 +648,68 @@ find_profile_sample_files(list<profile_sample_files> & files,
  * on the normal list of profiles otherwise.
  */
 void
-add_to_profile_set(profile_set & set, parsed_filename const & parsed,
-		   bool merge_by_lib, extra_images const & extra)
+add_to_profile_set(class_builder & builder, profile_set & set,
+                   parsed_filename const & parsed, string const & raw_key,
+                   bool merge_by_lib)
 {
 	if (parsed.image == parsed.lib_image && !merge_by_lib) {
-		profile_sample_files & sample_files =
-			find_profile_sample_files(set.files, parsed, extra);
-		add_to_profile_sample_files(sample_files, parsed);
+		add_to_sample_files(builder, set.files, parsed, raw_key);
 		return;
 	}
 
-	list<profile_dep_set>::iterator it = set.deps.begin();
-	list<profile_dep_set>::iterator const end = set.deps.end();
+	class_builder::dep_key const key(&set, parsed.lib_image);
 
-	for (; it != end; ++it) {
-		if (it->lib_image == parsed.lib_image && !merge_by_lib &&
-				parsed.jit_dumpfile_exists == false) {
-			profile_sample_files & sample_files =
-				find_profile_sample_files(it->files, parsed,
-							  extra);
-			add_to_profile_sample_files(sample_files, parsed);
+	if (!merge_by_lib && parsed.jit_dumpfile_exists == false) {
+		map<class_builder::dep_key, profile_dep_set *>::iterator it =
+			builder.dep_index.find(key);
+		if (it != builder.dep_index.end()) {
+			add_to_sample_files(builder, it->second->files,
+			                    parsed, raw_key);
 			return;
 		}
 	}
 
-	profile_dep_set depset;
+	set.deps.push_back(profile_dep_set());
+	profile_dep_set & depset = set.deps.back();
 	depset.lib_image = parsed.lib_image;
-	profile_sample_files & sample_files =
-		find_profile_sample_files(depset.files, parsed, extra);
-	add_to_profile_sample_files(sample_files, parsed);
-	set.deps.push_back(depset);
+	add_to_sample_files(builder, depset.files, parsed, raw_key);
+	builder.dep_index.insert(make_pair(key, &depset));
 }
 
 
+/// compare profile classes through pointers
+struct less_class {
+	bool operator()(profile_class const * lhs,
+	                profile_class const * rhs) const {
+		return *lhs < *rhs;
+	}
+};
+
+
 /**
  * Add a profile to a particular equivalence class. The previous matching
  * will have ensured the profile "fits", so now it's just a matter of
  * finding which sample file list it needs to go on.
  */
-void add_profile(profile_class & pclass, parsed_filename const & parsed,
-		 bool merge_by_lib, extra_images const & extra)
+void add_profile(class_builder & builder, profile_class & pclass,
+                 parsed_filename const & parsed, string const & raw_key,
+                 bool merge_by_lib)
 {
-	list<profile_set>::iterator it = pclass.profiles.begin();
-	list<profile_set>::iterator const end = pclass.profiles.end();
+	class_builder::set_key const key(&pclass, parsed.image);
 
-	for (; it != end; ++it) {
-		if (it->image == parsed.image) {
-			add_to_profile_set(*it, parsed, merge_by_lib, extra);
-			return;
-		}
+	map<class_builder::set_key, profile_set *>::iterator it =
+		builder.set_index.lower_bound(key);
+	if (it != builder.set_index.end() && it->first == key) {
+		add_to_profile_set(builder, *it->second, parsed, raw_key,
+		                   merge_by_lib);
+		return;
 	}
 
-	profile_set set;
+	pclass.profiles.push_back(profile_set());
+	profile_set & set = pclass.profiles.back();
 	set.image = parsed.image;
-	add_to_profile_set(set, parsed, merge_by_lib, extra);
-	pclass.profiles.push_back(set);
+	add_to_profile_set(builder, set, parsed, raw_key, merge_by_lib);
+	builder.set_index.insert(it, make_pair(key, &set));
 }
 
 }  // anon namespace
@@ -651,13 +719,14 @@ profile_classes const
 arrange_profiles(list<string> const & files, merge_option const & merge_by,
 		 extra_images const & extra)
 {
-	set<profile_class> temp_classes;
+	class_builder builder;
 
 	list<string>::const_iterator it = files.begin();
 	list<string>::const_iterator const end = files.end();
 
 	for (; it != end; ++it) {
 		parsed_filename parsed = parse_filename(*it, extra);
+		string const raw_key = sample_files_key(parsed);
 
 		if (parsed.lib_image.empty())
 			parsed.lib_image = parsed.image;
@@ -669,14 +738,24 @@ arrange_profiles(list<string> const & files, merge_option const & merge_by,
 		if (merge_by.lib)
 			parsed.image = parsed.lib_image;
 
-		profile_class & pclass =
-			find_class(temp_classes, parsed, merge_by);
-		add_profile(pclass, parsed, merge_by.lib, extra);
+		profile_class & pclass = find_class(builder, parsed, merge_by);
+		add_profile(builder, pclass, parsed, raw_key, merge_by.lib);
 	}
 
+	// sort by template for nicely ordered columns, the classes are
+	// sorted through pointers to not copy their profile lists
+	vector<profile_class *> sorted;
+	list<profile_class>::iterator cit = builder.classes.begin();
+	for (; cit != builder.classes.end(); ++cit)
+		sorted.push_back(&*cit);
+	stable_sort(sorted.begin(), sorted.end(), less_class());
+
 	profile_classes classes;
-	copy(temp_classes.begin(), temp_classes.end(),
-	     back_inserter(classes.v));
+	classes.v.resize(sorted.size());
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		classes.v[i].profiles.swap(sorted[i]->profiles);
+		classes.v[i].ptemplate = sorted[i]->ptemplate;
+	}
 
 	/* Coverity complains about classes.axis not being initialized upon
 	 * returning a copy of the classes object, so we'll silence it by
@@ -686,9 +765,6 @@ arrange_profiles(list<string> const & files, merge_option const & merge_by,
 	if (classes.v.empty())
 		return classes;
 
-	// sort by template for nicely ordered columns
-	stable_sort(classes.v.begin(), classes.v.end());
-
 	if (want_xml)
 		identify_xml_classes(classes, merge_by);
 	else
@@ -787,10 +863,9 @@ namespace {
 void add_to_group(image_group_set & group, string const & app_image,
                   list<profile_sample_files> const & files)
 {
-	image_set set;
-	set.app_image = app_image;
-	set.files = files;
-	group.push_back(set);
+	group.push_back(image_set());
+	group.back().app_image = app_image;
+	group.back().files = files;
 }
 
 
@@ -800,15 +875,15 @@ typedef map<string, inverted_profile> app_map_t;
 inverted_profile &
 get_iprofile(app_map_t & app_map, string const & image, size_t nr_classes)
 {
-	app_map_t::iterator ait = app_map.find(image);
-	if (ait != app_map.end())
+	app_map_t::iterator ait = app_map.lower_bound(image);
+	if (ait != app_map.end() && ait->first == image)
 		return ait->second;
 
-	inverted_profile ip;
+	ait = app_map.insert(ait, make_pair(image, inverted_profile()));
+	inverted_profile & ip = ait->second;
 	ip.image = image;
 	ip.groups.resize(nr_classes);
-	app_map[image] = ip;
-	return app_map[image];
+	return ip;
 }
 
 
@@ -821,8 +896,11 @@ verify_and_fill(app_map_t & app_map, list<inverted_profile> & plist,
 	app_map_t::iterator const end = app_map.end();
 
 	for (; it != end; ++it) {
-		plist.push_back(it->second);
+		// move rather than copy the sample file lists
+		plist.push_back(inverted_profile());
 		inverted_profile & ip = plist.back();
+		ip.image = it->second.image;
+		ip.groups.swap(it->second.groups);
 		extra.find_image_path(ip.image, ip.error, false);
 	}
 }
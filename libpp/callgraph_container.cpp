@@ -18,6 +18,7 @@
 #include <string>
 #include <iostream>
 #include <numeric>
+#include <sstream>
 
 #include "callgraph_container.h"
 #include "cverb.h"
@@ -27,8 +28,10 @@
 #include "populate.h"
 #include "string_filter.h"
 #include "op_bfd.h"
+#include "op_bfd_cache.h"
 #include "op_sample_file.h"
 #include "locate_images.h"
+#include "parallel.h"
 
 using namespace std;
 
@@ -86,10 +89,10 @@ compare_arc_count_reverse(symbol_entry const & lhs, symbol_entry const & rhs)
 
 
 // find the nearest bfd symbol for the given file offset and check it's
-// in range
+// in range, warnings go to out
 op_bfd_symbol const *
 get_symbol_by_filepos(op_bfd const & bfd, u32 bfd_offset,
-                      vma_t offset, symbol_index_t & i)
+                      vma_t offset, symbol_index_t & i, ostream & out)
 {
 	offset += bfd_offset;
 	op_bfd_symbol tmpsym(offset, 0, string());
@@ -111,9 +114,9 @@ get_symbol_by_filepos(op_bfd const & bfd, u32 bfd_offset,
 
 	if (offset >= end_offset) {
 		// let's be verbose for now
-		cerr << "warning: dropping hyperspace sample at offset "
-		     << hex << offset << " >= " << end_offset
-		     << " for binary " << bfd.get_filename() << dec << endl;
+		out << "warning: dropping hyperspace sample at offset "
+		    << hex << offset << " >= " << end_offset
+		    << " for binary " << bfd.get_filename() << dec << endl;
 		return NULL;
 	}
 
@@ -122,136 +125,143 @@ get_symbol_by_filepos(op_bfd const & bfd, u32 bfd_offset,
 }
 
 
-/// temporary caller and callee data held during processing
-class call_data {
-public:
-	call_data(profile_container const & p, profile_t const & pr,
-	          op_bfd const & bfd, u32 boff, image_name_id iid,
-	          image_name_id aid, bool debug_info)
-		: callee_end(0), pc(p), profile(pr), b(bfd), boffset(boff),
-		  image(iid), app(aid), debug(debug_info) {}
-
-	/// point to a caller symbol
-	void caller_sym(symbol_index_t i) {
-		sym = symbol_entry();
-
-		unsigned long long start;
-		unsigned long long end;
-		b.get_symbol_range(i, start, end);
-
-		samples.clear();
-
-		// see profile_t::samples_range() for why we need this check
-		if (start > boffset) {
-			profile_t::iterator_pair p_it = profile.samples_range(
-				caller_to_key(start - boffset),
-				caller_to_key(end - boffset));
-
-			// Our odb_key_t contain (from_eip << 32 | to_eip),
-			// the range of keys we selected above contains one
-			// caller but different callees, and due to the
-			// ordering callee offsets are not consecutive: so
-			// we must sort them first.
-
-			for (; p_it.first != p_it.second; ++p_it.first) {
-				samples.push_back(make_pair(p_it.first.vma(),
-					p_it.first.count()));
-			}
+/// an arc of a cg file between two op_bfd symbols
+struct bfd_arc {
+	symbol_index_t caller;
+	symbol_index_t callee;
+	count_type count;
+};
 
-			sort(samples.begin(), samples.end(),
-			     compare_by_callee_vma);
-		}
 
-		sym.size = end - start;
-		sym.name = symbol_names.create(b.syms[i].name());
-		sym.sample.vma = b.syms[i].vma();
+/// the symbol names of an op_bfd by symbol index, created on demand
+typedef vector<symbol_name_id> bfd_names_t;
 
-		finish_sym(i, start);
 
-		if (cverb << vdebug) {
-			cverb << vdebug << hex << "Caller sym: "
-			      << b.syms[i].name() << " filepos " << start
-			      << "-" << end << dec << endl;
-		}
-	}
+/**
+ * A cg file being processed, in four steps: prepare_cg_file() locates
+ * and opens its images, read_arcs() reads its arcs, name_symbols() creates
+ * the names of its images and symbols and record_arcs() records its arcs.
+ * The names are created serially, in the order the files are given, as
+ * the symbols are ordered by name ids.
+ */
+struct cg_file : noncopyable {
+	cg_file() : pclass(0), caller_bfd_ok(true), callee_bfd_ok(true),
+		skip(false), caller_offset(0), callee_offset(0),
+		caller_names(0), callee_names(0) {}
+
+	string filename;
+	string app_name;
+	size_t pclass;
+
+	scoped_ptr<cached_op_bfd> caller_bfd;
+	bool caller_bfd_ok;
+	scoped_ptr<cached_op_bfd> callee_bfd;
+	bool callee_bfd_ok;
+
+	/// set by read_arcs() if the file can't be used
+	bool skip;
+	u32 caller_offset;
+	u32 callee_offset;
+	/// in caller symbol order
+	vector<bfd_arc> arcs;
+	/// warnings of read_arcs(), shown once all files are read
+	ostringstream warnings;
+
+	image_name_id image_id;
+	image_name_id callee_image_id;
+	image_name_id app_id;
+	bfd_names_t const * caller_names;
+	bfd_names_t const * callee_names;
+};
 
-	/// point to a callee symbol
-	bool callee_sym(u32 off) {
-		sym = symbol_entry();
 
-		symbol_index_t i = 0;
-		op_bfd_symbol const * bfdsym =
-			get_symbol_by_filepos(b, boffset, off, i);
+void prepare_cg_file(cg_file & file, extra_images const & extra,
+                     op_bfd_cache & bfd_cache, bool merge_lib,
+                     string const & app_image)
+{
+	cverb << vdebug << "samples file : " << file.filename << endl;
 
-		if (!bfdsym)
-			return false;
+	parsed_filename caller_file = parse_filename(file.filename, extra);
+	file.app_name = merge_lib ? app_image : caller_file.image;
 
-		callee_end = bfdsym->size() + bfdsym->filepos() - boffset;
+	image_error error;
+	extra.find_image_path(caller_file.lib_image, error, false);
 
-		sym.size = bfdsym->size();
-		sym.name = symbol_names.create(bfdsym->name());
-		sym.sample.vma = bfdsym->vma();
+	if (error != image_ok)
+		report_image_error(caller_file.lib_image, error, false, extra);
 
-		finish_sym(i, bfdsym->filepos());
+	file.caller_bfd.reset(new cached_op_bfd(bfd_cache,
+		caller_file.lib_image, file.caller_bfd_ok));
+	if (!file.caller_bfd_ok)
+		report_image_error(caller_file.lib_image,
+		                   image_format_failure, false, extra);
 
-		if (cverb << vdebug) {
-			cverb << vdebug << hex << "Callee sym: "
-			      << bfdsym->name() << " filepos "
-			      << bfdsym->filepos() << "-"
-			      << (bfdsym->filepos() + bfdsym->size())
-			      << dec << endl;
-		}
-		return true;
-	}
+	parsed_filename callee_file = parse_filename(file.filename, extra);
 
-	void verbose_bfd(string const & prefix) const {
-		cverb << vdebug << prefix << " " << b.get_filename()
-		      << " offset " << boffset << " app "
-		      << image_names.name(app) << endl;
-	}
+	extra.find_image_path(callee_file.cg_image, error, false);
+	if (error != image_ok)
+		report_image_error(callee_file.cg_image, error, false, extra);
 
-	typedef vector<pair<odb_key_t, count_type> > samples_t;
+	file.callee_bfd.reset(new cached_op_bfd(bfd_cache,
+		callee_file.cg_image, file.callee_bfd_ok));
+	if (!file.callee_bfd_ok)
+		report_image_error(callee_file.cg_image,
+		                   image_format_failure, false, extra);
+}
 
-	typedef samples_t::const_iterator const_iterator;
 
-	samples_t samples;
-	symbol_entry sym;
-	u32 callee_end;
+typedef vector<pair<odb_key_t, count_type> > samples_t;
 
-private:
-	/// fill in the rest of the sym
-	void finish_sym(symbol_index_t i, unsigned long start) {
-		sym.image_name = image;
-		sym.app_name = app;
-		symbol_entry const * self = pc.find(sym);
-		if (self)
-			sym.sample.counts = self->sample.counts;
-
-		if (debug) {
-			string filename;
-			file_location & loc = sym.sample.file_loc;
-			if (b.get_linenr(i, start, filename, loc.linenr))
-				loc.filename = debug_names.create(filename);
+
+/// the samples of the caller symbol i sorted by callee, return the file
+/// offset of the symbol
+unsigned long long
+get_caller_samples(profile_t const & profile, op_bfd const & bfd,
+                   u32 boffset, symbol_index_t i, samples_t & samples)
+{
+	unsigned long long start;
+	unsigned long long end;
+	bfd.get_symbol_range(i, start, end);
+
+	samples.clear();
+
+	// see profile_t::samples_range() for why we need this check
+	if (start > boffset) {
+		profile_t::iterator_pair p_it = profile.samples_range(
+			caller_to_key(start - boffset),
+			caller_to_key(end - boffset));
+
+		// Our odb_key_t contain (from_eip << 32 | to_eip),
+		// the range of keys we selected above contains one
+		// caller but different callees, and due to the
+		// ordering callee offsets are not consecutive: so
+		// we must sort them first.
+
+		for (; p_it.first != p_it.second; ++p_it.first) {
+			samples.push_back(make_pair(p_it.first.vma(),
+				p_it.first.count()));
 		}
+
+		sort(samples.begin(), samples.end(), compare_by_callee_vma);
 	}
 
-	profile_container const & pc;
-	profile_t const & profile;
-	op_bfd const & b;
-	u32 boffset;
-	image_name_id image;
-	image_name_id app;
-	bool debug;
-};
+	if (cverb << vdebug) {
+		cverb << vdebug << hex << "Caller sym: "
+		      << bfd.syms[i].name() << " filepos " << start
+		      << "-" << end << dec << endl;
+	}
+
+	return start;
+}
 
 
 /// accumulate all samples for a given caller/callee pair
 count_type
-accumulate_callee(call_data::const_iterator & it, call_data::const_iterator end,
-                  u32 callee_end)
+accumulate_callee(samples_t::const_iterator & it,
+                  samples_t::const_iterator end, u32 callee_end)
 {
 	count_type count = 0;
-	call_data::const_iterator const start = it;
+	samples_t::const_iterator const start = it;
 
 	while (it != end) {
 		u32 offset = key_to_callee(it->first);
@@ -280,23 +290,471 @@ accumulate_callee(call_data::const_iterator & it, call_data::const_iterator end,
 }
 
 
+void read_arcs(cg_file & file)
+{
+	profile_t profile;
+	// We can't use start_offset support in profile_t, give
+	// it a zero offset and we will fix that below
+	profile.add_sample_file(file.filename);
+
+	op_bfd const & caller_bfd = **file.caller_bfd;
+	op_bfd const & callee_bfd = **file.callee_bfd;
+
+	opd_header const & header = profile.get_header();
+
+	// We can't use kernel sample file w/o the binary else we will
+	// use it with a zero offset, the code below will abort because
+	// we will get incorrect callee sub-range and out of range
+	// callee vma. FIXME
+	if (header.is_kernel && !file.caller_bfd_ok) {
+		file.skip = true;
+		return;
+	}
+
+	// We must handle start_offset, this offset can be different for the
+	// caller and the callee: kernel sample traversing the syscall barrier.
+	if (header.is_kernel)
+		file.caller_offset = caller_bfd.get_start_offset(0);
+	else
+		file.caller_offset = header.anon_start;
+
+	if (header.cg_to_is_kernel)
+		file.callee_offset = callee_bfd.get_start_offset(0);
+	else
+		file.callee_offset = header.cg_to_anon_start;
+
+	if (cverb << vdebug) {
+		cverb << vdebug << "Caller: " << caller_bfd.get_filename()
+		      << " offset " << file.caller_offset << " app "
+		      << file.app_name << endl;
+		cverb << vdebug << "Callee: " << callee_bfd.get_filename()
+		      << " offset " << file.callee_offset << " app "
+		      << file.app_name << endl;
+	}
+
+	// For each symbol in the caller bfd, process all arcs to
+	// callee bfd symbols
+
+	samples_t samples;
+	for (symbol_index_t i = 0; i < caller_bfd.syms.size(); ++i) {
+		get_caller_samples(profile, caller_bfd, file.caller_offset,
+		                   i, samples);
+
+		samples_t::const_iterator dit = samples.begin();
+		samples_t::const_iterator const dend = samples.end();
+		while (dit != dend) {
+			bfd_arc arc = { i, 0, 0 };
+			op_bfd_symbol const * bfdsym = get_symbol_by_filepos(
+				callee_bfd, file.callee_offset,
+				key_to_callee(dit->first), arc.callee,
+				file.warnings);
+
+			// if we can't find the callee, skip an arc
+			if (!bfdsym) {
+				++dit;
+				continue;
+			}
+
+			if (cverb << vdebug) {
+				cverb << vdebug << hex << "Callee sym: "
+				      << bfdsym->name() << " filepos "
+				      << bfdsym->filepos() << "-"
+				      << (bfdsym->filepos() + bfdsym->size())
+				      << dec << endl;
+			}
+
+			u32 const callee_end = bfdsym->size() +
+				bfdsym->filepos() - file.callee_offset;
+			arc.count = accumulate_callee(dit, dend, callee_end);
+			file.arcs.push_back(arc);
+		}
+	}
+}
+
+
+/// return the names of the symbols of bfd, created on demand by name()
+bfd_names_t &
+get_names(map<op_bfd const *, bfd_names_t> & names, op_bfd const & bfd)
+{
+	bfd_names_t & result = names[&bfd];
+	result.resize(bfd.syms.size());
+	return result;
+}
+
+
+void name(bfd_names_t & names, op_bfd const & bfd, symbol_index_t i)
+{
+	if (!names[i].set())
+		names[i] = symbol_names.create(bfd.syms[i].name());
+}
+
+
+void name_symbols(cg_file & file, map<op_bfd const *, bfd_names_t> & names)
+{
+	if (file.skip)
+		return;
+
+	op_bfd const & caller_bfd = **file.caller_bfd;
+	op_bfd const & callee_bfd = **file.callee_bfd;
+
+	file.image_id = image_names.create(caller_bfd.get_filename());
+	file.callee_image_id = image_names.create(callee_bfd.get_filename());
+	file.app_id = image_names.create(file.app_name);
+
+	bfd_names_t & caller_names = get_names(names, caller_bfd);
+	bfd_names_t & callee_names = get_names(names, callee_bfd);
+	file.caller_names = &caller_names;
+	file.callee_names = &callee_names;
+
+	// each caller symbol, then the callees of its arcs
+	vector<bfd_arc>::const_iterator it = file.arcs.begin();
+	for (symbol_index_t i = 0; i < caller_bfd.syms.size(); ++i) {
+		name(caller_names, caller_bfd, i);
+		for (; it != file.arcs.end() && it->caller == i; ++it)
+			name(callee_names, callee_bfd, it->callee);
+	}
+}
+
+
+/// protect debug_names, see make_symbol()
+op_mutex debug_names_mutex;
+
+
+symbol_entry make_symbol(op_bfd const & bfd, bfd_names_t const & names,
+                         symbol_index_t i, unsigned long long start,
+                         size_t size, image_name_id image,
+                         image_name_id app, profile_container const & pc,
+                         bool debug_info)
+{
+	symbol_entry sym;
+	sym.size = size;
+	sym.name = names[i];
+	sym.sample.vma = bfd.syms[i].vma();
+	sym.image_name = image;
+	sym.app_name = app;
+
+	symbol_entry const * self = pc.find(sym);
+	if (self)
+		sym.sample.counts = self->sample.counts;
+
+	if (debug_info) {
+		string filename;
+		file_location & loc = sym.sample.file_loc;
+		if (bfd.get_linenr(i, start, filename, loc.linenr)) {
+			op_mutex_lock lock(debug_names_mutex);
+			loc.filename = debug_names.create(filename);
+		}
+	}
+
+	return sym;
+}
+
+
+void record_arcs(cg_file const & file, arc_recorder & recorder,
+                 profile_container const & pc, bool debug_info)
+{
+	if (file.skip)
+		return;
+
+	op_bfd const & caller_bfd = **file.caller_bfd;
+	op_bfd const & callee_bfd = **file.callee_bfd;
+
+	symbol_entry caller;
+	vector<bfd_arc>::const_iterator it;
+	for (it = file.arcs.begin(); it != file.arcs.end(); ++it) {
+		if (it == file.arcs.begin() || it->caller != (it - 1)->caller) {
+			unsigned long long start;
+			unsigned long long end;
+			caller_bfd.get_symbol_range(it->caller, start, end);
+			caller = make_symbol(caller_bfd, *file.caller_names,
+				it->caller, start, end - start,
+				file.image_id, file.app_id, pc, debug_info);
+		}
+
+		op_bfd_symbol const & bfdsym = callee_bfd.syms[it->callee];
+		symbol_entry const callee = make_symbol(callee_bfd,
+			*file.callee_names, it->callee, bfdsym.filepos(),
+			bfdsym.size(), file.callee_image_id, file.app_id,
+			pc, debug_info);
+
+		recorder.add(caller, &callee, file.pclass, it->count);
+	}
+}
+
+
+/// the cg files of a cg_batch, owned
+struct cg_batch : noncopyable {
+	~cg_batch() {
+		for (size_t i = 0; i < files.size(); ++i)
+			delete files[i];
+	}
+
+	vector<cg_file *> files;
+};
+
+
+/// a cg file to process, with its application image and profile class
+struct cg_source {
+	string const * filename;
+	string const * app_image;
+	size_t pclass;
+};
+
+
+void add_cg_sources(vector<cg_source> & sources, list<image_set> const & lset,
+                    string const & app_image, size_t pclass)
+{
+	list<image_set>::const_iterator lit;
+	list<image_set>::const_iterator const lend = lset.end();
+	for (lit = lset.begin(); lit != lend; ++lit) {
+		list<profile_sample_files>::const_iterator pit;
+		list<profile_sample_files>::const_iterator pend
+			= lit->files.end();
+		for (pit = lit->files.begin(); pit != pend; ++pit) {
+			list<string>::const_iterator it;
+			for (it = pit->cg_files.begin();
+			     it != pit->cg_files.end(); ++it) {
+				cg_source const source =
+					{ &*it, &app_image, pclass };
+				sources.push_back(source);
+			}
+		}
+	}
+}
+
+
+/// the arc_recorder used by each thread of a populate_job
+class recorder_pool : noncopyable {
+public:
+	~recorder_pool() {
+		for (size_t i = 0; i < recorders.size(); ++i)
+			delete recorders[i];
+	}
+
+	arc_recorder * get() {
+		op_mutex_lock lock(mutex);
+		if (free.empty()) {
+			recorders.push_back(new arc_recorder);
+			return recorders.back();
+		}
+		arc_recorder * recorder = free.back();
+		free.pop_back();
+		return recorder;
+	}
+
+	void put(arc_recorder * recorder) {
+		op_mutex_lock lock(mutex);
+		free.push_back(recorder);
+	}
+
+	/// all the recorders
+	vector<arc_recorder *> recorders;
+
+private:
+	vector<arc_recorder *> free;
+	op_mutex mutex;
+};
+
+
+/// read_arcs() or record_arcs() for each file of a batch
+class populate_job : public parallel_job {
+public:
+	populate_job(vector<cg_file *> const & files_, recorder_pool & pool_,
+	             profile_container const & pc_, bool debug_info_)
+		: files(files_), pool(pool_), pc(pc_),
+		  debug_info(debug_info_), recording(false) {}
+
+	void run(size_t index) {
+		if (!recording) {
+			read_arcs(*files[index]);
+			return;
+		}
+
+		arc_recorder * recorder = pool.get();
+		record_arcs(*files[index], *recorder, pc, debug_info);
+		pool.put(recorder);
+	}
+
+	vector<cg_file *> const & files;
+	recorder_pool & pool;
+	profile_container const & pc;
+	bool debug_info;
+	/// false to read the arcs, true to record them
+	bool recording;
+};
+
+
 } // anonymous namespace
 
 
+arc_recorder::symbol_key::symbol_key(symbol_entry const & sym)
+	:
+	image_name(sym.image_name),
+	app_name(sym.app_name),
+	name(sym.name),
+	vma(sym.sample.vma),
+	size(sym.size)
+{
+}
+
+
+bool arc_recorder::symbol_key::operator<(symbol_key const & rhs) const
+{
+	// same order as less_symbol
+	if (image_name != rhs.image_name)
+		return image_name < rhs.image_name;
+
+	if (app_name != rhs.app_name)
+		return app_name < rhs.app_name;
+
+	if (name != rhs.name)
+		return name < rhs.name;
+
+	if (vma != rhs.vma)
+		return vma < rhs.vma;
+
+	return size < rhs.size;
+}
+
+
+bool arc_recorder::symbol_key::operator==(symbol_key const & rhs) const
+{
+	return image_name == rhs.image_name && app_name == rhs.app_name &&
+		name == rhs.name && vma == rhs.vma && size == rhs.size;
+}
+
+
+bool arc_recorder::arc::operator<(arc const & rhs) const
+{
+	if (caller != rhs.caller)
+		return caller < rhs.caller;
+	if (callee != rhs.callee)
+		return callee < rhs.callee;
+	return pclass < rhs.pclass;
+}
+
+
+u32 arc_recorder::get_node(symbol_entry const & sym, bool in_arc)
+{
+	pair<map<symbol_key, u32>::iterator, bool> res =
+		node_ids.insert(make_pair(symbol_key(sym), u32(nodes.size())));
+	u32 const id = res.first->second;
+
+	if (res.second) {
+		node const n = { entries.size(), in_arc ? entries.size() : npos };
+		entries.push_back(sym);
+		nodes.push_back(n);
+	} else if (in_arc && nodes[id].arc == npos) {
+		nodes[id].arc = entries.size();
+		entries.push_back(sym);
+	}
+
+	return id;
+}
+
+
+void arc_recorder::rank_nodes(vector<u32> & rank, vector<u32> & order) const
+{
+	rank.resize(nodes.size());
+	order.reserve(nodes.size());
+	map<symbol_key, u32>::const_iterator it;
+	for (it = node_ids.begin(); it != node_ids.end(); ++it) {
+		rank[it->second] = order.size();
+		order.push_back(it->second);
+	}
+}
+
+
+bool arc_recorder::is_output(u32 id, count_array_t const & total,
+                             double threshold,
+                             string_filter const & sym_filter) const
+{
+	symbol_entry const & sym = entries[nodes[id].main];
+
+	// threshold out the main symbol if needed
+	if (op_ratio(sym.sample.counts[0], total[0]) < threshold)
+		return false;
+
+	// FIXME: slow?
+	return sym_filter.match(symbol_names.demangle(sym.name));
+}
+
+
+void arc_recorder::clear()
+{
+	arcs_t().swap(arcs);
+	vector<node>().swap(nodes);
+	vector<symbol_entry>().swap(entries);
+	node_ids.clear();
+}
+
+
+void arc_recorder::merge_arcs()
+{
+	sort(arcs.begin(), arcs.end());
+
+	arcs_t::iterator out = arcs.begin();
+	arcs_t::const_iterator it;
+	for (it = arcs.begin(); it != arcs.end(); ++it) {
+		if (out != arcs.begin() && (out - 1)->caller == it->caller &&
+		    (out - 1)->callee == it->callee &&
+		    (out - 1)->pclass == it->pclass)
+			(out - 1)->count += it->count;
+		else
+			*out++ = *it;
+	}
+	arcs.erase(out, arcs.end());
+
+	merged_arcs = arcs.size();
+}
+
+
 void arc_recorder::
 add(symbol_entry const & caller, symbol_entry const * callee,
-    count_array_t const & arc_count)
+    size_t pclass, count_type arc_count)
 {
-	cg_data & data = sym_map[caller];
+	if (!callee) {
+		get_node(caller, false);
+		return;
+	}
+
+	u32 caller_id;
+	if (last_caller != npos &&
+	    symbol_key(entries[nodes[last_caller].main]) == symbol_key(caller)) {
+		caller_id = last_caller;
+	} else {
+		caller_id = get_node(caller, true);
+		last_caller = caller_id;
+	}
 
-	// If we have a callee, add it to the caller's list, then
-	// add the caller to the callee's list.
-	if (callee) {
-		data.callees[*callee] += arc_count;
+	arc const a = { caller_id, get_node(*callee, true), u32(pclass),
+	                arc_count };
+	arcs.push_back(a);
 
-		cg_data & callee_data = sym_map[*callee];
+	// the same arcs are met in many cg files, keep them merged
+	if (arcs.size() >= 2 * merged_arcs + 4096)
+		merge_arcs();
+}
+
+
+void arc_recorder::merge(arc_recorder const & other)
+{
+	vector<u32> ids(other.nodes.size());
+	for (size_t i = 0; i < other.nodes.size(); ++i) {
+		node const & n = other.nodes[i];
+		ids[i] = get_node(other.entries[n.main], false);
+		if (n.arc != npos)
+			get_node(other.entries[n.arc], true);
+	}
 
-		callee_data.callers[caller] += arc_count;
+	arcs_t::const_iterator it;
+	for (it = other.arcs.begin(); it != other.arcs.end(); ++it) {
+		arc const a = { ids[it->caller], ids[it->callee],
+		                it->pclass, it->count };
+		arcs.push_back(a);
+
+		if (arcs.size() >= 2 * merged_arcs + 4096)
+			merge_arcs();
 	}
 }
 
@@ -339,42 +797,99 @@ void arc_recorder::process_children(cg_symbol & sym, double threshold)
 }
 
 
+namespace {
+
+/// order arcs by caller then callee rank, see arc_recorder::process()
+struct less_by_caller {
+	less_by_caller(vector<u32> const & r) : rank(r) {}
+
+	template <typename Arc>
+	bool operator()(Arc const & lhs, Arc const & rhs) const {
+		if (lhs.caller != rhs.caller)
+			return rank[lhs.caller] < rank[rhs.caller];
+		return rank[lhs.callee] < rank[rhs.callee];
+	}
+
+	vector<u32> const & rank;
+};
+
+
+/// order arcs by callee then caller rank
+struct less_by_callee {
+	less_by_callee(vector<u32> const & r) : rank(r) {}
+
+	template <typename Arc>
+	bool operator()(Arc const & lhs, Arc const & rhs) const {
+		if (lhs.callee != rhs.callee)
+			return rank[lhs.callee] < rank[rhs.callee];
+		return rank[lhs.caller] < rank[rhs.caller];
+	}
+
+	vector<u32> const & rank;
+};
+
+}
+
+
 void arc_recorder::
 process(count_array_t total, double threshold,
         string_filter const & sym_filter)
 {
-	map_t::const_iterator it;
-	map_t::const_iterator end = sym_map.end();
+	merge_arcs();
 
-	for (it = sym_map.begin(); it != end; ++it) {
-		cg_symbol sym((*it).first);
-		cg_data const & data = (*it).second;
+	// The output is built in less_symbol order of the symbols and of
+	// their callers and callees: rank the nodes in this order and sort
+	// the arcs accordingly, once by caller and once by callee.
+	vector<u32> rank;
+	vector<u32> order;
+	rank_nodes(rank, order);
 
-		// threshold out the main symbol if needed
-		if (op_ratio(sym.sample.counts[0], total[0]) < threshold)
-			continue;
+	sort(arcs.begin(), arcs.end(), less_by_caller(rank));
+	arcs_t by_callee(arcs);
+	sort(by_callee.begin(), by_callee.end(), less_by_callee(rank));
 
-		// FIXME: slow?
-		if (!sym_filter.match(symbol_names.demangle(sym.name)))
-			continue;
+	arcs_t::const_iterator callee_it = arcs.begin();
+	arcs_t::const_iterator caller_it = by_callee.begin();
+
+	for (size_t i = 0; i < order.size(); ++i) {
+		u32 const id = order[i];
 
-		cg_data::children::const_iterator cit;
-		cg_data::children::const_iterator cend = data.callers.end();
+		// skip the arcs of the previous, thresholded out, symbols
+		while (callee_it != arcs.end() && rank[callee_it->caller] < i)
+			++callee_it;
+		while (caller_it != by_callee.end() &&
+		       rank[caller_it->callee] < i)
+			++caller_it;
 
-		for (cit = data.callers.begin(); cit != cend; ++cit) {
-			symbol_entry csym = cit->first;
-			csym.sample.counts = cit->second;
+		if (!is_output(id, total, threshold, sym_filter))
+			continue;
+
+		cg_symbol sym(entries[nodes[id].main]);
+
+		while (caller_it != by_callee.end() && caller_it->callee == id) {
+			symbol_entry csym = entries[nodes[caller_it->caller].arc];
+			csym.sample.counts = count_array_t();
+			u32 const caller = caller_it->caller;
+			for (; caller_it != by_callee.end() &&
+			     caller_it->callee == id &&
+			     caller_it->caller == caller; ++caller_it)
+				csym.sample.counts[caller_it->pclass] +=
+					caller_it->count;
 			sym.callers.push_back(csym);
-			sym.total_caller_count += cit->second;
+			sym.total_caller_count += csym.sample.counts;
 		}
 
-		cend = data.callees.end();
-
-		for (cit = data.callees.begin(); cit != cend; ++cit) {
-			symbol_entry csym = cit->first;
-			csym.sample.counts = cit->second;
+		while (callee_it != arcs.end() && callee_it->caller == id) {
+			symbol_entry csym = entries[nodes[callee_it->callee].arc];
+			csym.sample.counts = count_array_t();
+			u32 const callee = callee_it->callee;
+			for (; callee_it != arcs.end() &&
+			     callee_it->caller == id &&
+			     callee_it->callee == callee; ++callee_it)
+				csym.sample.counts[callee_it->pclass] +=
+					callee_it->count;
 			sym.callees.push_back(csym);
-			sym.total_callee_count += cit->second;
+			sym.total_callee_count += csym.sample.counts;
 		}
 
 		process_children(sym, threshold);
@@ -383,6 +898,57 @@ process(count_array_t total, double threshold,
 		// then store pointer to sym in cg_syms
 		cg_syms.push_back(&(*cg_syms_objs.insert(cg_syms_objs.end(), sym)));
 	}
+
+	// the recorder is not used anymore, free it
+	clear();
+}
+
+
+void arc_recorder::
+write_arcs(count_array_t total, double threshold,
+           string_filter const & sym_filter, arc_writer & writer)
+{
+	merge_arcs();
+
+	vector<u32> rank;
+	vector<u32> order;
+	rank_nodes(rank, order);
+	sort(arcs.begin(), arcs.end(), less_by_caller(rank));
+
+	// the callee filter result of each node: 0 unknown, 1 no, 2 yes
+	vector<char> matched(nodes.size(), 0);
+
+	arcs_t::const_iterator it = arcs.begin();
+	while (it != arcs.end()) {
+		u32 const caller = it->caller;
+		if (!is_output(caller, total, threshold, sym_filter)) {
+			while (it != arcs.end() && it->caller == caller)
+				++it;
+			continue;
+		}
+
+		symbol_entry const & caller_sym = entries[nodes[caller].arc];
+		while (it != arcs.end() && it->caller == caller) {
+			u32 const callee = it->callee;
+			count_array_t counts;
+			for (; it != arcs.end() && it->caller == caller &&
+			     it->callee == callee; ++it)
+				counts[it->pclass] += it->count;
+
+			symbol_entry const & callee_sym =
+				entries[nodes[callee].arc];
+			if (!matched[callee]) {
+				string const name =
+					symbol_names.demangle(callee_sym.name);
+				matched[callee] = sym_filter.match(name) ? 2 : 1;
+			}
+
+			if (matched[callee] == 2)
+				writer.write(caller_sym, callee_sym, counts);
+		}
+	}
+
+	clear();
 }
 
 
@@ -394,7 +960,7 @@ symbol_collection const & arc_recorder::get_symbols() const
 
 void callgraph_container::populate(list<inverted_profile> const & iprofiles,
    extra_images const & extra, bool debug_info, double threshold,
-   bool merge_lib, string_filter const & sym_filter)
+   bool merge_lib, string_filter const & sym_filter, arc_writer * writer)
 {
 	this->extra_found_images = extra;
 	// non callgraph samples container, we record sample at symbol level
@@ -412,158 +978,55 @@ void callgraph_container::populate(list<inverted_profile> const & iprofiles,
 
 	total_count = pc.samples_count();
 
+	// the same images are the caller and callee of many cg files
+	string_filter const no_filter;
+	op_bfd_cache bfd_cache(no_filter, extra_found_images);
+
+	vector<cg_source> sources;
 	for (it = iprofiles.begin(); it != end; ++it) {
-		for (size_t i = 0; i < it->groups.size(); ++i) {
-			populate(it->groups[i], it->image,
-				i, pc, debug_info, merge_lib);
-		}
+		for (size_t i = 0; i < it->groups.size(); ++i)
+			add_cg_sources(sources, it->groups[i], it->image, i);
 	}
 
-	recorder.process(total_count, threshold / 100.0, sym_filter);
-}
-
-
-void callgraph_container::populate(list<image_set> const & lset,
-	string const & app_image, size_t pclass,
-	profile_container const & pc, bool debug_info, bool merge_lib)
-{
-	list<image_set>::const_iterator lit;
-	list<image_set>::const_iterator const lend = lset.end();
-	for (lit = lset.begin(); lit != lend; ++lit) {
-		list<profile_sample_files>::const_iterator pit;
-		list<profile_sample_files>::const_iterator pend
-			= lit->files.end();
-		for (pit = lit->files.begin(); pit != pend; ++pit) {
-			populate(pit->cg_files, app_image,
-				 pclass, pc, debug_info, merge_lib);
+	// The cg files are read and their arcs recorded in parallel, a
+	// batch at a time to bound the nr. of images kept open. The verbose
+	// output is only readable one file at a time.
+	size_t const batch_size = (cverb << vdebug) ? 1 : 64;
+	recorder_pool pool;
+	for (size_t first = 0; first < sources.size(); first += batch_size) {
+		size_t const last = min(first + batch_size, sources.size());
+
+		cg_batch batch;
+		for (size_t i = first; i < last; ++i) {
+			batch.files.push_back(new cg_file);
+			cg_file & file = *batch.files.back();
+			file.filename = *sources[i].filename;
+			file.pclass = sources[i].pclass;
+			prepare_cg_file(file, extra_found_images, bfd_cache,
+			                merge_lib, *sources[i].app_image);
 		}
-	}
-}
 
+		populate_job job(batch.files, pool, pc, debug_info);
+		parallel_run(job, batch.files.size());
 
-void callgraph_container::populate(list<string> const & cg_files,
-	string const & app_image, size_t pclass,
-	profile_container const & pc, bool debug_info, bool merge_lib)
-{
-	list<string>::const_iterator it;
-	list<string>::const_iterator const end = cg_files.end();
-	for (it = cg_files.begin(); it != end; ++it) {
-		cverb << vdebug << "samples file : " << *it << endl;
-
-		parsed_filename caller_file =
-			parse_filename(*it, extra_found_images);
-		string const app_name = caller_file.image;
-
-		image_error error;
-		extra_found_images.find_image_path(caller_file.lib_image,
-				error, false);
-
-		if (error != image_ok)
-			report_image_error(caller_file.lib_image,
-					   error, false, extra_found_images);
-
-		bool caller_bfd_ok = true;
-		op_bfd caller_bfd(caller_file.lib_image,
-			string_filter(), extra_found_images, caller_bfd_ok);
-		if (!caller_bfd_ok)
-			report_image_error(caller_file.lib_image,
-			                   image_format_failure, false,
-					   extra_found_images);
-
-		parsed_filename callee_file =
-			parse_filename(*it, extra_found_images);
-
-		extra_found_images.find_image_path(callee_file.cg_image,
-				error, false);
-		if (error != image_ok)
-			report_image_error(callee_file.cg_image,
-					   error, false, extra_found_images);
-
-		bool callee_bfd_ok = true;
-		op_bfd callee_bfd(callee_file.cg_image,
-			string_filter(), extra_found_images, callee_bfd_ok);
-		if (!callee_bfd_ok)
-			report_image_error(callee_file.cg_image,
-		                           image_format_failure, false,
-					   extra_found_images);
-
-		profile_t profile;
-		// We can't use start_offset support in profile_t, give
-		// it a zero offset and we will fix that in add()
-		profile.add_sample_file(*it);
-		add(profile, caller_bfd, caller_bfd_ok, callee_bfd,
-		    merge_lib ? app_image : app_name, pc,
-		    debug_info, pclass);
-	}
-}
-
-
-void callgraph_container::
-add(profile_t const & profile, op_bfd const & caller_bfd, bool caller_bfd_ok,
-   op_bfd const & callee_bfd, string const & app_name,
-   profile_container const & pc, bool debug_info, size_t pclass)
-{
-	string const image_name = caller_bfd.get_filename();
-
-	opd_header const & header = profile.get_header();
-
-	// We can't use kernel sample file w/o the binary else we will
-	// use it with a zero offset, the code below will abort because
-	// we will get incorrect callee sub-range and out of range
-	// callee vma. FIXME
-	if (header.is_kernel && !caller_bfd_ok)
-		return;
-
-	// We must handle start_offset, this offset can be different for the
-	// caller and the callee: kernel sample traversing the syscall barrier.
-	u32 caller_offset;
-	if (header.is_kernel)
-		caller_offset = caller_bfd.get_start_offset(0);
-	else
-		caller_offset = header.anon_start;
-
-	u32 callee_offset;
-	if (header.cg_to_is_kernel)
-		callee_offset = callee_bfd.get_start_offset(0);
-	else
-		callee_offset = header.cg_to_anon_start;
-
-	image_name_id image_id = image_names.create(image_name);
-	image_name_id callee_image_id = image_names.create(callee_bfd.get_filename());
-	image_name_id app_id = image_names.create(app_name);
-
-	call_data caller(pc, profile, caller_bfd, caller_offset, image_id,
-	                   app_id, debug_info);
-	call_data callee(pc, profile, callee_bfd, callee_offset,
-	                   callee_image_id, app_id, debug_info);
+		map<op_bfd const *, bfd_names_t> names;
+		for (size_t i = 0; i < batch.files.size(); ++i) {
+			cerr << batch.files[i]->warnings.str();
+			name_symbols(*batch.files[i], names);
+		}
 
-	if (cverb << vdebug) {
-		caller.verbose_bfd("Caller:");
-		callee.verbose_bfd("Callee:");
+		job.recording = true;
+		parallel_run(job, batch.files.size());
 	}
 
-	// For each symbol in the caller bfd, process all arcs to
-	// callee bfd symbols
-
-	for (symbol_index_t i = 0; i < caller_bfd.syms.size(); ++i) {
+	for (size_t i = 0; i < pool.recorders.size(); ++i)
+		recorder.merge(*pool.recorders[i]);
 
-		caller.caller_sym(i);
-
-		call_data::const_iterator dit = caller.samples.begin();
-		call_data::const_iterator dend = caller.samples.end();
-		while (dit != dend) {
-			// if we can't find the callee, skip an arc
-			if (!callee.callee_sym(key_to_callee(dit->first))) {
-				++dit;
-				continue;
-			}
-
-			count_array_t arc_count;
-			arc_count[pclass] =
-				accumulate_callee(dit, dend, callee.callee_end);
-
-			recorder.add(caller.sym, &callee.sym, arc_count);
-		}
+	if (writer) {
+		recorder.write_arcs(total_count, threshold / 100.0,
+		                    sym_filter, *writer);
+	} else {
+		recorder.process(total_count, threshold / 100.0, sym_filter);
 	}
 }
 
@@ -574,7 +1037,7 @@ void callgraph_container::add_symbols(profile_container const & pc)
 	symbol_container::symbols_t::iterator const end = pc.end_symbol();
 
 	for (it = pc.begin_symbol(); it != end; ++it)
-		recorder.add(*it, 0, count_array_t());
+		recorder.add(*it, 0, 0, 0);
 }
 
 
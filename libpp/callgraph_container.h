@@ -12,6 +12,7 @@
 #ifndef CALLGRAPH_CONTAINER_H
 #define CALLGRAPH_CONTAINER_H
 
+#include <map>
 #include <set>
 #include <vector>
 #include <string>
@@ -23,9 +24,25 @@
 
 class profile_container;
 class inverted_profile;
-class profile_t;
-class image_set;
-class op_bfd;
+
+
+/**
+ * Receive the arcs of a callgraph one at a time, so they can be written
+ * out without building the cg symbols, see callgraph_container::populate()
+ */
+class arc_writer {
+public:
+	virtual ~arc_writer() {}
+
+	/**
+	 * @param caller  The calling symbol
+	 * @param callee  The called symbol
+	 * @param counts  nr. of samples of the arc for each profile class
+	 */
+	virtual void write(symbol_entry const & caller,
+	                   symbol_entry const & callee,
+	                   count_array_t const & counts) = 0;
+};
 
 
 /**
@@ -37,20 +54,31 @@ class op_bfd;
  */
 class arc_recorder {
 public:
+	arc_recorder() : merged_arcs(0), last_caller(npos) {}
 	~arc_recorder() {}
 
 	/**
 	 * Add a symbol arc.
 	 * @param caller  The calling symbol
 	 * @param callee  The called symbol
-	 * @param arc_count  profile data for the arcs
+	 * @param pclass  profile class nr of the arc
+	 * @param arc_count  nr. of samples of the arc
 	 *
 	 * If the callee is NULL, only the caller is added to the main
 	 * list. This is used to initially populate the recorder with
 	 * the symbols.
 	 */
 	void add(symbol_entry const & caller, symbol_entry const * callee,
-	         count_array_t const & arc_count);
+	         size_t pclass, count_type arc_count);
+
+	/**
+	 * Add all the symbols and arcs of another recorder, as if they
+	 * were given to add(). The result doesn't depend on the merge order
+	 * if the same symbol is the same symbol_entry in all the arcs, as
+	 * it is for all the arcs added while populating a
+	 * callgraph_container.
+	 */
+	void merge(arc_recorder const & other);
 
 	/// return all the cg symbols
 	symbol_collection const & get_symbols() const;
@@ -62,33 +90,92 @@ public:
 	void process(count_array_t total, double threshold,
 	             string_filter const & filter);
 
+	/**
+	 * After population, give the arcs to writer instead of building
+	 * the output. The arcs of the symbols process() would output are
+	 * written, in less_symbol order of their caller then callee, if
+	 * their callee matches the filter.
+	 */
+	void write_arcs(count_array_t total, double threshold,
+	                string_filter const & filter, arc_writer & writer);
+
 private:
+	/// the fields less_symbol compares, identifying a symbol
+	struct symbol_key {
+		explicit symbol_key(symbol_entry const & sym);
+
+		bool operator<(symbol_key const & rhs) const;
+		bool operator==(symbol_key const & rhs) const;
+
+		image_name_id image_name;
+		image_name_id app_name;
+		symbol_name_id name;
+		bfd_vma vma;
+		size_t size;
+	};
+
+	static size_t const npos = size_t(-1);
+
 	/**
-	 * Internal structure used during collation. We use a map to
-	 * allow quick lookup of children (we'll do this several times
-	 * if we have more than one profile class). Each child maps from
-	 * the symbol to the relevant arc data.
+	 * A symbol seen by add(), nodes are indexed by a dense id. Like the
+	 * std::map based container this replaces, the symbol first added is
+	 * the main entry of the output and the symbol first added by an arc
+	 * is used in the callers and callees lists.
 	 */
-	struct cg_data {
-		cg_data() {}
+	struct node {
+		/// index of the main entry in entries
+		size_t main;
+		/// index of the arc entry in entries, npos if none yet
+		size_t arc;
+	};
 
-		typedef std::map<symbol_entry, count_array_t, less_symbol> children;
+	/// one add() of an arc, merged by merge_arcs()
+	struct arc {
+		u32 caller;
+		u32 callee;
+		u32 pclass;
+		count_type count;
 
-		/// callers of this symbol
-		children callers;
-		/// callees of this symbol
-		children callees;
+		bool operator<(arc const & rhs) const;
 	};
 
+	typedef std::vector<arc> arcs_t;
+
+	/// return the node id of this symbol, creating it if needed
+	u32 get_node(symbol_entry const & sym, bool in_arc);
+
+	/// sort the arcs and sum the counts of identical ones
+	void merge_arcs();
+
+	/// the rank of each node in less_symbol order, and the nodes in
+	/// this order
+	void rank_nodes(std::vector<u32> & rank, std::vector<u32> & order) const;
+
+	/// true if the main symbol of this node is output
+	bool is_output(u32 id, count_array_t const & total, double threshold,
+	               string_filter const & filter) const;
+
+	/// free the population data
+	void clear();
+
 	/**
 	 * Sort and threshold callers and callees.
 	 */
 	void process_children(cg_symbol & sym, double threshold);
 
-	typedef std::map<symbol_entry, cg_data, less_symbol> map_t;
+	/// the symbols referred by nodes
+	std::vector<symbol_entry> entries;
+	std::vector<node> nodes;
+	/// the nodes by symbol, in less_symbol order
+	std::map<symbol_key, u32> node_ids;
+
+	arcs_t arcs;
+	/// nr. of arcs after the last merge_arcs()
+	size_t merged_arcs;
 
-	/// all the symbols (used during processing)
-	map_t sym_map;
+	/// the node of the last caller of an arc, the arcs of a caller
+	/// are added in a row
+	size_t last_caller;
 
 	/// symbol objects pointed to by pointers in vector cg_syms
 	cg_collection_objs cg_syms_objs;
@@ -97,7 +184,6 @@ private:
 	symbol_collection cg_syms;
 };
 
-
 /**
  * Store all callgraph information for the given profiles
  */
@@ -111,6 +197,8 @@ public:
 	 * @param threshold  ignore sample percent below this threshold
 	 * @param merge_lib  merge library samples
 	 * @param sym_filter  symbol filter
+	 * @param writer  if non null the arcs are given to it, in a stream,
+	 *  and no symbols are kept
 	 *
 	 * Currently all errors core dump.
 	 * FIXME: consider if this should be a ctor
@@ -118,7 +206,8 @@ public:
 	void populate(std::list<inverted_profile> const & iprofiles,
 		      extra_images const & extra, bool debug_info,
 		      double threshold, bool merge_lib,
-		      string_filter const & sym_filter);
+		      string_filter const & sym_filter,
+		      arc_writer * writer = 0);
 
 	/// return hint on how data must be displayed.
 	column_flags output_hint() const;
@@ -130,31 +219,6 @@ public:
 	symbol_collection const & get_symbols() const;
 
 private:
-	/**
-	 * Record caller/callee for one cg file
-	 * @param profile  one callgraph file stored in a profile_t
-	 * @param caller_bfd  the caller bfd
-	 * @param bfd_caller_ok  true if we succefully open the binary
-	 * @param callee_bfd  the callee bfd
-	 * @param app_name  the owning application
-	 * @param pc  the profile_container holding all non cg samples.
-	 * @param debug_info  record linenr debug information
-	 * @param pclass  profile class nr
-	 */
-	void add(profile_t const & profile, op_bfd const & caller_bfd,
-	         bool bfd_caller_ok, op_bfd const & callee_bfd,
-		 std::string const & app_name, profile_container const & pc,
-		 bool debug_info, size_t pclass);
-
-	void populate(std::list<image_set> const & lset,
-		      std::string const & app_image,
-		      size_t pclass, profile_container const & pc,
-		      bool debug_info, bool merge_lib);
-	void populate(std::list<std::string> const & cg_files,
-		      std::string const & app_image,
-		      size_t pclass, profile_container const & pc,
-		      bool debug_info, bool merge_lib);
-
 	/// record all main symbols
 	void add_symbols(profile_container const & pc);
 
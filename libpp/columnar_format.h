@@ -0,0 +1,101 @@
+/**
+ * @file columnar_format.h
+ * Layout of the binary column oriented report of opreport --format=columnar
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef COLUMNAR_FORMAT_H
+#define COLUMNAR_FORMAT_H
+
+#include "op_types.h"
+
+/**
+ * A columnar report is a header, a directory of nr_columns
+ * column_entry, then the columns. Each column starts at an offset from
+ * the start of the file multiple of 8, so that a consumer can mmap the
+ * file and use the columns as arrays in place. The integers are in the
+ * byte order of the writer, byte_order reads as byte_order_mark in this
+ * order.
+ *
+ * The rows of the symbol columns are the symbols in output order. With
+ * --details, the rows of the sample columns are the samples of each
+ * symbol in address order, the samples of symbol i being the rows
+ * sym_first_sample[i] to sym_first_sample[i + 1] excluded.
+ *
+ * The names are u32 offsets into the strings column, which holds NUL
+ * terminated strings, offset 0 being the empty string. The counts
+ * columns hold one dense array of rows counts per profile class, class
+ * after class: the count of row r in class c is at c * rows + r.
+ */
+namespace columnar {
+
+/// the first 8 bytes of a columnar report
+char const magic[] = "OPCOLUMN";
+
+u32 const version = 1;
+
+u32 const byte_order_mark = 0x01020304;
+
+struct header {
+	char magic[8];
+	u32 version;
+	u32 byte_order;
+	u64 nr_classes;
+	u64 nr_symbols;
+	u64 nr_samples;
+	u64 nr_columns;
+};
+
+struct column_entry {
+	/// a column_id
+	u32 id;
+	/// size of an element in bytes
+	u32 width;
+	/// from the start of the file
+	u64 offset;
+	/// in bytes
+	u64 size;
+};
+
+enum column_id {
+	/// char, the NUL terminated strings
+	strings = 1,
+	/// u32 per class, the class names
+	class_name,
+	/// u32 per class, the class descriptions
+	class_longname,
+	/// u64 per class, the total sample count of each class
+	class_total,
+	/// u32 per symbol, the symbol names, demangled as asked for
+	sym_name,
+	/// u32 per symbol, the full image names
+	sym_image,
+	/// u32 per symbol, the full owning application names
+	sym_app,
+	/// u64 per symbol
+	sym_vma,
+	/// u64 per symbol, in bytes
+	sym_size,
+	/// u32 per symbol, the source file names with --debug-info
+	sym_file,
+	/// u32 per symbol, the source line with --debug-info
+	sym_line,
+	/// u64 per class per symbol
+	sym_counts,
+	/// u64 per symbol plus one, the first sample row of each symbol
+	sym_first_sample,
+	/// u64 per sample
+	sample_vma,
+	/// u32 per sample, the source file names with --debug-info
+	sample_file,
+	/// u32 per sample, the source line with --debug-info
+	sample_line,
+	/// u64 per class per sample
+	sample_counts
+};
+
+} // namespace columnar
+
+#endif /* !COLUMNAR_FORMAT_H */
@@ -0,0 +1,20 @@
+/**
+ * @file count_matrix.cpp
+ * Dense [symbol x class] sample counts
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "count_matrix.h"
+
+count_matrix::count_matrix()
+	: rows(0), classes(0)
+{
+}
+
+
+count_matrix::count_matrix(size_t nr_rows, size_t nr_classes)
+	: rows(nr_rows), classes(nr_classes), counts(rows * classes)
+{
+}
@@ -0,0 +1,59 @@
+/**
+ * @file count_matrix.h
+ * Dense [symbol x class] sample counts
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef COUNT_MATRIX_H
+#define COUNT_MATRIX_H
+
+#include <cstddef>
+#include <vector>
+
+#include "op_types.h"
+
+/**
+ * The sample counts of a set of symbols laid out as one row of
+ * nr_classes() contiguous counts per symbol, rows stored one after the
+ * other. Summing or comparing the classes of a row, or a class over the
+ * rows, are then plain loops over an array.
+ */
+class count_matrix {
+public:
+	/// an empty matrix
+	count_matrix();
+
+	/// nr_rows rows of nr_classes zero counts
+	count_matrix(size_t nr_rows, size_t nr_classes);
+
+	/// nr. of rows, one per symbol
+	size_t nr_rows() const { return rows; }
+
+	/// nr. of counts in each row
+	size_t nr_classes() const { return classes; }
+
+	/// the nr_classes() counts of a row
+	count_type * row(size_t index) {
+		return &counts[index * classes];
+	}
+
+	/// the nr_classes() counts of a row
+	count_type const * row(size_t index) const {
+		return &counts[index * classes];
+	}
+
+	/// the count of a row for pclass, zero past nr_classes()
+	count_type count(size_t index, size_t pclass) const {
+		return pclass < classes ? counts[index * classes + pclass] : 0;
+	}
+
+private:
+	size_t rows;
+	size_t classes;
+	/// rows * classes counts, row major
+	std::vector<count_type> counts;
+};
+
+#endif /* !COUNT_MATRIX_H */
@@ -15,6 +15,7 @@
 #endif
 
 #include <cassert>
+#include <cstring>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
@@ -24,6 +25,7 @@
 #include "string_filter.h"
 
 #include "format_output.h"
+#include "columnar_format.h"
 #include "profile_container.h"
 #include "callgraph_container.h"
 #include "diff_container.h"
@@ -87,6 +89,111 @@ bool extract_linenr_info(string const & info, string & file, size_t & line)
 }
 
 
+/// the strings column of a columnar report, each string is stored once
+class string_table {
+public:
+	string_table() : data(1, '\0') {}
+
+	/// return the offset of str, adding it if needed
+	u32 add(string const & str);
+
+	/// the NUL terminated strings
+	vector<char> data;
+
+private:
+	map<string, u32> offsets;
+};
+
+
+u32 string_table::add(string const & str)
+{
+	if (str.empty())
+		return 0;
+
+	map<string, u32>::const_iterator it = offsets.find(str);
+	if (it != offsets.end())
+		return it->second;
+
+	u32 const offset = data.size();
+	data.insert(data.end(), str.begin(), str.end());
+	data.push_back('\0');
+	offsets[str] = offset;
+	return offset;
+}
+
+
+/// write the columns of a columnar report at the offsets of its directory
+class column_writer {
+public:
+	column_writer(ostream & out_) : out(out_), pos(0) {}
+
+	/// append a column to the directory
+	void add(u32 id, u32 width, u64 nr_elements);
+
+	/// write the header and the directory
+	void write_header(columnar::header & header);
+
+	/// pad up to the next column in the directory order
+	void next_column();
+
+	template <typename T>
+	void write(vector<T> const & v) {
+		if (!v.empty())
+			write(&v[0], v.size() * sizeof(T));
+	}
+
+	void write(void const * data, size_t size) {
+		out.write(static_cast<char const *>(data), size);
+		pos += size;
+	}
+
+private:
+	ostream & out;
+	/// nr. of bytes written
+	u64 pos;
+	vector<columnar::column_entry> columns;
+	/// the next column to write
+	size_t column;
+};
+
+
+void column_writer::add(u32 id, u32 width, u64 nr_elements)
+{
+	columnar::column_entry entry;
+	entry.id = id;
+	entry.width = width;
+	entry.offset = 0;
+	entry.size = width * nr_elements;
+	columns.push_back(entry);
+}
+
+
+void column_writer::write_header(columnar::header & header)
+{
+	header.nr_columns = columns.size();
+
+	u64 offset = sizeof(header) +
+		columns.size() * sizeof(columnar::column_entry);
+	for (size_t i = 0; i < columns.size(); ++i) {
+		offset = (offset + 7) & ~u64(7);
+		columns[i].offset = offset;
+		offset += columns[i].size;
+	}
+
+	write(&header, sizeof(header));
+	write(columns);
+	column = 0;
+}
+
+
+void column_writer::next_column()
+{
+	char const zeros[8] = { 0 };
+	u64 const offset = columns[column++].offset;
+	write(zeros, offset - pos);
+}
+
+
 } // anonymous namespace
 
 namespace format_output {
@@ -303,7 +410,7 @@ string formatter::format_linenr_info(field_datum const & f)
 string formatter::format_nr_samples(field_datum const & f)
 {
 	ostringstream out;
-	out << f.sample.counts[f.pclass];
+	out << f.count();
 	return out.str();
 }
 
@@ -313,8 +420,12 @@ string formatter::format_nr_cumulated_samples(field_datum const & f)
 	if (f.diff == -INFINITY)
 		return "---";
 	ostringstream out;
-	f.counts.cumulated_samples[f.pclass] += f.sample.counts[f.pclass];
-	out << f.counts.cumulated_samples[f.pclass];
+	if (f.cumulated) {
+		out << f.cumulated[f.pclass];
+	} else {
+		f.counts.cumulated_samples[f.pclass] += f.count();
+		out << f.counts.cumulated_samples[f.pclass];
+	}
 	return out.str();
 }
 
@@ -323,7 +434,7 @@ string formatter::format_percent(field_datum const & f)
 {
 	if (f.diff == -INFINITY)
 		return "---";
-	return get_percent(f.sample.counts[f.pclass], f.counts.total[f.pclass]);
+	return get_percent(f.count(), f.counts.total[f.pclass]);
 }
 
  
@@ -331,7 +442,11 @@ string formatter::format_cumulated_percent(field_datum const & f)
 {
 	if (f.diff == -INFINITY)
 		return "---";
-	f.counts.cumulated_percent[f.pclass] += f.sample.counts[f.pclass];
+	if (f.cumulated)
+		return get_percent(f.cumulated[f.pclass],
+		                   f.counts.total[f.pclass]);
+
+	f.counts.cumulated_percent[f.pclass] += f.count();
 
 	return get_percent(f.counts.cumulated_percent[f.pclass],
 	                   f.counts.total[f.pclass]);
@@ -340,14 +455,13 @@ string formatter::format_cumulated_percent(field_datum const & f)
  
 string formatter::format_percent_details(field_datum const & f)
 {
-	return get_percent(f.sample.counts[f.pclass],
-		f.counts.total[f.pclass]);
+	return get_percent(f.count(), f.counts.total[f.pclass]);
 }
 
  
 string formatter::format_cumulated_percent_details(field_datum const & f)
 {
-	f.counts.cumulated_percent_details[f.pclass] += f.sample.counts[f.pclass];
+	f.counts.cumulated_percent_details[f.pclass] += f.count();
 
 	return get_percent(f.counts.cumulated_percent_details[f.pclass],
 	                   f.counts.total[f.pclass]);
@@ -368,7 +482,9 @@ string formatter::format_diff(field_datum const & f)
 
 void formatter::
 do_output(ostream & out, symbol_entry const & symb, sample_entry const & sample,
-          counts_t & c, diff_array_t const & diffs, bool hide_immutable)
+          counts_t & c, diff_array_t const & diffs, bool hide_immutable,
+          count_type const * cumulated, count_type const * row,
+          size_t row_size)
 {
 	size_t padding = 0;
 
@@ -380,7 +496,8 @@ do_output(ostream & out, symbol_entry const & symb, sample_entry const & sample,
 	// repeated fields for each profile class
 	for (size_t pclass = 0 ; pclass < nr_classes; ++pclass) {
 		field_datum datum(symb, sample, pclass, c,
-				  extra_found_images, diffs[pclass]);
+				  extra_found_images, diffs[pclass],
+				  cumulated, row, row_size);
 
 		if (flags & ff_nr_samples)
 			padding = output_field(out, datum,
@@ -435,25 +552,27 @@ do_output(ostream & out, symbol_entry const & symb, sample_entry const & sample,
 opreport_formatter::opreport_formatter(profile_container const & p)
 	:
 	formatter(p.extra_found_images),
-	profile(p),
+	profile(&p),
 	need_details(false)
 {
-	counts.total = profile.samples_count();
+	counts.total = profile->samples_count();
 }
 
- 
-void opreport_formatter::show_details(bool on_off)
+
+opreport_formatter::opreport_formatter(count_array_t const & total,
+                                       extra_images const & extra)
+	:
+	formatter(extra),
+	profile(0),
+	need_details(false)
 {
-	need_details = on_off;
+	counts.total = total;
 }
 
-
-void opreport_formatter::output(ostream & out, symbol_entry const * symb)
+ 
+void opreport_formatter::show_details(bool on_off)
 {
-	do_output(out, *symb, symb->sample, counts);
-
-	if (need_details)
-		output_details(out, symb);
+	need_details = on_off && profile;
 }
 
 
@@ -462,10 +581,32 @@ output(ostream & out, symbol_collection const & syms)
 {
 	output_header(out);
 
+	// the counts of a symbol are a row of the profile count matrix, the
+	// cumulated columns are running sums of the rows in output order
+	count_matrix const * matrix = profile ? &profile->sample_counts() : 0;
+	size_t const width = matrix ? min(nr_classes, matrix->nr_classes()) : 0;
+	vector<count_type> cumulated(nr_classes);
+
 	symbol_collection::const_iterator it = syms.begin();
 	symbol_collection::const_iterator end = syms.end();
-	for (; it != end; ++it)
-		output(out, *it);
+	for (; it != end; ++it) {
+		symbol_entry const * symb = *it;
+		count_type const * row = 0;
+		if (matrix) {
+			row = matrix->row(symb->row);
+			for (size_t pclass = 0; pclass < width; ++pclass)
+				cumulated[pclass] += row[pclass];
+		} else {
+			for (size_t pclass = 0; pclass < nr_classes; ++pclass)
+				cumulated[pclass] += symb->sample.counts[pclass];
+		}
+
+		do_output(out, *symb, symb->sample, counts, diff_array_t(),
+		          false, &cumulated[0], row, width);
+
+		if (need_details)
+			output_details(out, symb);
+	}
 }
 
 
@@ -481,8 +622,8 @@ output_details(ostream & out, symbol_entry const * symb)
 	c.cumulated_samples = count_array_t();
 	c.cumulated_percent = count_array_t();
 
-	sample_container::samples_iterator it = profile.begin(symb);
-	sample_container::samples_iterator end = profile.end(symb);
+	sample_container::samples_iterator it = profile->begin(symb);
+	sample_container::samples_iterator end = profile->end(symb);
 	for (; it != end; ++it) {
 		out << "  ";
 		do_output(out, *symb, it->second, c, diff_array_t(), true);
@@ -569,9 +710,202 @@ void diff_formatter::output(ostream & out, diff_collection const & syms)
 		do_output(out, *it, it->sample, counts, it->diffs);
 }
 
+
+columnar_formatter::columnar_formatter(profile_container const & p)
+	:
+	formatter(p.extra_found_images),
+	profile(&p),
+	need_details(false)
+{
+	counts.total = profile->samples_count();
+}
+
+
+columnar_formatter::columnar_formatter(count_array_t const & total,
+                                       extra_images const & extra)
+	:
+	formatter(extra),
+	profile(0),
+	need_details(false)
+{
+	counts.total = total;
+}
+
+
+void columnar_formatter::show_details(bool on_off)
+{
+	need_details = on_off && profile;
+}
+
+
+void columnar_formatter::
+output(ostream & out, symbol_collection const & syms)
+{
+	using namespace columnar;
+
+	size_t const nr_syms = syms.size();
+	string_table strings;
+
+	// the strings first, the string columns are built on the way
+	vector<u32> class_names(nr_classes);
+	vector<u32> class_longnames(nr_classes);
+	for (size_t p = 0; p < nr_classes; ++p) {
+		class_names[p] = strings.add(classes.v[p].name);
+		class_longnames[p] = strings.add(classes.v[p].longname);
+	}
+
+	vector<u32> names(nr_syms);
+	vector<u32> images(nr_syms);
+	vector<u32> apps(nr_syms);
+	vector<u32> files(nr_syms);
+	vector<u64> first_sample(nr_syms + 1);
+	vector<u32> sample_files;
+	for (size_t i = 0; i < nr_syms; ++i) {
+		symbol_entry const * symb = syms[i];
+		names[i] = strings.add(symbol_names.demangle(symb->name));
+		images[i] = strings.add(get_image_name(symb->image_name,
+			image_name_storage::int_real_filename,
+			extra_found_images));
+		apps[i] = strings.add(get_image_name(symb->app_name,
+			image_name_storage::int_real_filename,
+			extra_found_images));
+		files[i] = strings.add(
+			debug_names.name(symb->sample.file_loc.filename));
+
+		first_sample[i] = sample_files.size();
+		if (!need_details)
+			continue;
+		sample_container::samples_iterator it = profile->begin(symb);
+		sample_container::samples_iterator end = profile->end(symb);
+		for (; it != end; ++it) {
+			sample_files.push_back(strings.add(
+				debug_names.name(it->second.file_loc.filename)));
+		}
+	}
+	size_t const nr_samples = sample_files.size();
+	first_sample[nr_syms] = nr_samples;
+
+	column_writer writer(out);
+	writer.add(columnar::strings, 1, strings.data.size());
+	writer.add(class_name, sizeof(u32), nr_classes);
+	writer.add(class_longname, sizeof(u32), nr_classes);
+	writer.add(class_total, sizeof(u64), nr_classes);
+	writer.add(sym_name, sizeof(u32), nr_syms);
+	writer.add(sym_image, sizeof(u32), nr_syms);
+	writer.add(sym_app, sizeof(u32), nr_syms);
+	writer.add(sym_vma, sizeof(u64), nr_syms);
+	writer.add(sym_size, sizeof(u64), nr_syms);
+	writer.add(sym_file, sizeof(u32), nr_syms);
+	writer.add(sym_line, sizeof(u32), nr_syms);
+	writer.add(sym_counts, sizeof(u64), nr_classes * nr_syms);
+	writer.add(sym_first_sample, sizeof(u64), nr_syms + 1);
+	writer.add(sample_vma, sizeof(u64), nr_samples);
+	writer.add(sample_file, sizeof(u32), nr_samples);
+	writer.add(sample_line, sizeof(u32), nr_samples);
+	writer.add(sample_counts, sizeof(u64), nr_classes * nr_samples);
+
+	columnar::header header;
+	memcpy(header.magic, magic, sizeof(header.magic));
+	header.version = version;
+	header.byte_order = byte_order_mark;
+	header.nr_classes = nr_classes;
+	header.nr_symbols = nr_syms;
+	header.nr_samples = nr_samples;
+	writer.write_header(header);
+
+	writer.next_column();
+	writer.write(strings.data);
+
+	vector<u64> totals(nr_classes);
+	for (size_t p = 0; p < nr_classes; ++p)
+		totals[p] = counts.total[p];
+	writer.next_column();
+	writer.write(class_names);
+	writer.next_column();
+	writer.write(class_longnames);
+	writer.next_column();
+	writer.write(totals);
+
+	writer.next_column();
+	writer.write(names);
+	writer.next_column();
+	writer.write(images);
+	writer.next_column();
+	writer.write(apps);
+
+	// the other columns are built one at a time
+	vector<u64> values(nr_syms);
+	for (size_t i = 0; i < nr_syms; ++i)
+		values[i] = syms[i]->sample.vma;
+	writer.next_column();
+	writer.write(values);
+
+	for (size_t i = 0; i < nr_syms; ++i)
+		values[i] = syms[i]->size;
+	writer.next_column();
+	writer.write(values);
+
+	writer.next_column();
+	writer.write(files);
+
+	vector<u32> lines(nr_syms);
+	for (size_t i = 0; i < nr_syms; ++i)
+		lines[i] = syms[i]->sample.file_loc.linenr;
+	writer.next_column();
+	writer.write(lines);
+
+	count_matrix const * matrix = profile ? &profile->sample_counts() : 0;
+	writer.next_column();
+	for (size_t p = 0; p < nr_classes; ++p) {
+		for (size_t i = 0; i < nr_syms; ++i) {
+			values[i] = matrix ? matrix->count(syms[i]->row, p)
+				: syms[i]->sample.counts[p];
+		}
+		writer.write(values);
+	}
+
+	writer.next_column();
+	writer.write(first_sample);
+
+	// the samples of each symbol, in the order of the first pass
+	values.resize(nr_samples);
+	lines.resize(nr_samples);
+	size_t row = 0;
+	for (size_t i = 0; i < nr_syms && nr_samples; ++i) {
+		sample_container::samples_iterator it = profile->begin(syms[i]);
+		sample_container::samples_iterator end = profile->end(syms[i]);
+		for (; it != end; ++it, ++row) {
+			values[row] = it->second.vma;
+			lines[row] = it->second.file_loc.linenr;
+		}
+	}
+	writer.next_column();
+	writer.write(values);
+	writer.next_column();
+	writer.write(sample_files);
+	writer.next_column();
+	writer.write(lines);
+
+	writer.next_column();
+	for (size_t p = 0; p < nr_classes; ++p) {
+		row = 0;
+		for (size_t i = 0; i < nr_syms && nr_samples; ++i) {
+			sample_container::samples_iterator it =
+				profile->begin(syms[i]);
+			sample_container::samples_iterator end =
+				profile->end(syms[i]);
+			for (; it != end; ++it)
+				values[row++] = it->second.counts[p];
+		}
+		writer.write(values);
+	}
+
+	out.flush();
+}
+
 // local variables used in generation of XML
 // buffer details for output later
-ostringstream bytes_out;
+string bytes_out;
 
 // module+symbol table for detecting duplicate symbols
 map<string, size_t> symbol_data_table;
@@ -629,34 +963,36 @@ show_details(bool on_off)
 }
 
 
-void xml_formatter::output(ostream & out)
+void xml_formatter::output(ostream & os)
 {
+	xml_writer out(os);
+
 	xml_support->build_subclasses(out);
 
 	xml_support->output_program_structure(out);
 	output_symbol_data(out);
 	if (need_details) {
-		out << open_element(DETAIL_TABLE);
+		out.open_element(DETAIL_TABLE);
 		for (size_t i = 0; i < symbol_details.size(); ++i) {
 			int id = symbol_details[i].id;
 
 			if (id >= 0) {
-				out << open_element(SYMBOL_DETAILS, true);
-				out << init_attr(TABLE_ID, (size_t)id);
-				out << close_element(NONE, true);
+				out.open_element(SYMBOL_DETAILS, true);
+				out.attr(TABLE_ID, (size_t)id);
+				out.close_element(NONE, true);
 				out << symbol_details[i].details;
-				out << close_element(SYMBOL_DETAILS);
+				out.close_element(SYMBOL_DETAILS);
 			}
 		}
-		out << close_element(DETAIL_TABLE);
+		out.close_element(DETAIL_TABLE);
 
 		// output bytesTable
-		out << open_element(BYTES_TABLE);
-		out << bytes_out.str();
-		out << close_element(BYTES_TABLE);
+		out.open_element(BYTES_TABLE);
+		out << bytes_out;
+		out.close_element(BYTES_TABLE);
 	}
 
-	out << close_element(PROFILE);
+	out.close_element(PROFILE);
 }
 
 bool
@@ -698,7 +1034,7 @@ xml_formatter::get_bfd_object(symbol_entry const * symb, op_bfd * & abfd) const
 }
 
 void xml_formatter::
-output_the_symbol_data(ostream & out, symbol_entry const * symb, op_bfd * & abfd)
+output_the_symbol_data(xml_writer & out, symbol_entry const * symb, op_bfd * & abfd)
 {
 	string const name = symbol_names.name(symb->name);
 	assert(name.size() > 0);
@@ -710,8 +1046,8 @@ output_the_symbol_data(ostream & out, symbol_entry const * symb, op_bfd * & abfd
 
 	if (sd_it != symbol_data_table.end()) {
 		// first time we've seen this symbol
-		out << open_element(SYMBOL_DATA, true);
-		out << init_attr(TABLE_ID, sd_it->second);
+		out.open_element(SYMBOL_DATA, true);
+		out.attr(TABLE_ID, sd_it->second);
 
 		field_datum datum(*symb, symb->sample, 0, counts,
 				  extra_found_images);
@@ -728,19 +1064,21 @@ output_the_symbol_data(ostream & out, symbol_entry const * symb, op_bfd * & abfd
 
 			if (need_details) {
 				get_bfd_object(symb, abfd);
-				if (abfd && abfd->symbol_has_contents(symb->sym_index))
-					xml_support->output_symbol_bytes(bytes_out, symb, sd_it->second, *abfd);
+				if (abfd && abfd->symbol_has_contents(symb->sym_index)) {
+					xml_writer bytes(bytes_out);
+					xml_support->output_symbol_bytes(bytes, symb, sd_it->second, *abfd);
+				}
 			}
 		}
-		out << close_element();
+		out.close_element();
 
 		// seen so remove (otherwise get several "no symbols")
 		symbol_data_table.erase(qname);
 	}
 }
 
-void xml_formatter::output_cg_children(ostream & out, 
-	cg_symbol::children const cg_symb, op_bfd * & abfd)
+void xml_formatter::output_cg_children(xml_writer & out,
+	cg_symbol::children const & cg_symb, op_bfd * & abfd)
 {
 	cg_symbol::children::const_iterator cit;
 	cg_symbol::children::const_iterator cend = cg_symb.end();
@@ -759,13 +1097,13 @@ void xml_formatter::output_cg_children(ostream & out,
 	}
 }
 
-void xml_formatter::output_symbol_data(ostream & out)
+void xml_formatter::output_symbol_data(xml_writer & out)
 {
 	op_bfd * abfd = NULL;
 	sym_iterator it = symbols.begin();
 	sym_iterator end = symbols.end();
 
-	out << open_element(SYMBOL_TABLE);
+	out.open_element(SYMBOL_TABLE);
 	for ( ; it != end; ++it) {
 		symbol_entry const * symb = *it;
 		cg_symbol const * cg_symb = dynamic_cast<cg_symbol const *>(symb);
@@ -776,22 +1114,21 @@ void xml_formatter::output_symbol_data(ostream & out)
 			output_cg_children(out, cg_symb->callees, abfd);
 		}
 	}
-	out << close_element(SYMBOL_TABLE);
+	out.close_element(SYMBOL_TABLE);
 
 	delete abfd;
 }
 
-string  xml_formatter::
-output_symbol_details(symbol_entry const * symb,
+void xml_formatter::
+output_symbol_details(xml_writer & out, symbol_entry const * symb,
     size_t & detail_index, size_t const lo, size_t const hi)
 {
 	if (!has_sample_counts(symb->sample.counts, lo, hi))
-		return "";
+		return;
 
 	sample_container::samples_iterator it = profile->begin(symb);
 	sample_container::samples_iterator end = profile->end(symb);
 
-	ostringstream str;
 	for (; it != end; ++it) {
 		counts_t c;
 
@@ -800,13 +1137,13 @@ output_symbol_details(symbol_entry const * symb,
 
 			if (count == 0) continue;
 
-			str << open_element(DETAIL_DATA, true);
-			str << init_attr(TABLE_ID, detail_index++);
+			out.open_element(DETAIL_DATA, true);
+			out.attr(TABLE_ID, detail_index++);
 
 			// first output the vma field
 			field_datum datum(*symb, it->second, 0, c, 
 					  extra_found_images, 0.0);
-			output_attribute(str, datum, ff_vma, VMA);
+			output_attribute(out, datum, ff_vma, VMA);
 			if (ff_linenr_info) {
 				string sym_file;
 				size_t sym_line;
@@ -821,46 +1158,37 @@ output_symbol_details(symbol_entry const * symb,
 						// source file.  this can happen with inlined functions in
 						// #included header files
 						if (sym_file != samp_file)
-							str << init_attr(SOURCE_FILE, samp_file);
+							out.attr(SOURCE_FILE, samp_file);
 					}
-					str << init_attr(SOURCE_LINE, samp_line);
+					out.attr(SOURCE_LINE, samp_line);
 				}
 			}
-			str << close_element(NONE, true);
+			out.close_element(NONE, true);
 
 			// output buffered sample data
-			output_sample_data(str, it->second, p);
+			output_sample_data(out, it->second, p);
 
-			str << close_element(DETAIL_DATA);
+			out.close_element(DETAIL_DATA);
 		}
 	}
-	return str.str();
 }
 
 void xml_formatter::
-output_symbol(ostream & out,
+output_symbol(xml_writer & out,
 	symbol_entry const * symb, size_t lo, size_t hi, bool is_module)
 {
-	ostringstream str;
 	// pointless reference to is_module, remove insane compiler warning
 	size_t indx = is_module ? 0 : 1;
 
-	// output symbol's summary data for each profile class
-	bool got_samples = false;
-
-	for (size_t p = lo; p <= hi; ++p) {
-		got_samples |= xml_support->output_summary_data(str,
-		    symb->sample.counts, p);
-	}
-
-	if (!got_samples)
+	// skip the symbols without samples in these profile classes
+	if (!has_sample_counts(symb->sample.counts, lo, hi))
 		return;
 
 	if (cverb << vxml)
 		out << "<!-- symbol_ref=" << symbol_names.name(symb->name) <<
-			" -->" << endl;
+			" -->\n";
 
-	out << open_element(SYMBOL, true);
+	out.open_element(SYMBOL, true);
 
 	string const name = symbol_names.name(symb->name);
 	assert(name.size() > 0);
@@ -871,47 +1199,43 @@ output_symbol(ostream & out,
 
 	indx = xml_get_symbol_index(qname);
 
-	out << init_attr(ID_REF, indx);
+	out.attr(ID_REF, indx);
 
 	if (need_details) {
-		ostringstream details;
 		symbol_details_t & sd = symbol_details[indx];
 		size_t const detail_lo = sd.index;
 
-		string detail_str = output_symbol_details(symb, sd.index, lo, hi);
+		xml_writer details(sd.details);
+		output_symbol_details(details, symb, sd.index, lo, hi);
 
-		if (detail_str.size() > 0) {
+		if (sd.index > detail_lo) {
 			if (sd.id < 0)
 				sd.id = indx;
-			details << detail_str;
-		}
-
-		if (sd.index > detail_lo) {
-			sd.details = sd.details + details.str();
-			out << init_attr(DETAIL_LO, detail_lo);
-			out << init_attr(DETAIL_HI, sd.index-1);
+			out.attr(DETAIL_LO, detail_lo);
+			out.attr(DETAIL_HI, sd.index-1);
 		}
 	}
-	out << close_element(NONE, true);
+	out.close_element(NONE, true);
 	// output summary
-	out << str.str();
-	out << close_element(SYMBOL);
+	for (size_t p = lo; p <= hi; ++p)
+		xml_support->output_summary_data(out, symb->sample.counts, p);
+	out.close_element(SYMBOL);
 }
 
 
 void xml_formatter::
-output_sample_data(ostream & out, sample_entry const & sample, size_t pclass)
+output_sample_data(xml_writer & out, sample_entry const & sample, size_t pclass)
 {
-	out << open_element(COUNT, true);
-	out << init_attr(CLASS, classes.v[pclass].name);
-	out << close_element(NONE, true);
+	out.open_element(COUNT, true);
+	out.attr(CLASS, classes.v[pclass].name);
+	out.close_element(NONE, true);
 	out << sample.counts[pclass];
-	out << close_element(COUNT);
+	out.close_element(COUNT);
 }
 
 
 void xml_formatter::
-output_attribute(ostream & out, field_datum const & datum,
+output_attribute(xml_writer & out, field_datum const & datum,
                  format_flags fl, tag_t tag)
 {
 	field_description const & field(format_map[fl]);
@@ -925,12 +1249,14 @@ output_attribute(ostream & out, field_datum const & datum,
 
 			if (extract_linenr_info(str, file, line)) {
 				if (tag == SOURCE_LINE)
-					out << init_attr(tag, line);
+					out.attr(tag, line);
 				else
-					out << init_attr(tag, file);
+					out.attr(tag, file);
 			}
-		} else
-			out << " " << init_attr(tag, str);
+		} else {
+			out << " ";
+			out.attr(tag, str);
+		}
 	}
 }
 
@@ -945,8 +1271,8 @@ xml_cg_formatter(callgraph_container const & cg, symbol_collection & s,
 }
 
 void xml_cg_formatter::
-output_symbol_core(ostream & out, cg_symbol::children const cg_symb,
-       string const selfname, string const qname,
+output_symbol_core(xml_writer & out, cg_symbol::children const & cg_symb,
+       string const & selfname, string const & qname,
        size_t lo, size_t hi, bool is_module, tag_t tag)
 {
 	cg_symbol::children::const_iterator cit;
@@ -956,25 +1282,21 @@ output_symbol_core(ostream & out, cg_symbol::children const cg_symb,
 		string const & module = get_image_name((cit)->image_name,
 			image_name_storage::int_filename, extra_found_images);
 		bool self = false;
-		ostringstream str;
 		size_t indx;
 
-		// output symbol's summary data for each profile class
-		for (size_t p = lo; p <= hi; ++p)
-			xml_support->output_summary_data(str, cit->sample.counts, p);
-
 		if (cverb << vxml)
 			out << "<!-- symbol_ref=" << symbol_names.name(cit->name) <<
-				" -->" << endl;
+				" -->\n";
 
 		if (is_module) {
-			out << open_element(MODULE, true);
-			out << init_attr(NAME, module) << close_element(NONE, true);
+			out.open_element(MODULE, true);
+			out.attr(NAME, module);
+			out.close_element(NONE, true);
 		}
 
-		out << open_element(SYMBOL, true);
+		out.open_element(SYMBOL, true);
 
-		string const symname = symbol_names.name(cit->name);
+		string const & symname = symbol_names.name(cit->name);
 		assert(symname.size() > 0);
 
 		string const symqname = module + ":" + symname;
@@ -987,38 +1309,37 @@ output_symbol_core(ostream & out, cg_symbol::children const cg_symb,
 			indx = xml_get_symbol_index(symqname);
 		}
 
-		out << init_attr(ID_REF, indx);
+		out.attr(ID_REF, indx);
 
 		if (self)
-			out << init_attr(SELFREF, "true");
+			out.attr(SELFREF, "true");
 
-		out << close_element(NONE, true);
-		out << str.str();
-		out << close_element(SYMBOL);
+		out.close_element(NONE, true);
+
+		// output symbol's summary data for each profile class
+		for (size_t p = lo; p <= hi; ++p)
+			xml_support->output_summary_data(out, cit->sample.counts, p);
+
+		out.close_element(SYMBOL);
 
 		if (is_module)
-			out << close_element(MODULE);
+			out.close_element(MODULE);
 	}
 }
 
 
 void xml_cg_formatter::
-output_symbol(ostream & out,
+output_symbol(xml_writer & out,
 	symbol_entry const * symb, size_t lo, size_t hi, bool is_module)
 {
 	cg_symbol const * cg_symb = dynamic_cast<cg_symbol const *>(symb);
-	ostringstream str;
 	size_t indx;
 
-	// output symbol's summary data for each profile class
-	for (size_t p = lo; p <= hi; ++p)
-		xml_support->output_summary_data(str, symb->sample.counts, p);
-
 	if (cverb << vxml)
 		out << "<!-- symbol_ref=" << symbol_names.name(symb->name) <<
-			" -->" << endl;
+			" -->\n";
 
-	out << open_element(SYMBOL, true);
+	out.open_element(SYMBOL, true);
 
 	string const name = symbol_names.name(symb->name);
 	assert(name.size() > 0);
@@ -1031,24 +1352,25 @@ output_symbol(ostream & out,
 
 	indx = xml_get_symbol_index(qname);
 
-	out << init_attr(ID_REF, indx);
+	out.attr(ID_REF, indx);
 
-	out << close_element(NONE, true);
+	out.close_element(NONE, true);
 
-	out << open_element(CALLERS);
+	out.open_element(CALLERS);
 	if (cg_symb)
 		output_symbol_core(out, cg_symb->callers, selfname, qname, lo, hi, is_module, CALLERS);
-	out << close_element(CALLERS);
+	out.close_element(CALLERS);
 
-	out << open_element(CALLEES);
+	out.open_element(CALLEES);
 	if (cg_symb)
 		output_symbol_core(out, cg_symb->callees, selfname, qname, lo, hi, is_module, CALLEES);
 
-	out << close_element(CALLEES);
+	out.close_element(CALLEES);
 
-	// output summary
-	out << str.str();
-	out << close_element(SYMBOL);
+	// output summary data for each profile class
+	for (size_t p = lo; p <= hi; ++p)
+		xml_support->output_summary_data(out, symb->sample.counts, p);
+	out.close_element(SYMBOL);
 }
 
 } // namespace format_output
@@ -85,15 +85,33 @@ protected:
 		field_datum(symbol_entry const & sym,
 		            sample_entry const & s,
 			    size_t pc, counts_t & c,
-			    extra_images const & extra, double d = 0.0)
+			    extra_images const & extra, double d = 0.0,
+			    count_type const * cum = 0,
+			    count_type const * r = 0, size_t rsize = 0)
 			: symbol(sym), sample(s), pclass(pc),
-			  counts(c), extra(extra), diff(d) {}
+			  counts(c), extra(extra), diff(d), cumulated(cum),
+			  row(r), row_size(rsize) {}
+
+		/// sample count of the field class
+		count_type count() const {
+			if (!row)
+				return sample.counts[pclass];
+			return pclass < row_size ? row[pclass] : 0;
+		}
+
 		symbol_entry const & symbol;
 		sample_entry const & sample;
 		size_t pclass;
 		counts_t & counts;
 		extra_images const & extra;
 		double diff;
+		/// cumulated counts of each class up to this sample, null if
+		/// they must be accumulated in counts
+		count_type const * cumulated;
+		/// the row_size first class counts of the sample, as laid
+		/// out in a count_matrix, null to use sample.counts
+		count_type const * row;
+		size_t row_size;
 	};
  
 	/// format callback type
@@ -136,7 +154,9 @@ protected:
 	void do_output(std::ostream & out, symbol_entry const & symbol,
 		      sample_entry const & sample, counts_t & c,
 	              diff_array_t const & = diff_array_t(),
-	              bool hide_immutable_field = false);
+	              bool hide_immutable_field = false,
+	              count_type const * cumulated = 0,
+	              count_type const * row = 0, size_t row_size = 0);
  
 	/// returns the nr of char needed to pad this field
 	size_t output_header_field(std::ostream & out, format_flags fl,
@@ -180,6 +200,13 @@ public:
 	/// build a ready to use formatter
 	opreport_formatter(profile_container const & profile);
 
+	/**
+	 * build a formatter of symbols not owned by a profile_container,
+	 * percentages are relative to total. Details can't be shown.
+	 */
+	opreport_formatter(count_array_t const & total,
+	                   extra_images const & extra);
+
 	/** output a vector of symbols to out according to the output format
 	 * specifier previously set by call(s) to add_format() */
 	void output(std::ostream & out, symbol_collection const & syms);
@@ -188,16 +215,12 @@ public:
 	void show_details(bool);
 
 private:
- 
-	/** output one symbol symb to out according to the output format
-	 * specifier previously set by call(s) to add_format() */
-	void output(std::ostream & out, symbol_entry const * symb);
 
 	/// output details for the symbol
 	void output_details(std::ostream & out, symbol_entry const * symb);
  
-	/// container we work from
-	profile_container const & profile;
+	/// container we work from, null if we have only symbols
+	profile_container const * profile;
  
 	/// true if we need to show details for each symbols
 	bool need_details;
@@ -235,6 +258,38 @@ private:
 };
 
 
+/**
+ * class to output symbols and, with details, their samples as a binary
+ * column oriented report, laid out as columnar_format.h describes. All
+ * the columns are written whatever the format flags.
+ */
+class columnar_formatter : public formatter {
+public:
+	/// build a ready to use formatter
+	columnar_formatter(profile_container const & profile);
+
+	/**
+	 * build a formatter of symbols not owned by a profile_container,
+	 * total are the class totals. Details can't be shown.
+	 */
+	columnar_formatter(count_array_t const & total,
+	                   extra_images const & extra);
+
+	/// output the vector of symbols syms to out
+	void output(std::ostream & out, symbol_collection const & syms);
+
+	/// set the output_details boolean
+	void show_details(bool);
+
+private:
+	/// container we work from, null if we have only symbols
+	profile_container const * profile;
+
+	/// true if we need to output the samples of each symbols
+	bool need_details;
+};
+
+
 /// class to output in XML format
 class xml_formatter : public formatter {
 public:
@@ -248,19 +303,19 @@ public:
 
 	/** output one symbol symb to out according to the output format
 	 * specifier previously set by call(s) to add_format() */
-	virtual void output_symbol(std::ostream & out,
+	virtual void output_symbol(xml_writer & out,
 		symbol_entry const * symb, size_t lo, size_t hi,
 		bool is_module);
 
 	/// output details for the symbol
-	std::string output_symbol_details(symbol_entry const * symb,
+	void output_symbol_details(xml_writer & out, symbol_entry const * symb,
 		size_t & detail_index, size_t const lo, size_t const hi);
 
 	/// set the output_details boolean
 	void show_details(bool);
 
 	// output SymbolData XML elements
-	void output_symbol_data(std::ostream & out);
+	void output_symbol_data(xml_writer & out);
 
 private:
 	/// container we work from
@@ -279,22 +334,22 @@ private:
 	/// get it's contents, hence we store the filter used by the bfd ctor.
 	string_filter const & symbol_filter;
 
-	void output_sample_data(std::ostream & out,
+	void output_sample_data(xml_writer & out,
 		sample_entry const & sample, size_t count);
 
 	/// output attribute in XML
-	void output_attribute(std::ostream & out, field_datum const & datum,
+	void output_attribute(xml_writer & out, field_datum const & datum,
 			      format_flags fl, tag_t tag);
 
 	/// Retrieve a bfd object for this symbol, reopening a new bfd object
 	/// only if necessary
 	bool get_bfd_object(symbol_entry const * symb, op_bfd * & abfd) const;
 
-	void output_the_symbol_data(std::ostream & out,
+	void output_the_symbol_data(xml_writer & out,
 		symbol_entry const * symb, op_bfd * & abfd);
 
-	void output_cg_children(std::ostream & out,
-		cg_symbol::children const cg_symb, op_bfd * & abfd);
+	void output_cg_children(xml_writer & out,
+		cg_symbol::children const & cg_symb, op_bfd * & abfd);
 };
 
 // callgraph XML output version
@@ -306,16 +361,16 @@ public:
 
 	/** output one symbol symb to out according to the output format
 	 * specifier previously set by call(s) to add_format() */
-	virtual void output_symbol(std::ostream & out,
+	virtual void output_symbol(xml_writer & out,
 		symbol_entry const * symb, size_t lo, size_t hi, bool is_module);
 
 private:
 	/// container we work from
 	callgraph_container const & callgraph;
 
-	void output_symbol_core(std::ostream & out,
-		cg_symbol::children const cg_symb,
-		std::string const selfname, std::string const qname,
+	void output_symbol_core(xml_writer & out,
+		cg_symbol::children const & cg_symb,
+		std::string const & selfname, std::string const & qname,
 		size_t lo, size_t hi, bool is_module, tag_t tag);
 };
 
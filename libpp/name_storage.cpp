@@ -80,23 +80,37 @@ string const & debug_name_storage::basename(debug_name_id id) const
 }
 
 
+namespace {
+
+string const demangle_name(string const & name)
+{
+	if (name[0] != '?')
+		return demangle_symbol(name);
+
+	if (name.length() < 2 || name[1] != '?')
+		return "(no symbols)";
+
+	return "anonymous symbol from section " + ltrim(name, "?");
+}
+
+}
+
+
 string const & symbol_name_storage::demangle(symbol_name_id id) const
 {
 	stored_name const & n = get(id);
-	if (!n.name_processed.empty() || n.name.empty())
-		return n.name_processed;
-
-	if (n.name[0] != '?') {
-		n.name_processed = demangle_symbol(n.name);
-		return n.name_processed;
+	{
+		op_mutex_lock lock(demangle_mutex);
+		if (!n.name_processed.empty() || n.name.empty())
+			return n.name_processed;
 	}
 
-	if (n.name.length() < 2 || n.name[1] != '?') {
-		n.name_processed = "(no symbols)";
-		return n.name_processed;
-	}
-	
-	n.name_processed = "anonymous symbol from section ";
-	n.name_processed += ltrim(n.name, "?");
+	// demangling is costly, don't serialize it. Threads racing on the
+	// same id compute the same name and the first one is kept.
+	string const processed = demangle_name(n.name);
+
+	op_mutex_lock lock(demangle_mutex);
+	if (n.name_processed.empty())
+		n.name_processed = processed;
 	return n.name_processed;
 }
@@ -15,6 +15,7 @@
 #include <string>
 
 #include "unique_storage.h"
+#include "parallel.h"
 
 class extra_images;
 
@@ -126,8 +127,16 @@ typedef name_storage<symbol_name_tag>::id_value symbol_name_id;
 
 /// class storing a set of shared symbol name
 struct symbol_name_storage : name_storage<symbol_name_tag> {
-	/// return the demangled name for the given ID
+	/**
+	 * return the demangled name for the given ID, it is computed once
+	 * and cached. This can be called concurrently from several
+	 * threads, but not concurrently with create().
+	 */
 	std::string const & demangle(symbol_name_id id) const;
+
+private:
+	/// protect the cached demangled names
+	mutable op_mutex demangle_mutex;
 };
 
 
@@ -12,6 +12,7 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <cstring>
 #include <sys/stat.h>
 
 #include "parse_filename.h"
@@ -23,54 +24,116 @@ using namespace std;
 
 namespace {
 
-// PP:3.19 event_name.count.unitmask.tgid.tid.cpu
-parsed_filename parse_event_spec(string const & event_spec)
+/// a [first, second) range of characters of the filename being parsed
+typedef pair<string::size_type, string::size_type> token;
+typedef vector<token> tokens;
+
+
+/**
+ * Split str[begin, end) at each sep in one pass, without building the
+ * strings. As with separate_token(), a sep preceded by a backslash does
+ * not split and a trailing empty token is dropped.
+ */
+void split(string const & str, string::size_type begin, string::size_type end,
+           char sep, tokens & result)
 {
-	typedef vector<string> parts_type;
-	typedef parts_type::size_type size_type;
+	result.clear();
+
+	string::size_type start = begin;
+	for (string::size_type pos = begin; pos != end; ++pos) {
+		if (str[pos] == '\\' && pos + 1 < end && str[pos + 1] == sep) {
+			++pos;
+		} else if (str[pos] == sep) {
+			result.push_back(token(start, pos));
+			start = pos + 1;
+		}
+	}
 
-	size_type const nr_parts = 6;
+	if (start != end)
+		result.push_back(token(start, end));
+}
 
-	parts_type parts = separate_token(event_spec, '.');
 
-	if (parts.size() != nr_parts) {
-		throw invalid_argument("parse_event_spec(): bad event specification: " + event_spec);
-	}
+/// the string of a split() token, with its escaped separators restored
+string get(string const & str, token const & tok, char sep)
+{
+	string result(str, tok.first, tok.second - tok.first);
 
-	for (size_type i = 0; i < nr_parts ; ++i) {
-		if (parts[i].empty()) {
-			throw invalid_argument("parse_event_spec(): bad event specification: " + event_spec);
-		}
+	string::size_type pos = 0;
+	while ((pos = result.find('\\', pos)) != string::npos) {
+		if (pos + 1 < result.size() && result[pos + 1] == sep)
+			result.erase(pos, 1);
+		++pos;
 	}
 
-	parsed_filename result;
+	return result;
+}
 
-	size_type i = 0;
-	result.event = parts[i++];
-	result.count = parts[i++];
-	result.unitmask = parts[i++];
-	result.tgid = parts[i++];
-	result.tid = parts[i++];
-	result.cpu = parts[i++];
 
-	return result;
+/// append the string of a path component to result, prefixed by a '/'
+void append_component(string & result, string const & str, token const & tok)
+{
+	string::size_type const len = tok.second - tok.first;
+
+	result += '/';
+	if (memchr(str.data() + tok.first, '\\', len))
+		result += get(str, tok, '/');
+	else
+		result.append(str, tok.first, len);
 }
 
 
-/**
- * @param component  path component
- *
- * remove from path_component all directory left to {root}, {kern} or {anon}
- */
-void remove_base_dir(vector<string> & path)
+/// return true if the token is the string s, the tokens compared with
+/// this never contain an escaped separator
+bool equal(string const & str, token const & tok, char const * s)
 {
-	vector<string>::iterator it;
-	for (it = path.begin(); it != path.end(); ++it) {
-		if (*it == "{root}" || *it == "{kern}"  || *it == "{anon}")
-			break;
+	return !str.compare(tok.first, tok.second - tok.first, s);
+}
+
+
+/// return true if the token starts with prefix
+bool has_prefix(string const & str, token const & tok, char const * prefix)
+{
+	string::size_type const len = strlen(prefix);
+	return tok.second - tok.first >= len &&
+		!str.compare(tok.first, len, prefix);
+}
+
+
+/// return true if the token is "{root}", "{kern}" or starts with "{anon"
+bool is_base_dir(string const & str, token const & tok)
+{
+	return equal(str, tok, "{root}") || equal(str, tok, "{kern}") ||
+		has_prefix(str, tok, "{anon");
+}
+
+
+// PP:3.19 event_name.count.unitmask.tgid.tid.cpu
+void parse_event_spec(string const & filename, string::size_type begin,
+                      parsed_filename & result)
+{
+	size_t const nr_parts = 6;
+
+	tokens parts;
+	split(filename, begin, filename.size(), '.', parts);
+
+	if (parts.size() != nr_parts) {
+		throw invalid_argument("parse_event_spec(): bad event specification: " + filename.substr(begin));
 	}
 
-	path.erase(path.begin(), it);
+	for (size_t i = 0; i < nr_parts ; ++i) {
+		if (parts[i].first == parts[i].second) {
+			throw invalid_argument("parse_event_spec(): bad event specification: " + filename.substr(begin));
+		}
+	}
+
+	size_t i = 0;
+	result.event = get(filename, parts[i++], '.');
+	result.count = get(filename, parts[i++], '.');
+	result.unitmask = get(filename, parts[i++], '.');
+	result.tgid = get(filename, parts[i++], '.');
+	result.tid = get(filename, parts[i++], '.');
+	result.cpu = get(filename, parts[i++], '.');
 }
 
 
@@ -127,34 +190,41 @@ parsed_filename parse_filename(string const & filename,
 		throw invalid_argument("parse_filename() invalid filename: " +
 				       filename);
 	}
-	string event_spec = filename.substr(pos + 1);
-	string filename_spec = filename.substr(0, pos);
 
-	parsed_filename result = parse_event_spec(event_spec);
+	parsed_filename result;
+	parse_event_spec(filename, pos + 1, result);
 
 	result.filename = filename;
 
-	vector<string> path = separate_token(filename_spec, '/');
+	// the path components are ranges of filename, only the image names
+	// are built as strings
+	tokens path;
+	split(filename, 0, pos, '/', path);
 
-	remove_base_dir(path);
+	// remove all directory left to {root}, {kern} or {anon}
+	size_t i = 0;
+	while (i < path.size() && !equal(filename, path[i], "{root}") &&
+	       !equal(filename, path[i], "{kern}") &&
+	       !equal(filename, path[i], "{anon}"))
+		++i;
 
 	// pp_interface PP:3.19 to PP:3.23 path must start either with {root}
-	// or {kern} and we must found at least 2 component, remove_base_dir()
-	// return an empty path if {root} or {kern} are not found
-	if (path.size() < 2) {
+	// or {kern} and we must found at least 2 component, return an error
+	// if {root} or {kern} are not found
+	if (path.size() - i < 2) {
 		throw invalid_argument("parse_filename() invalid filename: " +
 				       filename);
 	}
 
-	size_t i;
-	for (i = 1 ; i < path.size() ; ++i) {
-		if (path[i] == "{dep}")
+	for (++i ; i < path.size() ; ++i) {
+		if (equal(filename, path[i], "{dep}"))
 			break;
 
-		result.image += "/" + path[i];
+		append_component(result.image, filename, path[i]);
 	}
 
-	if (i == path.size()) {
+	// {dep}/ must be followed by a component
+	if (i + 1 >= path.size()) {
 		throw invalid_argument("parse_filename() invalid filename: " +
 				       filename);
 	}
@@ -163,29 +233,29 @@ parsed_filename parse_filename(string const & filename,
 	++i;
 
 	// PP:3.19 {dep}/ must be followed by {kern}/, {root}/ or {anon}/
-	if (path[i] != "{kern}" && path[i] != "{root}" &&
-	    path[i].find("{anon", 0) != 0) {
+	if (!is_base_dir(filename, path[i])) {
 		throw invalid_argument("parse_filename() invalid filename: " +
 				       filename);
 	}
 
-	bool anon = path[i].find("{anon:", 0) == 0;
+	bool anon = has_prefix(filename, path[i], "{anon:");
 
 	// skip "{root}", "{kern}" or "{anon:.*}"
 	++i;
 
 	for (; i < path.size(); ++i) {
-		if (path[i] == "{cg}")
+		if (equal(filename, path[i], "{cg}"))
 			break;
 
 		if (anon) {
-			pos = filename_spec.rfind('.');
-			pos = filename_spec.rfind('.', pos-1);
-			if (pos == string::npos) {
+			string const filename_spec = filename.substr(0, pos);
+			string::size_type dot = filename_spec.rfind('.');
+			dot = filename_spec.rfind('.', dot - 1);
+			if (dot == string::npos) {
 				throw invalid_argument("parse_filename() pid.addr.addr name expected: " +
 						       filename_spec);
 			}
-			string jitdump = filename_spec.substr(0, pos) + ".jo";
+			string jitdump = filename_spec.substr(0, dot) + ".jo";
 			// if a jitdump file exists, we point to this file
 			if (!stat(jitdump.c_str(), &st)) {
 				// later code assumes an optional prefix path
@@ -194,12 +264,14 @@ parsed_filename parse_filename(string const & filename,
 					extra_found_images.strip_path_prefix(jitdump);
 				result.jit_dumpfile_exists = true;
 			} else {
-				result.lib_image =  parse_anon(path[i], path[i - 1]);
+				result.lib_image = parse_anon(
+					get(filename, path[i], '/'),
+					get(filename, path[i - 1], '/'));
 			}
 			i++;
 			break;
 		} else {
-			result.lib_image += "/" + path[i];
+			append_component(result.lib_image, filename, path[i]);
 		}
 	}
 
@@ -208,23 +280,26 @@ parsed_filename parse_filename(string const & filename,
 
 	// skip "{cg}"
 	++i;
-	if (i == path.size() ||
-	    (path[i] != "{kern}" && path[i] != "{root}" &&
-	     path[i].find("{anon", 0) != 0)) {
+	if (i == path.size() || !is_base_dir(filename, path[i])) {
 		throw invalid_argument("parse_filename() invalid filename: "
 		                       + filename);
 	}
 
 	// skip "{root}", "{kern}" or "{anon}"
-	anon = (path[i].find("{anon", 0) == 0);
+	anon = has_prefix(filename, path[i], "{anon");
 	++i;
 
 	if (anon) {
-		result.cg_image = parse_anon(path[i], path[i - 1]);
+		if (i == path.size()) {
+			throw invalid_argument("parse_filename() invalid filename: "
+			                       + filename);
+		}
+		result.cg_image = parse_anon(get(filename, path[i], '/'),
+		                             get(filename, path[i - 1], '/'));
 		i++;
 	} else {
 		for (; i < path.size(); ++i)
-			result.cg_image += "/" + path[i];
+			append_component(result.cg_image, filename, path[i]);
 	}
 
 	return result;
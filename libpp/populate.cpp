@@ -21,43 +21,96 @@
 #include "populate_for_spu.h"
 
 #include "image_errors.h"
+#include "op_exception.h"
 
 #include <iostream>
+#include <vector>
 
 using namespace std;
 
 namespace {
 
-/// load merged files for one set of sample files
-bool
-populate_from_files(profile_t & profile, op_bfd const & abfd,
-                    list<profile_sample_files> const & files)
+/// the names of the sample files of one image_set
+vector<string> const
+sample_filenames(list<profile_sample_files> const & files)
 {
 	list<profile_sample_files>::const_iterator it = files.begin();
 	list<profile_sample_files>::const_iterator const end = files.end();
 
-	bool found = false;
+	vector<string> filenames;
 	// we can't handle cg files here obviously
 	for (; it != end; ++it) {
 		// A bit ugly but we must accept silently empty sample filename
 		// since we can create a profile_sample_files for cg file only
 		// (i.e no sample to the binary)
-		if (!it->sample_filename.empty()) {
-			profile.add_sample_file(it->sample_filename);
-			profile.set_offset(abfd);
-			found = true;
-		}
+		if (!it->sample_filename.empty())
+			filenames.push_back(it->sample_filename);
 	}
 
-	return found;
+	return filenames;
+}
+
+
+/// load merged files for one set of sample files
+bool
+populate_from_files(profile_t & profile, op_bfd const & abfd,
+                    list<profile_sample_files> const & files)
+{
+	vector<string> const filenames = sample_filenames(files);
+	if (filenames.empty())
+		return false;
+
+	profile.add_sample_files(filenames);
+	profile.set_offset(abfd);
+	return true;
 }
 
 }  // anon namespace
 
 
+image_samples::~image_samples()
+{
+	for (size_t i = 0; i < profiles.size(); ++i)
+		delete profiles[i];
+}
+
+
+void image_samples::load(inverted_profile const & ip)
+{
+	if (is_spu_profile(ip))
+		return;
+
+	try {
+		for (size_t i = 0; i < ip.groups.size(); ++i) {
+			list<image_set>::const_iterator it
+				= ip.groups[i].begin();
+			list<image_set>::const_iterator const end
+				= ip.groups[i].end();
+
+			for (; it != end; ++it) {
+				vector<string> const filenames =
+					sample_filenames(it->files);
+				if (filenames.empty()) {
+					profiles.push_back(0);
+					continue;
+				}
+
+				scoped_ptr<profile_t> profile(new profile_t);
+				profile->add_sample_files(filenames, 1);
+				profiles.push_back(profile.get());
+				profile.release();
+			}
+		}
+	} catch (op_fatal_error const & e) {
+		error = e.what();
+	}
+}
+
+
 void
 populate_for_image(profile_container & samples, inverted_profile const & ip,
-	string_filter const & symbol_filter, bool * has_debug_info)
+	string_filter const & symbol_filter, bool * has_debug_info,
+	image_samples const * loaded)
 {
 	if (is_spu_profile(ip)) {
 		populate_for_spu_image(samples, ip, symbol_filter,
@@ -77,6 +130,7 @@ populate_for_image(profile_container & samples, inverted_profile const & ip,
 	opd_header header;
 
 	bool found = false;
+	size_t nr_sets = 0;
 	for (size_t i = 0; i < ip.groups.size(); ++i) {
 		list<image_set>::const_iterator it
 			= ip.groups[i].begin();
@@ -87,7 +141,20 @@ populate_for_image(profile_container & samples, inverted_profile const & ip,
 		// image_set's files - this is because it->app_image
 		// changes, and the .add() would mis-attribute
 		// to the wrong app_image otherwise
-		for (; it != end; ++it) {
+		for (; it != end; ++it, ++nr_sets) {
+			if (loaded) {
+				if (nr_sets == loaded->profiles.size())
+					throw op_fatal_error(loaded->error);
+				profile_t * profile = loaded->profiles[nr_sets];
+				if (!profile)
+					continue;
+				profile->set_offset(abfd);
+				header = profile->get_header();
+				samples.add(*profile, abfd, it->app_image, i);
+				found = true;
+				continue;
+			}
+
 			profile_t profile;
 			if (populate_from_files(profile, abfd, it->files)) {
 				header = profile.get_header();
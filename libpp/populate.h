@@ -12,14 +12,49 @@
 #ifndef POPULATE_H
 #define POPULATE_H
 
+#include <string>
+#include <vector>
+
+#include "utility.h"
+
 class profile_container;
+class profile_t;
 class inverted_profile;
 class string_filter;
 
 
-/// Load all sample file information for exactly one binary image.
+/**
+ * The sample files of one binary image read ahead of
+ * populate_for_image(). Unlike populate_for_image(), load() uses no
+ * global state, so the images of a report can be loaded concurrently and
+ * then populated in turn.
+ */
+struct image_samples : noncopyable {
+	~image_samples();
+
+	/**
+	 * read the sample files of each image_set of ip in a single thread,
+	 * stopping at the first error
+	 */
+	void load(inverted_profile const & ip);
+
+	/// one per image_set of ip in order, null if it has no sample file
+	std::vector<profile_t *> profiles;
+
+	/// the error message of the image_set after the last profile
+	std::string error;
+};
+
+
+/**
+ * Load all sample file information for exactly one binary image. If
+ * loaded is non null, the sample files are taken from it instead of
+ * being read, and the error it recorded is thrown when its image_set
+ * is reached.
+ */
 void
 populate_for_image(profile_container & samples, inverted_profile const & ip,
-   string_filter const & symbol_filter, bool * has_debug_info);
+   string_filter const & symbol_filter, bool * has_debug_info,
+   image_samples const * loaded = 0);
 
 #endif /* POPULATE_H */
@@ -14,6 +14,7 @@
 #include "profile_container.h"
 #include "arrange_profiles.h"
 #include "op_bfd.h"
+#include "op_bfd_cache.h"
 #include "op_header.h"
 #include "populate.h"
 #include "populate_for_spu.h"
@@ -48,13 +49,10 @@ populate_spu_profile_from_files(list<profile_sample_files> const & files,
 				string const app_image,
 				profile_container & samples,
 				inverted_profile const & ip,
-				string_filter const & symbol_filter,
-				size_t ip_grp_num, bool * has_debug_info)
+				size_t ip_grp_num, bool * has_debug_info,
+				op_bfd_cache & bfd_cache)
 {
-	string archive_path = samples.extra_found_images.get_archive_path();
 	bool ok = ip.error == image_ok;
-	op_bfd * abfd = NULL;
-	string fname_to_check;
 	list<profile_sample_files>::const_iterator it = files.begin();
 	list<profile_sample_files>::const_iterator const end = files.end();
 	for (; it != end; ++it) {
@@ -64,20 +62,11 @@ populate_spu_profile_from_files(list<profile_sample_files> const & files,
 
 		profile.add_sample_file(it->sample_filename);
 		opd_header header = profile.get_header();
-		if (header.embedded_offset) {
-			abfd = new op_bfd(header.embedded_offset,
-					  ip.image,
-					  symbol_filter,
-					  samples.extra_found_images,
-					  ok);
-			fname_to_check = ip.image;
-		} else {
-			abfd = new op_bfd(ip.image,
-					  symbol_filter,
-					  samples.extra_found_images,
-					  ok);
-			fname_to_check = abfd->get_filename();
-		}
+		// a zero embedded_offset opens ip.image as a plain binary
+		cached_op_bfd abfd(bfd_cache, header.embedded_offset,
+		                   ip.image, ok);
+		string const fname_to_check = header.embedded_offset
+			? ip.image : abfd->get_filename();
 		profile.set_offset(*abfd);
 		if (!ok && ip.error == image_ok)
 			ip.error = image_format_failure;
@@ -97,7 +86,6 @@ populate_spu_profile_from_files(list<profile_sample_files> const & files,
 
 		if (has_debug_info && !*has_debug_info)
 			*has_debug_info = abfd->has_debug_info();
-		delete abfd;
 	}
 }
 }  // anon namespace
@@ -108,6 +96,8 @@ populate_for_spu_image(profile_container & samples,
 		       string_filter const & symbol_filter,
 		       bool * has_debug_info)
 {
+	// the sample files of an embedded SPU image share its op_bfd
+	op_bfd_cache bfd_cache(symbol_filter, samples.extra_found_images);
 
 	for (size_t i = 0; i < ip.groups.size(); ++i) {
 		list < image_set >::const_iterator it=
@@ -118,7 +108,7 @@ populate_for_spu_image(profile_container & samples,
 		for (; it != end; ++it)
 			populate_spu_profile_from_files(it->files,
 				it->app_image, samples, ip,
-				symbol_filter, i, has_debug_info);
+				i, has_debug_info, bfd_cache);
 	}
 }
 
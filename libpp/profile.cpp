@@ -13,6 +13,7 @@
 #include <unistd.h>
 #include <cstring>
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -27,10 +28,147 @@
 #include "profile.h"
 #include "op_bfd.h"
 #include "cverb.h"
+#include "parallel.h"
 #include "populate_for_spu.h"
 
 using namespace std;
 
+namespace {
+
+/// samples ordered by key, one entry by key
+typedef vector<pair<odb_key_t, count_type> > sorted_samples_t;
+
+/// libdb keeps a table of opened files which is not thread safe
+op_mutex odb_mutex;
+
+
+bool key_less(sorted_samples_t::value_type const & lhs, odb_key_t rhs)
+{
+	return lhs.first < rhs;
+}
+
+
+/// sort samples by key and sum the counts of a same key
+void sort_samples(sorted_samples_t & samples)
+{
+	if (samples.empty())
+		return;
+
+	sort(samples.begin(), samples.end());
+
+	sorted_samples_t::iterator out = samples.begin();
+	sorted_samples_t::iterator it = out + 1;
+	for (; it != samples.end(); ++it) {
+		if (it->first == out->first)
+			out->second += it->second;
+		else
+			*++out = *it;
+	}
+	samples.erase(out + 1, samples.end());
+}
+
+
+/// merge two sorted samples arrays, summing the counts of a same key
+void merge_samples(sorted_samples_t & result, sorted_samples_t const & lhs,
+                   sorted_samples_t const & rhs)
+{
+	result.clear();
+	result.reserve(lhs.size() + rhs.size());
+
+	sorted_samples_t::const_iterator l = lhs.begin();
+	sorted_samples_t::const_iterator r = rhs.begin();
+	while (l != lhs.end() && r != rhs.end()) {
+		if (l->first < r->first) {
+			result.push_back(*l++);
+		} else if (r->first < l->first) {
+			result.push_back(*r++);
+		} else {
+			result.push_back(make_pair(l->first,
+			                           l->second + r->second));
+			++l;
+			++r;
+		}
+	}
+	result.insert(result.end(), l, lhs.end());
+	result.insert(result.end(), r, rhs.end());
+}
+
+
+/// merge pairs of samples arrays, one level of the merge tree
+class merge_job : public parallel_job {
+public:
+	merge_job(vector<sorted_samples_t> & parts_)
+		: parts(parts_), merged((parts_.size() + 1) / 2) {}
+
+	void run(size_t index) {
+		size_t const first = index * 2;
+		if (first + 1 == parts.size()) {
+			merged[index].swap(parts[first]);
+			return;
+		}
+		merge_samples(merged[index], parts[first], parts[first + 1]);
+		sorted_samples_t().swap(parts[first]);
+		sorted_samples_t().swap(parts[first + 1]);
+	}
+
+	vector<sorted_samples_t> & parts;
+	vector<sorted_samples_t> merged;
+};
+
+} // anonymous namespace
+
+
+class profile_t::load_job : public parallel_job {
+public:
+	load_job(vector<string> const & filenames_)
+		: filenames(filenames_), headers(filenames_.size()),
+		  samples(filenames_.size()), errors(filenames_.size()) {}
+
+	void run(size_t index) {
+		try {
+			load(index);
+		} catch (op_fatal_error const & e) {
+			errors[index] = e.what();
+		}
+	}
+
+	vector<string> const & filenames;
+	vector<opd_header> headers;
+	vector<sorted_samples_t> samples;
+	/// error message of each file, empty if it was read
+	vector<string> errors;
+
+private:
+	void load(size_t index) {
+		odb_t samples_db;
+		{
+			op_mutex_lock lock(odb_mutex);
+			open_sample_file(filenames[index], samples_db);
+		}
+
+		headers[index] =
+			*static_cast<opd_header *>(odb_get_data(&samples_db));
+
+		odb_node_nr_t node_nr, pos;
+		odb_node_t * node = odb_get_iterator(&samples_db, &node_nr);
+
+		sorted_samples_t & result = samples[index];
+		result.reserve(node_nr);
+		for (pos = 0; pos < node_nr; ++pos) {
+			result.push_back(make_pair(node[pos].key,
+			                           count_type(node[pos].value)));
+		}
+
+		{
+			op_mutex_lock lock(odb_mutex);
+			odb_close(&samples_db);
+		}
+
+		sort_samples(result);
+	}
+};
+
+
 profile_t::profile_t()
 	: start_offset(0)
 {
@@ -93,35 +231,50 @@ void profile_t::open_sample_file(string const & filename, odb_t & db)
 
 void profile_t::add_sample_file(string const & filename)
 {
-	odb_t samples_db;
-
-	open_sample_file(filename, samples_db);
-
-	opd_header const & head =
-		*static_cast<opd_header *>(odb_get_data(&samples_db));
+	add_sample_files(vector<string>(1, filename));
+}
 
-	// if we already read a sample file header pointer is non null
-	if (file_header.get())
-		op_check_header(head, *file_header, filename);
-	else
-		file_header.reset(new opd_header(head));
 
-	odb_node_nr_t node_nr, pos;
-	odb_node_t * node = odb_get_iterator(&samples_db, &node_nr);
+void profile_t::add_sample_files(vector<string> const & filenames,
+                                 size_t nr_threads)
+{
+	load_job loader(filenames);
+	parallel_run(loader, filenames.size(), nr_threads);
+
+	for (size_t i = 0; i < filenames.size(); ++i) {
+		if (!loader.errors[i].empty())
+			throw op_fatal_error(loader.errors[i]);
+
+		// if we already read a sample file header pointer is non null
+		if (file_header.get())
+			op_check_header(loader.headers[i], *file_header,
+			                filenames[i]);
+		else
+			file_header.reset(new opd_header(loader.headers[i]));
+	}
 
-	for (pos = 0; pos < node_nr; ++pos) {
-		ordered_samples_t::iterator it = 
-		    ordered_samples.find(node[pos].key);
-		if (it != ordered_samples.end()) {
-			it->second += node[pos].value;
-		} else {
-			ordered_samples_t::value_type
-				val(node[pos].key, node[pos].value);
-			ordered_samples.insert(val);
+	vector<sorted_samples_t> parts;
+	parts.reserve(filenames.size() + 1);
+	if (!ordered_samples.empty()) {
+		parts.push_back(sorted_samples_t());
+		parts.back().swap(ordered_samples);
+	}
+	for (size_t i = 0; i < filenames.size(); ++i) {
+		if (!loader.samples[i].empty()) {
+			parts.push_back(sorted_samples_t());
+			parts.back().swap(loader.samples[i]);
 		}
 	}
 
-	odb_close(&samples_db);
+	// merge the sorted files two by two until a single one is left
+	while (parts.size() > 1) {
+		merge_job merger(parts);
+		parallel_run(merger, merger.merged.size(), nr_threads);
+		parts.swap(merger.merged);
+	}
+
+	if (!parts.empty())
+		ordered_samples.swap(parts.front());
 }
 
 
@@ -167,10 +320,11 @@ profile_t::samples_range(odb_key_t start, odb_key_t end) const
 			"oprofile-list@lists.sourceforge.net");
 	}
 
-	ordered_samples_t::const_iterator first = 
-		ordered_samples.lower_bound(start);
+	ordered_samples_t::const_iterator first =
+		lower_bound(ordered_samples.begin(), ordered_samples.end(),
+		            start, key_less);
 	ordered_samples_t::const_iterator last =
-		ordered_samples.lower_bound(end);
+		lower_bound(first, ordered_samples.end(), end, key_less);
 
 	return make_pair(const_iterator(first, start_offset),
 		const_iterator(last, start_offset));
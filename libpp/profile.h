@@ -14,11 +14,13 @@
 #define PROFILE_H
 
 #include <string>
-#include <map>
+#include <vector>
+#include <utility>
 #include <iterator>
 
 #include "odb.h"
 #include "op_types.h"
+#include "parallel.h"
 #include "utility.h"
 #include "populate_for_spu.h"
 
@@ -75,6 +77,20 @@ public:
 	 */
 	void add_sample_file(std::string const & filename);
 
+	/**
+	 * cumulate sample files to our container of samples
+	 * @param filenames  sample file names
+	 * @param nr_threads  the maximum nr. of threads of the jobs
+	 *
+	 * same as add_sample_file() for each file in turn, but the files are
+	 * read and merged by parallel_run() jobs. Headers are checked in
+	 * filenames order.
+	 *
+	 * all error are fatal
+	 */
+	void add_sample_files(std::vector<std::string> const & filenames,
+	                      size_t nr_threads = parallel_threads());
+
 	/// Set an appropriate start offset, see comments below.
 	void set_offset(op_bfd const & abfd);
 	u64 get_offset(void) const { return start_offset; }
@@ -100,17 +116,20 @@ private:
 	static void
 	open_sample_file(std::string const & filename, odb_t &);
 
+	/// parallel_run() job of add_sample_files() reading one file
+	class load_job;
+
 	/// copy of the samples file header
 	scoped_ptr<opd_header> file_header;
 
-	/// storage type for samples sorted by eip
-	typedef std::map<odb_key_t, count_type> ordered_samples_t;
+	/// storage type for samples sorted by eip, one entry by eip
+	typedef std::vector<std::pair<odb_key_t, count_type> > ordered_samples_t;
 
 	/**
 	 * Samples are stored in hash table, iterating over hash table don't
 	 * provide any ordering, the above count() interface rely on samples
-	 * ordered by eip. This map is only a temporary storage where samples
-	 * are ordered by eip.
+	 * ordered by eip. This array is only a temporary storage where
+	 * samples are ordered by eip.
 	 */
 	ordered_samples_t ordered_samples;
 
@@ -79,6 +79,13 @@ void profile_container::add(profile_t const & profile,
 	opd_header header = profile.get_header();
 	count_type sym_count_total = 0;
 
+	// symbols and samples are both sorted, most symbols have no samples:
+	// next is the first sample at or after last_end, a symbol lying
+	// between last_end and next is skipped without searching the samples
+	profile_t::iterator_pair const all = profile.samples_range();
+	profile_t::const_iterator next = all.first;
+	unsigned long long last_end = 0;
+
 	for (symbol_index_t i = 0; i < abfd.syms.size(); ++i) {
 
 		unsigned long long start = 0, end = 0;
@@ -86,8 +93,19 @@ void profile_container::add(profile_t const & profile,
 
 		abfd.get_symbol_range(i, start, end);
 
+		// see profile_t::samples_range(), such symbols get no samples
+		if (start < profile.get_offset())
+			continue;
+
+		if (start >= last_end &&
+		    (next == all.second || end <= next.vma()))
+			continue;
+
 		profile_t::iterator_pair p_it =
 			profile.samples_range(start, end);
+		next = p_it.second;
+		last_end = end;
+
 		count_type count = accumulate(p_it.first, p_it.second, 0ull);
 
 		// skip entries with no samples
@@ -185,6 +203,7 @@ profile_container::select_symbols(symbol_choice & choice) const
 
 	double const threshold = choice.threshold / 100.0;
 
+	count_matrix const & counts = symbols->sample_counts();
 	symbol_container::symbols_t::iterator it = symbols->begin();
 	symbol_container::symbols_t::iterator const end = symbols->end();
 
@@ -194,7 +213,7 @@ profile_container::select_symbols(symbol_choice & choice) const
 			continue;
 
 		double const percent =
-			op_ratio(it->sample.counts[0], total_count[0]);
+			op_ratio(counts.row(it->row)[0], total_count[0]);
 
 		if (percent >= threshold) {
 			result.push_back(&*it);
@@ -267,6 +286,12 @@ count_array_t profile_container::samples_count() const
 }
 
 
+count_matrix const & profile_container::sample_counts() const
+{
+	return symbols->sample_counts();
+}
+
+
 // Rest here are delegated to our private implementation.
 
 symbol_entry const *
@@ -309,6 +334,13 @@ count_array_t profile_container::samples_count(debug_name_id filename,
 }
 
 
+void profile_container::
+samples_count(map<debug_name_id, sample_container::line_counts_t> & lines) const
+{
+	samples->accumulate_lines(lines);
+}
+
+
 sample_container::samples_iterator
 profile_container::begin(symbol_entry const * symbol) const
 {
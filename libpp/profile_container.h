@@ -117,6 +117,13 @@ public:
 	/// return the total number of samples
 	count_array_t samples_count() const;
 
+	/**
+	 * return the sample counts of the symbols, the counts of a symbol
+	 * being the row symbol_entry::row. The symbols samples count are
+	 * still available through symbol_entry::sample.
+	 */
+	count_matrix const & sample_counts() const;
+
 	/// Get the samples count which belongs to filename. Return 0 if
 	/// no samples found.
 	count_array_t samples_count(debug_name_id filename_id) const;
@@ -124,6 +131,10 @@ public:
 	/// 0 if no samples found.
 	count_array_t samples_count(debug_name_id filename,
 			   size_t linenr) const;
+	/// Get the samples count of each line of each file, faster than
+	/// samples_count(filename, linenr) for all the lines
+	void samples_count(std::map<debug_name_id,
+	                   sample_container::line_counts_t> & lines) const;
 
 	/// return an iterator to the first symbol
 	symbol_container::symbols_t::iterator begin_symbol() const;
@@ -16,6 +16,8 @@
 #include <dirent.h>
 
 #include "file_manip.h"
+#include "file_tree.h"
+#include "parallel.h"
 #include "op_config.h"
 #include "profile_spec.h"
 #include "string_manip.h"
@@ -372,10 +374,33 @@ vector<string> filter_session(vector<string> const & session,
 	return result;
 }
 
-static bool invalid_sample_file;
-bool valid_candidate(string const & base_dir, string const & filename,
-                     profile_spec const & spec, bool exclude_dependent,
-                     bool exclude_cg)
+/// the sample files of a session kept by generate_file_list()
+class candidate_filter : public file_filter {
+public:
+	candidate_filter(string const & base_dir_, profile_spec const & spec_,
+	                 bool exclude_dependent_, bool exclude_cg_)
+		: base_dir(base_dir_), spec(spec_),
+		  exclude_dependent(exclude_dependent_),
+		  exclude_cg(exclude_cg_), invalid_sample_file(false) {}
+
+	bool operator()(string const & filename) const;
+
+	/// true if sample files of sample files were found, see operator()
+	bool invalid_found() const { return invalid_sample_file; }
+
+private:
+	string const & base_dir;
+	profile_spec const & spec;
+	bool exclude_dependent;
+	bool exclude_cg;
+
+	/// operator() is called concurrently
+	mutable op_mutex mutex;
+	mutable bool invalid_sample_file;
+};
+
+
+bool candidate_filter::operator()(string const & filename) const
 {
 	if (exclude_cg && filename.find("{cg}") != string::npos)
 		return false;
@@ -430,6 +455,7 @@ bool valid_candidate(string const & base_dir, string const & filename,
 	unsigned int j = base_dir.rfind('/');
 	string session_samples_dir = base_dir.substr(0, j);
 	if (sub.find(session_samples_dir) != string::npos) {
+		op_mutex_lock lock(mutex);
 		invalid_sample_file = true;
 		return false;
 	}
@@ -556,8 +582,7 @@ static void warn_if_sampling_problems(string const & session_samples_dir)
 list<string> profile_spec::generate_file_list(bool exclude_dependent,
   bool exclude_cg) const
 {
-	// FIXME: isn't remove_duplicates faster than doing this, then copy() ?
-	set<string> unique_files;
+	vector<string> files;
 
 	vector<string> sessions = filter_session(session, session_exclude);
 
@@ -583,30 +608,20 @@ list<string> profile_spec::generate_file_list(bool exclude_dependent,
 			continue;
 
 		string base_dir;
-		invalid_sample_file = false;
 		if ((*cit)[0] != '.' && (*cit)[0] != '/')
 			base_dir = archive_path + op_samples_dir;
 		base_dir += *cit;
 
 		base_dir = op_realpath(base_dir);
 
-		list<string> files;
-		create_file_list(files, base_dir, "*", true);
-
-		if (!files.empty()) {
+		candidate_filter const filter(base_dir, *this,
+		                              exclude_dependent, exclude_cg);
+		if (walk_file_tree(base_dir, filter, files)) {
 			found_file = true;
 			warn_if_sampling_problems(base_dir + "/");
 		}
 
-		list<string>::const_iterator it = files.begin();
-		list<string>::const_iterator fend = files.end();
-		for (; it != fend; ++it) {
-			if (valid_candidate(base_dir, *it, *this,
-			    exclude_dependent, exclude_cg)) {
-				unique_files.insert(*it);
-			}
-		}
-		if (invalid_sample_file) {
+		if (filter.invalid_found()) {
 			cerr << "Warning: Invalid sample files found in "
 			     << base_dir << endl;
 			cerr << "This problem can be caused by too high of a sampling rate."
@@ -622,8 +637,8 @@ list<string> profile_spec::generate_file_list(bool exclude_dependent,
 		throw op_fatal_error(os.str());
 	}
 
-	list<string> result;
-	copy(unique_files.begin(), unique_files.end(), back_inserter(result));
+	sort(files.begin(), files.end());
+	files.erase(unique(files.begin(), files.end()), files.end());
 
-	return result;
+	return list<string>(files.begin(), files.end());
 }
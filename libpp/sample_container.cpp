@@ -129,6 +129,29 @@ sample_container::accumulate_samples(debug_name_id filename,
 }
 
 
+void sample_container::
+accumulate_lines(map<debug_name_id, line_counts_t> & result) const
+{
+	build_by_loc();
+
+	line_counts_t * lines = 0;
+	debug_name_id filename;
+
+	samples_by_loc_t::const_iterator it;
+	for (it = samples_by_loc.begin(); it != samples_by_loc.end(); ++it) {
+		file_location const & loc = (*it)->file_loc;
+		if (!lines || !(loc.filename == filename)) {
+			filename = loc.filename;
+			lines = &result[filename];
+		}
+
+		if (lines->empty() || lines->back().first != loc.linenr)
+			lines->push_back(make_pair(loc.linenr, count_array_t()));
+		lines->back().second += (*it)->counts;
+	}
+}
+
+
 void sample_container::build_by_loc() const
 {
 	if (!samples_by_loc.empty())
@@ -15,6 +15,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "symbol.h"
 #include "symbol_functors.h"
@@ -50,6 +51,12 @@ public:
 	/// return nr of samples at the given line nr in the given file
 	count_array_t accumulate_samples(debug_name_id, size_t linenr) const;
 
+	/// nr of samples of each line with samples, by ascending line nr
+	typedef std::vector<std::pair<size_t, count_array_t> > line_counts_t;
+
+	/// return nr of samples of each line of each file, in one pass
+	void accumulate_lines(std::map<debug_name_id, line_counts_t> &) const;
+
 	/// return the sample entry for the given image_name and vma if any
 	sample_entry const * find_by_vma(symbol_entry const * symbol,
 					 bfd_vma vma) const;
@@ -62,7 +62,8 @@ struct sample_entry {
 /// associate a symbol with a file location, samples count and vma address
 class symbol_entry {
 public:
-	symbol_entry() :  sym_index(0), size(0), spu_offset(0), vma_adj(0) {}
+	symbol_entry()
+		: sym_index(0), size(0), spu_offset(0), vma_adj(0), row(0) {}
 	virtual ~symbol_entry() {}
 
 	/// which image this symbol belongs to
@@ -101,6 +102,13 @@ public:
 	 * this to every symbol_entry, but there isn't a better option.
 	 */
 	bfd_vma vma_adj;
+
+	/**
+	 * The row of the sample counts of this symbol in the
+	 * symbol_container::sample_counts() of the container holding it,
+	 * meaningless for a copy used outside of this container.
+	 */
+	size_t row;
 };
 
 
@@ -91,6 +91,37 @@ void symbol_container::build_by_loc() const
 }
 
 
+count_matrix const & symbol_container::sample_counts() const
+{
+	build_counts();
+	return counts;
+}
+
+
+void symbol_container::build_counts() const
+{
+	if (counts.nr_rows() || symbols.empty())
+		return;
+
+	size_t nr_classes = 1;
+	symbols_t::const_iterator cit = symbols.begin();
+	symbols_t::const_iterator end = symbols.end();
+	for (; cit != end; ++cit)
+		nr_classes = max(nr_classes, cit->sample.counts.size());
+
+	counts = count_matrix(symbols.size(), nr_classes);
+
+	size_t row = 0;
+	for (cit = symbols.begin(); cit != end; ++cit, ++row) {
+		// safe: row is not used by sorting criteria
+		const_cast<symbol_entry &>(*cit).row = row;
+		count_type * dest = counts.row(row);
+		for (size_t pclass = 0; pclass < nr_classes; ++pclass)
+			dest[pclass] = cit->sample.counts[pclass];
+	}
+}
+
+
 symbol_entry const * symbol_container::find_by_vma(string const & image_name,
 						   bfd_vma vma) const
 {
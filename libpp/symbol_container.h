@@ -17,6 +17,7 @@
 
 #include "symbol.h"
 #include "symbol_functors.h"
+#include "count_matrix.h"
 
 /**
  * An arbitrary container of symbols. Supports lookup
@@ -59,6 +60,14 @@ public:
 	/// Search a symbol. Return NULL if not found.
 	symbol_entry const * find(symbol_entry const & symbol) const;
 
+	/**
+	 * return the sample counts of the symbols, one row per symbol
+	 * given by symbol_entry::row, with as many classes as the symbol
+	 * with the most. Built on the first call: no symbol can be
+	 * inserted after.
+	 */
+	count_matrix const & sample_counts() const;
+
 	/// return start of symbols
 	symbols_t::iterator begin();
 
@@ -69,6 +78,9 @@ private:
 	/// build the symbol by file-location cache
 	void build_by_loc() const;
 
+	/// build the sample counts matrix
+	void build_counts() const;
+
 	/**
 	 * The main container of symbols. Multiple symbols with the same
 	 * name are allowed.
@@ -89,6 +101,9 @@ private:
 	 * so mutable.
 	 */
 	mutable symbols_by_loc_t symbols_by_loc;
+
+	/// The counts of the symbols in symbols order, lazily built
+	mutable count_matrix counts;
 };
 
 #endif /* SYMBOL_CONTAINER_H */
@@ -24,6 +24,17 @@ namespace {
 
 bool long_filenames;
 
+/// the counts symbols samples count are read from, if not null
+count_matrix const * sample_counts;
+
+
+count_type sample_count(symbol_entry const & symbol)
+{
+	if (sample_counts)
+		return sample_counts->row(symbol.row)[0];
+	return symbol.sample.counts[0];
+}
+
 int image_compare(image_name_id l, image_name_id r)
 {
 	if (long_filenames)
@@ -44,12 +55,15 @@ int compare_by(sort_options::sort_order order,
                symbol_entry const & lhs, symbol_entry const & rhs)
 {
 	switch (order) {
-		case sort_options::sample:
-			if (lhs.sample.counts[0] < rhs.sample.counts[0])
+		case sort_options::sample: {
+			count_type const lhs_count = sample_count(lhs);
+			count_type const rhs_count = sample_count(rhs);
+			if (lhs_count < rhs_count)
 				return 1;
-			if (lhs.sample.counts[0] > rhs.sample.counts[0])
+			if (lhs_count > rhs_count)
 				return -1;
 			return 0;
+		}
 
 		case sort_options::symbol:
 			return symbol_names.demangle(lhs.name).compare(
@@ -125,40 +139,94 @@ bool symbol_compare::operator()(symbol_entry const & lhs,
 }
 
 
-} // anonymous namespace
+/// order rows of a collection as symbol_compare, ties in row order
+template <typename Collection>
+struct row_compare {
+	row_compare(Collection const & syms_, symbol_compare const & compare_)
+		: syms(syms_), compare(compare_) {}
 
+	bool operator()(size_t lhs, size_t rhs) const {
+		if (compare(syms[lhs], syms[rhs]))
+			return true;
+		if (compare(syms[rhs], syms[lhs]))
+			return false;
+		return lhs < rhs;
+	}
 
-void sort_options::
-sort(symbol_collection & syms, bool reverse_sort, bool lf) const
+private:
+	Collection const & syms;
+	symbol_compare const & compare;
+};
+
+
+/**
+ * Sort syms as stable_sort() does, keeping only the limit first if
+ * limit is not zero. Those are selected in linear time with
+ * nth_element(), then only those are sorted.
+ */
+template <typename Collection>
+void sort_symbols(Collection & syms, symbol_compare const & compare,
+                  size_t limit)
 {
-	long_filenames = lf;
+	if (!limit || limit >= syms.size()) {
+		stable_sort(syms.begin(), syms.end(), compare);
+		return;
+	}
+
+	vector<size_t> rows(syms.size());
+	for (size_t i = 0; i < rows.size(); ++i)
+		rows[i] = i;
+
+	row_compare<Collection> const by_row(syms, compare);
+	nth_element(rows.begin(), rows.begin() + limit, rows.end(), by_row);
+	sort(rows.begin(), rows.begin() + limit, by_row);
 
-	vector<sort_order> sort_option(options);
-	for (sort_order cur = first; cur != last; cur = sort_order(cur + 1)) {
+	Collection selected;
+	selected.reserve(limit);
+	for (size_t i = 0; i < limit; ++i)
+		selected.push_back(syms[rows[i]]);
+	syms.swap(selected);
+}
+
+
+/// the given criteria then the remaining ones in sort_order order
+vector<sort_options::sort_order> const
+complete_order(vector<sort_options::sort_order> const & options)
+{
+	vector<sort_options::sort_order> sort_option(options);
+	for (sort_options::sort_order cur = sort_options::first;
+	     cur != sort_options::last;
+	     cur = sort_options::sort_order(cur + 1)) {
 		if (find(sort_option.begin(), sort_option.end(), cur) ==
 		    sort_option.end())
 			sort_option.push_back(cur);
 	}
-
-	stable_sort(syms.begin(), syms.end(),
-	            symbol_compare(sort_option, reverse_sort));
+	return sort_option;
 }
 
+} // anonymous namespace
+
 
-void sort_options::
-sort(diff_collection & syms, bool reverse_sort, bool lf) const
+void sort_options::sort(symbol_collection & syms, bool reverse_sort,
+                        bool lf, size_t limit,
+                        count_matrix const * counts) const
 {
 	long_filenames = lf;
+	sample_counts = counts;
 
-	vector<sort_order> sort_option(options);
-	for (sort_order cur = first; cur != last; cur = sort_order(cur + 1)) {
-		if (find(sort_option.begin(), sort_option.end(), cur) ==
-		    sort_option.end())
-			sort_option.push_back(cur);
-	}
+	vector<sort_order> const sort_option = complete_order(options);
+	sort_symbols(syms, symbol_compare(sort_option, reverse_sort), limit);
+}
+
+
+void sort_options::sort(diff_collection & syms, bool reverse_sort,
+                        bool lf, size_t limit) const
+{
+	long_filenames = lf;
+	sample_counts = 0;
 
-	stable_sort(syms.begin(), syms.end(),
-	            symbol_compare(sort_option, reverse_sort));
+	vector<sort_order> const sort_option = complete_order(options);
+	sort_symbols(syms, symbol_compare(sort_option, reverse_sort), limit);
 }
 
 
@@ -13,6 +13,7 @@
 #define SYMBOL_SORT_H
 
 #include "symbol.h"
+#include "count_matrix.h"
 
 #include <vector>
 #include <string>
@@ -36,16 +37,21 @@ struct sort_options {
 	void add_sort_option(sort_order order);
 
 	/**
-	 * Sort the given container by the given criteria.
+	 * Sort the given container by the given criteria. If limit is not
+	 * zero, only the limit first symbols are kept, and only those are
+	 * sorted. If counts is not null, the samples count of the symbols
+	 * are read from its rows, see profile_container::sample_counts().
 	 */
 	void sort(symbol_collection & syms, bool reverse_sort,
-	          bool long_filenames) const;
+	          bool long_filenames, size_t limit = 0,
+	          count_matrix const * counts = 0) const;
 
 	/**
-	 * Sort the given container by the given criteria.
+	 * Sort the given container by the given criteria. If limit is not
+	 * zero, only the limit first symbols are kept.
 	 */
 	void sort(diff_collection & syms, bool reverse_sort,
-	          bool long_filenames) const;
+	          bool long_filenames, size_t limit = 0) const;
 
 	std::vector<sort_order> options;
 };
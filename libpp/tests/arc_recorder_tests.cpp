@@ -0,0 +1,380 @@
+/**
+ * @file arc_recorder_tests.cpp
+ * tests arc_recorder against the std::map based recorder it replaced
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arrange_profiles.h"
+#include "callgraph_container.h"
+#include "name_storage.h"
+#include "demangle_symbol.h"
+#include "string_manip.h"
+#include "symbol.h"
+#include "symbol_functors.h"
+#include "op_types.h"
+
+using namespace std;
+
+// the globals of the pp tools libpp depends on
+profile_classes classes;
+namespace options {
+	demangle_type demangle = dmt_none;
+}
+
+namespace {
+
+size_t const nr_symbols = 300;
+size_t const nr_files = 40;
+size_t const nr_arcs_per_file = 500;
+size_t const nr_recorders = 4;
+size_t const nr_classes = 2;
+
+double const thresholds[] = { 0, 0.001, 0.01 };
+
+
+/// one arc of a sample file
+struct file_arc {
+	size_t caller;
+	size_t callee;
+	count_type count;
+};
+
+/// a cg file: its arcs, sorted by caller as read_arcs() gives them
+struct sample_file {
+	size_t pclass;
+	vector<file_arc> arcs;
+};
+
+
+bool operator<(file_arc const & lhs, file_arc const & rhs)
+{
+	return lhs.caller < rhs.caller;
+}
+
+
+/**
+ * The recorder used before arc_recorder, the arcs of each symbol kept in
+ * std::map ordered by less_symbol.
+ */
+class map_recorder {
+public:
+	void add(symbol_entry const & caller, symbol_entry const * callee,
+	         count_array_t const & arc_count) {
+		cg_data & data = sym_map[caller];
+		if (callee) {
+			data.callees[*callee] += arc_count;
+			cg_data & callee_data = sym_map[*callee];
+			callee_data.callers[caller] += arc_count;
+		}
+	}
+
+	void process(count_array_t total, double threshold,
+	             vector<cg_symbol> & cg_syms) const;
+
+private:
+	struct cg_data {
+		typedef map<symbol_entry, count_array_t, less_symbol> children;
+		children callers;
+		children callees;
+	};
+
+	typedef map<symbol_entry, cg_data, less_symbol> map_t;
+
+	map_t sym_map;
+};
+
+
+bool compare_arc_count(symbol_entry const & lhs, symbol_entry const & rhs)
+{
+	return lhs.sample.counts[0] < rhs.sample.counts[0];
+}
+
+
+bool compare_arc_count_reverse(symbol_entry const & lhs,
+                               symbol_entry const & rhs)
+{
+	return rhs.sample.counts[0] < lhs.sample.counts[0];
+}
+
+
+void process_children(cg_symbol & sym, double threshold)
+{
+	symbol_entry self = sym;
+
+	self.name = symbol_names.create(symbol_names.demangle(self.name)
+	                                + " [self]");
+
+	sym.total_callee_count += self.sample.counts;
+	sym.callees.push_back(self);
+
+	sort(sym.callers.begin(), sym.callers.end(), compare_arc_count);
+	sort(sym.callees.begin(), sym.callees.end(), compare_arc_count_reverse);
+
+	cg_symbol::children::iterator cit = sym.callers.begin();
+	cg_symbol::children::iterator cend = sym.callers.end();
+
+	while (cit != cend && op_ratio(cit->sample.counts[0],
+	       sym.total_caller_count[0]) < threshold)
+		++cit;
+
+	if (cit != cend)
+		sym.callers.erase(sym.callers.begin(), cit);
+
+	cit = sym.callees.begin();
+	cend = sym.callees.end();
+
+	while (cit != cend && op_ratio(cit->sample.counts[0],
+	       sym.total_callee_count[0]) >= threshold)
+		++cit;
+
+	if (cit != cend)
+		sym.callees.erase(cit, sym.callees.end());
+}
+
+
+void map_recorder::process(count_array_t total, double threshold,
+                           vector<cg_symbol> & cg_syms) const
+{
+	map_t::const_iterator it;
+	for (it = sym_map.begin(); it != sym_map.end(); ++it) {
+		cg_symbol sym(it->first);
+		cg_data const & data = it->second;
+
+		if (op_ratio(sym.sample.counts[0], total[0]) < threshold)
+			continue;
+
+		cg_data::children::const_iterator cit;
+		for (cit = data.callers.begin(); cit != data.callers.end(); ++cit) {
+			symbol_entry csym = cit->first;
+			csym.sample.counts = cit->second;
+			sym.callers.push_back(csym);
+			sym.total_caller_count += cit->second;
+		}
+
+		for (cit = data.callees.begin(); cit != data.callees.end(); ++cit) {
+			symbol_entry csym = cit->first;
+			csym.sample.counts = cit->second;
+			sym.callees.push_back(csym);
+			sym.total_callee_count += cit->second;
+		}
+
+		process_children(sym, threshold);
+		cg_syms.push_back(sym);
+	}
+}
+
+
+/**
+ * The symbols as profile_container gives them, with their sample counts,
+ * and as make_symbol() gives them in the arcs. Few names, images and vmas
+ * so that the less_symbol order depends on all its fields.
+ */
+void create_symbols(vector<symbol_entry> & main_syms,
+                    vector<symbol_entry> & arc_syms, count_array_t & total)
+{
+	main_syms.resize(nr_symbols);
+	arc_syms.resize(nr_symbols);
+	for (size_t i = 0; i < nr_symbols; ++i) {
+		symbol_entry & sym = arc_syms[i];
+		sym.name = symbol_names.create("function_" +
+			op_lexical_cast<string>(i % 37));
+		sym.image_name = image_names.create("/nonexistent/lib" +
+			op_lexical_cast<string>(i % 3) + ".so");
+		sym.app_name = image_names.create("/nonexistent/app" +
+			op_lexical_cast<string>(i % 2));
+		sym.sample.vma = (i % 5) * 0x100;
+		sym.size = i;
+		sym.sample.counts[0] = i % 11;
+
+		main_syms[i] = sym;
+		for (size_t j = 0; j < nr_classes; ++j) {
+			main_syms[i].sample.counts[j] = (i * 7 + j) % 53;
+			total[j] += main_syms[i].sample.counts[j];
+		}
+	}
+}
+
+
+/**
+ * Many files with the same arcs: the callers and callees are drawn from
+ * a small set of hot symbols half of the time.
+ */
+void create_files(vector<sample_file> & files)
+{
+	unsigned long seed = 1;
+	files.resize(nr_files);
+	for (size_t i = 0; i < nr_files; ++i) {
+		sample_file & file = files[i];
+		file.pclass = i % nr_classes;
+		for (size_t j = 0; j < nr_arcs_per_file; ++j) {
+			seed = seed * 1103515245UL + 12345;
+			size_t const range = (seed >> 16) % 2 ? 20 : nr_symbols;
+			file_arc arc;
+			arc.caller = (seed >> 8) % range;
+			seed = seed * 1103515245UL + 12345;
+			arc.callee = (seed >> 8) % range;
+			arc.count = (seed >> 20) % 100 + 1;
+			file.arcs.push_back(arc);
+		}
+		stable_sort(file.arcs.begin(), file.arcs.end());
+	}
+}
+
+
+/**
+ * Record the files in nr_recorders recorders, file i going to recorder
+ * (i + shift) % nr_recorders, then merge them in order or in reverse
+ * order into a recorder holding the symbols, as
+ * callgraph_container::populate() does.
+ */
+void record(arc_recorder & recorder, vector<symbol_entry> const & main_syms,
+            vector<symbol_entry> const & arc_syms,
+            vector<sample_file> const & files, size_t shift, bool reverse)
+{
+	// some symbols are only met in arcs
+	for (size_t i = 0; i < main_syms.size(); ++i) {
+		if (i % 10)
+			recorder.add(main_syms[i], 0, 0, 0);
+	}
+
+	vector<arc_recorder> recorders(nr_recorders);
+	for (size_t i = 0; i < files.size(); ++i) {
+		arc_recorder & rec = recorders[(i + shift) % nr_recorders];
+		vector<file_arc> const & arcs = files[i].arcs;
+		for (size_t j = 0; j < arcs.size(); ++j) {
+			rec.add(arc_syms[arcs[j].caller], &arc_syms[arcs[j].callee],
+			        files[i].pclass, arcs[j].count);
+		}
+	}
+
+	for (size_t i = 0; i < nr_recorders; ++i)
+		recorder.merge(recorders[reverse ? nr_recorders - 1 - i : i]);
+}
+
+
+void record_map(map_recorder & recorder,
+                vector<symbol_entry> const & main_syms,
+                vector<symbol_entry> const & arc_syms,
+                vector<sample_file> const & files)
+{
+	for (size_t i = 0; i < main_syms.size(); ++i) {
+		if (i % 10)
+			recorder.add(main_syms[i], 0, count_array_t());
+	}
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		vector<file_arc> const & arcs = files[i].arcs;
+		for (size_t j = 0; j < arcs.size(); ++j) {
+			count_array_t count;
+			count[files[i].pclass] = arcs[j].count;
+			recorder.add(arc_syms[arcs[j].caller],
+			             &arc_syms[arcs[j].callee], count);
+		}
+	}
+}
+
+
+bool same_counts(count_array_t const & lhs, count_array_t const & rhs)
+{
+	size_t const size = max(lhs.size(), rhs.size());
+	for (size_t i = 0; i < size; ++i) {
+		if (lhs[i] != rhs[i])
+			return false;
+	}
+	return true;
+}
+
+
+bool same_symbol(symbol_entry const & lhs, symbol_entry const & rhs)
+{
+	less_symbol less;
+	return !less(lhs, rhs) && !less(rhs, lhs) && lhs.name == rhs.name &&
+		same_counts(lhs.sample.counts, rhs.sample.counts);
+}
+
+
+bool same_children(cg_symbol::children const & lhs,
+                   cg_symbol::children const & rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+	for (size_t i = 0; i < lhs.size(); ++i) {
+		if (!same_symbol(lhs[i], rhs[i]))
+			return false;
+	}
+	return true;
+}
+
+
+int check(symbol_collection const & syms, vector<cg_symbol> const & expect,
+          char const * what)
+{
+	if (syms.size() != expect.size()) {
+		cerr << what << ": " << syms.size() << " symbols, expected "
+		     << expect.size() << endl;
+		return 1;
+	}
+
+	for (size_t i = 0; i < syms.size(); ++i) {
+		cg_symbol const & sym = static_cast<cg_symbol const &>(*syms[i]);
+		cg_symbol const & exp = expect[i];
+		if (!same_symbol(sym, exp) ||
+		    !same_counts(sym.total_caller_count, exp.total_caller_count) ||
+		    !same_counts(sym.total_callee_count, exp.total_callee_count) ||
+		    !same_children(sym.callers, exp.callers) ||
+		    !same_children(sym.callees, exp.callees)) {
+			cerr << what << ": symbol " << i << " "
+			     << symbol_names.name(sym.name) << " differs" << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	vector<symbol_entry> main_syms;
+	vector<symbol_entry> arc_syms;
+	count_array_t total;
+	create_symbols(main_syms, arc_syms, total);
+
+	vector<sample_file> files;
+	create_files(files);
+
+	map_recorder reference;
+	record_map(reference, main_syms, arc_syms, files);
+
+	string_filter const no_filter;
+	int errors = 0;
+	for (size_t i = 0; i < sizeof(thresholds) / sizeof(thresholds[0]); ++i) {
+		vector<cg_symbol> expect;
+		reference.process(total, thresholds[i], expect);
+
+		for (size_t shift = 0; shift < 2; ++shift) {
+			arc_recorder recorder;
+			record(recorder, main_syms, arc_syms, files, shift, shift);
+			recorder.process(total, thresholds[i], no_filter);
+			string const what = "threshold " +
+				op_lexical_cast<string>(thresholds[i]) +
+				(shift ? ", reverse merge" : "");
+			errors += check(recorder.get_symbols(), expect,
+			                what.c_str());
+		}
+	}
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file arrange_profiles_bench.cpp
+ * time parse_filename(), arrange_profiles() and invert_profiles() over a
+ * synthetic session tree
+ *
+ * usage: arrange_profiles_bench dir [nr_files]
+ *
+ * The sample files of nr_files (default 200000) profiles of a --separate=all
+ * session are created in dir if they do not exist yet, they contain only
+ * a timer interrupt sample file header.
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+
+#include "op_config.h"
+#include "op_cpu_type.h"
+#include "op_file.h"
+#include "op_sample_file.h"
+#include "op_exception.h"
+#include "arrange_profiles.h"
+#include "parse_filename.h"
+#include "locate_images.h"
+#include "string_manip.h"
+#include "demangle_symbol.h"
+
+using namespace std;
+
+// the globals of the pp tools libpp depends on
+profile_classes classes;
+namespace options {
+	demangle_type demangle = dmt_none;
+}
+
+namespace {
+
+size_t const nr_apps = 100;
+size_t const nr_libs = 20;
+size_t const nr_cpus = 4;
+
+
+string num(size_t n)
+{
+	return op_lexical_cast<string>(n);
+}
+
+
+double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+void create_sample_file(string const & filename)
+{
+	if (op_file_readable(filename.c_str()))
+		return;
+
+	if (create_path(filename.c_str())) {
+		cerr << "can't create the path of " << filename << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	opd_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, OPD_MAGIC, sizeof(header.magic));
+	header.version = OPD_VERSION;
+	header.cpu_type = CPU_TIMER_INT;
+
+	int fd = open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+	if (fd < 0 || write(fd, &header, sizeof(header)) != sizeof(header)) {
+		cerr << "can't write " << filename << endl;
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+}
+
+
+/// an application, each of its threads has samples for the application
+/// and its libraries on each cpu, plus a call graph file for its first
+/// library
+list<string> create_session(string const & dir, size_t nr_files)
+{
+	size_t nr_threads = nr_files / (nr_apps * nr_libs * nr_cpus);
+	if (!nr_threads)
+		nr_threads = 1;
+
+	list<string> files;
+	for (size_t app = 0; app < nr_apps; ++app) {
+		string const image = "/usr/bin/app" + num(app);
+		for (size_t lib = 0; lib < nr_libs; ++lib) {
+			string const lib_image = lib
+				? "/usr/lib/lib" + num(lib) + ".so" : image;
+			string const base = dir + "/{root}" + image +
+				"/{dep}/{root}" + lib_image + "/";
+			for (size_t thread = 0; thread < nr_threads; ++thread) {
+				string const tgid =
+					num(app * nr_threads + thread + 1);
+				for (size_t cpu = 0; cpu < nr_cpus; ++cpu) {
+					string const spec = "TIMER.0.0." + tgid +
+						"." + tgid + "." + num(cpu);
+					files.push_back(base + spec);
+					if (lib == 1) {
+						files.push_back(base + "{cg}/{root}"
+						        + image + "/" + spec);
+					}
+				}
+			}
+		}
+	}
+
+	list<string>::const_iterator it;
+	for (it = files.begin(); it != files.end(); ++it)
+		create_sample_file(*it);
+
+	return files;
+}
+
+
+void run(list<string> const & files, char const * merge_name,
+         merge_option const & merge_by, extra_images const & extra)
+{
+	double start = now();
+	profile_classes const classes =
+		arrange_profiles(files, merge_by, extra);
+	double const arrange_time = now() - start;
+
+	start = now();
+	list<inverted_profile> const iprofiles = invert_profiles(classes);
+	double const invert_time = now() - start;
+
+	cout << "--merge=" << merge_name << ": " << classes.v.size()
+	     << " classes, " << iprofiles.size() << " images, "
+	     << "arrange_profiles() " << arrange_time << "s, "
+	     << "invert_profiles() " << invert_time << "s" << endl;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char const * argv[])
+{
+	if (argc < 2) {
+		cerr << "usage: arrange_profiles_bench dir [nr_files]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t const nr_files = argc > 2 ? atoi(argv[2]) : 200000;
+
+	try {
+		double start = now();
+		list<string> const files = create_session(argv[1], nr_files);
+		cout << files.size() << " sample files ready in "
+		     << now() - start << "s" << endl;
+
+		extra_images extra;
+
+		start = now();
+		list<string>::const_iterator it;
+		for (it = files.begin(); it != files.end(); ++it)
+			parse_filename(*it, extra);
+		cout << "parse_filename() " << now() - start << "s" << endl;
+
+		merge_option const merge_cpu = { true, false, false, false, false };
+		run(files, "cpu", merge_cpu, extra);
+
+		merge_option const merge_all = { true, true, true, true, true };
+		run(files, "all", merge_all, extra);
+	} catch (op_exception const & e) {
+		cerr << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file columnar_format_tests.cpp
+ * tests the columnar_formatter output against columnar_format.h
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "arrange_profiles.h"
+#include "columnar_format.h"
+#include "format_output.h"
+#include "locate_images.h"
+#include "name_storage.h"
+#include "demangle_symbol.h"
+#include "symbol.h"
+
+using namespace std;
+
+// the globals of the pp tools libpp depends on
+profile_classes classes;
+namespace options {
+	demangle_type demangle = dmt_none;
+}
+
+struct symbol_data {
+	char const * name;
+	char const * image;
+	bfd_vma vma;
+	size_t size;
+	count_type counts[2];
+};
+
+static symbol_data const symbols_data[] = {
+	{ "main", "/nonexistent/bin/ls", 0x400000, 0x40, { 10, 0 } },
+	{ "memcpy", "/nonexistent/lib/libc.so", 0x7f0010, 0x100, { 3, 7 } },
+	{ "strlen", "/nonexistent/lib/libc.so", 0x7f0200, 0x20, { 0, 5 } },
+	{ "main", "/nonexistent/bin/true", 0x400100, 0x10, { 1, 1 } },
+};
+
+static size_t const nr_symbols =
+	sizeof(symbols_data) / sizeof(symbols_data[0]);
+static size_t const nr_classes = 2;
+
+
+static string report;
+
+
+static void fail(string const & what)
+{
+	cerr << "columnar report: " << what << endl;
+	exit(EXIT_FAILURE);
+}
+
+
+static columnar::column_entry const & find_column(u32 id)
+{
+	columnar::header const * header =
+		reinterpret_cast<columnar::header const *>(report.data());
+	columnar::column_entry const * entries =
+		reinterpret_cast<columnar::column_entry const *>(header + 1);
+
+	for (size_t i = 0; i < header->nr_columns; ++i) {
+		if (entries[i].id == id)
+			return entries[i];
+	}
+	fail("missing column");
+	return entries[0];
+}
+
+
+template <typename T>
+static T const * column(u32 id, size_t nr_elements)
+{
+	columnar::column_entry const & entry = find_column(id);
+	if (entry.width != sizeof(T) ||
+	    entry.size != nr_elements * sizeof(T))
+		fail("bad column size");
+	if (entry.offset % 8 || entry.offset + entry.size > report.size())
+		fail("bad column offset");
+	return reinterpret_cast<T const *>(report.data() + entry.offset);
+}
+
+
+static string get_string(u32 offset)
+{
+	columnar::column_entry const & entry = find_column(columnar::strings);
+	if (offset >= entry.size)
+		fail("bad string offset");
+	return report.data() + entry.offset + offset;
+}
+
+
+static void check_report()
+{
+	if (report.size() < sizeof(columnar::header))
+		fail("truncated");
+
+	columnar::header const * header =
+		reinterpret_cast<columnar::header const *>(report.data());
+	if (memcmp(header->magic, columnar::magic, sizeof(header->magic)) ||
+	    header->version != columnar::version ||
+	    header->byte_order != columnar::byte_order_mark)
+		fail("bad header");
+	if (header->nr_classes != nr_classes ||
+	    header->nr_symbols != nr_symbols || header->nr_samples != 0)
+		fail("bad header counts");
+
+	u32 const * class_names = column<u32>(columnar::class_name, nr_classes);
+	if (get_string(class_names[0]) != "cpu:0" ||
+	    get_string(class_names[1]) != "cpu:1")
+		fail("bad class names");
+
+	u32 const * names = column<u32>(columnar::sym_name, nr_symbols);
+	u32 const * images = column<u32>(columnar::sym_image, nr_symbols);
+	u64 const * vmas = column<u64>(columnar::sym_vma, nr_symbols);
+	u64 const * sizes = column<u64>(columnar::sym_size, nr_symbols);
+	u64 const * counts = column<u64>(columnar::sym_counts,
+	                                 nr_classes * nr_symbols);
+	u64 const * first = column<u64>(columnar::sym_first_sample,
+	                                nr_symbols + 1);
+	u64 const * totals = column<u64>(columnar::class_total, nr_classes);
+
+	for (size_t i = 0; i < nr_symbols; ++i) {
+		symbol_data const & data = symbols_data[i];
+		if (get_string(names[i]) != data.name ||
+		    get_string(images[i]) != data.image)
+			fail(string("bad names of ") + data.name);
+		if (vmas[i] != data.vma || sizes[i] != data.size)
+			fail(string("bad vma or size of ") + data.name);
+		for (size_t p = 0; p < nr_classes; ++p) {
+			if (counts[p * nr_symbols + i] != data.counts[p])
+				fail(string("bad counts of ") + data.name);
+		}
+		if (first[i] != 0)
+			fail("samples without --details");
+	}
+
+	// the same name is stored once
+	if (names[0] != names[3])
+		fail("duplicate strings");
+
+	if (totals[0] != 14 || totals[1] != 13)
+		fail("bad class totals");
+
+	column<u64>(columnar::sample_vma, 0);
+	column<u64>(columnar::sample_counts, 0);
+}
+
+
+int main()
+{
+	profile_class pclass;
+	pclass.name = "cpu:0";
+	pclass.longname = "Samples on CPU 0";
+	classes.v.push_back(pclass);
+	pclass.name = "cpu:1";
+	pclass.longname = "Samples on CPU 1";
+	classes.v.push_back(pclass);
+
+	vector<symbol_entry> entries(nr_symbols);
+	symbol_collection symbols;
+	for (size_t i = 0; i < nr_symbols; ++i) {
+		symbol_data const & data = symbols_data[i];
+		symbol_entry & sym = entries[i];
+		sym.name = symbol_names.create(string(data.name));
+		sym.image_name = image_names.create(string(data.image));
+		sym.app_name = sym.image_name;
+		sym.sample.vma = data.vma;
+		sym.size = data.size;
+		for (size_t p = 0; p < nr_classes; ++p) {
+			if (data.counts[p])
+				sym.sample.counts[p] = data.counts[p];
+		}
+		symbols.push_back(&sym);
+	}
+
+	count_array_t total;
+	for (size_t i = 0; i < nr_symbols; ++i)
+		total += symbols[i]->sample.counts;
+
+	extra_images extra;
+	format_output::columnar_formatter formatter(total, extra);
+	formatter.set_nr_classes(nr_classes);
+
+	ostringstream out;
+	formatter.output(out, symbols);
+	report = out.str();
+
+	check_report();
+
+	return EXIT_SUCCESS;
+}
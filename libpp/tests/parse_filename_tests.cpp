@@ -0,0 +1,140 @@
+/**
+ * @file parse_filename_tests.cpp
+ * tests parse_filename.h
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "parse_filename.h"
+#include "locate_images.h"
+
+using namespace std;
+
+struct parse_result {
+	char const * filename;
+	char const * image;
+	char const * lib_image;
+	char const * cg_image;
+	char const * event;
+	char const * count;
+	char const * unitmask;
+	char const * tgid;
+	char const * tid;
+	char const * cpu;
+};
+
+
+static parse_result const expect_parse[] = {
+	{ "/var/lib/oprofile/samples/current/{root}/bin/ls/{dep}/{root}/bin/ls/CPU_CLK_UNHALTED.100000.0.all.all.all",
+	  "/bin/ls", "/bin/ls", "",
+	  "CPU_CLK_UNHALTED", "100000", "0", "all", "all", "all" },
+	{ "/s/{kern}/vmlinux/{dep}/{kern}/vmlinux/TIMER.0.0.1.2.3",
+	  "/vmlinux", "/vmlinux", "",
+	  "TIMER", "0", "0", "1", "2", "3" },
+	{ "/s/{root}/usr/bin/bash/{dep}/{root}/lib/libc-2.3.so/EV.10.0x1.12.13.1",
+	  "/usr/bin/bash", "/lib/libc-2.3.so", "",
+	  "EV", "10", "0x1", "12", "13", "1" },
+	{ "/s/{root}/bin/bash/{dep}/{kern}/ext3/EV.10.0.1.1.0",
+	  "/bin/bash", "/ext3", "",
+	  "EV", "10", "0", "1", "1", "0" },
+	{ "/s/{root}/bin/bash/{dep}/{root}/bin/bash/{cg}/{root}/lib/libc.so/EV.10.0.1.1.0",
+	  "/bin/bash", "/bin/bash", "/lib/libc.so",
+	  "EV", "10", "0", "1", "1", "0" },
+	{ "/s/{root}/bin/bash/{dep}/{root}/bin/bash/{cg}/{kern}/vmlinux/EV.10.0.1.1.0",
+	  "/bin/bash", "/bin/bash", "/vmlinux",
+	  "EV", "10", "0", "1", "1", "0" },
+	{ "/s/{root}/bin/java/{dep}/{anon:anon}/1234.0x1000.0x2000/EV.10.0.1.1.0",
+	  "/bin/java", "anon (tgid:1234 range:0x1000-0x2000)", "",
+	  "EV", "10", "0", "1", "1", "0" },
+	{ "/s/{root}/bin/ls/{dep}/{root}/bin/ls/{cg}/{anon:[vdso]}/12.0x1.0x2/EV.10.0.1.1.0",
+	  "/bin/ls", "/bin/ls", "[vdso] (tgid:12 range:0x1-0x2)",
+	  "EV", "10", "0", "1", "1", "0" },
+	// path components may contain spaces
+	{ "/home/s/{root}/a b/c/{dep}/{root}/a b/c/EV.1.2.3.4.5",
+	  "/a b/c", "/a b/c", "",
+	  "EV", "1", "2", "3", "4", "5" },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+};
+
+
+static char const * const expect_invalid[] = {
+	"EV.10.0.1.1.0",
+	"/s/{root}/bin/ls/{dep}/{root}/bin/ls/EV.10.0.1.1",
+	"/s/{root}/bin/ls/{dep}/{root}/bin/ls/EV.10.0.1.1.0.0",
+	"/s/{root}/bin/ls/{dep}/{root}/bin/ls/EV..0.1.1.0",
+	"/s/bin/ls/{dep}/{root}/bin/ls/EV.10.0.1.1.0",
+	"/s/{root}/bin/ls/{root}/bin/ls/EV.10.0.1.1.0",
+	"/s/{root}/bin/ls/{dep}/bin/ls/EV.10.0.1.1.0",
+	"/s/{root}/bin/ls/{dep}/{root}/bin/ls/{cg}/EV.10.0.1.1.0",
+	"/s/{root}/bin/ls/{dep}/{root}/bin/ls/{cg}/bin/EV.10.0.1.1.0",
+	"/s/{root}/bin/java/{dep}/{anon:anon}/1.0x1/EV.10.0.1.1.0",
+	0
+};
+
+
+static void check(char const * filename, char const * field,
+                  string const & result, char const * expect)
+{
+	if (result != expect) {
+		cerr << "parse_filename(\"" << filename << "\")." << field
+		     << ": expect \"" << expect << "\" found \"" << result
+		     << "\"\n";
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+static void parse_tests()
+{
+	extra_images extra;
+
+	for (parse_result const * cur = expect_parse; cur->filename; ++cur) {
+		parsed_filename const result =
+			parse_filename(cur->filename, extra);
+		check(cur->filename, "filename", result.filename,
+		      cur->filename);
+		check(cur->filename, "image", result.image, cur->image);
+		check(cur->filename, "lib_image", result.lib_image,
+		      cur->lib_image);
+		check(cur->filename, "cg_image", result.cg_image,
+		      cur->cg_image);
+		check(cur->filename, "event", result.event, cur->event);
+		check(cur->filename, "count", result.count, cur->count);
+		check(cur->filename, "unitmask", result.unitmask,
+		      cur->unitmask);
+		check(cur->filename, "tgid", result.tgid, cur->tgid);
+		check(cur->filename, "tid", result.tid, cur->tid);
+		check(cur->filename, "cpu", result.cpu, cur->cpu);
+	}
+}
+
+
+static void invalid_tests()
+{
+	extra_images extra;
+
+	for (char const * const * cur = expect_invalid; *cur; ++cur) {
+		try {
+			parse_filename(*cur, extra);
+		} catch (invalid_argument const &) {
+			continue;
+		}
+		cerr << "parse_filename(\"" << *cur << "\") doesn't throw\n";
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+int main()
+{
+	parse_tests();
+	invalid_tests();
+	return EXIT_SUCCESS;
+}
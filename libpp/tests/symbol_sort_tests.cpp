@@ -0,0 +1,114 @@
+/**
+ * @file symbol_sort_tests.cpp
+ * tests sort_options::sort() with a limit against the full sort
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "arrange_profiles.h"
+#include "name_storage.h"
+#include "demangle_symbol.h"
+#include "string_manip.h"
+#include "symbol.h"
+#include "symbol_sort.h"
+
+using namespace std;
+
+// the globals of the pp tools libpp depends on
+profile_classes classes;
+namespace options {
+	demangle_type demangle = dmt_none;
+}
+
+static size_t const nr_symbols = 1000;
+
+static size_t const limits[] = { 1, 2, 10, 333, 999, 1000, 5000 };
+
+
+/// few distinct names, images, vmas and counts so that there are many
+/// ties, the size identifies the symbol
+static void create_symbols(vector<symbol_entry> & symbols)
+{
+	symbols.resize(nr_symbols);
+	for (size_t i = 0; i < nr_symbols; ++i) {
+		symbol_entry & sym = symbols[i];
+		sym.name = symbol_names.create("function_" +
+			op_lexical_cast<string>(i % 7));
+		sym.image_name = image_names.create("/nonexistent/lib" +
+			op_lexical_cast<string>(i % 5) + ".so");
+		sym.app_name = sym.image_name;
+		sym.sample.vma = i % 2;
+		sym.sample.counts[0] = i % 3;
+		sym.size = i;
+	}
+}
+
+
+static void check(string const & sort_spec, bool reverse)
+{
+	sort_options sort_by;
+	vector<string> const orders = separate_token(sort_spec, ',');
+	for (size_t i = 0; i < orders.size(); ++i)
+		sort_by.add_sort_option(orders[i]);
+
+	vector<symbol_entry> entries;
+	create_symbols(entries);
+
+	symbol_collection all;
+	diff_collection all_diffs;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		all.push_back(&entries[i]);
+		all_diffs.push_back(diff_symbol(entries[i]));
+	}
+
+	symbol_collection sorted(all);
+	sort_by.sort(sorted, reverse, false);
+	diff_collection sorted_diffs(all_diffs);
+	sort_by.sort(sorted_diffs, reverse, false);
+
+	for (size_t i = 0; i < sizeof(limits) / sizeof(limits[0]); ++i) {
+		size_t const limit = limits[i];
+		size_t const expected = min(limit, nr_symbols);
+
+		symbol_collection first(all);
+		sort_by.sort(first, reverse, false, limit);
+		diff_collection first_diffs(all_diffs);
+		sort_by.sort(first_diffs, reverse, false, limit);
+
+		if (first.size() != expected ||
+		    first_diffs.size() != expected) {
+			cerr << "sort " << sort_spec << " limit " << limit
+			     << ": " << first.size() << " symbols" << endl;
+			exit(EXIT_FAILURE);
+		}
+
+		for (size_t j = 0; j < expected; ++j) {
+			if (first[j] != sorted[j] ||
+			    first_diffs[j].size != sorted_diffs[j].size) {
+				cerr << "sort " << sort_spec << " limit "
+				     << limit << ": symbol " << j
+				     << " differs" << endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+}
+
+
+int main()
+{
+	check("sample", false);
+	check("sample", true);
+	check("symbol", false);
+	check("image,sample", true);
+	check("vma", false);
+
+	return EXIT_SUCCESS;
+}
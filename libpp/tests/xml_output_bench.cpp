@@ -0,0 +1,199 @@
+/**
+ * @file xml_output_bench.cpp
+ * time the opreport --xml output of a synthetic profile
+ *
+ * usage: xml_output_bench [nr_symbols] [output]
+ *
+ * nr_symbols (default 200000) symbols spread over the applications and
+ * libraries of a --separate=thread,cpu profile are written as opreport
+ * --xml writes them, to the output file if any else they are counted and
+ * discarded.
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "arrange_profiles.h"
+#include "format_output.h"
+#include "locate_images.h"
+#include "name_storage.h"
+#include "string_filter.h"
+#include "string_manip.h"
+#include "demangle_symbol.h"
+#include "symbol.h"
+#include "xml_utils.h"
+
+using namespace std;
+
+// the globals of the pp tools libpp depends on
+profile_classes classes;
+namespace options {
+	demangle_type demangle = dmt_none;
+}
+
+namespace {
+
+size_t const nr_apps = 20;
+size_t const nr_libs = 10;
+size_t const nr_threads = 2;
+size_t const nr_cpus = 2;
+
+
+string num(size_t n)
+{
+	return op_lexical_cast<string>(n);
+}
+
+
+/// count the characters written and drop them
+class null_buf : public streambuf {
+public:
+	null_buf() : count(0) {}
+
+	size_t count;
+
+protected:
+	int_type overflow(int_type c) {
+		++count;
+		return traits_type::not_eof(c);
+	}
+
+	streamsize xsputn(char const *, streamsize n) {
+		count += n;
+		return n;
+	}
+};
+
+
+double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+/// one class per application thread and cpu, as --separate=thread,cpu
+void create_classes()
+{
+	for (size_t app = 0; app < nr_apps; ++app) {
+		for (size_t thread = 0; thread < nr_threads; ++thread) {
+			for (size_t cpu = 0; cpu < nr_cpus; ++cpu) {
+				profile_class pclass;
+				pclass.ptemplate.event = "0";
+				pclass.ptemplate.count = "100000";
+				pclass.ptemplate.unitmask = "0";
+				pclass.ptemplate.tgid = num(app + 1);
+				pclass.ptemplate.tid =
+					num(app * nr_threads + thread + 1);
+				pclass.ptemplate.cpu = num(cpu);
+				classes.v.push_back(pclass);
+			}
+		}
+	}
+}
+
+
+bool less_image(symbol_entry const & lhs, symbol_entry const & rhs)
+{
+	if (lhs.app_name != rhs.app_name)
+		return lhs.app_name < rhs.app_name;
+	return lhs.image_name < rhs.image_name;
+}
+
+
+/// the symbols of an application and its libraries have samples in
+/// the classes of this application
+void create_symbols(vector<symbol_entry> & symbols, size_t nr_symbols)
+{
+	size_t const app_classes = nr_threads * nr_cpus;
+
+	symbols.resize(nr_symbols);
+	for (size_t i = 0; i < nr_symbols; ++i) {
+		size_t const app = i % nr_apps;
+		size_t const lib = (i / nr_apps) % nr_libs;
+		string const app_name = "/usr/bin/app" + num(app);
+
+		symbol_entry & sym = symbols[i];
+		sym.app_name = image_names.create(app_name);
+		sym.image_name = lib ? image_names.create("/usr/lib/lib" +
+			num(lib) + ".so") : sym.app_name;
+		sym.name = symbol_names.create("function_" + num(i));
+		sym.sample.vma = 0x400000 + i * 0x40;
+		sym.size = 0x40;
+
+		size_t const pclass = app * app_classes + i % app_classes;
+		sym.sample.counts[pclass] = i % 97 + 1;
+		if (i % 3 == 0)
+			sym.sample.counts[pclass ^ 1] = i % 13 + 1;
+	}
+
+	stable_sort(symbols.begin(), symbols.end(), less_image);
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char const * argv[])
+{
+	size_t const nr_symbols = argc > 1 ? atoi(argv[1]) : 200000;
+
+	null_buf discard;
+	ofstream file;
+	ostream out(&discard);
+	if (argc > 2) {
+		file.open(argv[2]);
+		if (!file) {
+			cerr << "can't open " << argv[2] << endl;
+			return EXIT_FAILURE;
+		}
+		out.rdbuf(file.rdbuf());
+	}
+
+	create_classes();
+	size_t const nr_classes = classes.v.size();
+
+	vector<symbol_entry> entries;
+	create_symbols(entries, nr_symbols);
+
+	symbol_collection symbols;
+	for (size_t i = 0; i < entries.size(); ++i)
+		symbols.push_back(&entries[i]);
+
+	extra_images extra;
+	string_filter const symbol_filter;
+
+	format_output::xml_formatter xml_out(0, symbols, extra,
+		symbol_filter);
+	xml_out.set_nr_classes(nr_classes);
+	xml_out.show_long_filenames(true);
+	xml_out.add_format(format_flags(ff_vma | ff_nr_samples | ff_percent |
+	                                ff_symb_name));
+
+	xml_support = new xml_utils(&xml_out, symbols, nr_classes, extra);
+
+	double const start = now();
+	xml_out.output(out);
+	out.flush();
+
+	double const elapsed = now() - start;
+
+	cout << nr_symbols << " symbols, " << nr_classes << " classes: ";
+	if (argc > 2)
+		cout << file.tellp();
+	else
+		cout << discard.count;
+	cout << " bytes of XML in " << elapsed << "s" << endl;
+
+	return EXIT_SUCCESS;
+}
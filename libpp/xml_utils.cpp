@@ -279,7 +279,7 @@ typedef growable_vector<subclass_info_t> subclass_array_t;
 typedef growable_vector<subclass_array_t> event_subclass_t;
 typedef growable_vector<event_subclass_t> cpu_subclass_t;
 
-void xml_utils::build_subclasses(ostream & out)
+void xml_utils::build_subclasses(xml_writer & out)
 {
 	size_t subclasses = 0;
 	string subclass_name;
@@ -291,7 +291,7 @@ void xml_utils::build_subclasses(ostream & out)
 	if (nr_cpus <= 1 && nr_events <= 1 && !has_nonzero_masks)
 		return;
 
-	out << open_element(CLASSES);
+	out.open_element(CLASSES);
 	for (size_t i = 0; i < classes.v.size(); ++i) {
 		profile_class & pclass = classes.v[i];
 		size_t event = atoi(pclass.ptemplate.event.c_str());
@@ -324,20 +324,20 @@ void xml_utils::build_subclasses(ostream & out)
 			subclass_name = str.str();
 			(*sc_ptr)[new_index].unitmask = pclass.ptemplate.unitmask;
 			(*sc_ptr)[new_index].subclass_name = subclass_name;
-			out << open_element(CLASS, true);
-			out << init_attr(NAME, subclass_name);
+			out.open_element(CLASS, true);
+			out.attr(NAME, subclass_name);
 			if (nr_cpus > 1) 
-				out << init_attr(CPU_NUM, pclass.ptemplate.cpu);
+				out.attr(CPU_NUM, pclass.ptemplate.cpu);
 			if (nr_events > 1) 
-				out << init_attr(EVENT_NUM, event);
+				out.attr(EVENT_NUM, event);
 			if (has_nonzero_masks) 
-				out << init_attr(EVENT_MASK, pclass.ptemplate.unitmask);
-			out << close_element();
+				out.attr(EVENT_MASK, pclass.ptemplate.unitmask);
+			out.close_element();
 		}
 
 		pclass.name = subclass_name;
 	}
-	out << close_element(CLASSES);
+	out.close_element(CLASSES);
 	has_subclasses = true;
 }
 
@@ -370,42 +370,44 @@ get_counts_string(count_array_t const & counts, size_t begin, size_t end)
 
 
 void
-xml_utils::output_symbol_bytes(ostream & out, symbol_entry const * symb,
+xml_utils::output_symbol_bytes(xml_writer & out, symbol_entry const * symb,
 			       size_t sym_id, op_bfd const & abfd)
 {
 	size_t size = symb->size;
 	scoped_array<unsigned char> contents(new unsigned char[size]);
 	if (abfd.get_symbol_contents(symb->sym_index, contents.get())) {
 		string const name = symbol_names.name(symb->name);
-		out << open_element(BYTES, true) << init_attr(TABLE_ID, sym_id);
-		out << close_element(NONE, true);
+		out.open_element(BYTES, true);
+		out.attr(TABLE_ID, sym_id);
+		out.close_element(NONE, true);
 		for (size_t i = 0; i < size; ++i) {
 			char hex_map[] = "0123456789ABCDEF";
-			char hex[2];
+			char hex[3];
 			hex[0] = hex_map[(contents[i] >> 4) & 0xf];
 			hex[1] = hex_map[contents[i] & 0xf];
-			out << hex[0] << hex[1];
+			hex[2] = '\0';
+			out << hex;
 		}
-		out << close_element(BYTES);
+		out.close_element(BYTES);
 	}
 }
 
 
 bool
-xml_utils::output_summary_data(ostream & out, count_array_t const & summary, size_t pclass)
+xml_utils::output_summary_data(xml_writer & out, count_array_t const & summary, size_t pclass)
 {
 	size_t const count = summary[pclass];
 
 	if (count == 0)
 		return false;
 
-	out << open_element(COUNT, has_subclasses);
+	out.open_element(COUNT, has_subclasses);
 	if (has_subclasses) {
-		out << init_attr(CLASS, classes.v[pclass].name);
-		out << close_element(NONE, true);
+		out.attr(CLASS, classes.v[pclass].name);
+		out.close_element(NONE, true);
 	}
 	out << count;
-	out << close_element(COUNT);
+	out.close_element(COUNT);
 	return true;
 }
 
@@ -423,11 +425,11 @@ public:
 	void set_begin(sym_iterator b);
 	void set_end(sym_iterator e);
 	void add_to_summary(count_array_t const & counts);
-	void output(ostream & out);
+	void output(xml_writer & out);
 	bool is_closed(string const & n);
 protected:
-	void output_summary(ostream & out);
-	void output_symbols(ostream & out, bool is_module);
+	void output_summary(xml_writer & out);
+	void output_symbols(xml_writer & out, bool is_module);
 
 	string name;
 	sym_iterator begin;
@@ -451,7 +453,9 @@ public:
 	void summarize();
 	void set_end(sym_iterator end);
 	string const get_tid() { return thread_id; }
-	void output(ostream & out);
+	/// true if output() writes anything
+	bool has_output();
+	void output(xml_writer & out);
 	void dump();
 private:
 	// indices into the classes array applicable to this process
@@ -469,7 +473,9 @@ public:
 		string const & app_name, sym_iterator it);
 	void summarize();
 	void set_end(sym_iterator end);
-	void output(ostream & out);
+	/// true if output() writes anything
+	bool has_output();
+	void output(xml_writer & out);
 	void dump();
 private:
 	size_t nr_threads;
@@ -486,7 +492,7 @@ public:
 	void summarize();
 	void summarize_processes(extra_images const & extra_found_images);
 	void set_process_end();
-	void output_process_symbols(ostream & out);
+	void output_process_symbols(xml_writer & out);
 	void dump_processes();
 private:
 	size_t nr_processes;
@@ -497,7 +503,7 @@ private:
 class binary_info : public module_info {
 public:
 	binary_info() { nr_modules = 0; }
-	void output(ostream & out);
+	void output(xml_writer & out);
 	binary_info * build_binary(string const & n);
 	void add_module_symbol(string const & module, string const & app,
 		sym_iterator it);
@@ -515,7 +521,7 @@ public:
 	binary_root_info() { nr_binaries = 0; }
 	binary_info * add_binary(string const & n, sym_iterator it);
 	void summarize_binaries(extra_images const & extra_found_images);
-	void output_binary_symbols(ostream & out);
+	void output_binary_symbols(xml_writer & out);
 	void dump_binaries();
 private:
 	size_t nr_binaries;
@@ -572,24 +578,25 @@ void module_info::dump()
 }
 
 
-void module_info::output(ostream & out)
+void module_info::output(xml_writer & out)
 {
-	out << open_element(MODULE, true);
-	out << init_attr(NAME, name) << close_element(NONE, true);
+	out.open_element(MODULE, true);
+	out.attr(NAME, name);
+	out.close_element(NONE, true);
 	output_summary(out);
 	output_symbols(out, true);
-	out << close_element(MODULE);
+	out.close_element(MODULE);
 }
 
 
-void module_info::output_summary(ostream & out)
+void module_info::output_summary(xml_writer & out)
 {
 	for (size_t p = lo; p <= hi; ++p)
 		(void)xml_support->output_summary_data(out, summary, p);
 }
 
 
-void module_info::output_symbols(ostream & out, bool is_module)
+void module_info::output_symbols(xml_writer & out, bool is_module)
 {
 	if (begin == (sym_iterator)0)
 		return;
@@ -746,7 +753,7 @@ void process_root_info::set_process_end()
 		processes[p].set_end(symbols_end);
 }
 
-void process_root_info::output_process_symbols(ostream & out)
+void process_root_info::output_process_symbols(xml_writer & out)
 {
 	for (size_t p = 0; p < nr_processes; ++p)
 		processes[p].output(out);
@@ -771,17 +778,18 @@ binary_info::build_binary(string const & n)
 }
 
 
-void binary_info::output(ostream & out)
+void binary_info::output(xml_writer & out)
 {
-	out << open_element(BINARY, true);
-	out << init_attr(NAME, name) << close_element(NONE, true);
+	out.open_element(BINARY, true);
+	out.attr(NAME, name);
+	out.close_element(NONE, true);
 
 	output_summary(out);
 	output_symbols(out, false);
 	for (size_t a = 0; a < nr_modules; ++a)
 		my_modules[a].output(out);
 
-	out << close_element(BINARY);
+	out.close_element(BINARY);
 }
 
 
@@ -796,7 +804,7 @@ binary_root_info::add_binary(string const & n, sym_iterator it)
 }
 
 
-void binary_root_info::output_binary_symbols(ostream & out)
+void binary_root_info::output_binary_symbols(xml_writer & out)
 {
 	for (size_t a = 0; a < nr_binaries; ++a)
 		binaries[a].output(out);
@@ -875,25 +883,26 @@ void thread_info::add_module_symbol(string const & n, sym_iterator it)
 	m.add_to_summary((*it)->sample.counts);
 }
 
-void thread_info::output(ostream & out)
+bool thread_info::has_output()
 {
-	ostringstream thread_summary;
-	ostringstream modules_output;
-
-	output_summary(thread_summary);
+	// the modules are output even without samples
+	return nr_modules || has_sample_counts(summary, lo, hi);
+}
 
-	for (size_t m = 0; m < nr_modules; ++m)
-		my_modules[m].output(modules_output);
 
+void thread_info::output(xml_writer & out)
+{
 	// ignore threads with no sample data
-	if (modules_output.str().size() == 0 && thread_summary.str().size() == 0)
+	if (!has_output())
 		return;
 
-	out << open_element(THREAD, true);
-	out << init_attr(THREAD_ID, thread_id) << close_element(NONE, true);
-	out << thread_summary.str();
-	out << modules_output.str();
-	out << close_element(THREAD);
+	out.open_element(THREAD, true);
+	out.attr(THREAD_ID, thread_id);
+	out.close_element(NONE, true);
+	output_summary(out);
+	for (size_t m = 0; m < nr_modules; ++m)
+		my_modules[m].output(out);
+	out.close_element(THREAD);
 }
 
 
@@ -937,26 +946,30 @@ void process_info::set_end(sym_iterator end)
 }
 
 
-void process_info::output(ostream & out)
+bool process_info::has_output()
 {
-	ostringstream process_summary;
-	ostringstream thread_output;
-
-	output_summary(process_summary);
+	for (size_t t = 0; t < nr_threads; ++t) {
+		if (my_threads[t].has_output())
+			return true;
+	}
+	return has_sample_counts(summary, lo, hi);
+}
 
-	for (size_t t = 0; t < nr_threads; ++t)
-		my_threads[t].output(thread_output);
 
+void process_info::output(xml_writer & out)
+{
 	// ignore processes with no sample data
-	if (thread_output.str().size() == 0 && process_summary.str().size() == 0)
+	if (!has_output())
 		return;
 
-	out << open_element(PROCESS, true);
-	out << init_attr(PROC_ID, process_id);
-	out << init_attr(NAME, name) << close_element(NONE, true);
-	out << process_summary.str();
-	out << thread_output.str();
-	out << close_element(PROCESS);
+	out.open_element(PROCESS, true);
+	out.attr(PROC_ID, process_id);
+	out.attr(NAME, name);
+	out.close_element(NONE, true);
+	output_summary(out);
+	for (size_t t = 0; t < nr_threads; ++t)
+		my_threads[t].output(out);
+	out.close_element(PROCESS);
 }
 
 
@@ -1018,11 +1031,13 @@ void build_process_tree()
 	} while (tgid != nr_classes);
 }
 
-void xml_utils::output_program_structure(ostream & out)
+void xml_utils::output_program_structure(xml_writer & out)
 {
-
-	if (cverb << vxml)
+	if (cverb << vxml) {
+		// the dumps go to the same stream, keep them in order
+		out.flush();
 		dump_classes();
+	}
 
 	if (has_separated_thread_info()) {
 		build_process_tree();
@@ -44,13 +44,13 @@ public:
 	static void output_xml_header(std::string const & command_options,
 						   std::string const & cpu_info,
 						   std::string const & events);
-	void output_symbol_bytes(std::ostream & out, symbol_entry const * symb,
+	void output_symbol_bytes(xml_writer & out, symbol_entry const * symb,
 	                         size_t sym_id, op_bfd const & abfd);
-	bool output_summary_data(std::ostream & out, count_array_t const & summary,
+	bool output_summary_data(xml_writer & out, count_array_t const & summary,
 							 size_t pclass);
 	size_t get_symbol_index(sym_iterator const it);
-	void output_program_structure(std::ostream & out);
-	void build_subclasses(std::ostream & out);
+	void output_program_structure(xml_writer & out);
+	void build_subclasses(xml_writer & out);
 private:
 	bool multiple_events;
 	bool has_subclasses;
@@ -15,6 +15,7 @@
 #include "demangle_symbol.h"
 #include "demangle_java_symbol.h"
 #include "op_regex.h"
+#include "parallel.h"
 
 // from libiberty
 /*@{\name demangle option parameter */
@@ -33,6 +34,15 @@ namespace options {
 	extern demangle_type demangle;
 }
 
+namespace {
+
+/// protect the lazy initialization of stl_regex
+op_mutex stl_regex_mutex;
+bool stl_regex_init = false;
+regular_expression_replace stl_regex;
+
+}
+
 string const demangle_symbol(string const & name)
 {
 	if (options::demangle == dmt_none)
@@ -55,15 +65,16 @@ string const demangle_symbol(string const & name)
 	free(unmangled);
 
 	if (options::demangle == dmt_smart) {
-		static bool init = false;
-		static regular_expression_replace regex;
-		if (init == false) {
-			setup_regex(regex, OP_DATADIR "/stl.pat");
-			init = true;
+		{
+			op_mutex_lock lock(stl_regex_mutex);
+			if (stl_regex_init == false) {
+				setup_regex(stl_regex, OP_DATADIR "/stl.pat");
+				stl_regex_init = true;
+			}
 		}
 		// we don't protect against exception here, pattern must be
 		// right and user can easily work-around by using -d
-		regex.execute(result);
+		stl_regex.execute(result);
 	}
 
 	return result;
@@ -34,6 +34,8 @@ enum demangle_type {
  *
  * The demangled name lists the parameters and type
  * qualifiers such as "const".
+ *
+ * This can be called concurrently from several threads.
  */
 std::string const demangle_symbol(std::string const & name);
 
@@ -11,6 +11,8 @@
  */
 
 #include <cerrno>
+#include <cctype>
+#include <cstring>
 
 #include <iostream>
 #include <fstream>
@@ -69,6 +71,90 @@ size_t subexpr_index(char ch)
 	return size_t(-1);
 }
 
+
+// return the end of the bracket expression starting at pattern[pos]
+size_t skip_bracket(string const & pattern, size_t pos)
+{
+	size_t i = pos + 1;
+	if (i < pattern.length() && pattern[i] == '^')
+		++i;
+	// a leading ']' is a literal
+	if (i < pattern.length() && pattern[i] == ']')
+		++i;
+	while (i < pattern.length() && pattern[i] != ']') {
+		// [:class:], [.coll.] and [=equiv=] can contain a ']'
+		if (pattern[i] == '[' && i + 1 < pattern.length() &&
+		    strchr(":.=", pattern[i + 1])) {
+			char const delim[] = { pattern[i + 1], ']', '\0' };
+			size_t end = pattern.find(delim, i + 2);
+			if (end == string::npos)
+				return pattern.length();
+			i = end + 2;
+		} else {
+			++i;
+		}
+	}
+	return i + 1;
+}
+
+
+// Return the longest string every match of the POSIX extended regular
+// expression pattern contains, empty if none is found. Only the literals
+// outside of any grouping and not followed by a repetition operator are
+// considered, this is conservative but enough for stl.pat patterns.
+string required_literal(string const & pattern)
+{
+	string best, cur;
+	size_t depth = 0;
+
+	for (size_t i = 0; i < pattern.length(); ) {
+		char ch = pattern[i];
+		bool literal = false;
+		size_t next = i + 1;
+
+		if (ch == '\\' && i + 1 < pattern.length()) {
+			ch = pattern[i + 1];
+			next = i + 2;
+			// \<, \>, \w etc. and back-references are not literals
+			literal = !isalnum((unsigned char)ch) &&
+				!strchr("<>`'", ch);
+		} else if (ch == '[') {
+			next = skip_bracket(pattern, i);
+		} else if (ch == '{') {
+			// the bounds of an interval are not literals
+			size_t end = pattern.find('}', i);
+			next = end == string::npos ? pattern.length() : end + 1;
+		} else if (ch == '(') {
+			++depth;
+		} else if (ch == ')') {
+			if (depth)
+				--depth;
+		} else if (ch == '|') {
+			if (!depth)
+				return string();
+		} else {
+			literal = !strchr(".^$*+?}", ch);
+		}
+
+		bool const repeated = next < pattern.length() &&
+			strchr("*+?{", pattern[next]);
+		if (literal && !depth && !repeated) {
+			cur += ch;
+		} else {
+			if (cur.length() > best.length())
+				best = cur;
+			cur.erase();
+		}
+
+		i = next;
+	}
+
+	if (cur.length() > best.length())
+		best = cur;
+
+	return best;
+}
+
 }  // anonymous namespace
 
 
@@ -108,7 +194,8 @@ void regular_expression_replace::add_pattern(string const & pattern,
 
 	regex_t regexp;
 	op_regcomp(regexp, expanded_pattern);
-	replace_t regex = { regexp, replace };
+	replace_t regex = { regexp, replace,
+	                    required_literal(expanded_pattern) };
 	regex_replace.push_back(regex);
 }
 
@@ -190,6 +277,11 @@ bool regular_expression_replace::do_execute(string & str,
 {
 	bool changed = false;
 
+	// most demangled names don't contain the literal part of most
+	// patterns, checking it is much cheaper than running regexec()
+	if (str.find(regexp.literal) == string::npos)
+		return false;
+
 	regmatch_t match[max_match];
 	for (size_t iter = 0;
 	     op_regexec(regexp.regexp, str, match, max_match) && iter < limit;
@@ -87,6 +87,8 @@ private:
 		regex_t regexp;
 		// replace the matched part with this string
 		std::string replace;
+		// every match contains this string, used to skip regexec()
+		std::string literal;
 	};
 
 	// helper to execute
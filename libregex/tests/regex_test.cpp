@@ -62,9 +62,60 @@ static void do_test(istream& fin)
 		cerr << "input file ill formed\n";
 }
 
+
+struct pattern_test {
+	char const * pattern;
+	char const * input;
+	char const * expect;
+};
+
+/// patterns whose required literal is not a plain substring of the pattern
+static pattern_test const pattern_tests[] = {
+	{ "ab{2,3}c", "abbc", "X" },
+	{ "ab{2,3}c", "xabbbcx", "xXx" },
+	{ "ab{2,3}c", "abc", "abc" },
+	{ "ab{2}", "abb", "X" },
+	{ "(ab){2}c", "ababc", "X" },
+	{ "a[0-9]{1,2}b", "a12b", "X" },
+	{ "foo|bar", "bar", "X" },
+	{ "foo|bar", "foo", "X" },
+	{ "x(foo|bar)y", "xbary", "X" },
+	{ "x(foo|bar)y", "xbazy", "xbazy" },
+	{ "a[]b]c", "a]c", "X" },
+	{ "a[^]x]c", "abc", "X" },
+	{ "a[[:digit:]]c", "a5c", "X" },
+	{ "a[[:alpha:]]{2}c", "abbc", "X" },
+	{ "a\\.b", "a.b", "X" },
+	{ "a\\.b", "axb", "axb" },
+	{ "abc*d", "abd", "X" },
+	{ "abc?d", "abd", "X" },
+};
+
+static void do_pattern_tests()
+{
+	size_t const nr_tests = sizeof(pattern_tests) / sizeof(pattern_tests[0]);
+	for (size_t i = 0; i < nr_tests; ++i) {
+		pattern_test const & test = pattern_tests[i];
+		regular_expression_replace rep;
+		rep.add_pattern(test.pattern, "X");
+		string str(test.input);
+		rep.execute(str);
+		if (str != test.expect) {
+			cerr << "mistmatch: pattern, test, expect, returned\n"
+			     << '"' << test.pattern << '"' << endl
+			     << '"' << test.input << '"' << endl
+			     << '"' << test.expect << '"' << endl
+			     << '"' << str << '"' << endl;
+			++nr_error;
+		}
+	}
+}
+
 int main(int argc, char * argv[])
 {
 	try {
+		do_pattern_tests();
+
 		if (argc > 1) {
 			for (int i = 1; i < argc; ++i) {
 				ifstream fin(argv[i]);
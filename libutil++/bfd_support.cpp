@@ -31,6 +31,7 @@
 #include <cstring>
 #include <cassert>
 #include <iostream>
+#include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <sstream>
@@ -459,6 +460,21 @@ bool find_separate_debug_file(bfd * ibfd, string const & filepath_in,
 }
 
 
+string image_build_id(bfd * ibfd)
+{
+	unsigned char buildid[64];
+
+	if (!get_build_id(ibfd, buildid))
+		return string();
+
+	ostringstream id;
+	id << hex << setfill('0');
+	for (size_t i = 0; i < build_id_size; ++i)
+		id << setw(2) << (unsigned int)buildid[i];
+	return id.str();
+}
+
+
 bool interesting_symbol(asymbol * sym)
 {
 	// #717720 some binutils are miscompiled by gcc 2.95, one of the
@@ -470,20 +486,27 @@ bool interesting_symbol(asymbol * sym)
 		throw op_runtime_error(os.str());
 	}
 
-	if (!(sym->section->flags & SEC_CODE))
+	return interesting_symbol(sym->section, sym->name, sym->flags);
+}
+
+
+bool interesting_symbol(asection const * section, char const * name,
+                        flagword flags)
+{
+	if (!(section->flags & SEC_CODE))
 		return false;
 
 	// returning true for fix up in op_bfd_symbol()
-	if (!sym->name || sym->name[0] == '\0')
+	if (!name || name[0] == '\0')
 		return true;
 	/* ARM assembler internal mapping symbols aren't interesting */
-	if ((strcmp("$a", sym->name) == 0) ||
-	    (strcmp("$t", sym->name) == 0) ||
-	    (strcmp("$d", sym->name) == 0))
+	if ((strcmp("$a", name) == 0) ||
+	    (strcmp("$t", name) == 0) ||
+	    (strcmp("$d", name) == 0))
 		return false;
 
 	// C++ exception stuff
-	if (sym->name[0] == '.' && sym->name[1] == 'L')
+	if (name[0] == '.' && name[1] == 'L')
 		return false;
 
 	/* This case cannot be moved to boring_symbol(),
@@ -491,7 +514,7 @@ bool interesting_symbol(asymbol * sym)
 	 * and sometimes this symbol appears at an address
 	 * different from all other symbols.
 	 */
-	if (!strcmp("gcc2_compiled.", sym->name))
+	if (!strcmp("gcc2_compiled.", name))
 		return false;
 
 	/* Commit ab45a0cc5d1cf522c1aef8f22ed512a9aae0dc1c removed a check for
@@ -499,7 +522,7 @@ bool interesting_symbol(asymbol * sym)
 	 * was removed.
 	 */
 
-        if (sym->flags & BSF_SECTION_SYM)
+        if (flags & BSF_SECTION_SYM)
                 return false;
 
 	return true;
@@ -560,10 +583,28 @@ bfd_info::~bfd_info()
 
 void bfd_info::close()
 {
+	lines.reset();
 	if (abfd)
 		bfd_close(abfd);
 }
 
+
+void bfd_info::set_line_table(line_table * table)
+{
+	lines.reset(table);
+}
+
+
+line_table const & bfd_info::get_line_table() const
+{
+	if (!lines.get()) {
+		lines.reset(new line_table(abfd));
+		cverb << vbfd << "decoded " << lines->size()
+		      << " line table rows" << endl;
+	}
+	return *lines;
+}
+
 #if SYNTHESIZE_SYMBOLS
 /**
  * This function is intended solely for processing ppc64 debuginfo files.
@@ -727,7 +768,7 @@ bool bfd_info::get_synth_symbols()
 
 void bfd_info::get_symbols()
 {
-	if (!abfd)
+	if (!abfd || syms.get())
 		return;
 
 	cverb << vbfd << "bfd_info::get_symbols() for "
@@ -775,13 +816,14 @@ find_nearest_line(bfd_info const & b, op_bfd_symbol const & sym,
 	asection * section = NULL;
 	asymbol * empty_syms[1];
 	bfd_vma pc;
+	bfd_vma vma;
 	bool ret;
 
 	if (!b.valid())
 		goto fail;
 
 	// take care about artificial symbol
-	if (!sym.symbol())
+	if (!sym.section())
 		goto fail;
 
 	abfd = b.abfd;
@@ -797,26 +839,26 @@ find_nearest_line(bfd_info const & b, op_bfd_symbol const & sym,
 		asection * sect_candidate;
 		bfd_vma vma_adj = b.get_image_bfd_info()->abfd->start_address - abfd->start_address;
 		if (vma_adj == 0)
-			section = sym.symbol()->section;
+			section = const_cast<asection *>(sym.section());
 		for (sect_candidate = abfd->sections;
 		     (sect_candidate != NULL) && (section == NULL);
 		     sect_candidate = sect_candidate->next) {
-			if (sect_candidate->vma + vma_adj == sym.symbol()->section->vma) {
+			if (sect_candidate->vma + vma_adj == sym.section()->vma) {
 				section = sect_candidate;
 			}
 		}
 		if (section == NULL) {
-			cerr << "ERROR: Unable to find section for symbol " << sym.symbol()->name << endl;
+			cerr << "ERROR: Unable to find section for symbol " << sym.name() << endl;
 			goto fail;
 		}
 		syms = empty_syms;
 		syms[0] = NULL;
 
 	} else {
-		section = sym.symbol()->section;
+		section = const_cast<asection *>(sym.section());
 	}
 	if (anon_obj)
-		pc = offset - sym.symbol()->section->vma;
+		pc = offset - sym.section()->vma;
 	else
 		pc = (sym.value() + offset) - sym.filepos();
 
@@ -826,6 +868,17 @@ find_nearest_line(bfd_info const & b, op_bfd_symbol const & sym,
 	if (pc >= bfd_section_size(abfd, section))
 		goto fail;
 
+	// bfd_find_nearest_line() looks up the same address, a row without
+	// line number is left to it for the function check and the fixup
+	vma = section->output_section
+		? section->output_section->vma + section->output_offset
+		: section->vma;
+	if (b.get_line_table().find(vma + pc, info.filename, info.line) &&
+	    info.line) {
+		info.found = true;
+		return info;
+	}
+
 	ret = bfd_find_nearest_line(abfd, section, syms, pc, &cfilename,
 	                                 &function, &linenr);
 
@@ -15,6 +15,7 @@
 #include "utility.h"
 #include "op_types.h"
 #include "locate_images.h"
+#include "line_table.h"
 
 #include <bfd.h>
 #include <stdint.h>
@@ -42,6 +43,12 @@ struct bfd_info {
 	/// pick out the symbols from the bfd, if we can
 	void get_symbols();
 
+	/// return the line table of the BFD, decoded on first use
+	line_table const & get_line_table() const;
+
+	/// use table, which we now own, instead of decoding the BFD one
+	void set_line_table(line_table * table);
+
 	/// the actual BFD
 	bfd * abfd;
 	/// normal symbols (includes synthesized symbols)
@@ -75,6 +82,9 @@ private:
 	 */ 
 	bfd_info * image_bfd_info;
 
+	/// DWARF line programs of abfd, NULL until get_line_table()
+	mutable scoped_ptr<line_table> lines;
+
 #if SYNTHESIZE_SYMBOLS
 	/**
 	 * This function is used only for ppc64 binaries. It uses the runtime
@@ -119,6 +129,9 @@ find_separate_debug_file(bfd * ibfd,
                          std::string & debug_filename,
                          extra_images const & extra);
 
+/// return the hex build-id of the binary, or an empty string if it has none
+std::string image_build_id(bfd * ibfd);
+
 /// open the given BFD
 bfd * open_bfd(std::string const & file);
 
@@ -131,6 +144,10 @@ bfd * spu_open_bfd(std::string const name, int fd, uint64_t offset_to_spu_elf);
 /// Return true if the symbol is worth looking at
 bool interesting_symbol(asymbol * sym);
 
+/// same as above for a symbol read without bfd, flags are BSF_ flags
+bool interesting_symbol(asection const * section, char const * name,
+                        flagword flags);
+
 /**
  * return true if the first symbol is less interesting than the second symbol
  * boring symbol are eliminated when multiple symbol exist at the same vma
@@ -0,0 +1,274 @@
+/**
+ * @file elf_symbols.cpp
+ * Read ELF symbol tables without canonicalizing them through bfd
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "elf_symbols.h"
+#include "bfd_support.h"
+#include "op_bfd.h"
+#include "file_manip.h"
+#include "cverb.h"
+
+#include <elf.h>
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+extern verbose vbfd;
+
+namespace {
+
+#ifndef STT_GNU_IFUNC
+#define STT_GNU_IFUNC 10
+#endif
+#ifndef STT_ARM_TFUNC
+#define STT_ARM_TFUNC STT_LOPROC
+#endif
+#ifndef STB_GNU_UNIQUE
+#define STB_GNU_UNIQUE 10
+#endif
+
+/// field accessors for ELFCLASS32 or ELFCLASS64 structures
+class elf_reader {
+public:
+	elf_reader(bfd * abfd_, bool is64_) : is64(is64_), abfd(abfd_) {}
+
+	/// read an address sized field
+	bfd_vma addr(bfd_byte const * base, size_t off32, size_t off64) const {
+		if (is64)
+			return bfd_get_64(abfd, base + off64);
+		return bfd_get_32(abfd, base + off32);
+	}
+
+	/// read a 32 bits field
+	unsigned int word(bfd_byte const * base, size_t off32,
+	                  size_t off64) const {
+		return bfd_get_32(abfd, base + (is64 ? off64 : off32));
+	}
+
+	/// read a 16 bits field
+	unsigned int half(bfd_byte const * base, size_t off32,
+	                  size_t off64) const {
+		return bfd_get_16(abfd, base + (is64 ? off64 : off32));
+	}
+
+	/// read a byte field
+	unsigned int byte(bfd_byte const * base, size_t off32,
+	                  size_t off64) const {
+		return base[is64 ? off64 : off32];
+	}
+
+	bool const is64;
+
+private:
+	bfd * abfd;
+};
+
+#define EHDR(field) offsetof(Elf32_Ehdr, field), offsetof(Elf64_Ehdr, field)
+#define SHDR(field) offsetof(Elf32_Shdr, field), offsetof(Elf64_Shdr, field)
+#define SYM(field) offsetof(Elf32_Sym, field), offsetof(Elf64_Sym, field)
+
+
+/// a section header with its offsets checked against the file size
+struct elf_section {
+	unsigned int name;
+	unsigned int type;
+	bfd_vma addr;
+	bfd_vma offset;
+	bfd_vma size;
+	unsigned int link;
+};
+
+
+/// return the nul terminated string at offset in the string table strtab
+char const * get_string(mapped_file const & file, elf_section const & strtab,
+                        unsigned int offset)
+{
+	if (strtab.type != SHT_STRTAB || offset >= strtab.size)
+		return 0;
+
+	char const * str = reinterpret_cast<char const *>(file.data()) +
+		strtab.offset + offset;
+	if (!memchr(str, '\0', strtab.size - offset))
+		return 0;
+	return str;
+}
+
+
+/**
+ * return the address of an ARM symbol as bfd gives it: EABI Thumb
+ * functions have the low bit of their address set and bfd clears it.
+ * Functions of the older STT_ARM_TFUNC type are Thumb code by their type,
+ * bfd makes them STT_FUNC but keeps their address as is.
+ */
+bfd_vma arm_symbol_value(unsigned int type, bfd_vma value)
+{
+	switch (type) {
+	case STT_FUNC:
+	case STT_GNU_IFUNC:
+		return value & ~(bfd_vma)1;
+	case STT_ARM_TFUNC:
+	default:
+		return value;
+	}
+}
+
+} // anonymous namespace
+
+
+bool read_elf_symbols(bfd * abfd, vector<op_bfd_symbol> & symbols,
+                      size_t & nr_syms)
+{
+	if (bfd_get_flavour(abfd) != bfd_target_elf_flavour ||
+	    abfd->my_archive || abfd->origin)
+		return false;
+
+	enum bfd_architecture const arch = bfd_get_arch(abfd);
+	if (arch != bfd_arch_i386 && arch != bfd_arch_arm)
+		return false;
+
+	int const arch_size = bfd_get_arch_size(abfd);
+	if (arch_size != 32 && (arch_size != 64 || sizeof(bfd_vma) < 8))
+		return false;
+
+	mapped_file file(bfd_get_filename(abfd));
+	if (!file.valid() || file.size() < sizeof(Elf64_Ehdr))
+		return false;
+
+	bfd_byte const * data = file.data();
+	elf_reader const elf(abfd, arch_size == 64);
+	if (memcmp(data, ELFMAG, SELFMAG) ||
+	    data[EI_CLASS] != (elf.is64 ? ELFCLASS64 : ELFCLASS32))
+		return false;
+
+	size_t const shdr_size = elf.is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr);
+	size_t const sym_size = elf.is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+
+	bfd_vma const shoff = elf.addr(data, EHDR(e_shoff));
+	size_t const shnum = elf.half(data, EHDR(e_shnum));
+	size_t const shstrndx = elf.half(data, EHDR(e_shstrndx));
+
+	// extended section numbering is left to bfd
+	if (!shnum || shnum >= SHN_LORESERVE || shstrndx >= shnum ||
+	    elf.half(data, EHDR(e_shentsize)) != shdr_size ||
+	    shoff > file.size() || shnum > (file.size() - shoff) / shdr_size)
+		return false;
+
+	vector<elf_section> sections(shnum);
+	elf_section const * symtab = 0;
+	for (size_t i = 0; i < shnum; ++i) {
+		bfd_byte const * shdr = data + shoff + i * shdr_size;
+		elf_section & sect = sections[i];
+		sect.name = elf.word(shdr, SHDR(sh_name));
+		sect.type = elf.word(shdr, SHDR(sh_type));
+		sect.addr = elf.addr(shdr, SHDR(sh_addr));
+		sect.offset = elf.addr(shdr, SHDR(sh_offset));
+		sect.size = elf.addr(shdr, SHDR(sh_size));
+		sect.link = elf.word(shdr, SHDR(sh_link));
+
+		if (sect.type == SHT_SYMTAB_SHNDX)
+			return false;
+		if (sect.type == SHT_NOBITS)
+			continue;
+		if (sect.offset > file.size() ||
+		    sect.size > file.size() - sect.offset)
+			return false;
+		if (sect.type == SHT_SYMTAB && !symtab)
+			symtab = &sect;
+	}
+
+	nr_syms = 0;
+	if (!symtab)
+		return true;
+
+	if (symtab->link >= shnum)
+		return false;
+	elf_section const & strtab = sections[symtab->link];
+	elf_section const & shstrtab = sections[shstrndx];
+
+	// the bfd code section of each ELF section index, symbols of the other
+	// sections are not interesting
+	vector<asection const *> code_sections(shnum);
+	for (asection const * s = abfd->sections; s; s = s->next) {
+		if (!(s->flags & SEC_CODE))
+			continue;
+		for (size_t i = 1; i < shnum; ++i) {
+			char const * name = get_string(file, shstrtab,
+			                               sections[i].name);
+			if (!code_sections[i] && name && !strcmp(name, s->name) &&
+			    sections[i].addr == s->vma &&
+			    sections[i].size == s->size) {
+				code_sections[i] = s;
+				break;
+			}
+		}
+	}
+
+	bool const section_relative = !(abfd->flags & (EXEC_P | DYNAMIC));
+	size_t const symcount = symtab->size / sym_size;
+	size_t const first = symbols.size();
+
+	// skip the first symbol, a null dummy
+	for (size_t i = 1; i < symcount; ++i) {
+		bfd_byte const * sym = data + symtab->offset + i * sym_size;
+
+		unsigned int const shndx = elf.half(sym, SYM(st_shndx));
+		if (shndx == SHN_UNDEF || shndx >= shnum || !code_sections[shndx])
+			continue;
+		asection const * section = code_sections[shndx];
+
+		char const * name =
+			get_string(file, strtab, elf.word(sym, SYM(st_name)));
+		if (!name) {
+			symbols.erase(symbols.begin() + first, symbols.end());
+			return false;
+		}
+
+		unsigned int const info = elf.byte(sym, SYM(st_info));
+		bfd_vma value = elf.addr(sym, SYM(st_value));
+
+		if (arch == bfd_arch_arm)
+			value = arm_symbol_value(ELF32_ST_TYPE(info), value);
+
+		if (!section_relative)
+			value -= section->vma;
+
+		flagword flags = 0;
+		switch (ELF32_ST_BIND(info)) {
+		case STB_LOCAL:
+			flags |= BSF_LOCAL;
+			break;
+		case STB_GLOBAL:
+			flags |= BSF_GLOBAL;
+			break;
+		case STB_WEAK:
+			flags |= BSF_WEAK;
+			break;
+		case STB_GNU_UNIQUE:
+			flags |= BSF_GNU_UNIQUE;
+			break;
+		}
+		// bfd names the unnamed section symbols after their section
+		if (ELF32_ST_TYPE(info) == STT_SECTION) {
+			flags |= BSF_SECTION_SYM;
+			if (!*name)
+				name = section->name;
+		}
+
+		if (interesting_symbol(section, name, flags))
+			symbols.push_back(op_bfd_symbol(section, value, name, flags));
+	}
+
+	nr_syms = symcount ? symcount - 1 : 0;
+
+	cverb << vbfd << "read_elf_symbols: " << dec << nr_syms
+	      << " symbols in " << bfd_get_filename(abfd) << hex << endl;
+
+	return true;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file elf_symbols.h
+ * Read ELF symbol tables without canonicalizing them through bfd
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef ELF_SYMBOLS_H
+#define ELF_SYMBOLS_H
+
+#include "config.h"
+
+#include <bfd.h>
+
+#include <cstddef>
+#include <vector>
+
+class op_bfd_symbol;
+
+/**
+ * read_elf_symbols - read the interesting symbols of an ELF file
+ * @param abfd the bfd of the file, the symbol sections are its sections
+ * @param symbols the interesting_symbol() symbols of the .symtab are
+ *  appended to it in symbol table order
+ * @param nr_syms output parameter, the nr. of symbols
+ *  bfd_canonicalize_symtab() would return
+ *
+ * The file is mapped and its .symtab read in place, the symbols which are
+ * not in a code section are only counted. This gives the same symbols as
+ * bfd_info::get_symbols() without allocating an asymbol per ELF symbol.
+ *
+ * Only plain x86 and ARM ELF files are handled, the bfd backends of other
+ * targets may alter symbols while reading them. Return false if the file
+ * is not handled, the caller must then fall back to bfd.
+ */
+bool read_elf_symbols(bfd * abfd, std::vector<op_bfd_symbol> & symbols,
+                      size_t & nr_syms);
+
+#endif /* !ELF_SYMBOLS_H */
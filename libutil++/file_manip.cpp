@@ -10,6 +10,7 @@
  */
 
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <utime.h>
@@ -97,7 +98,7 @@ bool is_files_identical(string const & file1, string const & file2)
 
 string const op_realpath(string const & name)
 {
-	static char tmp[PATH_MAX];
+	char tmp[PATH_MAX];
 	if (!realpath(name.c_str(), tmp))
 		return name;
 	return string(tmp);
@@ -177,3 +178,29 @@ string op_basename(string const & path_name)
 
 	return erase_to_last_of(result, '/');
 }
+
+
+mapped_file::mapped_file(string const & filename)
+	: data_(0), size_(0)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return;
+
+	struct stat st;
+	if (!fstat(fd, &st) && st.st_size > 0) {
+		void * base = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (base != MAP_FAILED) {
+			data_ = static_cast<unsigned char const *>(base);
+			size_ = st.st_size;
+		}
+	}
+	close(fd);
+}
+
+
+mapped_file::~mapped_file()
+{
+	if (data_)
+		munmap(const_cast<unsigned char *>(data_), size_);
+}
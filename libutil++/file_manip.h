@@ -15,6 +15,8 @@
 #include <string>
 #include <list>
 
+#include "utility.h"
+
 
 /**
  * copy_file - copy a file.
@@ -86,4 +88,22 @@ std::string op_dirname(std::string const & file_name);
  */
 std::string op_basename(std::string const & path_name);
 
+/**
+ * A read-only private mapping of a whole file, valid() is false if the
+ * file can't be opened or mapped or is empty.
+ */
+class mapped_file : noncopyable {
+public:
+	explicit mapped_file(std::string const & filename);
+	~mapped_file();
+
+	bool valid() const { return data_; }
+	unsigned char const * data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	unsigned char const * data_;
+	size_t size_;
+};
+
 #endif /* !FILE_MANIP_H */
@@ -0,0 +1,156 @@
+/**
+ * @file file_tree.cpp
+ * List the files of a directory tree in parallel
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "file_tree.h"
+#include "parallel.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+/// what is found in a directory
+struct dir_content {
+	dir_content() : nr_files(0) {}
+
+	/// the files accepted by the filter
+	vector<string> files;
+	/// the sub-directories
+	vector<string> subdirs;
+	/// the nr. of files, filtered or not
+	size_t nr_files;
+	/// the entries which can't be stat()ed
+	vector<string> errors;
+};
+
+
+/// read the directories of one level of the tree
+class read_dirs_job : public parallel_job {
+public:
+	read_dirs_job(vector<string> const & dirs_, file_filter const & filter_)
+		: dirs(dirs_), filter(filter_), contents(dirs_.size()) {}
+
+	void run(size_t index);
+
+	vector<string> const & dirs;
+	file_filter const & filter;
+	vector<dir_content> contents;
+};
+
+
+/**
+ * Set is_dir to the type of the entry ent of the directory dir_fd, the
+ * entry is pathname. Return false if the entry must be ignored.
+ */
+bool get_entry_type(int dir_fd, struct dirent const * ent,
+                    string const & pathname, bool & is_dir,
+                    dir_content & content)
+{
+	if (ent->d_type != DT_UNKNOWN && ent->d_type != DT_LNK) {
+		is_dir = ent->d_type == DT_DIR;
+		return true;
+	}
+
+	struct stat st;
+	if (fstatat(dir_fd, ent->d_name, &st, 0) == 0) {
+		is_dir = S_ISDIR(st.st_mode);
+		return true;
+	}
+
+	int const err = errno;
+	struct stat lst;
+	// dangling symlink -- silently ignore
+	if (fstatat(dir_fd, ent->d_name, &lst, AT_SYMLINK_NOFOLLOW) != 0 ||
+	    !S_ISLNK(lst.st_mode)) {
+		content.errors.push_back("stat failed for " + pathname +
+		                         " (" + strerror(err) + ")");
+	}
+
+	return false;
+}
+
+
+void read_dirs_job::run(size_t index)
+{
+	string const & dirname = dirs[index];
+	dir_content & content = contents[index];
+
+	int const fd = open(dirname.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return;
+
+	DIR * dir = fdopendir(fd);
+	if (!dir) {
+		close(fd);
+		return;
+	}
+
+	struct dirent * ent;
+	while ((ent = readdir(dir)) != 0) {
+		if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+			continue;
+
+		string const pathname = dirname + "/" + ent->d_name;
+
+		bool is_dir;
+		if (!get_entry_type(fd, ent, pathname, is_dir, content))
+			continue;
+
+		if (is_dir) {
+			content.subdirs.push_back(pathname);
+		} else {
+			++content.nr_files;
+			if (filter(pathname))
+				content.files.push_back(pathname);
+		}
+	}
+
+	closedir(dir);
+}
+
+} // anonymous namespace
+
+
+size_t walk_file_tree(string const & base_dir, file_filter const & filter,
+                      vector<string> & files)
+{
+	size_t nr_files = 0;
+
+	vector<string> dirs(1, base_dir);
+	while (!dirs.empty()) {
+		read_dirs_job job(dirs, filter);
+		parallel_run(job, dirs.size());
+
+		vector<string> subdirs;
+		for (size_t i = 0; i < dirs.size(); ++i) {
+			dir_content const & content = job.contents[i];
+
+			for (size_t j = 0; j < content.errors.size(); ++j)
+				cerr << content.errors[j] << endl;
+
+			nr_files += content.nr_files;
+			files.insert(files.end(), content.files.begin(),
+			             content.files.end());
+			subdirs.insert(subdirs.end(), content.subdirs.begin(),
+			               content.subdirs.end());
+		}
+
+		dirs.swap(subdirs);
+	}
+
+	return nr_files;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file file_tree.h
+ * List the files of a directory tree in parallel
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef FILE_TREE_H
+#define FILE_TREE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// the filter of walk_file_tree(), called concurrently from several threads
+class file_filter {
+public:
+	virtual ~file_filter() {}
+
+	/// return true if the file of this pathname must be listed
+	virtual bool operator()(std::string const & pathname) const = 0;
+};
+
+
+/**
+ * walk_file_tree - list the files of a directory tree
+ * @param base_dir  the directory to walk
+ * @param filter  the files to list
+ * @param files  output, the pathnames of the files filter accepted, in no
+ *  particular order
+ *
+ * This lists the same files as create_file_list(files, base_dir, "*", true):
+ * every entry but the directories is a file and symlinks are followed.
+ * The directories of each level of the tree are read in parallel and the
+ * files are filtered as they are found. The entry types come from readdir()
+ * d_type, only symlinks and entries of file systems not filling d_type
+ * are stat()ed, relative to their directory.
+ *
+ * Return the nr. of files found, filtered or not.
+ */
+size_t walk_file_tree(std::string const & base_dir, file_filter const & filter,
+                      std::vector<std::string> & files);
+
+#endif /* !FILE_TREE_H */
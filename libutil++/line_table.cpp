@@ -0,0 +1,664 @@
+/**
+ * @file line_table.cpp
+ * Address to source line table decoded from DWARF line programs
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "line_table.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// the few DWARF constants we need, bfd does not install dwarf2.h
+enum {
+	DW_AT_stmt_list = 0x10,
+	DW_AT_comp_dir = 0x1b
+};
+
+enum {
+	DW_FORM_addr = 0x01,
+	DW_FORM_block2 = 0x03,
+	DW_FORM_block4 = 0x04,
+	DW_FORM_data2 = 0x05,
+	DW_FORM_data4 = 0x06,
+	DW_FORM_data8 = 0x07,
+	DW_FORM_string = 0x08,
+	DW_FORM_block = 0x09,
+	DW_FORM_block1 = 0x0a,
+	DW_FORM_data1 = 0x0b,
+	DW_FORM_flag = 0x0c,
+	DW_FORM_sdata = 0x0d,
+	DW_FORM_strp = 0x0e,
+	DW_FORM_udata = 0x0f,
+	DW_FORM_ref_addr = 0x10,
+	DW_FORM_ref1 = 0x11,
+	DW_FORM_ref2 = 0x12,
+	DW_FORM_ref4 = 0x13,
+	DW_FORM_ref8 = 0x14,
+	DW_FORM_ref_udata = 0x15,
+	DW_FORM_indirect = 0x16,
+	DW_FORM_sec_offset = 0x17,
+	DW_FORM_exprloc = 0x18,
+	DW_FORM_flag_present = 0x19,
+	DW_FORM_ref_sig8 = 0x20,
+	DW_FORM_GNU_ref_alt = 0x1f20,
+	DW_FORM_GNU_strp_alt = 0x1f21
+};
+
+enum {
+	DW_LNS_extended_op = 0,
+	DW_LNS_copy = 1,
+	DW_LNS_advance_pc = 2,
+	DW_LNS_advance_line = 3,
+	DW_LNS_set_file = 4,
+	DW_LNS_const_add_pc = 8,
+	DW_LNS_fixed_advance_pc = 9
+};
+
+enum {
+	DW_LNE_end_sequence = 1,
+	DW_LNE_set_address = 2,
+	DW_LNE_define_file = 3
+};
+
+/**
+ * Bounds checked reader of DWARF data. Reading past the end sets the
+ * cursor in error state and returns zero.
+ */
+class dwarf_cursor {
+public:
+	dwarf_cursor(bfd * abfd_, bfd_byte const * begin, bfd_byte const * end_)
+		: abfd(abfd_), p(begin), end(end_), good(begin <= end_) {}
+
+	bool ok() const { return good; }
+	bool at_end() const { return p >= end; }
+	unsigned long long left() const { return end - p; }
+	bfd_byte const * pos() const { return p; }
+
+	unsigned int u8() {
+		return need(1) ? *p++ : 0;
+	}
+
+	unsigned int u16() {
+		if (!need(2))
+			return 0;
+		p += 2;
+		return bfd_get_16(abfd, p - 2);
+	}
+
+	unsigned long long u32() {
+		if (!need(4))
+			return 0;
+		p += 4;
+		return bfd_get_32(abfd, p - 4);
+	}
+
+	unsigned long long u64() {
+		if (!need(8))
+			return 0;
+		p += 8;
+		return bfd_get_64(abfd, p - 8);
+	}
+
+	/// a section offset, 32 or 64 bits wide
+	unsigned long long offset(bool dwarf64) {
+		return dwarf64 ? u64() : u32();
+	}
+
+	/// an address of the given size
+	unsigned long long address(unsigned int size) {
+		switch (size) {
+		case 1: return u8();
+		case 2: return u16();
+		case 4: return u32();
+		case 8: return u64();
+		}
+		good = false;
+		return 0;
+	}
+
+	unsigned long long uleb() {
+		unsigned long long result = 0;
+		unsigned int shift = 0;
+		unsigned int byte;
+		do {
+			byte = u8();
+			if (shift < 64)
+				result |= (unsigned long long)(byte & 0x7f) << shift;
+			shift += 7;
+		} while ((byte & 0x80) && good);
+		return result;
+	}
+
+	long long sleb() {
+		unsigned long long result = 0;
+		unsigned int shift = 0;
+		unsigned int byte;
+		do {
+			byte = u8();
+			if (shift < 64)
+				result |= (unsigned long long)(byte & 0x7f) << shift;
+			shift += 7;
+		} while ((byte & 0x80) && good);
+		if (shift < 64 && (byte & 0x40))
+			result |= ~0ULL << shift;
+		return (long long)result;
+	}
+
+	/// a NUL terminated string, NULL if unterminated
+	char const * str() {
+		bfd_byte const * nul =
+			(bfd_byte const *)memchr(p, 0, at_end() ? 0 : left());
+		if (!nul) {
+			good = false;
+			p = end;
+			return 0;
+		}
+		char const * s = (char const *)p;
+		p = nul + 1;
+		return s;
+	}
+
+	void skip(unsigned long long n) {
+		if (need(n))
+			p += n;
+	}
+
+	/**
+	 * Read the initial length of a unit, return a cursor on the unit
+	 * contents and move past the unit.
+	 */
+	dwarf_cursor unit(bool & dwarf64) {
+		unsigned long long length = u32();
+		dwarf64 = length == 0xffffffff;
+		if (dwarf64)
+			length = u64();
+		bfd_byte const * begin = p;
+		skip(length);
+		return dwarf_cursor(abfd, begin, good ? p : begin);
+	}
+
+private:
+	bool need(unsigned long long n) {
+		if (good && (unsigned long long)(end - p) >= n)
+			return true;
+		good = false;
+		p = end;
+		return false;
+	}
+
+	bfd * abfd;
+	bfd_byte const * p;
+	bfd_byte const * end;
+	bool good;
+};
+
+
+bool read_section(bfd * abfd, char const * name, vector<bfd_byte> & data)
+{
+	asection * sect = bfd_get_section_by_name(abfd, name);
+	if (!sect || !(bfd_get_section_flags(abfd, sect) & SEC_HAS_CONTENTS))
+		return false;
+
+	bfd_size_type size = bfd_section_size(abfd, sect);
+	if (!size)
+		return false;
+
+	data.resize(size);
+	return bfd_get_section_contents(abfd, sect, &data[0], 0, size);
+}
+
+
+/// the attributes of a compilation unit DIE we are interested in
+struct cu_info {
+	cu_info() : has_stmt_list(false), stmt_list(0), comp_dir(0) {}
+
+	bool has_stmt_list;
+	unsigned long long stmt_list;
+	char const * comp_dir;
+};
+
+
+/// read or skip an attribute value, return false if the form is unknown
+bool read_attribute(dwarf_cursor & cur, unsigned int attr, unsigned long long form,
+                    unsigned int version, unsigned int addr_size, bool dwarf64,
+                    vector<bfd_byte> const & debug_str, cu_info & cu)
+{
+	unsigned long long value = 0;
+	char const * str = 0;
+
+	switch (form) {
+	case DW_FORM_addr: value = cur.address(addr_size); break;
+	case DW_FORM_block2: cur.skip(cur.u16()); break;
+	case DW_FORM_block4: cur.skip(cur.u32()); break;
+	case DW_FORM_data2:
+	case DW_FORM_ref2: value = cur.u16(); break;
+	case DW_FORM_data4:
+	case DW_FORM_ref4: value = cur.u32(); break;
+	case DW_FORM_data8:
+	case DW_FORM_ref8:
+	case DW_FORM_ref_sig8: value = cur.u64(); break;
+	case DW_FORM_string: str = cur.str(); break;
+	case DW_FORM_block:
+	case DW_FORM_exprloc: cur.skip(cur.uleb()); break;
+	case DW_FORM_block1: cur.skip(cur.u8()); break;
+	case DW_FORM_data1:
+	case DW_FORM_ref1:
+	case DW_FORM_flag: value = cur.u8(); break;
+	case DW_FORM_sdata: value = cur.sleb(); break;
+	case DW_FORM_udata:
+	case DW_FORM_ref_udata: value = cur.uleb(); break;
+	case DW_FORM_flag_present: break;
+	case DW_FORM_sec_offset:
+	case DW_FORM_GNU_ref_alt:
+	case DW_FORM_GNU_strp_alt: value = cur.offset(dwarf64); break;
+	case DW_FORM_ref_addr:
+		value = version == 2 ? cur.address(addr_size)
+		                     : cur.offset(dwarf64);
+		break;
+	case DW_FORM_strp:
+		value = cur.offset(dwarf64);
+		if (value < debug_str.size() &&
+		    memchr(&debug_str[value], 0, debug_str.size() - value))
+			str = (char const *)&debug_str[value];
+		break;
+	case DW_FORM_indirect:
+		form = cur.uleb();
+		if (form == DW_FORM_indirect)
+			return false;
+		return read_attribute(cur, attr, form, version, addr_size,
+		                      dwarf64, debug_str, cu);
+	default:
+		return false;
+	}
+
+	if (attr == DW_AT_stmt_list && !str) {
+		cu.has_stmt_list = true;
+		cu.stmt_list = value;
+	} else if (attr == DW_AT_comp_dir && str) {
+		// as bfd does, strip the "machine.:" prefix of Irix cc
+		char const * cp = strchr(str, ':');
+		if (cp && cp != str && cp[-1] == '.' && cp[1] == '/')
+			str = cp + 1;
+		cu.comp_dir = str;
+	}
+
+	return cur.ok();
+}
+
+
+/**
+ * Read the attributes of the first DIE of a compilation unit, the cursor
+ * is positioned on its abbreviation code.
+ */
+bool read_cu_die(dwarf_cursor & cur, bfd * abfd, vector<bfd_byte> const & debug_abbrev,
+                 unsigned long long abbrev_offset, unsigned int version,
+                 unsigned int addr_size, bool dwarf64,
+                 vector<bfd_byte> const & debug_str, cu_info & cu)
+{
+	unsigned long long code = cur.uleb();
+	if (!cur.ok() || !code || abbrev_offset >= debug_abbrev.size())
+		return false;
+
+	dwarf_cursor abbrev(abfd, &debug_abbrev[abbrev_offset],
+	                    &debug_abbrev[0] + debug_abbrev.size());
+
+	// find the abbreviation, skipping the attribute specs of others
+	for (;;) {
+		unsigned long long abbrev_code = abbrev.uleb();
+		if (!abbrev.ok() || !abbrev_code)
+			return false;
+		if (abbrev_code == code)
+			break;
+		abbrev.uleb();
+		abbrev.u8();
+		while (abbrev.ok() && (abbrev.uleb() | abbrev.uleb()))
+			;
+	}
+	abbrev.uleb();
+	abbrev.u8();
+
+	while (abbrev.ok()) {
+		unsigned long long attr = abbrev.uleb();
+		unsigned long long form = abbrev.uleb();
+		if (!attr && !form)
+			return true;
+		if (!read_attribute(cur, attr, form, version, addr_size,
+		                    dwarf64, debug_str, cu))
+			return false;
+	}
+
+	return false;
+}
+
+
+/// build a source filename as bfd concat_filename() does
+string file_path(char const * name, unsigned long long dir,
+                 vector<char const *> const & dirs, char const * comp_dir)
+{
+	if (name[0] == '/')
+		return name;
+
+	char const * dir_name = 0;
+	char const * subdir_name = 0;
+
+	if (dir && dir <= dirs.size())
+		subdir_name = dirs[dir - 1];
+
+	if (!subdir_name || subdir_name[0] != '/')
+		dir_name = comp_dir;
+
+	if (!dir_name) {
+		dir_name = subdir_name;
+		subdir_name = 0;
+	}
+
+	if (!dir_name)
+		return name;
+
+	string result(dir_name);
+	result += '/';
+	if (subdir_name) {
+		result += subdir_name;
+		result += '/';
+	}
+	return result + name;
+}
+
+} // anonymous namespace
+
+
+line_table::line_table(bfd * abfd)
+{
+	// line program addresses of relocatable objects need relocation
+	if (!abfd || !(abfd->flags & (EXEC_P | DYNAMIC)))
+		return;
+
+	vector<bfd_byte> debug_info, debug_abbrev, debug_line, debug_str;
+	if (!read_section(abfd, ".debug_info", debug_info) ||
+	    !read_section(abfd, ".debug_abbrev", debug_abbrev) ||
+	    !read_section(abfd, ".debug_line", debug_line))
+		return;
+	read_section(abfd, ".debug_str", debug_str);
+
+	file_ids_t file_ids;
+	dwarf_cursor info(abfd, &debug_info[0], &debug_info[0] + debug_info.size());
+
+	while (!info.at_end()) {
+		bool dwarf64;
+		dwarf_cursor cur = info.unit(dwarf64);
+		if (!info.ok())
+			break;
+
+		// skip compilation units bfd can't handle either
+		unsigned int version = cur.u16();
+		if (version < 2 || version > 4)
+			continue;
+
+		unsigned long long abbrev_offset = cur.offset(dwarf64);
+		unsigned int addr_size = cur.u8();
+
+		cu_info cu;
+		if (!read_cu_die(cur, abfd, debug_abbrev, abbrev_offset, version,
+		                 addr_size, dwarf64, debug_str, cu))
+			continue;
+
+		if (cu.has_stmt_list)
+			decode_program(abfd, debug_line, cu.stmt_list,
+			               cu.comp_dir, file_ids);
+	}
+
+	stable_sort(rows.begin(), rows.end(), row_less);
+}
+
+
+bool line_table::decode_program(bfd * abfd, vector<bfd_byte> const & debug_line,
+                                unsigned long long offset, char const * comp_dir,
+                                file_ids_t & file_ids)
+{
+	if (offset >= debug_line.size())
+		return false;
+
+	dwarf_cursor section(abfd, &debug_line[offset],
+	                     &debug_line[0] + debug_line.size());
+	bool dwarf64;
+	dwarf_cursor cur = section.unit(dwarf64);
+
+	unsigned int version = cur.u16();
+	if (!section.ok() || version < 2 || version > 4)
+		return false;
+
+	unsigned long long header_length = cur.offset(dwarf64);
+	if (!cur.ok() || header_length > cur.left())
+		return false;
+	bfd_byte const * program = cur.pos() + header_length;
+
+	unsigned int min_insn_length = cur.u8();
+	if (version >= 4 && cur.u8() != 1)
+		return false;	// VLIW op_index is not supported
+	cur.u8();	// default_is_stmt, bfd ignores it
+	int line_base = (signed char)cur.u8();
+	unsigned int line_range = cur.u8();
+	unsigned int opcode_base = cur.u8();
+	if (!cur.ok() || !line_range || !opcode_base)
+		return false;
+
+	vector<unsigned int> opcode_lengths(opcode_base);
+	for (unsigned int i = 1; i < opcode_base; ++i)
+		opcode_lengths[i] = cur.u8();
+
+	vector<char const *> dirs;
+	for (char const * dir = cur.str(); dir && *dir; dir = cur.str())
+		dirs.push_back(dir);
+
+	vector<string> files;
+	for (char const * name = cur.str(); name && *name; name = cur.str()) {
+		unsigned long long dir = cur.uleb();
+		cur.uleb();
+		cur.uleb();
+		files.push_back(file_path(name, dir, dirs, comp_dir));
+	}
+
+	if (!cur.ok() || program < cur.pos())
+		return false;
+	cur.skip(program - cur.pos());
+
+	// rows hold the file number until the program end, define_file can
+	// add files at any point
+	size_t const first_row = rows.size();
+	size_t seq_start = first_row;
+	size_t seq_head = first_row;
+	row state;
+	state.vma = 0;
+	state.file = 1;
+	state.line = 1;
+
+	while (cur.ok() && !cur.at_end()) {
+		unsigned int opcode = cur.u8();
+
+		if (opcode >= opcode_base) {
+			unsigned int adjust = opcode - opcode_base;
+			state.vma += (adjust / line_range) * min_insn_length;
+			state.line += line_base + int(adjust % line_range);
+			add_row(state, seq_start, seq_head);
+			continue;
+		}
+
+		switch (opcode) {
+		case DW_LNS_extended_op: {
+			unsigned long long length = cur.uleb();
+			if (!length || length > cur.left()) {
+				cur.skip(length);
+				break;
+			}
+			bfd_byte const * next = cur.pos() + length;
+			switch (cur.u8()) {
+			case DW_LNE_end_sequence: {
+				row end = state;
+				end.file = end_sequence;
+				// bfd misses the end of a sequence not ending after
+				// its highest row and adds the next rows to it
+				bool const merged = seq_start != rows.size() &&
+					end.vma <= rows[seq_head].vma;
+				rows.push_back(end);
+				if (!merged) {
+					close_sequence(seq_start);
+					seq_start = seq_head = rows.size();
+				}
+				state.vma = 0;
+				state.file = 1;
+				state.line = 1;
+				break;
+			}
+			case DW_LNE_set_address:
+				state.vma = cur.address(length - 1);
+				break;
+			case DW_LNE_define_file: {
+				char const * name = cur.str();
+				unsigned long long dir = cur.uleb();
+				if (name)
+					files.push_back(file_path(name, dir, dirs, comp_dir));
+				break;
+			}
+			}
+			if (next < cur.pos())
+				cur.skip(length);
+			else
+				cur.skip(next - cur.pos());
+			break;
+		}
+		case DW_LNS_copy:
+			add_row(state, seq_start, seq_head);
+			break;
+		case DW_LNS_advance_pc:
+			state.vma += cur.uleb() * min_insn_length;
+			break;
+		case DW_LNS_advance_line:
+			state.line += cur.sleb();
+			break;
+		case DW_LNS_set_file:
+			state.file = cur.uleb();
+			break;
+		case DW_LNS_const_add_pc:
+			state.vma += ((255 - opcode_base) / line_range) * min_insn_length;
+			break;
+		case DW_LNS_fixed_advance_pc:
+			state.vma += cur.u16();
+			break;
+		default:
+			// including the other standard opcodes, none of them
+			// changes the address or the line
+			for (unsigned int i = 0; i < opcode_lengths[opcode]; ++i)
+				cur.uleb();
+			break;
+		}
+	}
+
+	if (!cur.ok()) {
+		rows.resize(first_row);
+		return false;
+	}
+
+	// an unterminated sequence ends at its last row, as for bfd
+	if (seq_start != rows.size()) {
+		rows[seq_head].file = end_sequence;
+		close_sequence(seq_start);
+	}
+
+	// map the file numbers of this unit to global filename indexes
+	vector<unsigned int> file_index(files.size() + 1);
+	for (size_t i = 0; i <= files.size(); ++i) {
+		string const & name = i ? files[i - 1] : string("<unknown>");
+		file_ids_t::const_iterator it = file_ids.find(name);
+		if (it == file_ids.end()) {
+			it = file_ids.insert(make_pair(name, filenames.size())).first;
+			filenames.push_back(name);
+		}
+		file_index[i] = it->second;
+	}
+
+	for (size_t i = first_row; i < rows.size(); ++i) {
+		unsigned int & file = rows[i].file;
+		if (file == end_sequence)
+			continue;
+		file = file_index[file <= files.size() ? file : 0];
+	}
+
+	return true;
+}
+
+
+void line_table::add_row(row const & r, size_t seq_start, size_t & seq_head)
+{
+	if (seq_start == rows.size() || r.vma > rows[seq_head].vma) {
+		seq_head = rows.size();
+		rows.push_back(r);
+	} else if (r.vma == rows[seq_head].vma) {
+		// bfd keeps the last of the rows added at the sequence end
+		rows[seq_head] = r;
+	} else {
+		rows.push_back(r);
+	}
+}
+
+
+void line_table::close_sequence(size_t seq_start)
+{
+	vector<row>::iterator begin = rows.begin() + seq_start;
+	stable_sort(begin, rows.end(), row_less);
+
+	// bfd keeps the first of the rows added out of order at an address,
+	// in order rows at the same address have already been merged
+	vector<row>::iterator it = begin;
+	vector<row>::iterator out = begin;
+	for (; it != rows.end(); ++it) {
+		if (out != begin && (out - 1)->vma == it->vma &&
+		    (out - 1)->file != end_sequence && it->file != end_sequence)
+			continue;
+		*out++ = *it;
+	}
+	rows.erase(out, rows.end());
+}
+
+
+bool line_table::row_less(row const & lhs, row const & rhs)
+{
+	if (lhs.vma != rhs.vma)
+		return lhs.vma < rhs.vma;
+	// a sequence end sorts before a row starting at the same address
+	return lhs.file == end_sequence && rhs.file != end_sequence;
+}
+
+
+bool line_table::vma_less(bfd_vma vma, row const & rhs)
+{
+	return vma < rhs.vma;
+}
+
+
+bool line_table::find(bfd_vma vma, string & filename,
+                      unsigned int & linenr) const
+{
+	vector<row>::const_iterator it =
+		upper_bound(rows.begin(), rows.end(), vma, vma_less);
+	if (it == rows.begin())
+		return false;
+	--it;
+	if (it->file == end_sequence)
+		return false;
+
+	// rows of overlapping sequences, bfd would use the first sequence
+	while (it != rows.begin() && (it - 1)->vma == it->vma &&
+	       (it - 1)->file != end_sequence)
+		--it;
+
+	filename = filenames[it->file];
+	linenr = it->line;
+	return true;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file line_table.h
+ * Address to source line table decoded from DWARF line programs
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef LINE_TABLE_H
+#define LINE_TABLE_H
+
+#include "config.h"
+#include "utility.h"
+
+#include <bfd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * All the rows of the .debug_line programs of an image sorted by address,
+ * so a lookup is a binary search rather than a bfd_find_nearest_line()
+ * call. Like the bfd in use only DWARF 2 to 4 compilation units are
+ * decoded, and only for linked images since relocations are not applied;
+ * addresses the table does not cover must be looked up through bfd.
+ */
+class line_table : noncopyable {
+public:
+	/// an empty table, see symbol_cache::load_lines()
+	line_table() {}
+
+	/// decode the line programs of abfd, the table is empty on failure
+	explicit line_table(bfd * abfd);
+
+	/// return true if no line program row has been decoded
+	bool empty() const { return rows.empty(); }
+
+	/// nr. of line program rows
+	size_t size() const { return rows.size(); }
+
+	/**
+	 * find - look up the source line of an address
+	 * @param vma the address
+	 * @param filename source filename, output parameter
+	 * @param linenr line number, output parameter
+	 *
+	 * Return false if vma is not covered by a line program. linenr is
+	 * zero if the row covering vma has no line number, as for a
+	 * bfd_find_nearest_line() lookup the caller must then check the
+	 * function and look for the line of the next rows.
+	 */
+	bool find(bfd_vma vma, std::string & filename,
+	          unsigned int & linenr) const;
+
+private:
+	friend class symbol_cache;
+
+	/// a line program row, or the end of a sequence
+	struct row {
+		bfd_vma vma;
+		/// index in filenames, or end_sequence
+		unsigned int file;
+		unsigned int line;
+	};
+
+	static unsigned int const end_sequence = ~0U;
+
+	static bool row_less(row const & lhs, row const & rhs);
+	static bool vma_less(bfd_vma vma, row const & rhs);
+
+	typedef std::map<std::string, unsigned int> file_ids_t;
+
+	/// add a row to the sequence starting at seq_start
+	void add_row(row const & r, size_t seq_start, size_t & seq_head);
+
+	/// sort the rows of a sequence and drop the ones bfd would ignore
+	void close_sequence(size_t seq_start);
+
+	/// decode the line program of a compilation unit
+	bool decode_program(bfd * abfd, std::vector<bfd_byte> const & debug_line,
+	                    unsigned long long offset, char const * comp_dir,
+	                    file_ids_t & file_ids);
+
+	std::vector<row> rows;
+	std::vector<std::string> filenames;
+};
+
+#endif /* !LINE_TABLE_H */
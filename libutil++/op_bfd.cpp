@@ -27,6 +27,7 @@
 #include <sstream>
 
 #include "op_bfd.h"
+#include "elf_symbols.h"
 #include "locate_images.h"
 #include "string_filter.h"
 #include "stream_util.h"
@@ -53,33 +54,48 @@ struct remove_filter {
 };
 
 
+/// function object for removing the symbols of filtered sections
+struct section_filter {
+	section_filter(vector<asection const *> const & sections)
+		: sections_(sections) {}
+
+	bool operator()(op_bfd_symbol const & symbol) {
+		return find(sections_.begin(), sections_.end(),
+		            symbol.section()) != sections_.end();
+	}
+
+	vector<asection const *> const & sections_;
+};
+
+
 } // namespace anon
 
 
 op_bfd_symbol::op_bfd_symbol(asymbol const * a)
-	: bfd_symbol(a), symb_value(a->value),
+	: bfd_symbol(a), symb_section(a->section), symb_value(a->value),
 	  section_filepos(a->section->filepos),
 	  section_vma(a->section->vma),
 	  symb_size(0), symb_hidden(false), symb_weak(false),
 	  symb_artificial(false)
 {
-	// Some sections have unnamed symbols in them. If
-	// we just ignore them then we end up sticking
-	// things like .plt hits inside of _init. So instead
-	// we name the symbol after the section.
-	if (a->name && a->name[0] != '\0') {
-		symb_name = a->name;
-		symb_weak = a->flags & BSF_WEAK;
-		symb_hidden = (a->flags & BSF_LOCAL)
- 			&& !(a->flags & BSF_GLOBAL);
-	} else {
-		symb_name = string("??") + a->section->name;
-	}
+	set_name(a->name, a->flags);
+}
+
+
+op_bfd_symbol::op_bfd_symbol(asection const * section, bfd_vma value,
+                             char const * name, flagword flags)
+	: bfd_symbol(0), symb_section(section), symb_value(value),
+	  section_filepos(section->filepos),
+	  section_vma(section->vma),
+	  symb_size(0), symb_hidden(false), symb_weak(false),
+	  symb_artificial(false)
+{
+	set_name(name, flags);
 }
 
 
 op_bfd_symbol::op_bfd_symbol(bfd_vma vma, size_t size, string const & name)
-	: bfd_symbol(0), symb_value(vma),
+	: bfd_symbol(0), symb_section(0), symb_value(vma),
 	  section_filepos(0), section_vma(0),
 	  symb_size(size), symb_name(name),
 	  symb_hidden(false), symb_weak(false), symb_artificial(true)
@@ -87,6 +103,34 @@ op_bfd_symbol::op_bfd_symbol(bfd_vma vma, size_t size, string const & name)
 }
 
 
+op_bfd_symbol::op_bfd_symbol(asection const * section, unsigned long value,
+                             unsigned long filepos, size_t size,
+                             string const & name, bool hidden, bool weak)
+	: bfd_symbol(0), symb_section(section), symb_value(value),
+	  section_filepos(filepos), section_vma(section->vma),
+	  symb_size(size), symb_name(name),
+	  symb_hidden(hidden), symb_weak(weak), symb_artificial(false)
+{
+}
+
+
+void op_bfd_symbol::set_name(char const * name, flagword flags)
+{
+	// Some sections have unnamed symbols in them. If
+	// we just ignore them then we end up sticking
+	// things like .plt hits inside of _init. So instead
+	// we name the symbol after the section.
+	if (name && name[0] != '\0') {
+		symb_name = name;
+		symb_weak = flags & BSF_WEAK;
+		symb_hidden = (flags & BSF_LOCAL)
+ 			&& !(flags & BSF_GLOBAL);
+	} else {
+		symb_name = string("??") + symb_section->name;
+	}
+}
+
+
 bool op_bfd_symbol::operator<(op_bfd_symbol const & rhs) const
 {
 	return filepos() < rhs.filepos();
@@ -94,7 +138,7 @@ bool op_bfd_symbol::operator<(op_bfd_symbol const & rhs) const
 
 unsigned long op_bfd_symbol::symbol_endpos(void) const
 {
-	return bfd_symbol->section->filepos + bfd_symbol->section->size;
+	return symb_section->filepos + symb_section->size;
 }
 
 
@@ -105,14 +149,16 @@ op_bfd::op_bfd(string const & fname, string_filter const & symbol_filter,
 	archive_path(extra_images.get_archive_path()),
 	extra_found_images(extra_images),
 	file_size(-1),
+	cached_syms(false),
+	bfd_syms_loaded(false),
+	lines_cached(false),
 	anon_obj(false),
 	vma_adj(0)
 {
 	fd =  -1;
 	struct stat st;
-	// after creating all symbol it's convenient for user code to access
-	// symbols through a vector. We use an intermediate list to avoid a
-	// O(N�) behavior when we will filter vector element below
+	// symbols are gathered, sorted and filtered in a temporary vector
+	// before being swapped into syms
 	symbols_found_t symbols;
 	asection const * sect;
 	string suf = ".jo";
@@ -174,8 +220,24 @@ op_bfd::op_bfd(string const & fname, string_filter const & symbol_filter,
 		}
 	}
 
+	sym_cache.reset(new symbol_cache(ibfd.abfd, st));
+	if (sym_cache->load_symbols(ibfd.abfd, symbols, debug_filename)) {
+		// only images with debug info are cached
+		debug_info.reset(true);
+		cached_syms = true;
+		goto out;
+	}
+
 	get_symbols(symbols);
 
+	// a prelinked image and its debug file disagree on the section
+	// vmas, and the symbols of an image whose debug file is not found
+	// yet would change when it is installed
+	if (vma_adj == 0 && has_debug_info() && !symbols.empty()) {
+		sym_cache->save_symbols(symbols,
+			dbfd.valid() ? debug_filename : string());
+	}
+
 out:
 	add_symbols(symbols, symbol_filter);
 	return;
@@ -210,7 +272,26 @@ unsigned long op_bfd::get_start_offset(bfd_vma vma) const
 
 void op_bfd::get_symbols(op_bfd::symbols_found_t & symbols)
 {
-	ibfd.get_symbols();
+	// plain ELF symbol tables are read in place, the bfd symbols are then
+	// loaded only if a bfd lookup needs them
+	size_t nr_image_syms = 0;
+	bool const elf_image = read_elf_symbols(ibfd.abfd, symbols, nr_image_syms);
+	if (elf_image) {
+		symbols.erase(remove_if(symbols.begin(), symbols.end(),
+		                        section_filter(filtered_section)),
+		              symbols.end());
+	} else {
+		ibfd.get_symbols();
+		nr_image_syms = ibfd.nr_syms;
+		for (size_t i = 0; i < ibfd.nr_syms; ++i) {
+			if (!interesting_symbol(ibfd.syms[i]))
+				continue;
+			if (find(filtered_section.begin(), filtered_section.end(),
+				 ibfd.syms[i]->section) != filtered_section.end())
+				continue;
+			symbols.push_back(op_bfd_symbol(ibfd.syms[i]));
+		}
+	}
 
 	// On separate debug file systems, the main bfd has no symbols,
 	// so even for non -g reports, we want to process the dbfd.
@@ -219,67 +300,65 @@ void op_bfd::get_symbols(op_bfd::symbols_found_t & symbols)
 	has_debug_info();
 
 	dbfd.set_image_bfd_info(&ibfd);
-	dbfd.get_symbols();
-	if (dbfd.valid() && !ibfd.nr_syms)
-		vma_adj = ibfd.abfd->start_address - dbfd.abfd->start_address;
-	else
-		vma_adj= 0;
 
-	size_t i;
-	for (i = 0; i < ibfd.nr_syms; ++i) {
-		if (!interesting_symbol(ibfd.syms[i]))
-			continue;
-		if (find(filtered_section.begin(), filtered_section.end(),
-			 ibfd.syms[i]->section) != filtered_section.end())
-			continue;
-		symbols.push_back(op_bfd_symbol(ibfd.syms[i]));
+	// need to use filepos of original file's section for debug file
+	// symbols. We probably need to be more careful for special symbols
+	// which have ->section from .rodata like *ABS*
+	if (dbfd.valid()) {
+		for (asection * sect = dbfd.abfd->sections; sect;
+		     sect = sect->next) {
+			if (!(sect->flags & SEC_CODE))
+				continue;
+			filepos_map_t::const_iterator it =
+				filepos_map.find(sect->name);
+			if (it != filepos_map.end() && it->second != 0)
+				sect->filepos = it->second;
+		}
 	}
 
-	for (i = 0; i < dbfd.nr_syms; ++i) {
-		if (!interesting_symbol(dbfd.syms[i]))
-			continue;
-
-		// need to use filepos of original file's section for
-		// debug file symbols. We probably need to be more
-		// careful for special symbols which have ->section from
-		// .rodata like *ABS*
-		u32 filepos = filepos_map[dbfd.syms[i]->section->name];
-		if (filepos != 0)
-			dbfd.syms[i]->section->filepos = filepos;
-		symbols.push_back(op_bfd_symbol(dbfd.syms[i]));
+	size_t nr_debug_syms = 0;
+	bool const elf_debug = dbfd.valid() &&
+		read_elf_symbols(dbfd.abfd, symbols, nr_debug_syms);
+	if (!elf_debug) {
+		dbfd.get_symbols();
+		for (size_t i = 0; i < dbfd.nr_syms; ++i) {
+			if (interesting_symbol(dbfd.syms[i]))
+				symbols.push_back(op_bfd_symbol(dbfd.syms[i]));
+		}
 	}
 
-	symbols.sort();
+	bfd_syms_loaded = !elf_image && !elf_debug;
+
+	if (dbfd.valid() && !nr_image_syms)
+		vma_adj = ibfd.abfd->start_address - dbfd.abfd->start_address;
+	else
+		vma_adj= 0;
 
-	symbols_found_t::iterator it = symbols.begin();
+	stable_sort(symbols.begin(), symbols.end());
 
 	// we need to ensure than for a given vma only one symbol exist else
 	// we read more than one time some samples. Fix #526098
-	while (it != symbols.end()) {
-		symbols_found_t::iterator temp = it;
-		++temp;
-		if (temp != symbols.end() && (it->vma() == temp->vma()) &&
-			(it->filepos() == temp->filepos())) {
-			if (boring_symbol(*it, *temp)) {
-				it = symbols.erase(it);
-			} else {
-				symbols.erase(temp);
-			}
+	size_t kept = 0;
+	for (size_t i = 1; i < symbols.size(); ++i) {
+		if (symbols[kept].vma() == symbols[i].vma() &&
+		    symbols[kept].filepos() == symbols[i].filepos()) {
+			if (boring_symbol(symbols[kept], symbols[i]))
+				symbols[kept] = symbols[i];
 		} else {
-			++it;
+			symbols[++kept] = symbols[i];
 		}
 	}
+	if (!symbols.empty())
+		symbols.erase(symbols.begin() + kept + 1, symbols.end());
 
 	// now we can calculate the symbol size, we can't first include/exclude
 	// symbols because the size of symbol is calculated from the difference
 	// between the vma of a symbol and the next one.
-	for (it = symbols.begin() ; it != symbols.end(); ++it) {
+	for (size_t i = 0; i < symbols.size(); ++i) {
 		op_bfd_symbol const * next = 0;
-		symbols_found_t::iterator temp = it;
-		++temp;
-		if (temp != symbols.end())
-			next = &*temp;
-		it->size(symbol_size(*it, next));
+		if (i + 1 < symbols.size())
+			next = &symbols[i + 1];
+		symbols[i].size(symbol_size(symbols[i], next));
 	}
 }
 
@@ -294,11 +373,10 @@ void op_bfd::add_symbols(op_bfd::symbols_found_t & symbols,
 	cverb << vbfd << "number of symbols before filtering "
 	      << dec << symbols.size() << hex << endl;
 
-	symbols_found_t::iterator it;
-	it = remove_if(symbols.begin(), symbols.end(),
-	               remove_filter(symbol_filter));
-
-	copy(symbols.begin(), it, back_inserter(syms));
+	symbols.erase(remove_if(symbols.begin(), symbols.end(),
+	                        remove_filter(symbol_filter)),
+	              symbols.end());
+	syms.swap(symbols);
 
 	cverb << vbfd << "number of symbols now "
 	      << dec << syms.size() << hex << endl;
@@ -336,7 +414,10 @@ get_symbol_contents(symbol_index_t sym_index, unsigned char * contents) const
 	op_bfd_symbol const & bfd_sym = syms[sym_index];
 	size_t size = bfd_sym.size();
 
-	if (!bfd_get_section_contents(ibfd.abfd, bfd_sym.symbol()->section, 
+	op_mutex_lock lock(bfd_mutex);
+
+	if (!bfd_get_section_contents(ibfd.abfd,
+				 const_cast<asection *>(bfd_sym.section()),
 				 contents, 
 				 static_cast<file_ptr>(bfd_sym.value()), size)) {
 		return false;
@@ -345,6 +426,13 @@ get_symbol_contents(symbol_index_t sym_index, unsigned char * contents) const
 }
 
 bool op_bfd::has_debug_info() const
+{
+	op_mutex_lock lock(bfd_mutex);
+	return check_debug_info();
+}
+
+
+bool op_bfd::check_debug_info() const
 {
 	if (debug_info.cached())
 		return debug_info.get();
@@ -375,14 +463,34 @@ bool op_bfd::has_debug_info() const
 bool op_bfd::get_linenr(symbol_index_t sym_idx, bfd_vma offset,
 			string & source_filename, unsigned int & linenr) const
 {
-	if (!has_debug_info())
+	op_mutex_lock lock(bfd_mutex);
+
+	if (!check_debug_info())
 		return false;
 
-	bfd_info const & b = dbfd.valid() ? dbfd : ibfd;
 	op_bfd_symbol const & sym = syms[sym_idx];
 
+	if (cached_syms) {
+		if (!lines_cached) {
+			cached_lines.reset(new line_table);
+			lines_cached = sym_cache->load_lines(*cached_lines);
+		}
+		if (find_cached_line(sym, offset, source_filename, linenr))
+			return true;
+	}
+
+	load_bfd_symbols();
+
+	bfd_info const & b = dbfd.valid() ? dbfd : ibfd;
+
 	linenr_info const info = find_nearest_line(b, sym, offset, anon_obj);
 
+	if (sym_cache.get() && !lines_cached) {
+		lines_cached = true;
+		if (!b.get_line_table().empty())
+			sym_cache->save_lines(b.get_line_table());
+	}
+
 	if (!info.found)
 		return false;
 
@@ -392,6 +500,52 @@ bool op_bfd::get_linenr(symbol_index_t sym_idx, bfd_vma offset,
 }
 
 
+void op_bfd::load_bfd_symbols() const
+{
+	if (bfd_syms_loaded)
+		return;
+
+	cverb << vbfd << "loading bfd symbols of " << filename << endl;
+
+	bfd_syms_loaded = true;
+	cached_syms = false;
+	ibfd.get_symbols();
+	if (!dbfd.valid() && !debug_filename.empty())
+		dbfd.abfd = open_bfd(debug_filename);
+	dbfd.set_image_bfd_info(&ibfd);
+	dbfd.get_symbols();
+
+	if (cached_lines.get() && lines_cached) {
+		bfd_info & b = dbfd.valid() ? dbfd : ibfd;
+		b.set_line_table(cached_lines.release());
+	}
+	cached_lines.reset();
+}
+
+
+bool op_bfd::find_cached_line(op_bfd_symbol const & sym, bfd_vma offset,
+                              string & source_filename,
+                              unsigned int & linenr) const
+{
+	asection const * section = sym.section();
+	if (!section || !(section->flags & SEC_ALLOC) || cached_lines->empty())
+		return false;
+
+	// the same address find_nearest_line() looks up, cached images
+	// share their section vmas with their debug file
+	bfd_vma const pc = anon_obj ? offset - section->vma
+		: (sym.value() + offset) - sym.filepos();
+	if (pc >= section->size)
+		return false;
+
+	bfd_vma const vma = section->output_section
+		? section->output_section->vma + section->output_offset
+		: section->vma;
+	// a row without line number needs the bfd function check and fixup
+	return cached_lines->find(vma + pc, source_filename, linenr) && linenr;
+}
+
+
 size_t op_bfd::symbol_size(op_bfd_symbol const & sym,
 			   op_bfd_symbol const * next) const
 {
@@ -433,10 +587,10 @@ void op_bfd::get_symbol_range(symbol_index_t sym_idx,
 	cverb << (vbfd & vlevel1)
 	      << "start " << hex << start << ", end " << end << endl;
 
-	if (sym.symbol()) {
+	if (sym.section()) {
 		cverb << (vbfd & vlevel1) << "in section "
-		      << sym.symbol()->section->name << ", filepos "
-		      << hex << sym.symbol()->section->filepos << endl;
+		      << sym.section()->name << ", filepos "
+		      << hex << sym.section()->filepos << endl;
 	}
 }
 
@@ -16,14 +16,15 @@
 
 #include <vector>
 #include <string>
-#include <list>
 #include <map>
 #include <set>
 
 #include "bfd_support.h"
+#include "symbol_cache.h"
 #include "locate_images.h"
 #include "utility.h"
 #include "cached_value.h"
+#include "parallel.h"
 #include "op_types.h"
 
 class op_bfd;
@@ -44,14 +45,23 @@ public:
 	/// ctor for real symbols
 	op_bfd_symbol(asymbol const * a);
 
+	/// ctor for real symbols read without bfd, see read_elf_symbols()
+	op_bfd_symbol(asection const * section, bfd_vma value,
+	              char const * name, flagword flags);
+
 	/// ctor for artificial symbols
 	op_bfd_symbol(bfd_vma vma, size_t size, std::string const & name);
 
+	/// ctor for symbols read from the symbol cache
+	op_bfd_symbol(asection const * section, unsigned long value,
+	              unsigned long filepos, size_t size,
+	              std::string const & name, bool hidden, bool weak);
+
 	bfd_vma vma() const { return symb_value + section_vma; }
 	unsigned long value() const { return symb_value; }
 	unsigned long filepos() const { return symb_value + section_filepos; }
 	unsigned long symbol_endpos(void) const;
-	asection const * section(void) const { return bfd_symbol->section; }
+	asection const * section(void) const { return symb_section; }
 	std::string const & name() const { return symb_name; }
 	asymbol const * symbol() const { return bfd_symbol; }
 	size_t size() const { return symb_size; }
@@ -64,9 +74,14 @@ public:
 	bool operator<(op_bfd_symbol const & lhs) const;
 
 private:
+	/// set the name and the visibility of a real symbol
+	void set_name(char const * name, flagword flags);
+
 	/// the original bfd symbol, this can be null if the symbol is an
-	/// artificial symbol
+	/// artificial symbol or was not read through bfd
 	asymbol const * bfd_symbol;
+	/// the section of this symbol, null for an artificial symbol
+	asection const * symb_section;
 	/// the offset of this symbol relative to the begin of the section's
 	/// symbol
 	unsigned long symb_value;
@@ -216,7 +231,7 @@ public:
 
 private:
 	/// temporary container type for getting symbols
-	typedef std::list<op_bfd_symbol> symbols_found_t;
+	typedef std::vector<op_bfd_symbol> symbols_found_t;
 
 	/**
 	 * Parse and sort in ascending order all symbols
@@ -260,6 +275,22 @@ private:
 	 */
 	uint process_symtab(bfd_info * bfd, uint start);
 
+	/**
+	 * Load the bfd symbols, and the debug file if it is not opened yet,
+	 * which syms were built without when they come from the symbol cache
+	 * or from read_elf_symbols(); bfd lookups need them. The cached line
+	 * table is handed over to the bfd used for lookups.
+	 */
+	void load_bfd_symbols() const;
+
+	/// has_debug_info() with bfd_mutex held
+	bool check_debug_info() const;
+
+	/// look up a source line in the cached line table
+	bool find_cached_line(op_bfd_symbol const & sym, bfd_vma offset,
+	                      std::string & filename,
+	                      unsigned int & linenr) const;
+
 	/// filename we open (not including archive path)
 	std::string filename;
 
@@ -278,8 +309,9 @@ private:
 	/// true if at least one section has (flags & SEC_DEBUGGING) != 0
 	mutable cached_value<bool> debug_info;
 
-	/// our main bfd object: .bfd may be NULL
-	bfd_info ibfd;
+	/// our main bfd object: .bfd may be NULL, its symbols are loaded
+	/// lazily if syms come from the symbol cache
+	mutable bfd_info ibfd;
 
 	// corresponding debug bfd object, if one is found
 	mutable bfd_info dbfd;
@@ -290,6 +322,28 @@ private:
 	/// kernel modules where all code section vma are set to 0.
 	std::vector<asection const *> filtered_section;
 
+	/// symbol cache of the image, NULL if the image can't be cached
+	scoped_ptr<symbol_cache> sym_cache;
+
+	/// true while syms come from the symbol cache and no bfd symbols
+	/// have been loaded
+	mutable bool cached_syms;
+
+	/// true once the bfd symbols of ibfd and dbfd are loaded
+	mutable bool bfd_syms_loaded;
+
+	/// line table read from the symbol cache, used while cached_syms
+	mutable scoped_ptr<line_table> cached_lines;
+
+	/// true once the line table has been looked for in or written to
+	/// the symbol cache
+	mutable bool lines_cached;
+
+	/// op_bfd_cache shares an op_bfd between threads: the const methods
+	/// loading the debug file, the symbols or the line tables above and
+	/// reading through the bfds hold this lock
+	mutable op_mutex bfd_mutex;
+
 	typedef std::map<std::string, u32> filepos_map_t;
 	// mapping of section names to filepos in the original binary
 	filepos_map_t filepos_map;
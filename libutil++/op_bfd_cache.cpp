@@ -0,0 +1,132 @@
+/**
+ * @file op_bfd_cache.cpp
+ * Share op_bfd objects between the users of the same image
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "op_bfd_cache.h"
+#include "op_bfd.h"
+#include "cverb.h"
+
+#include <iostream>
+
+using namespace std;
+
+extern verbose vbfd;
+
+
+bool op_bfd_cache::key::operator<(key const & rhs) const
+{
+	if (spu_offset != rhs.spu_offset)
+		return spu_offset < rhs.spu_offset;
+	if (open != rhs.open)
+		return open < rhs.open;
+	return filename < rhs.filename;
+}
+
+
+op_bfd_cache::op_bfd_cache(string_filter const & symbol_filter_,
+                           extra_images const & extra_, size_t max_images_)
+	:
+	symbol_filter(symbol_filter_),
+	extra(extra_),
+	max_images(max_images_),
+	hits(0),
+	misses(0)
+{
+}
+
+
+op_bfd_cache::~op_bfd_cache()
+{
+	cverb << vbfd << "op_bfd cache: " << dec << hits << " hits, " << misses
+	      << " misses" << endl;
+
+	entries_t::iterator it;
+	for (it = entries.begin(); it != entries.end(); ++it)
+		delete it->second.abfd;
+}
+
+
+op_bfd_cache::entries_t::iterator
+op_bfd_cache::get(key const & k, bool & ok)
+{
+	entries_t::iterator it = entries.find(k);
+	if (it != entries.end()) {
+		++hits;
+		entry & e = it->second;
+		if (!e.refs++)
+			lru.erase(e.lru_pos);
+		ok = e.ok;
+		return it;
+	}
+
+	++misses;
+	// build it before inserting it, the ctor can throw
+	op_bfd * abfd = k.spu_offset
+		? new op_bfd(k.spu_offset, k.filename, symbol_filter, extra, ok)
+		: new op_bfd(k.filename, symbol_filter, extra, ok);
+
+	it = entries.insert(entries_t::value_type(k, entry())).first;
+	it->second.abfd = abfd;
+	it->second.ok = ok;
+	it->second.refs = 1;
+	return it;
+}
+
+
+void op_bfd_cache::release(entries_t::iterator it)
+{
+	entry & e = it->second;
+	if (--e.refs)
+		return;
+
+	e.lru_pos = lru.insert(lru.begin(), it->first);
+
+	while (lru.size() > max_images) {
+		entries_t::iterator old = entries.find(lru.back());
+		cverb << vbfd << "op_bfd cache: closing "
+		      << old->first.filename << endl;
+		delete old->second.abfd;
+		entries.erase(old);
+		lru.pop_back();
+	}
+}
+
+
+cached_op_bfd::cached_op_bfd(op_bfd_cache & cache_,
+                             string const & filename, bool & ok)
+	: cache(cache_)
+{
+	op_bfd_cache::key const k = { filename, 0, ok };
+	it = cache.get(k, ok);
+}
+
+
+cached_op_bfd::cached_op_bfd(op_bfd_cache & cache_, uint64_t spu_offset,
+                             string const & filename, bool & ok)
+	: cache(cache_)
+{
+	op_bfd_cache::key const k = { filename, spu_offset, ok };
+	it = cache.get(k, ok);
+}
+
+
+cached_op_bfd::~cached_op_bfd()
+{
+	cache.release(it);
+}
+
+
+op_bfd const & cached_op_bfd::operator*() const
+{
+	return *it->second.abfd;
+}
+
+
+op_bfd const * cached_op_bfd::operator->() const
+{
+	return it->second.abfd;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file op_bfd_cache.h
+ * Share op_bfd objects between the users of the same image
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef OP_BFD_CACHE_H
+#define OP_BFD_CACHE_H
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "utility.h"
+
+class op_bfd;
+class string_filter;
+class extra_images;
+
+/**
+ * A cache of the op_bfd objects built with the same symbol filter and
+ * extra images, keyed by image name and embedded SPU offset. Opening an
+ * image and building its symbol table is costly, this lets the callers
+ * which meet the same images again and again, one callgraph file at a
+ * time, open them once.
+ *
+ * The objects are reference counted through cached_op_bfd. At most
+ * max_images unreferenced objects are kept, the least recently used
+ * being closed first. The hit and miss counts are shown under
+ * --verbose=bfd when the cache is destroyed.
+ *
+ * The filter and the extra images must outlive the cache.
+ */
+class op_bfd_cache : noncopyable {
+public:
+	op_bfd_cache(string_filter const & symbol_filter,
+	             extra_images const & extra, size_t max_images = 64);
+
+	~op_bfd_cache();
+
+	/// nr. of op_bfd found in the cache
+	size_t nr_hits() const { return hits; }
+	/// nr. of op_bfd built
+	size_t nr_misses() const { return misses; }
+	/// nr. of op_bfd held, referenced or not
+	size_t nr_images() const { return entries.size(); }
+
+private:
+	friend class cached_op_bfd;
+
+	/// what an op_bfd is built from
+	struct key {
+		/// the image name, not resolved through the extra images as
+		/// op_bfd::get_filename() returns it
+		std::string filename;
+		/// the embedded SPU image offset, 0 if none
+		uint64_t spu_offset;
+		/// the ok value given to the op_bfd ctor
+		bool open;
+
+		bool operator<(key const & rhs) const;
+	};
+
+	/// unreferenced entries, most recently used first
+	typedef std::list<key> lru_t;
+
+	struct entry {
+		entry() : abfd(0), ok(false), refs(0) {}
+
+		op_bfd * abfd;
+		/// the ok value returned by the op_bfd ctor
+		bool ok;
+		/// nr. of cached_op_bfd using it
+		size_t refs;
+		/// position in lru if refs == 0
+		lru_t::iterator lru_pos;
+	};
+
+	typedef std::map<key, entry> entries_t;
+
+	/// return the op_bfd for this key, building it if needed
+	entries_t::iterator get(key const & k, bool & ok);
+
+	/// drop a reference returned by get()
+	void release(entries_t::iterator it);
+
+	string_filter const & symbol_filter;
+	extra_images const & extra;
+	size_t max_images;
+
+	entries_t entries;
+	lru_t lru;
+
+	size_t hits;
+	size_t misses;
+};
+
+
+/**
+ * A reference to an op_bfd of an op_bfd_cache, the arguments are the
+ * ones of the op_bfd ctors.
+ */
+class cached_op_bfd : noncopyable {
+public:
+	cached_op_bfd(op_bfd_cache & cache, std::string const & filename,
+	              bool & ok);
+
+	cached_op_bfd(op_bfd_cache & cache, uint64_t spu_offset,
+	              std::string const & filename, bool & ok);
+
+	~cached_op_bfd();
+
+	op_bfd const & operator*() const;
+	op_bfd const * operator->() const;
+
+private:
+	op_bfd_cache & cache;
+	op_bfd_cache::entries_t::iterator it;
+};
+
+#endif /* !OP_BFD_CACHE_H */
@@ -0,0 +1,435 @@
+/**
+ * @file op_disassembler.cpp
+ * Disassemble a binary image in-process with libopcodes
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "op_disassembler.h"
+#include "bfd_support.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#ifdef HAVE_LIBOPCODES
+#include <dis-asm.h>
+#endif
+
+using namespace std;
+
+#ifdef HAVE_LIBOPCODES
+
+struct op_disassembler::state {
+	state() : abfd(0), disasm(0), synth_syms(0), section(0) {}
+
+	~state() {
+		free(synth_syms);
+		if (abfd)
+			bfd_close(abfd);
+	}
+
+	/// the code section holding vma, NULL if none
+	asection * find_section(bfd_vma vma) const;
+
+	/// the index in syms of the function symbol named name at vma, the
+	/// first code symbol at vma if there is none with this name, npos
+	/// if none
+	size_t find_function(string const & name, bfd_vma vma) const;
+
+	/// the section of the symbol at index place in syms, of the first
+	/// code section holding vma if place is npos, NULL if none
+	asection * function_section(size_t place, bfd_vma vma) const;
+
+	/// read the contents of sect, return false on failure
+	bool load_section(asection * sect);
+
+	/// the last symbol at or before vma, NULL if none
+	asymbol const * find_symbol(bfd_vma vma) const;
+
+	bfd * abfd;
+	disassembler_ftype disasm;
+	disassemble_info info;
+	/// the text of the instruction being decoded
+	string text;
+
+	static size_t const npos = size_t(-1);
+
+	/// the symbols of abfd sorted by address, the disassembler symtab
+	vector<asymbol *> syms;
+	scoped_array<asymbol *> bfd_syms;
+	scoped_array<asymbol *> dyn_syms;
+	asymbol * synth_syms;
+
+	/// the section whose contents are in contents
+	asection * section;
+	vector<bfd_byte> contents;
+};
+
+
+namespace {
+
+int text_printf(void * stream, char const * format, ...)
+{
+	char buf[256];
+	va_list args;
+	va_start(args, format);
+	int const len = vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+
+	string & text = *static_cast<string *>(stream);
+	if (len < int(sizeof(buf))) {
+		text += buf;
+		return len;
+	}
+
+	vector<char> big(len + 1);
+	va_start(args, format);
+	vsnprintf(&big[0], big.size(), format, args);
+	va_end(args);
+	text += &big[0];
+	return len;
+}
+
+
+/// as objdump_print_addr(): the address then the nearest symbol
+void print_address(bfd_vma vma, disassemble_info * info)
+{
+	op_disassembler::state const & st =
+		*static_cast<op_disassembler::state *>(info->application_data);
+
+	ostringstream os;
+	os << hex << vma;
+
+	asymbol const * sym = st.find_symbol(vma);
+	if (sym) {
+		os << " <" << bfd_asymbol_name(sym);
+		bfd_vma const value = bfd_asymbol_value(sym);
+		if (vma != value)
+			os << "+0x" << (vma - value);
+		os << '>';
+	}
+
+	info->fprintf_func(info->stream, "%s", os.str().c_str());
+}
+
+
+bool interesting(asymbol const * sym)
+{
+	if (sym->flags & (BSF_SECTION_SYM | BSF_FILE | BSF_DEBUGGING))
+		return false;
+	if (!sym->section || bfd_is_und_section(sym->section))
+		return false;
+	return sym->name && sym->name[0];
+}
+
+
+bool less_address(asymbol const * lhs, asymbol const * rhs)
+{
+	return bfd_asymbol_value(lhs) < bfd_asymbol_value(rhs);
+}
+
+
+/// read the symbol table, dynamic or not, of abfd
+long read_symtab(bfd * abfd, bool dynamic, scoped_array<asymbol *> & syms)
+{
+	long const size = dynamic
+		? bfd_get_dynamic_symtab_upper_bound(abfd)
+		: bfd_get_symtab_upper_bound(abfd);
+	if (size <= 0)
+		return 0;
+
+	syms.reset(new asymbol *[size]);
+	long const nr_syms = dynamic
+		? bfd_canonicalize_dynamic_symtab(abfd, syms.get())
+		: bfd_canonicalize_symtab(abfd, syms.get());
+	return nr_syms > 0 ? nr_syms : 0;
+}
+
+} // anonymous namespace
+
+
+asection * op_disassembler::state::find_section(bfd_vma vma) const
+{
+	for (asection * sect = abfd->sections; sect; sect = sect->next) {
+		if (!(bfd_get_section_flags(abfd, sect) & SEC_CODE))
+			continue;
+		bfd_vma const start = bfd_get_section_vma(abfd, sect);
+		if (vma >= start && vma < start + bfd_section_size(abfd, sect))
+			return sect;
+	}
+	return 0;
+}
+
+
+size_t op_disassembler::state::find_function(string const & name,
+                                              bfd_vma vma) const
+{
+	// the first symbol whose address is not below vma
+	size_t first = 0;
+	size_t last = syms.size();
+	while (first < last) {
+		size_t const mid = first + (last - first) / 2;
+		if (bfd_asymbol_value(syms[mid]) < vma)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	size_t found = npos;
+	for (size_t i = first; i < syms.size() &&
+	     bfd_asymbol_value(syms[i]) == vma; ++i) {
+		if (!(bfd_get_section_flags(abfd, syms[i]->section) & SEC_CODE))
+			continue;
+		if (name == bfd_asymbol_name(syms[i]))
+			return i;
+		if (found == npos)
+			found = i;
+	}
+
+	return found;
+}
+
+
+asection * op_disassembler::state::function_section(size_t place,
+                                                    bfd_vma vma) const
+{
+	if (place == npos)
+		return find_section(vma);
+	return syms[place]->section;
+}
+
+
+bool op_disassembler::state::load_section(asection * sect)
+{
+	if (sect == section)
+		return true;
+
+	section = 0;
+	contents.resize(bfd_section_size(abfd, sect));
+	if (contents.empty() ||
+	    !bfd_get_section_contents(abfd, sect, &contents[0], 0,
+	                              contents.size()))
+		return false;
+
+	section = sect;
+	info.buffer = &contents[0];
+	info.buffer_vma = bfd_get_section_vma(abfd, sect);
+	info.buffer_length = contents.size();
+	info.section = sect;
+	return true;
+}
+
+
+asymbol const * op_disassembler::state::find_symbol(bfd_vma vma) const
+{
+	// the last symbol whose address is not above vma
+	size_t first = 0;
+	size_t last = syms.size();
+	while (first < last) {
+		size_t const mid = first + (last - first) / 2;
+		if (bfd_asymbol_value(syms[mid]) <= vma)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+	return first ? syms[first - 1] : 0;
+}
+
+
+op_disassembler::op_disassembler(string const & filename)
+	: st(new state)
+{
+	st->abfd = open_bfd(filename);
+	if (!st->abfd)
+		return;
+
+	st->disasm = disassembler(st->abfd);
+	if (!st->disasm)
+		return;
+
+	init_disassemble_info(&st->info, &st->text, text_printf);
+	st->info.arch = bfd_get_arch(st->abfd);
+	st->info.mach = bfd_get_mach(st->abfd);
+	st->info.flavour = bfd_get_flavour(st->abfd);
+	st->info.endian = bfd_big_endian(st->abfd)
+		? BFD_ENDIAN_BIG : BFD_ENDIAN_LITTLE;
+	st->info.print_address_func = print_address;
+	st->info.application_data = st.get();
+	disassemble_init_for_target(&st->info);
+
+	long const nr_syms = read_symtab(st->abfd, false, st->bfd_syms);
+	long const nr_dyn_syms = read_symtab(st->abfd, true, st->dyn_syms);
+
+	for (long i = 0; i < nr_syms; ++i) {
+		if (interesting(st->bfd_syms[i]))
+			st->syms.push_back(st->bfd_syms[i]);
+	}
+	if (!nr_syms) {
+		for (long i = 0; i < nr_dyn_syms; ++i) {
+			if (interesting(st->dyn_syms[i]))
+				st->syms.push_back(st->dyn_syms[i]);
+		}
+	}
+
+	// the foo@plt stubs
+	long const nr_synth = bfd_get_synthetic_symtab(st->abfd,
+		nr_syms, st->bfd_syms.get(), nr_dyn_syms, st->dyn_syms.get(),
+		&st->synth_syms);
+	for (long i = 0; i < nr_synth; ++i)
+		st->syms.push_back(&st->synth_syms[i]);
+
+	stable_sort(st->syms.begin(), st->syms.end(), less_address);
+
+	if (!st->syms.empty()) {
+		st->info.symtab = &st->syms[0];
+		st->info.symtab_size = st->syms.size();
+	}
+}
+
+
+op_disassembler::~op_disassembler()
+{
+}
+
+
+bool op_disassembler::valid() const
+{
+	return st->disasm;
+}
+
+
+string op_disassembler::format() const
+{
+	return bfd_get_target(st->abfd);
+}
+
+
+string op_disassembler::section_name(string const & name, bfd_vma vma) const
+{
+	asection const * sect =
+		st->function_section(st->find_function(name, vma), vma);
+	return sect ? bfd_get_section_name(st->abfd, sect) : string();
+}
+
+
+string op_disassembler::format_vma(bfd_vma vma) const
+{
+	char buf[32];
+	bfd_sprintf_vma(st->abfd, buf, vma);
+	return buf;
+}
+
+
+bool op_disassembler::disassemble(string const & name, bfd_vma start,
+                                  bfd_vma end, insn_handler & handler)
+{
+	size_t const place = st->find_function(name, start);
+	asection * sect = st->function_section(place, start);
+	if (!sect || !st->load_section(sect))
+		return false;
+
+	// as objdump does for the block of instructions following a symbol:
+	// the symbols up to start, from the function one
+	if (place != state::npos) {
+		size_t last = place;
+		while (last < st->syms.size() &&
+		       bfd_asymbol_value(st->syms[last]) <= start)
+			++last;
+		st->info.symbols = &st->syms[place];
+		st->info.num_symbols = last - place;
+		st->info.symtab_pos = place;
+	} else {
+		st->info.symbols = 0;
+		st->info.num_symbols = 0;
+		st->info.symtab_pos = -1;
+	}
+
+	bfd_vma const sect_start = st->info.buffer_vma;
+	bfd_vma const sect_end = sect_start + st->info.buffer_length;
+	end = min(end, sect_end);
+
+	// As objdump does, drop the leading zeros of the addresses by
+	// chunks of 4, keeping at least one, then blank the others.
+	char buf[32];
+	bfd_sprintf_vma(st->abfd, buf, sect_end);
+	size_t skip = 0;
+	while (buf[skip] == '0')
+		++skip;
+	if (buf[skip] == '\0' && sect_start != 0)
+		skip = 0;
+	if (skip)
+		skip = (skip - 1) & ~size_t(3);
+
+	bfd_vma vma = start;
+	while (vma < end) {
+		bfd_sprintf_vma(st->abfd, buf, vma);
+		char * s = buf + skip;
+		for (; *s == '0'; ++s)
+			*s = ' ';
+		if (*s == '\0')
+			*--s = '0';
+
+		st->text.clear();
+		int const size = st->disasm(vma, &st->info);
+		if (size <= 0)
+			break;
+
+		handler.insn(vma, size, buf + skip, st->text);
+		vma += size;
+	}
+
+	return true;
+}
+
+#else // !HAVE_LIBOPCODES
+
+struct op_disassembler::state {
+};
+
+
+op_disassembler::op_disassembler(string const &)
+{
+}
+
+
+op_disassembler::~op_disassembler()
+{
+}
+
+
+bool op_disassembler::valid() const
+{
+	return false;
+}
+
+
+string op_disassembler::format() const
+{
+	return string();
+}
+
+
+string op_disassembler::section_name(string const &, bfd_vma) const
+{
+	return string();
+}
+
+
+string op_disassembler::format_vma(bfd_vma) const
+{
+	return string();
+}
+
+
+bool op_disassembler::disassemble(string const &, bfd_vma, bfd_vma,
+                                  insn_handler &)
+{
+	return false;
+}
+
+#endif // HAVE_LIBOPCODES
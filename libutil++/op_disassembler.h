@@ -0,0 +1,83 @@
+/**
+ * @file op_disassembler.h
+ * Disassemble a binary image in-process with libopcodes
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef OP_DISASSEMBLER_H
+#define OP_DISASSEMBLER_H
+
+#include "config.h"
+
+#include <bfd.h>
+
+#include <string>
+
+#include "utility.h"
+
+/// receive the instructions of op_disassembler::disassemble()
+class insn_handler {
+public:
+	virtual ~insn_handler() {}
+
+	/**
+	 * @param vma  the address of the instruction
+	 * @param size  its size in bytes
+	 * @param address  vma as objdump shows it in front of the instruction
+	 * @param text  the instruction
+	 */
+	virtual void insn(bfd_vma vma, size_t size, std::string const & address,
+	                  std::string const & text) = 0;
+};
+
+
+/**
+ * The disassembler of an image. The instructions are formatted as
+ * objdump -d --no-show-raw-insn formats them, the addresses of their
+ * operands being followed by the nearest symbol. Without libopcodes no
+ * image can be disassembled.
+ */
+class op_disassembler : noncopyable {
+public:
+	/// open the image, see valid()
+	explicit op_disassembler(std::string const & filename);
+
+	~op_disassembler();
+
+	/// false if the image can't be disassembled
+	bool valid() const;
+
+	/// the BFD target name of the image, the objdump "file format"
+	std::string format() const;
+
+	/**
+	 * the name of the code section of the function symbol named name
+	 * at vma, else of the first code section holding vma, empty if none.
+	 * The sections of a relocatable image all start at address 0, only
+	 * the symbol tells which one holds the function.
+	 */
+	std::string section_name(std::string const & name, bfd_vma vma) const;
+
+	/// vma with all its digits, as objdump shows a symbol address
+	std::string format_vma(bfd_vma vma) const;
+
+	/**
+	 * Disassemble the instructions of the function named name from
+	 * start to end, in the section section_name() gives. As objdump
+	 * does, the disassembler is given the function symbol and the
+	 * sorted symbol table, ARM uses them to tell Thumb code from ARM
+	 * code. Return false if start isn't in a code section.
+	 */
+	bool disassemble(std::string const & name, bfd_vma start, bfd_vma end,
+	                 insn_handler & handler);
+
+	/// libopcodes state
+	struct state;
+
+private:
+	scoped_ptr<state> st;
+};
+
+#endif /* !OP_DISASSEMBLER_H */
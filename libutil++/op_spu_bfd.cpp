@@ -46,6 +46,9 @@ op_bfd::op_bfd(uint64_t spu_offset, string const & fname,
 	archive_path(extra_images.get_archive_path()),
 	extra_found_images(extra_images),
 	file_size(-1),
+	cached_syms(false),
+	bfd_syms_loaded(false),
+	lines_cached(false),
 	embedding_filename(fname),
 	anon_obj(false),
 	vma_adj(0)
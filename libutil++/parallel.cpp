@@ -0,0 +1,103 @@
+/**
+ * @file parallel.cpp
+ * Run independent jobs over several threads
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "parallel.h"
+#include "op_exception.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+/// state shared by the threads of a parallel_run()
+struct run_state {
+	run_state(parallel_job & job_, size_t count_)
+		: job(job_), count(count_), next(0), failed(count_) {}
+
+	parallel_job & job;
+	size_t const count;
+	/// next index to hand out
+	size_t next;
+	/// lowest failing index, count if none
+	size_t failed;
+	string message;
+	op_mutex mutex;
+};
+
+
+void record_failure(run_state & state, size_t index, char const * message)
+{
+	op_mutex_lock lock(state.mutex);
+	if (index < state.failed) {
+		state.failed = index;
+		state.message = message;
+	}
+}
+
+
+void * run_jobs(void * arg)
+{
+	run_state & state = *static_cast<run_state *>(arg);
+
+	for (;;) {
+		size_t const index = __sync_fetch_and_add(&state.next, 1);
+		if (index >= state.count)
+			break;
+
+		try {
+			state.job.run(index);
+		} catch (exception const & e) {
+			record_failure(state, index, e.what());
+		} catch (...) {
+			record_failure(state, index, "unknown exception");
+		}
+	}
+
+	return 0;
+}
+
+} // anonymous namespace
+
+
+size_t parallel_threads()
+{
+	long const nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return nr_cpus > 1 ? nr_cpus : 1;
+}
+
+
+void parallel_run(parallel_job & job, size_t count, size_t nr_threads)
+{
+	nr_threads = min(nr_threads, count);
+
+	run_state state(job, count);
+
+	// the calling thread is one of the workers, if a thread can't be
+	// created the others just take more indexes
+	vector<pthread_t> threads;
+	for (size_t i = 1; i < nr_threads; ++i) {
+		pthread_t thread;
+		if (pthread_create(&thread, 0, run_jobs, &state))
+			break;
+		threads.push_back(thread);
+	}
+
+	run_jobs(&state);
+
+	for (size_t i = 0; i < threads.size(); ++i)
+		pthread_join(threads[i], 0);
+
+	if (state.failed != count)
+		throw op_fatal_error(state.message);
+}
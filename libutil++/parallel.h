@@ -0,0 +1,80 @@
+/**
+ * @file parallel.h
+ * Run independent jobs over several threads
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "utility.h"
+
+#include <pthread.h>
+
+#include <cstddef>
+
+/**
+ * Interface of the jobs given to parallel_run(): run() is called once for
+ * each job index, concurrently from several threads.
+ */
+class parallel_job {
+public:
+	virtual ~parallel_job() {}
+
+	/// do the job of the given index
+	virtual void run(size_t index) = 0;
+};
+
+
+/// return the default nr. of threads of parallel_run(), the nr. of
+/// online cpus
+size_t parallel_threads();
+
+
+/**
+ * parallel_run - call job.run(i) for each i in [0, count)
+ * @param job  the job to run
+ * @param count  the nr. of job indexes
+ * @param nr_threads  the maximum nr. of threads to use
+ *
+ * Indexes are handed out in increasing order to up to nr_threads threads,
+ * the calling thread being one of them, and parallel_run() returns when
+ * all are done. No thread is created if nr_threads or count is 1.
+ *
+ * If run() throws for some indexes, the remaining indexes are still run
+ * and the exception message of the lowest failing index is then thrown as
+ * an op_fatal_error.
+ */
+void parallel_run(parallel_job & job, size_t count,
+                  size_t nr_threads = parallel_threads());
+
+
+/// a non recursive mutex
+class op_mutex : noncopyable {
+public:
+	op_mutex() { pthread_mutex_init(&mutex, 0); }
+	~op_mutex() { pthread_mutex_destroy(&mutex); }
+
+	void lock() { pthread_mutex_lock(&mutex); }
+	void unlock() { pthread_mutex_unlock(&mutex); }
+
+private:
+	pthread_mutex_t mutex;
+};
+
+
+/// lock a mutex for the lifetime of the object
+class op_mutex_lock : noncopyable {
+public:
+	explicit op_mutex_lock(op_mutex & mutex_) : mutex(mutex_) {
+		mutex.lock();
+	}
+	~op_mutex_lock() { mutex.unlock(); }
+
+private:
+	op_mutex & mutex;
+};
+
+#endif /* !PARALLEL_H */
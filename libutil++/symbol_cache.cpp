@@ -0,0 +1,345 @@
+/**
+ * @file symbol_cache.cpp
+ * On-disk cache of image symbols and line tables keyed by build-id
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "symbol_cache.h"
+#include "bfd_support.h"
+#include "line_table.h"
+#include "op_bfd.h"
+#include "op_file.h"
+#include "file_manip.h"
+#include "cverb.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+extern verbose vbfd;
+
+namespace {
+
+u32 const cache_magic = 0x4353504f;	/* "OPSC" */
+u32 const cache_version = 1;
+
+/*
+ * A cache file is a header, nr_records fixed size records and a string
+ * table of nr_strings nul terminated strings, all in host byte order.
+ * Every part keeps a 8 bytes alignment so the records can be read in
+ * place from the mapping.
+ */
+struct cache_header {
+	u32 magic;
+	u32 version;
+	u64 mtime;
+	u64 size;
+	u64 nr_records;
+	u64 nr_strings;
+	u64 strings_size;
+};
+
+enum {
+	sym_hidden = 1 << 0,
+	sym_weak = 1 << 1
+};
+
+/// name and section are offsets in the string table, the first string of
+/// which is the separate debug filename
+struct symbol_record {
+	u64 value;
+	u64 section_filepos;
+	u64 section_vma;
+	u64 size;
+	u32 name;
+	u32 section;
+	u32 flags;
+	u32 pad;
+};
+
+/// file indexes the string table
+struct row_record {
+	u64 vma;
+	u32 file;
+	u32 line;
+};
+
+
+string cache_dir()
+{
+	char const * dir = getenv("OPROFILE_CACHE_DIR");
+	return dir ? dir : string();
+}
+
+
+/**
+ * check the layout of a mapped cache file, return its header if it is
+ * valid for an image of the given mtime and size
+ */
+cache_header const * check_file(mapped_file const & file, size_t record_size,
+                                u64 mtime, u64 size)
+{
+	if (!file.valid() || file.size() < sizeof(cache_header))
+		return 0;
+
+	cache_header const * header =
+		reinterpret_cast<cache_header const *>(file.data());
+	if (header->magic != cache_magic ||
+	    header->version != cache_version ||
+	    header->mtime != mtime || header->size != size)
+		return 0;
+
+	size_t const left = file.size() - sizeof(cache_header);
+	if (header->nr_records > left / record_size ||
+	    header->strings_size != left - header->nr_records * record_size)
+		return 0;
+
+	char const * strings = reinterpret_cast<char const *>(file.data()) +
+		file.size() - header->strings_size;
+	if (header->strings_size ?
+	    strings[header->strings_size - 1] != '\0' : header->nr_strings)
+		return 0;
+
+	return header;
+}
+
+
+/// append the nul terminated str to a string table, return its offset
+u32 add_string(string & strings, string const & str)
+{
+	u32 offset = strings.size();
+	strings.append(str.c_str(), str.size() + 1);
+	return offset;
+}
+
+
+/// pad a string table to the record alignment
+void pad_strings(string & strings)
+{
+	strings.append((8 - strings.size() % 8) % 8, '\0');
+}
+
+} // anonymous namespace
+
+
+symbol_cache::symbol_cache(bfd * abfd, struct stat const & st)
+	: mtime(st.st_mtime), size(st.st_size)
+{
+	string const dir = cache_dir();
+	if (dir.empty())
+		return;
+
+	string const build_id = image_build_id(abfd);
+	if (build_id.empty())
+		return;
+
+	path = dir + "/" + build_id;
+}
+
+
+bool symbol_cache::load_symbols(bfd * abfd, vector<op_bfd_symbol> & symbols,
+                                string & debug_filename) const
+{
+	if (!enabled())
+		return false;
+
+	mapped_file file(path + ".syms");
+	cache_header const * header =
+		check_file(file, sizeof(symbol_record), mtime, size);
+	if (!header || !header->nr_strings)
+		return false;
+
+	symbol_record const * records =
+		reinterpret_cast<symbol_record const *>(header + 1);
+	char const * strings = reinterpret_cast<char const *>(file.data()) +
+		file.size() - header->strings_size;
+
+	vector<op_bfd_symbol> result;
+	result.reserve(header->nr_records);
+	for (u64 i = 0; i < header->nr_records; ++i) {
+		symbol_record const & rec = records[i];
+		if (rec.name >= header->strings_size ||
+		    rec.section >= header->strings_size)
+			return false;
+
+		// a section not at the same place means a stale cache file
+		asection const * sect =
+			bfd_get_section_by_name(abfd, strings + rec.section);
+		if (!sect || sect->vma != rec.section_vma)
+			return false;
+
+		result.push_back(op_bfd_symbol(sect, rec.value,
+			rec.section_filepos, rec.size, strings + rec.name,
+			rec.flags & sym_hidden, rec.flags & sym_weak));
+	}
+
+	cverb << vbfd << "read " << result.size() << " symbols from "
+	      << path << ".syms" << endl;
+
+	symbols.swap(result);
+	debug_filename = strings;
+	return true;
+}
+
+
+void symbol_cache::save_symbols(vector<op_bfd_symbol> const & symbols,
+                                string const & debug_filename) const
+{
+	if (!enabled())
+		return;
+
+	vector<symbol_record> records;
+	string strings;
+	add_string(strings, debug_filename);
+
+	vector<op_bfd_symbol>::const_iterator it = symbols.begin();
+	for (; it != symbols.end(); ++it) {
+		symbol_record rec;
+		memset(&rec, 0, sizeof(rec));
+		rec.value = it->value();
+		rec.section_filepos = it->filepos() - it->value();
+		rec.section_vma = it->section()->vma;
+		rec.size = it->size();
+		rec.name = add_string(strings, it->name());
+		rec.section = add_string(strings, it->section()->name);
+		rec.flags = (it->hidden() ? sym_hidden : 0) |
+			(it->weak() ? sym_weak : 0);
+		records.push_back(rec);
+	}
+	pad_strings(strings);
+
+	cache_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = cache_magic;
+	header.version = cache_version;
+	header.mtime = mtime;
+	header.size = size;
+	header.nr_records = records.size();
+	header.nr_strings = symbols.size() * 2 + 1;
+	header.strings_size = strings.size();
+
+	string data(reinterpret_cast<char const *>(&header), sizeof(header));
+	if (!records.empty()) {
+		data.append(reinterpret_cast<char const *>(&records[0]),
+		            records.size() * sizeof(symbol_record));
+	}
+	data += strings;
+
+	save(path + ".syms", data);
+}
+
+
+bool symbol_cache::load_lines(line_table & table) const
+{
+	if (!enabled())
+		return false;
+
+	mapped_file file(path + ".lines");
+	cache_header const * header =
+		check_file(file, sizeof(row_record), mtime, size);
+	if (!header)
+		return false;
+
+	vector<string> filenames;
+	char const * strings = reinterpret_cast<char const *>(file.data()) +
+		file.size() - header->strings_size;
+	char const * end = strings + header->strings_size;
+	for (char const * str = strings; filenames.size() < header->nr_strings;
+	     str += strlen(str) + 1) {
+		if (str >= end)
+			return false;
+		filenames.push_back(str);
+	}
+
+	row_record const * records =
+		reinterpret_cast<row_record const *>(header + 1);
+	vector<line_table::row> rows(header->nr_records);
+	for (u64 i = 0; i < header->nr_records; ++i) {
+		if (records[i].file != line_table::end_sequence &&
+		    records[i].file >= filenames.size())
+			return false;
+		rows[i].vma = records[i].vma;
+		rows[i].file = records[i].file;
+		rows[i].line = records[i].line;
+	}
+
+	cverb << vbfd << "read " << rows.size() << " line table rows from "
+	      << path << ".lines" << endl;
+
+	table.rows.swap(rows);
+	table.filenames.swap(filenames);
+	return true;
+}
+
+
+void symbol_cache::save_lines(line_table const & table) const
+{
+	if (!enabled())
+		return;
+
+	vector<row_record> records(table.rows.size());
+	for (size_t i = 0; i < table.rows.size(); ++i) {
+		records[i].vma = table.rows[i].vma;
+		records[i].file = table.rows[i].file;
+		records[i].line = table.rows[i].line;
+	}
+
+	string strings;
+	for (size_t i = 0; i < table.filenames.size(); ++i)
+		add_string(strings, table.filenames[i]);
+	pad_strings(strings);
+
+	cache_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = cache_magic;
+	header.version = cache_version;
+	header.mtime = mtime;
+	header.size = size;
+	header.nr_records = records.size();
+	header.nr_strings = table.filenames.size();
+	header.strings_size = strings.size();
+
+	string data(reinterpret_cast<char const *>(&header), sizeof(header));
+	if (!records.empty()) {
+		data.append(reinterpret_cast<char const *>(&records[0]),
+		            records.size() * sizeof(row_record));
+	}
+	data += strings;
+
+	save(path + ".lines", data);
+}
+
+
+void symbol_cache::save(string const & filename, string const & data) const
+{
+	if (create_path(filename.c_str())) {
+		cverb << vbfd << "can't create the directory of "
+		      << filename << endl;
+		return;
+	}
+
+	// readers never see a partial file
+	ostringstream tmp;
+	tmp << filename << ".tmp." << getpid();
+
+	ofstream out(tmp.str().c_str(), ios::out | ios::binary);
+	out.write(data.data(), data.size());
+	out.close();
+
+	if (!out || rename(tmp.str().c_str(), filename.c_str())) {
+		cverb << vbfd << "can't write " << filename << endl;
+		unlink(tmp.str().c_str());
+		return;
+	}
+
+	cverb << vbfd << "wrote " << filename << endl;
+}
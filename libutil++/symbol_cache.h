@@ -0,0 +1,83 @@
+/**
+ * @file symbol_cache.h
+ * On-disk cache of image symbols and line tables keyed by build-id
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef SYMBOL_CACHE_H
+#define SYMBOL_CACHE_H
+
+#include "config.h"
+#include "utility.h"
+#include "op_types.h"
+
+#include <bfd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+class op_bfd_symbol;
+class line_table;
+
+/**
+ * The sorted symbols op_bfd extracts from an image and the line table of
+ * its debug info, saved in $OPROFILE_CACHE_DIR under the image build-id. A cache file is valid while the image keeps
+ * the mtime and size it had when the file was written; the files are
+ * mapped and copied out, so the report tools skip symbol canonicalization,
+ * the separate debug file search and the DWARF decoding for images they
+ * already met.
+ */
+class symbol_cache : noncopyable {
+public:
+	/**
+	 * @param abfd the image
+	 * @param st stat of the image
+	 *
+	 * The cache is disabled if the image has no build-id or if
+	 * OPROFILE_CACHE_DIR is unset or empty.
+	 */
+	symbol_cache(bfd * abfd, struct stat const & st);
+
+	/// return false if this image can't be cached
+	bool enabled() const { return !path.empty(); }
+
+	/**
+	 * load_symbols - read the symbols of the image
+	 * @param abfd the image, the sections of the symbols are looked up
+	 *  by name in it
+	 * @param symbols output parameter, sorted and sized symbols
+	 * @param debug_filename output parameter, the separate debug file
+	 *  the symbols were read from, empty if none
+	 *
+	 * Return false if there is no valid cache file for the image.
+	 */
+	bool load_symbols(bfd * abfd, std::vector<op_bfd_symbol> & symbols,
+	                  std::string & debug_filename) const;
+
+	/// write the symbols of the image, errors are not reported
+	void save_symbols(std::vector<op_bfd_symbol> const & symbols,
+	                  std::string const & debug_filename) const;
+
+	/// read the line table of the image, return false on failure
+	bool load_lines(line_table & table) const;
+
+	/// write the line table of the image, errors are not reported
+	void save_lines(line_table const & table) const;
+
+private:
+	/// write a cache file through a temporary file
+	void save(std::string const & filename, std::string const & data) const;
+
+	/// cache filename without suffix, empty if disabled
+	std::string path;
+	/// image mtime
+	u64 mtime;
+	/// image size
+	u64 size;
+};
+
+#endif /* !SYMBOL_CACHE_H */
@@ -0,0 +1,332 @@
+/**
+ * @file elf_symbols_tests.cpp
+ * tests read_elf_symbols() against bfd_canonicalize_symtab()
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <elf.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "elf_symbols.h"
+#include "bfd_support.h"
+#include "op_bfd.h"
+
+using namespace std;
+
+namespace {
+
+struct fixture_symbol {
+	char const * name;
+	unsigned char bind;
+	unsigned char type;
+	/// 1 .text, 2 .data, 0 undefined
+	unsigned short shndx;
+	Elf32_Addr value;
+};
+
+/// symbols of the generated relocatable files, ARM Thumb functions have
+/// the low bit of their address set in the EABI
+fixture_symbol const fixture_symbols[] = {
+	{ "", STB_LOCAL, STT_SECTION, 1, 0 },
+	{ "$a", STB_LOCAL, STT_NOTYPE, 1, 0 },
+	{ "arm_func", STB_GLOBAL, STT_FUNC, 1, 0 },
+	{ "$t", STB_LOCAL, STT_NOTYPE, 1, 0x10 },
+	{ "thumb_func", STB_GLOBAL, STT_FUNC, 1, 0x11 },
+	{ "old_thumb_func", STB_GLOBAL, STT_LOPROC, 1, 0x18 },
+	{ "thumb_ifunc", STB_WEAK, STT_GNU_IFUNC, 1, 0x21 },
+	{ "local_label", STB_LOCAL, STT_NOTYPE, 1, 0x24 },
+	{ "static_func", STB_LOCAL, STT_FUNC, 1, 0x28 },
+	{ "$d", STB_LOCAL, STT_NOTYPE, 1, 0x30 },
+	{ ".Lexception", STB_LOCAL, STT_NOTYPE, 1, 0x34 },
+	{ "data_object", STB_GLOBAL, STT_OBJECT, 2, 0 },
+	{ "undefined_func", STB_GLOBAL, STT_NOTYPE, 0, 0 },
+};
+
+size_t const nr_fixture_symbols =
+	sizeof(fixture_symbols) / sizeof(fixture_symbols[0]);
+
+size_t const text_size = 0x40;
+size_t const data_size = 0x10;
+
+
+bool host_is_big_endian()
+{
+	unsigned int const one = 1;
+	return *reinterpret_cast<unsigned char const *>(&one) == 0;
+}
+
+
+/// append the bytes of a structure to the image
+template <typename T>
+void append(vector<char> & image, T const & t)
+{
+	char const * p = reinterpret_cast<char const *>(&t);
+	image.insert(image.end(), p, p + sizeof(T));
+}
+
+
+/// append a string to a string table, return its offset
+Elf32_Word add_string(vector<char> & strtab, char const * str)
+{
+	if (!*str)
+		return 0;
+	Elf32_Word const offset = strtab.size();
+	strtab.insert(strtab.end(), str, str + strlen(str) + 1);
+	return offset;
+}
+
+
+/**
+ * write a 32 bits ELF relocatable file for machine with a .text and a .data
+ * section and the fixture_symbols, in host byte order
+ */
+bool write_fixture(string const & path, Elf32_Half machine, Elf32_Word flags)
+{
+	enum { sh_null, sh_text, sh_data, sh_symtab, sh_strtab, sh_shstrtab,
+	       nr_sections };
+
+	vector<char> shstrtab(1, '\0');
+	Elf32_Word const names[nr_sections] = {
+		0,
+		add_string(shstrtab, ".text"),
+		add_string(shstrtab, ".data"),
+		add_string(shstrtab, ".symtab"),
+		add_string(shstrtab, ".strtab"),
+		add_string(shstrtab, ".shstrtab"),
+	};
+
+	vector<char> strtab(1, '\0');
+	vector<char> symtab;
+	Elf32_Sym sym;
+	memset(&sym, 0, sizeof(sym));
+	append(symtab, sym);
+	// the ELF local symbols come first
+	Elf32_Word nr_locals = 1;
+	for (int local = 1; local >= 0; --local) {
+		for (size_t i = 0; i < nr_fixture_symbols; ++i) {
+			fixture_symbol const & fsym = fixture_symbols[i];
+			if ((fsym.bind == STB_LOCAL) != bool(local))
+				continue;
+			sym.st_name = add_string(strtab, fsym.name);
+			sym.st_value = fsym.value;
+			sym.st_size = 0;
+			sym.st_info = ELF32_ST_INFO(fsym.bind, fsym.type);
+			sym.st_shndx = fsym.shndx;
+			append(symtab, sym);
+			nr_locals += local;
+		}
+	}
+
+	Elf32_Ehdr ehdr;
+	memset(&ehdr, 0, sizeof(ehdr));
+	memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+	ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+	ehdr.e_ident[EI_DATA] = host_is_big_endian() ? ELFDATA2MSB : ELFDATA2LSB;
+	ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+	ehdr.e_type = ET_REL;
+	ehdr.e_machine = machine;
+	ehdr.e_version = EV_CURRENT;
+	ehdr.e_flags = flags;
+	ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+	ehdr.e_shentsize = sizeof(Elf32_Shdr);
+	ehdr.e_shnum = nr_sections;
+	ehdr.e_shstrndx = sh_shstrtab;
+
+	vector<char> image;
+	append(image, ehdr);
+
+	Elf32_Shdr shdr[nr_sections];
+	memset(shdr, 0, sizeof(shdr));
+	for (size_t i = 0; i < nr_sections; ++i)
+		shdr[i].sh_name = names[i];
+
+	shdr[sh_text].sh_type = SHT_PROGBITS;
+	shdr[sh_text].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+	shdr[sh_text].sh_offset = image.size();
+	shdr[sh_text].sh_size = text_size;
+	shdr[sh_text].sh_addralign = 4;
+	image.resize(image.size() + text_size);
+
+	shdr[sh_data].sh_type = SHT_PROGBITS;
+	shdr[sh_data].sh_flags = SHF_ALLOC | SHF_WRITE;
+	shdr[sh_data].sh_offset = image.size();
+	shdr[sh_data].sh_size = data_size;
+	shdr[sh_data].sh_addralign = 4;
+	image.resize(image.size() + data_size);
+
+	shdr[sh_symtab].sh_type = SHT_SYMTAB;
+	shdr[sh_symtab].sh_offset = image.size();
+	shdr[sh_symtab].sh_size = symtab.size();
+	shdr[sh_symtab].sh_link = sh_strtab;
+	shdr[sh_symtab].sh_info = nr_locals;
+	shdr[sh_symtab].sh_addralign = 4;
+	shdr[sh_symtab].sh_entsize = sizeof(Elf32_Sym);
+	image.insert(image.end(), symtab.begin(), symtab.end());
+
+	shdr[sh_strtab].sh_type = SHT_STRTAB;
+	shdr[sh_strtab].sh_offset = image.size();
+	shdr[sh_strtab].sh_size = strtab.size();
+	shdr[sh_strtab].sh_addralign = 1;
+	image.insert(image.end(), strtab.begin(), strtab.end());
+
+	shdr[sh_shstrtab].sh_type = SHT_STRTAB;
+	shdr[sh_shstrtab].sh_offset = image.size();
+	shdr[sh_shstrtab].sh_size = shstrtab.size();
+	shdr[sh_shstrtab].sh_addralign = 1;
+	image.insert(image.end(), shstrtab.begin(), shstrtab.end());
+
+	image.resize((image.size() + 3) & ~size_t(3));
+	Elf32_Ehdr * header = reinterpret_cast<Elf32_Ehdr *>(&image[0]);
+	header->e_shoff = image.size();
+	for (size_t i = 0; i < nr_sections; ++i)
+		append(image, shdr[i]);
+
+	ofstream out(path.c_str(), ios::binary);
+	out.write(&image[0], image.size());
+	return out.good();
+}
+
+
+string symbol_desc(op_bfd_symbol const & sym)
+{
+	ostringstream os;
+	os << sym.name() << " " << sym.section()->name << "+0x" << hex
+	   << sym.value() << (sym.hidden() ? " hidden" : "")
+	   << (sym.weak() ? " weak" : "");
+	return os.str();
+}
+
+
+/**
+ * compare the symbols read_elf_symbols() reads from path with the
+ * interesting bfd symbols, return the nr. of errors. arch is the expected
+ * bfd architecture of the file, the file is skipped if the bfd can't read
+ * it as such
+ */
+int check_file(string const & path, enum bfd_architecture arch)
+{
+	bfd * abfd = bfd_openr(path.c_str(), NULL);
+	if (!abfd) {
+		cerr << "can't open " << path << endl;
+		return 1;
+	}
+
+	int errors = 0;
+	if (!bfd_check_format(abfd, bfd_object) ||
+	    bfd_get_arch(abfd) != arch) {
+		cout << path << ": skipped, this libbfd has no backend "
+		     "for it" << endl;
+		bfd_close(abfd);
+		return 0;
+	}
+
+	vector<op_bfd_symbol> elf_syms;
+	size_t nr_syms = 0;
+	if (!read_elf_symbols(abfd, elf_syms, nr_syms)) {
+		cerr << path << ": read_elf_symbols() failed" << endl;
+		bfd_close(abfd);
+		return 1;
+	}
+
+	long const size = bfd_get_symtab_upper_bound(abfd);
+	vector<asymbol *> syms(size > 0 ? size / sizeof(asymbol *) : 1);
+	long const symcount = size > 0 ? bfd_canonicalize_symtab(abfd, &syms[0]) : 0;
+	if (nr_syms != size_t(symcount)) {
+		cerr << path << ": " << nr_syms << " symbols counted, bfd has "
+		     << symcount << endl;
+		++errors;
+	}
+
+	vector<op_bfd_symbol> bfd_syms;
+	for (long i = 0; i < symcount; ++i) {
+		if (interesting_symbol(syms[i]))
+			bfd_syms.push_back(op_bfd_symbol(syms[i]));
+	}
+
+	if (elf_syms.size() != bfd_syms.size()) {
+		cerr << path << ": " << elf_syms.size()
+		     << " symbols read, bfd has " << bfd_syms.size() << endl;
+		++errors;
+	}
+
+	for (size_t i = 0; i < min(elf_syms.size(), bfd_syms.size()); ++i) {
+		op_bfd_symbol const & elf_sym = elf_syms[i];
+		op_bfd_symbol const & bfd_sym = bfd_syms[i];
+		if (elf_sym.section() != bfd_sym.section() ||
+		    elf_sym.value() != bfd_sym.value() ||
+		    elf_sym.name() != bfd_sym.name() ||
+		    elf_sym.hidden() != bfd_sym.hidden() ||
+		    elf_sym.weak() != bfd_sym.weak()) {
+			cerr << path << ": symbol " << i << " read as "
+			     << symbol_desc(elf_sym) << ", bfd has "
+			     << symbol_desc(bfd_sym) << endl;
+			++errors;
+		}
+	}
+
+	bfd_close(abfd);
+	return errors;
+}
+
+
+/// this test binary, a linked image of the host
+string self_path()
+{
+	char buf[PATH_MAX];
+	ssize_t const len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+	if (len <= 0)
+		return string();
+	buf[len] = '\0';
+	return buf;
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	bfd_init();
+
+	char dir_template[] = "/tmp/elf_symbols_tests.XXXXXX";
+	char const * dir = mkdtemp(dir_template);
+	if (!dir) {
+		cerr << "can't create a temporary directory" << endl;
+		return EXIT_FAILURE;
+	}
+
+	string const x86_path = string(dir) + "/x86.o";
+	string const arm_path = string(dir) + "/arm.o";
+	bool const written = write_fixture(x86_path, EM_386, 0) &&
+		write_fixture(arm_path, EM_ARM, EF_ARM_EABI_VER5);
+
+	int errors = 0;
+	if (written) {
+		errors += check_file(x86_path, bfd_arch_i386);
+		errors += check_file(arm_path, bfd_arch_arm);
+	} else {
+		cerr << "can't write the fixtures in " << dir << endl;
+		++errors;
+	}
+
+#if defined(__i386__) || defined(__x86_64__)
+	errors += check_file(self_path(), bfd_arch_i386);
+#endif
+
+	unlink(x86_path.c_str());
+	unlink(arm_path.c_str());
+	rmdir(dir);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -11,8 +11,11 @@
 #include <unistd.h>
 #include <stdlib.h>
 
+#include <cstring>
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <list>
 
 #include "file_manip.h"
@@ -228,6 +231,28 @@ void create_file_list_tests()
 }
 
 
+static void mapped_file_tests(char const * prog_name)
+{
+	ifstream in(prog_name, ios::in | ios::binary);
+	ostringstream contents;
+	contents << in.rdbuf();
+	string const expect = contents.str();
+
+	mapped_file file(prog_name);
+	if (!file.valid() || file.size() != expect.size() ||
+	    memcmp(file.data(), expect.data(), expect.size())) {
+		cerr << "mapped_file(" << prog_name << ") fail\n";
+		exit(EXIT_FAILURE);
+	}
+
+	if (mapped_file("non_existing_file").valid() ||
+	    mapped_file(".").valid()) {
+		cerr << "mapped_file() of a non regular file is valid\n";
+		exit(EXIT_FAILURE);
+	}
+}
+
+
 int main(int, char * argv[])
 {
 	dirname_tests();
@@ -237,5 +262,6 @@ int main(int, char * argv[])
 	op_file_readable_tests();
 	realpath_tests();
 	create_file_list_tests();
+	mapped_file_tests(argv[0]);
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,155 @@
+/**
+ * @file file_tree_tests.cpp
+ * tests file_tree.h
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "file_tree.h"
+#include "file_manip.h"
+
+using namespace std;
+
+/// reject the files whose name contains "skip"
+struct skip_filter : file_filter {
+	bool operator()(string const & pathname) const {
+		return pathname.find("skip") == string::npos;
+	}
+};
+
+
+static string base;
+/// created entries, removed in reverse order
+static vector<string> created;
+
+
+static void make_dir(string const & name)
+{
+	string const path = base + "/" + name;
+	if (mkdir(path.c_str(), 0755)) {
+		cerr << "can't create " << path << endl;
+		exit(EXIT_FAILURE);
+	}
+	created.push_back(path);
+}
+
+
+static void make_file(string const & name)
+{
+	string const path = base + "/" + name;
+	int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+	if (fd < 0) {
+		cerr << "can't create " << path << endl;
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+	created.push_back(path);
+}
+
+
+static void make_link(string const & target, string const & name)
+{
+	string const path = base + "/" + name;
+	if (symlink(target.c_str(), path.c_str())) {
+		cerr << "can't create " << path << endl;
+		exit(EXIT_FAILURE);
+	}
+	created.push_back(path);
+}
+
+
+static void cleanup()
+{
+	for (size_t i = created.size(); i-- > 0; ) {
+		if (unlink(created[i].c_str()))
+			rmdir(created[i].c_str());
+	}
+	rmdir(base.c_str());
+}
+
+
+static void walk_tests()
+{
+	make_dir("a");
+	make_dir("a/b");
+	make_dir("a/b/c");
+	make_dir("empty");
+	make_file("top");
+	make_file("a/skip_me");
+	make_file("a/one");
+	make_file("a/b/two");
+	make_file("a/b/c/three");
+	make_file("a/b/c/.hidden");
+	make_link("a/b", "dir_link");
+	make_link("a/one", "file_link");
+	make_link("nowhere", "dangling");
+
+	list<string> expect_list;
+	create_file_list(expect_list, base, "*", true);
+	vector<string> expect;
+	skip_filter const filter;
+	list<string>::const_iterator it;
+	for (it = expect_list.begin(); it != expect_list.end(); ++it) {
+		if (filter(*it))
+			expect.push_back(*it);
+	}
+	sort(expect.begin(), expect.end());
+
+	vector<string> files;
+	size_t const nr_files = walk_file_tree(base, filter, files);
+	sort(files.begin(), files.end());
+
+	if (nr_files != expect_list.size()) {
+		cerr << "walk_file_tree(): " << nr_files << " files found, "
+		     << expect_list.size() << " expected" << endl;
+		cleanup();
+		exit(EXIT_FAILURE);
+	}
+
+	if (files != expect) {
+		cerr << "walk_file_tree(): files differ from create_file_list()"
+		     << endl;
+		for (size_t i = 0; i < files.size(); ++i)
+			cerr << "found: " << files[i] << endl;
+		for (size_t i = 0; i < expect.size(); ++i)
+			cerr << "expected: " << expect[i] << endl;
+		cleanup();
+		exit(EXIT_FAILURE);
+	}
+
+	files.clear();
+	if (walk_file_tree(base + "/none", filter, files) || !files.empty()) {
+		cerr << "walk_file_tree(): files found in a missing directory"
+		     << endl;
+		cleanup();
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+int main()
+{
+	char dir[] = "/tmp/file_tree_tests.XXXXXX";
+	if (!mkdtemp(dir)) {
+		cerr << "can't create a temporary directory" << endl;
+		return EXIT_FAILURE;
+	}
+	base = dir;
+
+	walk_tests();
+
+	cleanup();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file line_table_fixture.cpp
+ * an image built with DWARF 4 line programs for line_table_tests, the
+ * templates instantiated here add rows from many header files
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct word_count {
+	string word;
+	size_t count;
+};
+
+
+bool more_frequent(word_count const & lhs, word_count const & rhs)
+{
+	if (lhs.count != rhs.count)
+		return lhs.count > rhs.count;
+	return lhs.word < rhs.word;
+}
+
+
+map<string, size_t> count_words(istream & in)
+{
+	map<string, size_t> counts;
+	string word;
+	while (in >> word) {
+		transform(word.begin(), word.end(), word.begin(), ::tolower);
+		++counts[word];
+	}
+	return counts;
+}
+
+
+vector<word_count> sort_counts(map<string, size_t> const & counts)
+{
+	vector<word_count> result;
+	map<string, size_t>::const_iterator it;
+	for (it = counts.begin(); it != counts.end(); ++it) {
+		word_count const wc = { it->first, it->second };
+		result.push_back(wc);
+	}
+	stable_sort(result.begin(), result.end(), more_frequent);
+	return result;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char * argv[])
+{
+	ostringstream text;
+	for (int i = 0; i < argc; ++i)
+		text << argv[i] << ' ';
+
+	istringstream in(text.str());
+	vector<word_count> const counts = sort_counts(count_words(in));
+	for (size_t i = 0; i < counts.size(); ++i)
+		cout << counts[i].word << ": " << counts[i].count << '\n';
+
+	return 0;
+}
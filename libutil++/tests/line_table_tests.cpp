@@ -0,0 +1,150 @@
+/**
+ * @file line_table_tests.cpp
+ * tests line_table.h against bfd_find_nearest_line() on line_table_fixture
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <sys/time.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "line_table.h"
+
+using namespace std;
+
+namespace {
+
+double elapsed(timeval const & start)
+{
+	timeval now;
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1e6;
+}
+
+
+/// the line_table_fixture image, next to this test
+string fixture_path()
+{
+	char buf[PATH_MAX];
+	ssize_t const len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+	if (len <= 0)
+		return "line_table_fixture";
+	buf[len] = '\0';
+	string const path = buf;
+	return path.substr(0, path.rfind('/') + 1) + "line_table_fixture";
+}
+
+
+int check_lookups(bfd * abfd)
+{
+	asection * text = bfd_get_section_by_name(abfd, ".text");
+	if (!text) {
+		cerr << "no .text section\n";
+		return EXIT_FAILURE;
+	}
+
+	vector<asymbol *> syms(bfd_get_symtab_upper_bound(abfd) / sizeof(asymbol *) + 1);
+	bfd_canonicalize_symtab(abfd, &syms[0]);
+
+	timeval start;
+	gettimeofday(&start, NULL);
+	line_table table(abfd);
+	double decode_time = elapsed(start);
+
+	if (table.empty()) {
+		cerr << "no line table rows decoded\n";
+		return EXIT_FAILURE;
+	}
+
+	bfd_vma const vma = text->vma;
+	bfd_size_type const size = bfd_section_size(abfd, text);
+
+	gettimeofday(&start, NULL);
+	for (bfd_size_type pc = 0; pc < size; ++pc) {
+		string filename;
+		unsigned int linenr;
+		table.find(vma + pc, filename, linenr);
+	}
+	double table_time = elapsed(start);
+
+	gettimeofday(&start, NULL);
+	for (bfd_size_type pc = 0; pc < size; ++pc) {
+		char const * cfilename;
+		char const * function;
+		unsigned int linenr;
+		bfd_find_nearest_line(abfd, text, &syms[0], pc, &cfilename,
+		                      &function, &linenr);
+	}
+	double bfd_time = elapsed(start);
+
+	// every address of .text, a line is found by both or by none
+	size_t checked = 0;
+	size_t mismatches = 0;
+	for (bfd_size_type pc = 0; pc < size; ++pc) {
+		char const * cfilename = 0;
+		char const * function = 0;
+		unsigned int bfd_linenr = 0;
+		string filename;
+		unsigned int linenr = 0;
+
+		if (!table.find(vma + pc, filename, linenr))
+			linenr = 0;
+		if (!bfd_find_nearest_line(abfd, text, &syms[0], pc, &cfilename,
+		                           &function, &bfd_linenr) ||
+		    !cfilename)
+			bfd_linenr = 0;
+
+		if (!linenr && !bfd_linenr)
+			continue;
+
+		++checked;
+		if (linenr != bfd_linenr || filename != cfilename) {
+			if (mismatches++ < 10) {
+				cerr << "mismatch at 0x" << hex << vma + pc
+				     << dec << ": " << filename << ":"
+				     << linenr << " instead of "
+				     << (bfd_linenr ? cfilename : "")
+				     << ":" << bfd_linenr << endl;
+			}
+		}
+	}
+
+	if (!checked || mismatches) {
+		cerr << mismatches << " mismatches on " << checked
+		     << " lookups\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << table.size() << " rows decoded in " << decode_time << "s, "
+	     << checked << " lookups checked\n";
+	cout << "line_table: " << table_time << "s, bfd_find_nearest_line: "
+	     << bfd_time << "s\n";
+
+	return EXIT_SUCCESS;
+}
+
+} // anonymous namespace
+
+
+int main(int, char * argv[])
+{
+	bfd_init();
+
+	string const fixture = fixture_path();
+	bfd * abfd = bfd_openr(fixture.c_str(), NULL);
+	if (!abfd || !bfd_check_format(abfd, bfd_object)) {
+		cerr << argv[0] << ": can't open " << fixture << endl;
+		return EXIT_FAILURE;
+	}
+
+	int ret = check_lookups(abfd);
+	bfd_close(abfd);
+	return ret;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file op_bfd_cache_tests.cpp
+ * tests op_bfd_cache.h
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <limits.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "op_bfd_cache.h"
+#include "op_bfd.h"
+#include "string_filter.h"
+#include "locate_images.h"
+
+using namespace std;
+
+static string_filter const no_filter;
+static extra_images const extra;
+
+
+static void check(bool cond, char const * what)
+{
+	if (!cond) {
+		cerr << "failed: " << what << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+static void check_counts(op_bfd_cache const & cache, size_t hits,
+                         size_t misses, size_t images, char const * what)
+{
+	if (cache.nr_hits() != hits || cache.nr_misses() != misses ||
+	    cache.nr_images() != images) {
+		cerr << what << ": " << cache.nr_hits() << " hits, "
+		     << cache.nr_misses() << " misses, " << cache.nr_images()
+		     << " images, expected " << hits << ", " << misses
+		     << ", " << images << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+/// this test binary
+static string self_path()
+{
+	char buf[PATH_MAX];
+	ssize_t const len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+	check(len > 0, "readlink /proc/self/exe");
+	buf[len] = '\0';
+	return buf;
+}
+
+
+/// an image name which doesn't exist, its op_bfd is cheap to build
+static string missing_image(size_t i)
+{
+	return string("/nonexistent/op_bfd_cache_tests/image") +
+		char('a' + i);
+}
+
+
+static void test_hit_and_miss()
+{
+	op_bfd_cache cache(no_filter, extra);
+	string const self = self_path();
+
+	bool ok = true;
+	cached_op_bfd first(cache, self, ok);
+	check(ok, "open the test binary");
+	check_counts(cache, 0, 1, 1, "first open");
+
+	ok = true;
+	cached_op_bfd second(cache, self, ok);
+	check(ok, "hit keeps ok");
+	check(&*first == &*second, "hit shares the op_bfd");
+	check(second->get_filename() == self, "hit filename");
+	check_counts(cache, 1, 1, 1, "second open");
+
+	// ok is part of the key, an op_bfd built with ok false opens nothing
+	ok = false;
+	cached_op_bfd unopened(cache, self, ok);
+	check(!ok, "unopened keeps ok false");
+	check(&*unopened != &*first, "unopened is another op_bfd");
+	check_counts(cache, 1, 2, 2, "unopened");
+
+	// the embedded offset is part of the key
+	ok = false;
+	cached_op_bfd spu(cache, 0x1000, self, ok);
+	check(&*spu != &*unopened, "spu offset is another op_bfd");
+	check_counts(cache, 1, 3, 3, "spu offset");
+
+	// a hit gives back the ok value of the op_bfd ctor
+	bool missing_ok = true;
+	{
+		cached_op_bfd missing(cache, missing_image(0), missing_ok);
+	}
+	ok = true;
+	cached_op_bfd missing(cache, missing_image(0), ok);
+	check(ok == missing_ok, "missing image hit keeps ok");
+	check_counts(cache, 2, 4, 4, "missing image");
+}
+
+
+static void test_lru()
+{
+	size_t const max_images = 3;
+	op_bfd_cache cache(no_filter, extra, max_images);
+
+	// release a, b, c in this order: a is the least recently used
+	for (size_t i = 0; i < max_images; ++i) {
+		bool ok = true;
+		cached_op_bfd abfd(cache, missing_image(i), ok);
+	}
+	check_counts(cache, 0, 3, 3, "fill");
+
+	// using a again makes b the least recently used
+	op_bfd const * a;
+	{
+		bool ok = true;
+		cached_op_bfd abfd(cache, missing_image(0), ok);
+		a = &*abfd;
+	}
+	check_counts(cache, 1, 3, 3, "reuse a");
+
+	// d evicts b
+	{
+		bool ok = true;
+		cached_op_bfd abfd(cache, missing_image(3), ok);
+	}
+	check_counts(cache, 1, 4, 3, "add d");
+
+	bool ok = true;
+	cached_op_bfd a_again(cache, missing_image(0), ok);
+	check(&*a_again == a, "a is kept");
+	check_counts(cache, 2, 4, 3, "a kept");
+	{
+		cached_op_bfd c(cache, missing_image(2), ok);
+		cached_op_bfd d(cache, missing_image(3), ok);
+	}
+	check_counts(cache, 4, 4, 3, "c and d kept");
+	// b was evicted, a being referenced the cache now holds 4 op_bfd
+	{
+		cached_op_bfd b(cache, missing_image(1), ok);
+	}
+	check_counts(cache, 4, 5, 4, "b evicted");
+}
+
+
+static void test_referenced()
+{
+	size_t const max_images = 2;
+	op_bfd_cache cache(no_filter, extra, max_images);
+
+	// a referenced entry is not counted against max_images nor evicted
+	bool ok = true;
+	cached_op_bfd held(cache, missing_image(0), ok);
+	op_bfd const * held_bfd = &*held;
+	for (size_t i = 1; i <= 2 * max_images; ++i) {
+		cached_op_bfd abfd(cache, missing_image(i), ok);
+	}
+	check_counts(cache, 0, 1 + 2 * max_images, 1 + max_images,
+	             "referenced and unreferenced");
+
+	cached_op_bfd held_again(cache, missing_image(0), ok);
+	check(&*held_again == held_bfd, "referenced entry kept");
+	check(held_again->get_filename() == missing_image(0),
+	      "referenced entry filename");
+	check_counts(cache, 1, 1 + 2 * max_images, 1 + max_images,
+	             "referenced hit");
+
+	// the oldest unreferenced entries are gone, the newest are kept
+	{
+		cached_op_bfd abfd(cache, missing_image(2 * max_images), ok);
+	}
+	check_counts(cache, 2, 1 + 2 * max_images, 1 + max_images,
+	             "newest kept");
+	{
+		cached_op_bfd abfd(cache, missing_image(1), ok);
+	}
+	check_counts(cache, 2, 2 + 2 * max_images, 1 + max_images,
+	             "oldest evicted");
+}
+
+
+int main()
+{
+	test_hit_and_miss();
+	test_lru();
+	test_referenced();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file parallel_tests.cpp
+ * tests parallel.h
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "parallel.h"
+#include "op_exception.h"
+
+using namespace std;
+
+/// count the calls of each index
+struct count_job : parallel_job {
+	count_job(size_t count) : calls(count) {}
+
+	void run(size_t index) {
+		__sync_fetch_and_add(&calls[index], 1);
+	}
+
+	vector<unsigned int> calls;
+};
+
+
+/// fail for the indexes multiple of 7
+struct failing_job : count_job {
+	failing_job(size_t count) : count_job(count) {}
+
+	void run(size_t index) {
+		count_job::run(index);
+		if (index && index % 7 == 0)
+			throw op_fatal_error(string("failed ") + char('0' + index / 7));
+	}
+};
+
+
+static void check_calls(count_job const & job, char const * what)
+{
+	for (size_t i = 0; i < job.calls.size(); ++i) {
+		if (job.calls[i] != 1) {
+			cerr << what << ": index " << i << " run "
+			     << job.calls[i] << " times\n";
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+
+static void run_tests()
+{
+	size_t const nr_threads[] = { 1, 2, 4, 16 };
+
+	for (size_t i = 0; i < sizeof(nr_threads) / sizeof(nr_threads[0]); ++i) {
+		count_job none(0);
+		parallel_run(none, 0, nr_threads[i]);
+
+		count_job job(1000);
+		parallel_run(job, job.calls.size(), nr_threads[i]);
+		check_calls(job, "parallel_run");
+	}
+}
+
+
+static void exception_tests()
+{
+	size_t const nr_threads[] = { 1, 4 };
+
+	for (size_t i = 0; i < sizeof(nr_threads) / sizeof(nr_threads[0]); ++i) {
+		failing_job job(50);
+		string message;
+		try {
+			parallel_run(job, job.calls.size(), nr_threads[i]);
+		} catch (op_fatal_error const & e) {
+			message = e.what();
+		}
+
+		if (message != "failed 1") {
+			cerr << "parallel_run() with " << nr_threads[i]
+			     << " threads: bad exception \"" << message
+			     << "\"\n";
+			exit(EXIT_FAILURE);
+		}
+
+		check_calls(job, "parallel_run with exceptions");
+	}
+}
+
+
+int main()
+{
+	run_tests();
+	exception_tests();
+	return EXIT_SUCCESS;
+}
@@ -41,6 +41,13 @@ public:
 	T & operator*() const { return *p_; }
 	T * operator->() const { return p_; }
 	T * get() const { return p_; }
+
+	/// give up ownership of the pointee
+	T * release() {
+		T * p = p_;
+		p_ = 0;
+		return p;
+	}
  
 	void swap(scoped_ptr & sp) {
 		T * tmp = sp.p_;
@@ -8,7 +8,8 @@
  * @author Dave Nomura
  */
 
-#include <sstream>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 
 #include "op_xml_out.h"
@@ -16,67 +17,212 @@
 
 using namespace std;
 
-#define MAX_XML_BUF 16384
-static char buf[MAX_XML_BUF];
+namespace {
+
+/// the buffer of a stream writer is flushed past this size
+size_t const flush_size = 64 * 1024;
+
+}
+
 
 string tag_name(tag_t tag)
 {
-	ostringstream out;
-	out << xml_tag_name(tag);
-	return out.str();
+	return xml_tag_name(tag);
 }
 
 
 string open_element(tag_t tag, bool with_attrs)
 {
-	ostringstream out;
-
-	buf[0] = '\0';
-	open_xml_element(tag, with_attrs, buf, MAX_XML_BUF);
-	out << buf;
-	return out.str();
+	string str;
+	xml_writer(str).open_element(tag, with_attrs);
+	return str;
 }
 
 
 string close_element(tag_t tag, bool has_nested)
 {
-	ostringstream out;
-
-	buf[0] = '\0';
-	close_xml_element(tag, has_nested, buf, MAX_XML_BUF);
-	out << buf;
-	return out.str();
+	string str;
+	xml_writer(str).close_element(tag, has_nested);
+	return str;
 }
 
 
 string init_attr(tag_t attr, size_t value)
 {
-	ostringstream out;
-
-	buf[0] = '\0';
-	init_xml_int_attr(attr, value, buf, MAX_XML_BUF);
-	out << buf;
-	return out.str();
+	string str;
+	xml_writer(str).attr(attr, value);
+	return str;
 }
 
 
 string init_attr(tag_t attr, double value)
 {
-	ostringstream out;
-
-	buf[0] = '\0';
-	init_xml_dbl_attr(attr, value, buf, MAX_XML_BUF);
-	out << buf;
-	return out.str();
+	string str;
+	xml_writer(str).attr(attr, value);
+	return str;
 }
 
 
 string init_attr(tag_t attr, string const & str)
 {
-	ostringstream out;
+	string out;
+	xml_writer(out).attr(attr, str);
+	return out;
+}
+
+
+xml_writer::xml_writer(ostream & out_)
+	: out(&out_), buf(own_buf)
+{
+	buf.reserve(flush_size + 4096);
+}
+
+
+xml_writer::xml_writer(string & str)
+	: out(0), buf(str)
+{
+}
+
+
+xml_writer::~xml_writer()
+{
+	flush();
+}
+
+
+void xml_writer::flush()
+{
+	if (!out || buf.empty())
+		return;
+	out->write(buf.data(), buf.size());
+	buf.clear();
+}
+
+
+void xml_writer::check_flush()
+{
+	if (out && buf.size() >= flush_size)
+		flush();
+}
+
+
+void xml_writer::append(char const * str)
+{
+	buf.append(str, strlen(str));
+	check_flush();
+}
+
 
-	buf[0] = '\0';
-	init_xml_str_attr(attr, str.c_str(), buf, MAX_XML_BUF);
-	out << buf;
-	return out.str();
+void xml_writer::append_number(unsigned long long value)
+{
+	char digits[24];
+	char * end = digits + sizeof(digits);
+	char * pos = end;
+	do {
+		*--pos = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	buf.append(pos, end - pos);
+}
+
+
+void xml_writer::open_element(tag_t tag, bool with_attrs)
+{
+	buf += '<';
+	append(xml_tag_name(tag));
+	append(with_attrs ? " " : ">\n");
+}
+
+
+void xml_writer::close_element(tag_t tag, bool has_nested)
+{
+	if (tag == NONE) {
+		append(has_nested ? ">\n" : "/>\n");
+		return;
+	}
+	buf += "</";
+	buf += xml_tag_name(tag);
+	append(">\n");
+}
+
+
+void xml_writer::attr(tag_t attr, size_t value)
+{
+	buf += ' ';
+	buf += xml_tag_name(attr);
+	buf += "=\"";
+	// as the %d of init_xml_int_attr()
+	int const ivalue = value;
+	if (ivalue < 0) {
+		buf += '-';
+		append_number(-static_cast<long long>(ivalue));
+	} else {
+		append_number(ivalue);
+	}
+	append("\"");
+}
+
+
+void xml_writer::attr(tag_t attr, double value)
+{
+	// the longest %.2f is DBL_MAX, 309 digits then ".00"
+	char str[320];
+	snprintf(str, sizeof(str), "%.2f", value);
+
+	buf += ' ';
+	buf += xml_tag_name(attr);
+	buf += "=\"";
+	buf += str;
+	append("\"");
+}
+
+
+void xml_writer::attr(tag_t attr, string const & str)
+{
+	buf += ' ';
+	buf += xml_tag_name(attr);
+	buf += "=\"";
+	for (string::const_iterator it = str.begin(); it != str.end(); ++it) {
+		switch (*it) {
+		case '&':
+			buf += "&amp;";
+			break;
+		case '<':
+			buf += "&lt;";
+			break;
+		case '>':
+			buf += "&gt;";
+			break;
+		case '"':
+			buf += "&quot;";
+			break;
+		default:
+			buf += *it;
+			break;
+		}
+	}
+	append("\"");
+}
+
+
+xml_writer & xml_writer::operator<<(string const & str)
+{
+	buf += str;
+	check_flush();
+	return *this;
+}
+
+
+xml_writer & xml_writer::operator<<(char const * str)
+{
+	append(str);
+	return *this;
+}
+
+
+xml_writer & xml_writer::operator<<(unsigned long long value)
+{
+	append_number(value);
+	check_flush();
+	return *this;
 }
@@ -10,7 +10,12 @@
 
 #ifndef XML_OUTPUT_H
 #define XML_OUTPUT_H
+
+#include <iosfwd>
+#include <string>
+
 #include "op_xml_out.h"
+#include "utility.h"
 
 std::string tag_name(tag_t tag);
 std::string open_element(tag_t tag, bool with_attrs = false);
@@ -19,4 +24,46 @@ std::string init_attr(tag_t attr, size_t value);
 std::string init_attr(tag_t attr, double value);
 std::string init_attr(tag_t attr, std::string const & str);
 
+
+/**
+ * Write XML formatted as by the functions above, straight into a buffer
+ * reused from one element to the next instead of building a string per
+ * element. The buffer is written to the stream when it grows past a few
+ * pages and when the writer is destroyed. A writer built on a string
+ * appends to it instead, for the output which must be held back.
+ */
+class xml_writer : noncopyable {
+public:
+	explicit xml_writer(std::ostream & out);
+	explicit xml_writer(std::string & str);
+
+	/// flush()
+	~xml_writer();
+
+	void open_element(tag_t tag, bool with_attrs = false);
+	void close_element(tag_t tag = NONE, bool has_nested = false);
+	/// written as an int, as init_xml_int_attr() does
+	void attr(tag_t attr, size_t value);
+	void attr(tag_t attr, double value);
+	/// str is quoted
+	void attr(tag_t attr, std::string const & str);
+
+	/// raw text, not quoted
+	xml_writer & operator<<(std::string const & str);
+	xml_writer & operator<<(char const * str);
+	xml_writer & operator<<(unsigned long long value);
+
+	/// write the buffer to the stream, if any
+	void flush();
+
+private:
+	void check_flush();
+	void append(char const * str);
+	void append_number(unsigned long long value);
+
+	std::ostream * out;
+	std::string own_buf;
+	std::string & buf;
+};
+
 #endif /* XML_OUTPUT_H */
@@ -0,0 +1,86 @@
+/**
+ * @file op_arc_hash.c
+ * Growable hash of call-graph arcs keyed on caller and callee ids
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "op_arc_hash.h"
+#include "op_libiberty.h"
+
+#include <stdlib.h>
+
+#define ARC_HASH_MIN_SIZE 256
+
+static size_t arc_slot(struct op_arc_hash const * hash,
+                       unsigned long from_id, unsigned long to_id)
+{
+	unsigned long val = from_id * 0x9e3779b1UL;
+	val ^= to_id + (val >> 16);
+	return val & (hash->size - 1);
+}
+
+
+static void grow(struct op_arc_hash * hash)
+{
+	struct list_head * old_slots = hash->slots;
+	size_t old_size = hash->size;
+	size_t i;
+
+	hash->size = old_size ? old_size * 2 : ARC_HASH_MIN_SIZE;
+	hash->slots = xmalloc(hash->size * sizeof(struct list_head));
+	for (i = 0; i < hash->size; ++i)
+		list_init(&hash->slots[i]);
+
+	for (i = 0; i < old_size; ++i) {
+		struct list_head * pos;
+		struct list_head * pos2;
+		list_for_each_safe(pos, pos2, &old_slots[i]) {
+			struct op_arc * arc =
+				list_entry(pos, struct op_arc, hash);
+			list_add(&arc->hash, &hash->slots[
+			         arc_slot(hash, arc->from_id, arc->to_id)]);
+		}
+	}
+
+	free(old_slots);
+}
+
+
+void op_arc_hash_add(struct op_arc_hash * hash, struct op_arc * arc,
+                     unsigned long from_id, unsigned long to_id)
+{
+	if (hash->nr_arcs >= hash->size)
+		grow(hash);
+
+	arc->from_id = from_id;
+	arc->to_id = to_id;
+	list_add(&arc->hash, &hash->slots[arc_slot(hash, from_id, to_id)]);
+	hash->nr_arcs++;
+}
+
+
+void op_arc_hash_del(struct op_arc_hash * hash, struct op_arc * arc)
+{
+	list_del(&arc->hash);
+	hash->nr_arcs--;
+}
+
+
+struct op_arc * op_arc_hash_find(struct op_arc_hash const * hash,
+                                 unsigned long from_id, unsigned long to_id)
+{
+	struct list_head * pos;
+
+	if (!hash->size)
+		return NULL;
+
+	list_for_each(pos, &hash->slots[arc_slot(hash, from_id, to_id)]) {
+		struct op_arc * arc = list_entry(pos, struct op_arc, hash);
+		if (arc->from_id == from_id && arc->to_id == to_id)
+			return arc;
+	}
+
+	return NULL;
+}
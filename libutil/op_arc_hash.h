@@ -0,0 +1,79 @@
+/**
+ * @file op_arc_hash.h
+ * Growable hash of call-graph arcs keyed on caller and callee ids
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef OP_ARC_HASH_H
+#define OP_ARC_HASH_H
+
+#include "op_list.h"
+
+#include <stddef.h>
+
+/**
+ * An arc between two objects identified by unique, never reused ids. It
+ * is embedded in the owner of the arc, list_entry() gives back the owner
+ * from the op_arc returned by op_arc_hash_find().
+ */
+struct op_arc {
+	/** next in the arc hash slot */
+	struct list_head hash;
+	/** id of the caller */
+	unsigned long from_id;
+	/** id of the callee */
+	unsigned long to_id;
+};
+
+/** the arcs, the nr. of slots is doubled when it is exceeded by nr_arcs */
+struct op_arc_hash {
+	/** slots, NULL until the first arc is added */
+	struct list_head * slots;
+	/** nr. of slots, a power of two */
+	size_t size;
+	/** nr. of arcs in the hash */
+	size_t nr_arcs;
+};
+
+/** an empty arc hash, doing no allocation */
+#define OP_ARC_HASH_INIT { NULL, 0, 0 }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * op_arc_hash_add - add an arc
+ * @param hash the arc hash
+ * @param arc the arc to add, must not be in a hash
+ * @param from_id id of the caller
+ * @param to_id id of the callee
+ */
+void op_arc_hash_add(struct op_arc_hash * hash, struct op_arc * arc,
+                     unsigned long from_id, unsigned long to_id);
+
+/**
+ * op_arc_hash_del - remove an arc
+ * @param hash the arc hash holding arc
+ * @param arc the arc to remove
+ */
+void op_arc_hash_del(struct op_arc_hash * hash, struct op_arc * arc);
+
+/**
+ * op_arc_hash_find - find an arc
+ * @param hash the arc hash
+ * @param from_id id of the caller
+ * @param to_id id of the callee
+ *
+ * Return the arc from from_id to to_id, NULL if there is none.
+ */
+struct op_arc * op_arc_hash_find(struct op_arc_hash const * hash,
+                                 unsigned long from_id, unsigned long to_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !OP_ARC_HASH_H */
@@ -0,0 +1,120 @@
+/**
+ * @file op_stats.c
+ * Per-thread statistics counters summed on read
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "op_stats.h"
+#include "op_libiberty.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void op_stats_register(op_stats_t * stats, unsigned long * block)
+{
+	unsigned int i, nr = stats->nr_blocks;
+
+	for (i = 0; i < nr && i < OP_STATS_MAX_BLOCKS; ++i) {
+		if (stats->blocks[i] == block)
+			return;
+	}
+
+	for (;;) {
+		/* reuse the slot of an unregistered thread */
+		for (i = 0; i < nr && i < OP_STATS_MAX_BLOCKS; ++i) {
+			if (__sync_bool_compare_and_swap(&stats->blocks[i],
+			                                 NULL, block))
+				return;
+		}
+
+		if (nr >= OP_STATS_MAX_BLOCKS) {
+			fprintf(stderr, "Too many threads updating statistics\n");
+			abort();
+		}
+
+		/* take a new slot, it is free once nr_blocks covers it */
+		__sync_bool_compare_and_swap(&stats->nr_blocks, nr, nr + 1);
+		nr = stats->nr_blocks;
+	}
+}
+
+
+void op_stats_unregister(op_stats_t * stats, unsigned long * block,
+                         size_t nr_counters)
+{
+	unsigned int i, nr = stats->nr_blocks;
+	size_t counter;
+
+	for (i = 0; i < nr && i < OP_STATS_MAX_BLOCKS; ++i) {
+		if (stats->blocks[i] == block)
+			break;
+	}
+	if (i == nr || i == OP_STATS_MAX_BLOCKS)
+		return;
+
+	if (!stats->base) {
+		unsigned long * base = xcalloc(nr_counters, sizeof(unsigned long));
+		if (!__sync_bool_compare_and_swap(&stats->base, NULL, base))
+			free(base);
+	}
+
+	/* readers can count block twice until its slot is freed */
+	for (counter = 0; counter < nr_counters; ++counter)
+		__sync_fetch_and_add(&stats->base[counter], block[counter]);
+
+	stats->blocks[i] = NULL;
+}
+
+
+unsigned long op_stats_read(op_stats_t const * stats, size_t counter)
+{
+	unsigned long sum = 0;
+	unsigned int i, nr = stats->nr_blocks;
+
+	for (i = 0; i < nr && i < OP_STATS_MAX_BLOCKS; ++i) {
+		/* NULL for a free slot */
+		unsigned long const * block = stats->blocks[i];
+		if (block)
+			sum += ((unsigned long const volatile *)block)[counter];
+	}
+
+	if (stats->base)
+		sum += ((unsigned long const volatile *)stats->base)[counter];
+
+	return sum;
+}
+
+
+int op_stats_write(char const * filename, struct op_stats_entry const * entries,
+                   size_t nr_entries)
+{
+	char * tmp_name;
+	FILE * fp;
+	size_t i;
+	int err = 0;
+
+	tmp_name = xmalloc(strlen(filename) + 5);
+	strcpy(tmp_name, filename);
+	strcat(tmp_name, ".tmp");
+
+	fp = fopen(tmp_name, "w");
+	if (!fp) {
+		err = errno;
+		goto out;
+	}
+
+	fprintf(fp, "time: %lu\n", (unsigned long)time(NULL));
+	for (i = 0; i < nr_entries; ++i)
+		fprintf(fp, "%s: %lu\n", entries[i].name, entries[i].value);
+
+	if (fclose(fp) || rename(tmp_name, filename))
+		err = errno;
+out:
+	free(tmp_name);
+	return err;
+}
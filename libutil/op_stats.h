@@ -0,0 +1,100 @@
+/**
+ * @file op_stats.h
+ * Per-thread statistics counters summed on read
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#ifndef OP_STATS_H
+#define OP_STATS_H
+
+#include <stddef.h>
+
+/**
+ * Qualifier for the counters array of a statistics set. Each thread
+ * updates its own copy with plain increments, no lock nor shared cache
+ * line is involved; readers sum all the registered copies.
+ */
+#ifdef NDK_BUILD
+/* no TLS support in the NDK toolchain, a single copy is used */
+#define OP_STATS_PER_THREAD
+#else
+#define OP_STATS_PER_THREAD __thread
+#endif
+
+/** maximum nr. of threads registered at the same time to a statistics set */
+#define OP_STATS_MAX_BLOCKS 64
+
+/** the per-thread counters arrays of a statistics set */
+typedef struct {
+	/** registered blocks, NULL for a free slot */
+	unsigned long * volatile blocks[OP_STATS_MAX_BLOCKS];
+	/** nr. of slots ever used in blocks */
+	unsigned int nr_blocks;
+	/** counts of the unregistered threads, NULL until the first one */
+	unsigned long * volatile base;
+} op_stats_t;
+
+/** a statistic exported by op_stats_write() */
+struct op_stats_entry {
+	char const * name;
+	unsigned long value;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * op_stats_register - make the calling thread counters visible to readers
+ * @param stats the statistics set
+ * @param block the calling thread copy of the counters array
+ *
+ * Must be called once by each thread before it updates the counters,
+ * a block registered twice is not summed twice. This never blocks. At
+ * most OP_STATS_MAX_BLOCKS threads can be registered at the same time,
+ * a thread must call op_stats_unregister() before it exits.
+ */
+void op_stats_register(op_stats_t * stats, unsigned long * block);
+
+/**
+ * op_stats_unregister - stop reading the calling thread counters
+ * @param stats the statistics set
+ * @param block the calling thread copy of the counters array
+ * @param nr_counters nr. of counters in block
+ *
+ * The counts of block are added to the totals of stats and its slot is
+ * freed for another thread. Must be called by a registered thread before
+ * it exits, block is not read after this call.
+ */
+void op_stats_unregister(op_stats_t * stats, unsigned long * block,
+                         size_t nr_counters);
+
+/**
+ * op_stats_read - return the sum of a counter over all threads
+ * @param stats the statistics set
+ * @param counter index of the counter in the counters array
+ *
+ * The result is not a snapshot, counters are updated concurrently.
+ */
+unsigned long op_stats_read(op_stats_t const * stats, size_t counter);
+
+/**
+ * op_stats_write - atomically replace a "name: value" statistics file
+ * @param filename the file to write
+ * @param entries the statistics to write
+ * @param nr_entries nr. of entries
+ *
+ * A "time:" line holding the current time in seconds is written first,
+ * readers can use it to compute rates. Return 0 on success, errno on
+ * failure.
+ */
+int op_stats_write(char const * filename, struct op_stats_entry const * entries,
+                   size_t nr_entries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !OP_STATS_H */
@@ -0,0 +1,65 @@
+/**
+ * @file arc_hash_tests.c
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "op_arc_hash.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+/* enough arcs to grow the hash several times */
+#define NR_ARCS 5000
+
+static struct op_arc arcs[NR_ARCS];
+
+static void error(char const * str, size_t i)
+{
+	fprintf(stderr, "%s: arc %lu\n", str, (unsigned long)i);
+	exit(EXIT_FAILURE);
+}
+
+
+int main()
+{
+	struct op_arc_hash hash = OP_ARC_HASH_INIT;
+	size_t i;
+
+	if (op_arc_hash_find(&hash, 1, 2))
+		error("arc found in an empty hash", 0);
+
+	/* callers with many callees and callees with many callers */
+	for (i = 0; i < NR_ARCS; ++i)
+		op_arc_hash_add(&hash, &arcs[i], i % 10, i / 10);
+
+	for (i = 0; i < NR_ARCS; ++i) {
+		if (op_arc_hash_find(&hash, i % 10, i / 10) != &arcs[i])
+			error("arc not found", i);
+	}
+
+	if (op_arc_hash_find(&hash, 10, 0) || op_arc_hash_find(&hash, 0, NR_ARCS))
+		error("missing arc found", 0);
+
+	for (i = 0; i < NR_ARCS; i += 2)
+		op_arc_hash_del(&hash, &arcs[i]);
+
+	for (i = 0; i < NR_ARCS; ++i) {
+		struct op_arc * arc = op_arc_hash_find(&hash, i % 10, i / 10);
+		if (arc != (i % 2 ? &arcs[i] : NULL))
+			error("wrong arc after deletion", i);
+	}
+
+	if (hash.nr_arcs != NR_ARCS / 2)
+		error("wrong nr. of arcs", hash.nr_arcs);
+
+	/* re-key an arc as sfile_find_cg() does for a re-created callee */
+	op_arc_hash_del(&hash, &arcs[1]);
+	op_arc_hash_add(&hash, &arcs[1], 1, NR_ARCS);
+	if (op_arc_hash_find(&hash, 1, 0) ||
+	    op_arc_hash_find(&hash, 1, NR_ARCS) != &arcs[1])
+		error("re-keyed arc", 1);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file stats_tests.c
+ *
+ * @remark Copyright 2013 OProfile authors
+ * @remark Read the file COPYING
+ */
+
+#include "op_stats.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* more threads than OP_STATS_MAX_BLOCKS, never all alive together */
+#define NR_THREADS (4 * OP_STATS_MAX_BLOCKS)
+#define NR_RUNNING 8
+#define NR_INCREMENTS 1000
+
+enum { STAT_A, STAT_B, NR_STATS };
+
+static OP_STATS_PER_THREAD unsigned long stats[NR_STATS];
+static op_stats_t stats_threads;
+
+static void error(char const * str, unsigned long value)
+{
+	fprintf(stderr, "%s: %lu\n", str, value);
+	exit(EXIT_FAILURE);
+}
+
+
+static void * thread_main(void * arg)
+{
+	size_t i;
+
+	(void)arg;
+
+	op_stats_register(&stats_threads, stats);
+	for (i = 0; i < NR_INCREMENTS; ++i) {
+		++stats[STAT_A];
+		stats[STAT_B] += 2;
+	}
+	op_stats_unregister(&stats_threads, stats, NR_STATS);
+
+	return NULL;
+}
+
+
+int main()
+{
+	pthread_t threads[NR_RUNNING];
+	unsigned long expected;
+	size_t i, j;
+
+	op_stats_register(&stats_threads, stats);
+	stats[STAT_A] = 1;
+
+	for (i = 0; i < NR_THREADS; i += NR_RUNNING) {
+		for (j = 0; j < NR_RUNNING; ++j) {
+			if (pthread_create(&threads[j], NULL, thread_main, NULL))
+				error("pthread_create() failed", j);
+		}
+		for (j = 0; j < NR_RUNNING; ++j)
+			pthread_join(threads[j], NULL);
+	}
+
+	if (stats_threads.nr_blocks > NR_RUNNING + 1)
+		error("slots of exited threads not reused",
+		      stats_threads.nr_blocks);
+
+	expected = 1 + NR_THREADS * NR_INCREMENTS;
+	if (op_stats_read(&stats_threads, STAT_A) != expected)
+		error("wrong STAT_A", op_stats_read(&stats_threads, STAT_A));
+
+	expected = 2 * NR_THREADS * NR_INCREMENTS;
+	if (op_stats_read(&stats_threads, STAT_B) != expected)
+		error("wrong STAT_B", op_stats_read(&stats_threads, STAT_B));
+
+	/* the main thread counts are still read from its block */
+	stats[STAT_A] += 1;
+	expected = 2 + NR_THREADS * NR_INCREMENTS;
+	if (op_stats_read(&stats_threads, STAT_A) != expected)
+		error("wrong STAT_A after update",
+		      op_stats_read(&stats_threads, STAT_A));
+
+	return EXIT_SUCCESS;
+}
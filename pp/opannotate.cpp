@@ -25,6 +25,8 @@
 #include "string_manip.h"
 #include "demangle_symbol.h"
 #include "child_reader.h"
+#include "op_disassembler.h"
+#include "parallel.h"
 #include "op_file.h"
 #include "file_manip.h"
 #include "arrange_profiles.h"
@@ -459,6 +461,135 @@ void do_one_output_objdump(symbol_collection const & symbols,
 }
 
 
+/**
+ * Annotate the instructions of a symbol as they are disassembled, each
+ * instruction gets the samples from its address to the next one.
+ */
+class asm_annotator : public insn_handler {
+public:
+	asm_annotator(ostream & out_, symbol_entry const * symbol)
+		: out(out_), vma_adj(symbol->vma_adj),
+		  samp_it(samples->begin(symbol)),
+		  samp_end(samples->end(symbol)) {}
+
+	void insn(bfd_vma vma, size_t size, string const & address,
+	          string const & text);
+
+private:
+	ostream & out;
+	bfd_vma vma_adj;
+	sample_container::samples_iterator samp_it;
+	sample_container::samples_iterator const samp_end;
+};
+
+
+void asm_annotator::insn(bfd_vma vma, size_t size, string const & address,
+                         string const & text)
+{
+	bfd_vma const start = vma - vma_adj;
+
+	// samples before the first instruction are dropped
+	while (samp_it != samp_end && samp_it->second.vma < start)
+		++samp_it;
+
+	bool has_samples = false;
+	count_array_t counts;
+	for (; samp_it != samp_end && samp_it->second.vma < start + size;
+	     ++samp_it) {
+		counts += samp_it->second.counts;
+		has_samples = true;
+	}
+
+	if (has_samples) {
+		out << count_str(counts, samples->samples_count());
+		// For each events
+		for (size_t i = 1; i < nr_events; ++i)
+			out << "  ";
+		out << " :";
+	} else {
+		out << annotation_fill;
+	}
+
+	out << address << ":\t" << text << '\n';
+}
+
+
+bool less_symbol_vma(symbol_entry const * lhs, symbol_entry const * rhs)
+{
+	return lhs->sample.vma < rhs->sample.vma;
+}
+
+
+/**
+ * Disassemble the symbols in-process and output them as objdump does,
+ * return false if we must run objdump instead: libopcodes can't handle
+ * the image or one of its sections, or the source or objdump options are
+ * needed. Nothing is output unless the whole image is disassembled.
+ */
+bool output_disassembled_asm(symbol_collection const & symbols,
+                             string const & app_name)
+{
+	if (source || !objdump_params.empty())
+		return false;
+
+	image_error error;
+	string const image =
+		classes.extra_found_images.find_image_path(app_name, error,
+							   true);
+	if (error != image_ok)
+		return false;
+
+	op_disassembler disasm(image);
+	if (!disasm.valid())
+		return false;
+
+	// objdump order
+	symbol_collection by_vma(symbols);
+	stable_sort(by_vma.begin(), by_vma.end(), less_symbol_vma);
+
+	ostringstream out;
+	out << annotation_fill << '\n'
+	    << annotation_fill << image << ":     file format "
+	    << disasm.format() << '\n'
+	    << annotation_fill << '\n';
+
+	string section;
+	symbol_collection::const_iterator it;
+	for (it = by_vma.begin(); it != by_vma.end(); ++it) {
+		symbol_entry const * symbol = *it;
+		bfd_vma const start = symbol->sample.vma + symbol->vma_adj;
+
+		string const & sym_name = symbol_names.name(symbol->name);
+		string const name = disasm.section_name(sym_name, start);
+		if (name.empty())
+			continue;
+
+		if (name != section) {
+			out << annotation_fill << '\n' << annotation_fill
+			    << "Disassembly of section " << name << ":\n";
+			section = name;
+		}
+
+		out << annotation_fill << '\n'
+		    << disasm.format_vma(start) << " <"
+		    << sym_name << ">:" << symbol_annotation(symbol) << '\n';
+
+		asm_annotator annotator(out, symbol);
+		if (!disasm.disassemble(sym_name, start, start + symbol->size,
+		                        annotator)) {
+			cerr << "warning: could not disassemble "
+			     << symbol_names.demangle(symbol->name)
+			     << " in section " << name << " of " << image
+			     << ", using objdump" << endl;
+			return false;
+		}
+	}
+
+	cout << out.str();
+	return true;
+}
+
+
 void output_objdump_asm(symbol_collection const & symbols,
 			string const & app_name)
 {
@@ -501,11 +632,13 @@ bool output_asm(string const & app_name)
 	if (!symbols.empty()) {
 		sort_options options;
 		options.add_sort_option(sort_options::sample);
-		options.sort(symbols, false, false);
+		options.sort(symbols, false, false, 0,
+		             &samples->sample_counts());
 
 		output_info(cout);
 
-		output_objdump_asm(symbols, app_name);
+		if (!output_disassembled_asm(symbols, app_name))
+			output_objdump_asm(symbols, app_name);
 
 		return true;
 	}
@@ -514,11 +647,21 @@ bool output_asm(string const & app_name)
 }
 
 
-string const source_line_annotation(debug_name_id filename, size_t linenr)
+/// what is needed to annotate a source file
+struct source_file {
+	debug_name_id filename;
+	/// the samples of the lines with samples
+	sample_container::line_counts_t lines;
+	/// the symbols by line nr.
+	symbol_collection symbols;
+	count_array_t total;
+};
+
+
+string const source_line_annotation(count_array_t const & counts)
 {
 	string str;
 
-	count_array_t counts = samples->samples_count(filename, linenr);
 	if (!counts.zero()) {
 		str += count_str(counts, samples->samples_count());
 		for (size_t i = 1; i < nr_events; ++i)
@@ -532,10 +675,8 @@ string const source_line_annotation(debug_name_id filename, size_t linenr)
 }
 
 
-string source_symbol_annotation(debug_name_id filename, size_t linenr)
+string source_symbol_annotation(symbol_collection const & symbols)
 {
-	symbol_collection const symbols = samples->find_symbol(filename, linenr);
-
 	if (symbols.empty())
 		return string();
 
@@ -578,9 +719,13 @@ void output_per_file_info(ostream & out, debug_name_id filename,
 }
 
 
-string const line0_info(debug_name_id filename)
+string const line0_info(source_file const & file)
 {
-	string annotation = source_line_annotation(filename, 0);
+	count_array_t counts;
+	if (!file.lines.empty() && file.lines[0].first == 0)
+		counts = file.lines[0].second;
+
+	string annotation = source_line_annotation(counts);
 	if (trim(annotation, " \t:").empty())
 		return string();
 
@@ -590,23 +735,39 @@ string const line0_info(debug_name_id filename)
 }
 
 
-void do_output_one_file(ostream & out, istream & in, debug_name_id filename,
+void do_output_one_file(ostream & out, istream & in, source_file const & file,
                         bool header)
 {
-	count_array_t count = samples->samples_count(filename);
-
 	if (header) {
-		output_per_file_info(out, filename, count);
-		out << line0_info(filename) << '\n';
+		output_per_file_info(out, file.filename, file.total);
+		out << line0_info(file) << '\n';
 	}
 
 
 	if (in) {
+		// walk the lines with samples and the symbols along the source
+		sample_container::line_counts_t::const_iterator lit =
+			file.lines.begin();
+		symbol_collection::const_iterator sit = file.symbols.begin();
+		symbol_collection line_symbols;
 		string str;
 
 		for (size_t linenr = 1 ; getline(in, str) ; ++linenr) {
-			out << source_line_annotation(filename, linenr) << str
-			    << source_symbol_annotation(filename, linenr)
+			while (lit != file.lines.end() && lit->first < linenr)
+				++lit;
+			count_array_t counts;
+			if (lit != file.lines.end() && lit->first == linenr)
+				counts = lit->second;
+
+			line_symbols.clear();
+			for (; sit != file.symbols.end() &&
+			     (*sit)->sample.file_loc.linenr <= linenr; ++sit) {
+				if ((*sit)->sample.file_loc.linenr == linenr)
+					line_symbols.push_back(*sit);
+			}
+
+			out << source_line_annotation(counts) << str
+			    << source_symbol_annotation(line_symbols)
 			    << '\n';
 		}
 
@@ -615,23 +776,22 @@ void do_output_one_file(ostream & out, istream & in, debug_name_id filename,
 		// symbols belonging to this file. This make more visible the
 		// problem of having less samples for a given file than the
 		// sum of all symbols samples for this file due to inlining
-		symbol_collection const symbols = samples->select_symbols(filename);
-		for (size_t i = 0; i < symbols.size(); ++i)
-			out << symbol_annotation(symbols[i]) << endl;
+		for (size_t i = 0; i < file.symbols.size(); ++i)
+			out << symbol_annotation(file.symbols[i]) << endl;
 	}
 
 	if (!header) {
-		output_per_file_info(out, filename, count);
-		out << line0_info(filename) << '\n';
+		output_per_file_info(out, file.filename, file.total);
+		out << line0_info(file) << '\n';
 	}
 }
 
 
-void output_one_file(istream & in, debug_name_id filename,
-                     string const & source)
+void output_one_file(istream & in, source_file const & file,
+                     string const & source, ostream & err)
 {
 	if (output_dir.empty()) {
-		do_output_one_file(cout, in, filename, true);
+		do_output_one_file(cout, in, file, true);
 		return;
 	}
 
@@ -649,37 +809,37 @@ void output_one_file(istream & in, debug_name_id filename,
 	 */
 	if (out_file.find("/../") != string::npos) {
 		if (in) {
-			cerr << "refusing to create non-canonical filename "
-			     << out_file  << endl;
+			err << "refusing to create non-canonical filename "
+			    << out_file  << endl;
 		}
 		return;
 	} else if (!is_prefix(out_file, output_dir)) {
 		if (in) {
-			cerr << "refusing to create file " << out_file
-			     << " outside of output directory " << output_dir
-			     << endl;
+			err << "refusing to create file " << out_file
+			    << " outside of output directory " << output_dir
+			    << endl;
 		}
 		return;
 	}
 
 	if (is_files_identical(out_file, source)) {
-		cerr << "input and output files are identical: "
-		     << out_file << endl;
+		err << "input and output files are identical: "
+		    << out_file << endl;
 		return;
 	}
 
 	if (create_path(out_file.c_str())) {
-		cerr << "unable to create file: "
-		     << '"' << op_dirname(out_file) << '"' << endl;
+		err << "unable to create file: "
+		    << '"' << op_dirname(out_file) << '"' << endl;
 		return;
 	}
 
 	ofstream out(out_file.c_str());
 	if (!out) {
-		cerr << "unable to open output file "
-		     << '"' << out_file << '"' << endl;
+		err << "unable to open output file "
+		    << '"' << out_file << '"' << endl;
 	} else {
-		do_output_one_file(out, in, filename, false);
+		do_output_one_file(out, in, file, false);
 		output_info(out);
 	}
 }
@@ -726,6 +886,56 @@ string const locate_source_file(debug_name_id filename_id)
 }
 
 
+/// annotate source files, each to its own output file with --output-dir
+class annotate_job : public parallel_job {
+public:
+	annotate_job(vector<source_file> const & files_,
+	             path_filter const & filter_, bool serial_)
+		: files(files_), filter(filter_), serial(serial_),
+		  errors(files_.size()) {}
+
+	void run(size_t index);
+
+	vector<source_file> const & files;
+	path_filter const & filter;
+	/// true if the files are annotated one at a time, in order
+	bool serial;
+	/// the warnings of each file if not serial
+	vector<string> errors;
+};
+
+
+void annotate_job::run(size_t index)
+{
+	source_file const & file = files[index];
+	string const & source = locate_source_file(file.filename);
+
+	if (!filter.match(source))
+		return;
+
+	ostringstream err;
+
+	ifstream in(source.c_str());
+
+	// it is common to have empty filename due to the lack
+	// of debug info (eg _init function) so warn only
+	// if the filename is non empty. The case: no debug
+	// info at all has already been checked.
+	if (!in && source.length()) {
+		err << "opannotate (warning): unable to open for "
+		       "reading: " << source << endl;
+	}
+
+	if (source.length())
+		output_one_file(in, file, source, err);
+
+	if (serial)
+		cerr << err.str();
+	else
+		errors[index] = err.str();
+}
+
+
 void output_source(path_filter const & filter)
 {
 	bool const separate_file = !output_dir.empty();
@@ -736,26 +946,29 @@ void output_source(path_filter const & filter)
 	vector<debug_name_id> filenames =
 		samples->select_filename(options::threshold);
 
-	for (size_t i = 0 ; i < filenames.size() ; ++i) {
-		string const & source = locate_source_file(filenames[i]);
-
-		if (!filter.match(source))
-			continue;
+	// the line counts of all the files in one pass
+	map<debug_name_id, sample_container::line_counts_t> lines;
+	samples->samples_count(lines);
 
-		ifstream in(source.c_str());
+	vector<source_file> files(filenames.size());
+	for (size_t i = 0 ; i < filenames.size() ; ++i) {
+		source_file & file = files[i];
+		file.filename = filenames[i];
+		file.lines.swap(lines[filenames[i]]);
+		file.symbols = samples->select_symbols(filenames[i]);
+
+		sample_container::line_counts_t::const_iterator it;
+		for (it = file.lines.begin(); it != file.lines.end(); ++it)
+			file.total += it->second;
+	}
 
-		// it is common to have empty filename due to the lack
-		// of debug info (eg _init function) so warn only
-		// if the filename is non empty. The case: no debug
-		// info at all has already been checked.
-		if (!in && source.length()) {
-			cerr << "opannotate (warning): unable to open for "
-			     "reading: " << source << endl;
-		}
+	// the files go to cout in order unless they have their own file
+	annotate_job job(files, filter, !separate_file);
+	parallel_run(job, files.size(),
+	             separate_file ? parallel_threads() : 1);
 
-		if (source.length())
-			output_one_file(in, filenames[i], source);
-	}
+	for (size_t i = 0; i < job.errors.size(); ++i)
+		cerr << job.errors[i];
 }
 
 
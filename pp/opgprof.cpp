@@ -10,6 +10,7 @@
  */
 
 #include <iostream>
+#include <vector>
 #include <cstdio>
 
 #include "op_header.h"
@@ -263,6 +264,7 @@ void load_cg(profile_t & cg_db, list<profile_sample_files> const & files)
 	 * call stack) so by using the list of non-cg file we are sure to get
 	 * all existing cg files.
 	 */
+	vector<string> filenames;
 	for (; it != end; ++it) {
 		list<string>::const_iterator cit;
 		list<string>::const_iterator const cend = it->cg_files.end();
@@ -272,9 +274,11 @@ void load_cg(profile_t & cg_db, list<profile_sample_files> const & files)
 			 * data in from/to eip. */
 			cverb << vsfile << "loading cg samples file : " 
 			      << *cit << endl;
-			cg_db.add_sample_file(*cit);
+			filenames.push_back(*cit);
 		}
 	}
+
+	cg_db.add_sample_files(filenames);
 }
 
 
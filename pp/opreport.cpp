@@ -29,9 +29,11 @@
 #include "callgraph_container.h"
 #include "diff_container.h"
 #include "symbol_sort.h"
+#include "symbol_functors.h"
 #include "format_output.h"
 #include "xml_utils.h"
 #include "image_errors.h"
+#include "parallel.h"
 
 using namespace std;
 
@@ -373,7 +375,17 @@ void output_symbols(profile_container const & pc, bool multiple_apps)
 	choice.threshold = options::threshold;
 	symbol_collection symbols = pc.select_symbols(choice);
 	options::sort_by.sort(symbols, options::reverse_sort,
-	                      options::long_filenames);
+	                      options::long_filenames, options::limit,
+	                      &pc.sample_counts());
+
+	if (options::columnar) {
+		format_output::columnar_formatter out(pc);
+		out.set_nr_classes(nr_classes);
+		out.show_details(options::details);
+		out.output(cout, symbols);
+		return;
+	}
+
 	format_output::formatter * out;
 	format_output::xml_formatter * xml_out = 0;
 	format_output::opreport_formatter * text_out = 0;
@@ -413,6 +425,270 @@ void output_symbols(profile_container const & pc, bool multiple_apps)
 }
 
 
+/**
+ * Write the arcs of a --folded report as they come, one
+ * "caller;callee count" line per arc in the folded stacks format of
+ * flame graph tools. A frame is image`symbol, the report has a single
+ * profile class so there is one count per line.
+ */
+class folded_writer : public arc_writer {
+public:
+	folded_writer(ostream & out_) : out(out_) {}
+
+	void write(symbol_entry const & caller, symbol_entry const & callee,
+	           count_array_t const & counts);
+
+private:
+	void write_frame(symbol_entry const & sym);
+
+	ostream & out;
+};
+
+
+void folded_writer::write(symbol_entry const & caller,
+                          symbol_entry const & callee,
+                          count_array_t const & counts)
+{
+	write_frame(caller);
+	out << ';';
+	write_frame(callee);
+	out << ' ' << counts[0] << '\n';
+}
+
+
+void folded_writer::write_frame(symbol_entry const & sym)
+{
+	out << get_image_name(sym.image_name, options::long_filenames
+			? image_name_storage::int_real_filename
+			: image_name_storage::int_real_basename,
+		classes.extra_found_images)
+	    << '`' << symbol_names.demangle(sym.name);
+}
+
+
+/**
+ * The symbols of a --stream report. Images are populated one at a time,
+ * each in its own profile_container which is freed once its symbols are
+ * copied here. Totals only grow, so a symbol under the threshold of the
+ * current totals can never reach it and is dropped. The counts of a
+ * symbol are final once its image is added, so with a limit a symbol
+ * which is not in the limit first ones can't be output either and is
+ * dropped too.
+ */
+class streamed_symbols {
+public:
+	/**
+	 * @param threshold_  the --threshold percentage
+	 * @param limit_  drop the symbols out of the limit_ first, if non
+	 * zero. threshold_ must then be zero: a symbol before the dropped
+	 * ones could fall under the threshold later and let one of them in.
+	 */
+	streamed_symbols(double threshold_, size_t limit_)
+		: threshold(threshold_ / 100.0), limit(limit_),
+		  limit_hints(cf_none), pruned_size(0) {}
+
+	/// add the symbols of a populated image
+	void add(profile_container const & pc);
+
+	/// return the total samples count of the images added so far
+	count_array_t const & samples_count() const { return total; }
+
+	/**
+	 * select the symbols over threshold, ordered as
+	 * profile_container::select_symbols() does
+	 * @param hints  hints filled in
+	 */
+	symbol_collection const select(column_flags & hints) const;
+
+private:
+	/// drop the symbols under the threshold of the current totals and
+	/// the ones out of the limit
+	void prune();
+
+	double const threshold;
+	size_t const limit;
+	/// hints of the symbols dropped because of the limit
+	column_flags limit_hints;
+	count_array_t total;
+	vector<symbol_entry> symbols;
+	/// size of symbols after the last prune()
+	size_t pruned_size;
+};
+
+
+void streamed_symbols::add(profile_container const & pc)
+{
+	total += pc.samples_count();
+
+	profile_container::symbol_choice choice;
+	symbol_collection const image_symbols = pc.select_symbols(choice);
+	for (size_t i = 0; i < image_symbols.size(); ++i)
+		symbols.push_back(*image_symbols[i]);
+
+	// pruning is not cheap, do it only once the symbols doubled
+	if ((threshold > 0 || limit) &&
+	    symbols.size() >= 2 * pruned_size + 1024)
+		prune();
+}
+
+
+void streamed_symbols::prune()
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < symbols.size(); ++i) {
+		if (op_ratio(symbols[i].sample.counts[0], total[0]) >= threshold)
+			symbols[kept++] = symbols[i];
+	}
+	symbols.erase(symbols.begin() + kept, symbols.end());
+
+	if (limit && symbols.size() > limit) {
+		symbol_collection first = select(limit_hints);
+		// as output_streamed_symbols() will
+		options::sort_by.sort(first, options::reverse_sort,
+		                      options::long_filenames, limit);
+
+		vector<symbol_entry> first_symbols;
+		first_symbols.reserve(first.size());
+		for (size_t i = 0; i < first.size(); ++i)
+			first_symbols.push_back(*first[i]);
+		symbols.swap(first_symbols);
+	}
+
+	pruned_size = symbols.size();
+}
+
+
+struct less_symbol_pointer {
+	bool operator()(symbol_entry const * lhs,
+	                symbol_entry const * rhs) const {
+		return less_symbol()(*lhs, *rhs);
+	}
+};
+
+
+symbol_collection const streamed_symbols::select(column_flags & hints) const
+{
+	symbol_collection result;
+
+	hints = column_flags(hints | limit_hints);
+	for (size_t i = 0; i < symbols.size(); ++i) {
+		if (op_ratio(symbols[i].sample.counts[0], total[0]) >= threshold) {
+			result.push_back(&symbols[i]);
+			hints = symbols[i].output_hint(hints);
+		}
+	}
+
+	sort(result.begin(), result.end(), less_symbol_pointer());
+
+	return result;
+}
+
+
+void output_streamed_symbols(list<inverted_profile> & iprofiles,
+                             bool multiple_apps)
+{
+	streamed_symbols streamed(options::threshold,
+		options::threshold > 0 ? 0 : options::limit);
+
+	list<inverted_profile>::iterator it = iprofiles.begin();
+	list<inverted_profile>::iterator const end = iprofiles.end();
+
+	for (; it != end; ++it) {
+		profile_container samples(options::debug_info, false,
+			classes.extra_found_images);
+		populate_for_image(samples, *it, options::symbol_filter, 0);
+		streamed.add(samples);
+	}
+
+	column_flags hints = cf_none;
+	symbol_collection symbols = streamed.select(hints);
+	options::sort_by.sort(symbols, options::reverse_sort,
+	                      options::long_filenames, options::limit);
+
+	format_output::opreport_formatter out(streamed.samples_count(),
+		classes.extra_found_images);
+
+	out.set_nr_classes(nr_classes);
+	out.show_long_filenames(options::long_filenames);
+	out.show_header(options::show_header);
+	out.vma_format_64bit(hints & cf_64bit_vma);
+	out.show_global_percent(options::global_percent);
+
+	format_flags flags = get_format_flags(hints);
+	if (multiple_apps)
+		flags = format_flags(flags | ff_app_name);
+
+	out.add_format(flags);
+	out.output(cout, symbols);
+}
+
+
+/// the image_samples of a batch of images, see populate_diff()
+class image_load_job : public parallel_job, noncopyable {
+public:
+	image_load_job(vector<inverted_profile const *> const & images_)
+		: images(images_), samples(images_.size()) {
+		for (size_t i = 0; i < samples.size(); ++i)
+			samples[i] = new image_samples;
+	}
+
+	~image_load_job() {
+		for (size_t i = 0; i < samples.size(); ++i)
+			delete samples[i];
+	}
+
+	void run(size_t index) {
+		samples[index]->load(*images[index]);
+	}
+
+	vector<inverted_profile const *> const & images;
+	vector<image_samples *> samples;
+};
+
+
+/**
+ * Populate the containers of the two profiles of a differential report.
+ * The sample files of a batch of images of both profiles are read in
+ * parallel, then the images are populated in turn, all the images of
+ * pc1 first: the names and the debug information are not thread safe,
+ * and are so created in the same order whatever the nr. of threads.
+ */
+void populate_diff(profile_container & pc1,
+                   list<inverted_profile> const & iprofiles1,
+                   profile_container & pc2,
+                   list<inverted_profile> const & iprofiles2)
+{
+	vector<inverted_profile const *> images;
+	vector<profile_container *> containers;
+
+	list<inverted_profile>::const_iterator it;
+	for (it = iprofiles1.begin(); it != iprofiles1.end(); ++it) {
+		images.push_back(&*it);
+		containers.push_back(&pc1);
+	}
+	for (it = iprofiles2.begin(); it != iprofiles2.end(); ++it) {
+		images.push_back(&*it);
+		containers.push_back(&pc2);
+	}
+
+	// bound the nr. of images whose samples are held at once
+	size_t const batch_size = 64;
+	for (size_t first = 0; first < images.size(); first += batch_size) {
+		size_t const last = min(first + batch_size, images.size());
+		vector<inverted_profile const *> const batch(
+			images.begin() + first, images.begin() + last);
+
+		image_load_job job(batch);
+		parallel_run(job, batch.size());
+
+		for (size_t i = 0; i < batch.size(); ++i) {
+			populate_for_image(*containers[first + i], *batch[i],
+				options::symbol_filter, 0, job.samples[i]);
+		}
+	}
+}
+
+
 void output_diff_symbols(profile_container const & pc1,
                          profile_container const & pc2, bool multiple_apps)
 {
@@ -440,7 +716,7 @@ void output_diff_symbols(profile_container const & pc1,
 	out.add_format(flags);
 
 	options::sort_by.sort(symbols, options::reverse_sort,
-	                      options::long_filenames);
+	                      options::long_filenames, options::limit);
 
 	out.output(cout, symbols);
 }
@@ -453,7 +729,7 @@ void output_cg_symbols(callgraph_container const & cg, bool multiple_apps)
 	symbol_collection symbols = cg.get_symbols();
 
 	options::sort_by.sort(symbols, options::reverse_sort,
-	                      options::long_filenames);
+	                      options::long_filenames, options::limit);
 
 	format_output::formatter * out;
 	format_output::xml_cg_formatter * xml_out = 0;
@@ -533,31 +809,25 @@ int opreport(options::spec const & spec)
 				multiple_apps |= true;
 		}
 
-		profile_container pc1(options::debug_info, options::details,
-				      classes.extra_found_images);
-
-		list<inverted_profile>::iterator it = iprofiles.begin();
-		list<inverted_profile>::iterator const end = iprofiles.end();
-
-		for (; it != end; ++it)
-			populate_for_image(pc1, *it,
-					   options::symbol_filter, 0);
-
 		list<inverted_profile> iprofiles2 = invert_profiles(classes2);
 
 		report_image_errors(iprofiles2, classes2.extra_found_images);
 
+		profile_container pc1(options::debug_info, options::details,
+				      classes.extra_found_images);
 		profile_container pc2(options::debug_info, options::details,
 				      classes2.extra_found_images);
 
-		list<inverted_profile>::iterator it2 = iprofiles2.begin();
-		list<inverted_profile>::iterator const end2 = iprofiles2.end();
-
-		for (; it2 != end2; ++it2)
-			populate_for_image(pc2, *it2,
-					   options::symbol_filter, 0);
+		populate_diff(pc1, iprofiles, pc2, iprofiles2);
 
 		output_diff_symbols(pc1, pc2, multiple_apps);
+	} else if (options::folded) {
+		callgraph_container cg_container;
+		folded_writer writer(cout);
+		cg_container.populate(iprofiles, classes.extra_found_images,
+			options::debug_info, options::threshold,
+			options::merge_by.lib, options::symbol_filter, &writer);
+		cout.flush();
 	} else if (options::callgraph) {
 		callgraph_container cg_container;
 		cg_container.populate(iprofiles, classes.extra_found_images,
@@ -565,6 +835,8 @@ int opreport(options::spec const & spec)
 			options::merge_by.lib, options::symbol_filter);
 
 		output_cg_symbols(cg_container, multiple_apps);
+	} else if (options::stream) {
+		output_streamed_symbols(iprofiles, multiple_apps);
 	} else {
 		profile_container samples(options::debug_info,
 			options::details, classes.extra_found_images);
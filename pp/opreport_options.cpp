@@ -50,6 +50,10 @@ namespace options {
 	bool global_percent;
 	bool xml;
 	string xml_options;
+	bool stream;
+	bool folded;
+	bool columnar;
+	size_t limit;
 }
 
 
@@ -61,6 +65,8 @@ vector<string> sort;
 vector<string> exclude_symbols;
 vector<string> include_symbols;
 string demangle_option = "normal";
+string format_option = "text";
+int limit_opt;
 
 popt::option options_array[] = {
 	popt::option(options::callgraph, "callgraph", 'c',
@@ -88,6 +94,8 @@ popt::option options_array[] = {
 	popt::option(options::threshold_opt, "threshold", 't',
 		     "minimum percentage needed to produce output",
 		     "percent"),
+	popt::option(limit_opt, "limit", '\0',
+		     "output at most the given number of symbols", "nr"),
 
 	popt::option(demangle_option, "demangle", 'D',
 		     "demangle GNU C++ symbol names (default normal)",
@@ -109,6 +117,12 @@ popt::option options_array[] = {
 
 	popt::option(options::xml, "xml", 'X',
 		     "XML output"),
+	popt::option(options::stream, "stream", '\0',
+		     "populate and drop one image at a time to bound memory use"),
+	popt::option(options::folded, "folded", '\0',
+		     "write the call graph arcs as folded stacks"),
+	popt::option(format_option, "format", '\0',
+		     "output format (default text)", "text|columnar"),
 
 };
 
@@ -143,6 +157,28 @@ void handle_sort_option()
 }
 
 
+void handle_format_option()
+{
+	if (format_option == "columnar") {
+		options::columnar = true;
+	} else if (format_option != "text") {
+		cerr << "unknown output format " << format_option << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+void handle_limit_option()
+{
+	if (limit_opt < 0) {
+		cerr << "illegal limit value: " << limit_opt << endl;
+		exit(EXIT_FAILURE);
+	}
+
+	options::limit = limit_opt;
+}
+
+
 void handle_output_file()
 {
 	if (outfile.empty())
@@ -166,6 +202,36 @@ void check_options(bool diff)
 
 	bool do_exit = false;
 
+	if (folded) {
+		if (xml) {
+			cerr << "--folded is incompatible with --xml" << endl;
+			do_exit = true;
+		}
+
+		// the arcs only, a header would break the format
+		callgraph = true;
+		show_header = false;
+	}
+
+	if (columnar) {
+		if (xml || callgraph || stream || diff) {
+			cerr << "--format=columnar is incompatible with --xml, "
+			     "--callgraph, --folded, --stream and differential "
+			     "profiles" << endl;
+			do_exit = true;
+		}
+
+		// the symbols only, a header would break the format
+		symbols = true;
+		show_header = false;
+	}
+
+	if (limit && (xml || folded)) {
+		cerr << "--limit is incompatible with --xml and --folded"
+		     << endl;
+		do_exit = true;
+	}
+
 	if (callgraph) {
 		symbols = true;
 		if (details) {
@@ -197,6 +263,21 @@ void check_options(bool diff)
 		do_exit = true;
 	}
 
+	if (stream) {
+		if (details || xml || callgraph || diff) {
+			cerr << "--stream is incompatible with --details, "
+			     "--xml, --callgraph and differential profiles"
+			     << endl;
+			do_exit = true;
+		}
+
+		if (!symbols) {
+			cerr << "--stream is meaningless without --symbols"
+			     << endl;
+			do_exit = true;
+		}
+	}
+
 	if (!symbols) {
 		if (diff) {
 			cerr << "different profiles are meaningless "
@@ -210,6 +291,12 @@ void check_options(bool diff)
 			do_exit = true;
 		}
 
+		if (limit) {
+			cerr << "--limit is meaningless without --symbols"
+			     << endl;
+			do_exit = true;
+		}
+
 		if (debug_info || accumulated) {
 			cerr << "--debug-info and --accumulated are "
 			     << "meaningless without --symbols" << endl;
@@ -314,6 +401,8 @@ void handle_options(options::spec const & spec)
 	handle_sort_option();
 	merge_by = handle_merge_option(mergespec, true, exclude_dependent);
 	handle_output_file();
+	handle_format_option();
+	handle_limit_option();
 	demangle = handle_demangle_option(demangle_option);
 	check_options(spec.first.size());
 
@@ -321,6 +410,15 @@ void handle_options(options::spec const & spec)
 
 	if (!spec.first.size()) {
 		process_spec(classes, spec.common);
+
+		// flame graph tools read one count per line
+		if (folded && classes.v.size() > 1) {
+			cerr << "--folded needs a single profile class, "
+			     "there are " << classes.v.size() << ": restrict "
+			     "the profile specification or merge them with "
+			     "--merge" << endl;
+			exit(EXIT_FAILURE);
+		}
 	} else {
 		if (options::xml) {
 			cerr << "differential profiles are incompatible with --xml" << endl;
@@ -41,6 +41,10 @@ namespace options {
 	extern bool accumulated;
 	extern bool xml;
 	extern std::string xml_options;
+	extern bool stream;
+	extern bool folded;
+	extern bool columnar;
+	extern size_t limit;
 }
 
 /// All the chosen sample files.